@@ -2,8 +2,130 @@
  * Copyright (c) 2024 Marvell.
  */
 
+#include <errno.h>
+
+#include <rte_ip.h>
+#include <rte_udp.h>
+
 #include "l2_node.h"
 
+bool l2_ethdev_sw_uso[RTE_MAX_ETHPORTS];
+
+/* Copy bytes of a possibly chained mbuf to a flat buffer */
+static __rte_always_inline int
+l2_ethdev_uso_copy(struct rte_mbuf *m, uint32_t off, uint32_t len, char *buf)
+{
+	const void *p = rte_pktmbuf_read(m, off, len, buf);
+
+	if (unlikely(!p))
+		return -EINVAL;
+	if (p != buf)
+		rte_memcpy(buf, p, len);
+	return 0;
+}
+
+/* Split a UDP GSO packet into datagrams of tso_segsz payload each */
+static uint16_t
+l2_ethdev_uso_segment(struct rte_mbuf *m, struct rte_mbuf **segs, uint16_t max_segs)
+{
+	uint32_t hdr_len = m->l2_len + m->l3_len + m->l4_len;
+	uint64_t ol_flags = m->ol_flags & ~RTE_MBUF_F_TX_UDP_SEG;
+	uint32_t off, plen, seg_sz = m->tso_segsz;
+	struct rte_ipv4_hdr *ip4;
+	struct rte_ipv6_hdr *ip6;
+	struct rte_udp_hdr *udp;
+	uint16_t nb_segs = 0;
+	struct rte_mbuf *seg;
+	char *data;
+
+	if (unlikely(!seg_sz || m->pkt_len <= hdr_len))
+		return 0;
+
+	for (off = hdr_len; off < m->pkt_len; off += plen) {
+		plen = RTE_MIN(seg_sz, m->pkt_len - off);
+		if (unlikely(nb_segs == max_segs))
+			goto free;
+
+		seg = rte_pktmbuf_alloc(m->pool);
+		if (unlikely(!seg))
+			goto free;
+		segs[nb_segs++] = seg;
+
+		data = rte_pktmbuf_append(seg, hdr_len + plen);
+		if (unlikely(!data))
+			goto free;
+		if (l2_ethdev_uso_copy(m, 0, hdr_len, data) ||
+		    l2_ethdev_uso_copy(m, off, plen, data + hdr_len))
+			goto free;
+
+		seg->ol_flags = ol_flags;
+		seg->tx_offload = m->tx_offload;
+		seg->tso_segsz = 0;
+
+		udp = (struct rte_udp_hdr *)(data + m->l2_len + m->l3_len);
+		udp->dgram_len = rte_cpu_to_be_16(m->l4_len + plen);
+		if (ol_flags & RTE_MBUF_F_TX_IPV4) {
+			ip4 = (struct rte_ipv4_hdr *)(data + m->l2_len);
+			ip4->total_length = rte_cpu_to_be_16(m->l3_len + m->l4_len + plen);
+			ip4->packet_id =
+				rte_cpu_to_be_16(rte_be_to_cpu_16(ip4->packet_id) + nb_segs - 1);
+			ip4->hdr_checksum = 0;
+			if (!(ol_flags & RTE_MBUF_F_TX_IP_CKSUM))
+				ip4->hdr_checksum = rte_ipv4_cksum(ip4);
+			udp->dgram_cksum = rte_ipv4_phdr_cksum(ip4, ol_flags);
+		} else {
+			ip6 = (struct rte_ipv6_hdr *)(data + m->l2_len);
+			ip6->payload_len = rte_cpu_to_be_16(m->l4_len + plen);
+			udp->dgram_cksum = rte_ipv6_phdr_cksum(ip6, ol_flags);
+		}
+	}
+
+	return nb_segs;
+free:
+	rte_pktmbuf_free_bulk(segs, nb_segs);
+	return 0;
+}
+
+/* Send a group of packets segmenting UDP GSO packets on the way */
+static __rte_noinline void
+l2_ethdev_tx_sw_uso(struct rte_graph *graph, struct rte_node *node, uint16_t port,
+		    uint16_t queue, void **objs, uint16_t nb_pkts)
+{
+	struct rte_mbuf *segs[L2_ETHDEV_USO_SEGS_MAX];
+	uint16_t count, nb_segs, i, j;
+	struct rte_mbuf *mbuf;
+
+	for (i = 0, j = 0; i < nb_pkts; i++) {
+		mbuf = (struct rte_mbuf *)objs[i];
+		if (likely(!(mbuf->ol_flags & RTE_MBUF_F_TX_UDP_SEG)))
+			continue;
+
+		/* Flush packets preceding the GSO packet to keep order */
+		if (i != j) {
+			count = rte_eth_tx_burst(port, queue, (struct rte_mbuf **)&objs[j], i - j);
+			if (count != i - j)
+				rte_node_enqueue(graph, node, 0, &objs[j + count], i - j - count);
+		}
+		j = i + 1;
+
+		nb_segs = l2_ethdev_uso_segment(mbuf, segs, RTE_DIM(segs));
+		if (unlikely(!nb_segs)) {
+			rte_node_enqueue_x1(graph, node, 0, mbuf);
+			continue;
+		}
+		count = rte_eth_tx_burst(port, queue, segs, nb_segs);
+		if (count != nb_segs)
+			rte_pktmbuf_free_bulk(&segs[count], nb_segs - count);
+		rte_pktmbuf_free(mbuf);
+	}
+
+	if (i != j) {
+		count = rte_eth_tx_burst(port, queue, (struct rte_mbuf **)&objs[j], i - j);
+		if (count != i - j)
+			rte_node_enqueue(graph, node, 0, &objs[j + count], i - j - count);
+	}
+}
+
 static uint16_t
 l2_ethdev_tx_node_process(struct rte_graph *graph, struct rte_node *node, void **objs,
 			  uint16_t nb_objs)
@@ -21,6 +143,11 @@ l2_ethdev_tx_node_process(struct rte_graph *graph, struct rte_node *node, void *
 		mbuf = (struct rte_mbuf *)objs[i];
 		queue = l2_mbuf_tx_priv1(mbuf)->tx_queue;
 		nb_pkts = l2_mbuf_tx_priv1(mbuf)->nb_pkts;
+		if (unlikely(l2_ethdev_sw_uso[port])) {
+			l2_ethdev_tx_sw_uso(graph, node, port, queue, &objs[i], nb_pkts);
+			i += nb_pkts;
+			continue;
+		}
 		count = rte_eth_tx_burst(port, queue, (struct rte_mbuf **)&objs[i], nb_pkts);
 		/* Redirect unsent pkts to drop node */
 		if (count != nb_pkts)
@@ -64,6 +64,11 @@ struct l2_mbuf_tx_priv1 {
 #define L2_VIRTIO_RX_Q_MAX       64
 #define L2_VIRTIO_RX_BURST_MAX   128
 
+#define L2_ETHDEV_USO_SEGS_MAX 64
+
+/* Ports needing UDP segmentation in software, set on virtio feature negotiation */
+extern bool l2_ethdev_sw_uso[RTE_MAX_ETHPORTS];
+
 /**
  * Get mbuf_priv1 pointer from rte_mbuf.
  *
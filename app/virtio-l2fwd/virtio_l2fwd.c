@@ -56,6 +56,7 @@
 
 #define MAX_ETHDEV_RX_PER_LCORE 128
 #define MAX_VIRTIO_RX_PER_LCORE 128
+#define MAX_DMA_STRIPES         4
 
 #define MAX_LCORE_PARAMS 1024
 
@@ -63,6 +64,11 @@
 
 #define MAX_DMA_VCHANS 4
 
+/* Minimum queue pairs of a virtio device managed by a service lcore */
+#define SERVICE_SHARD_QP_MIN 4
+
+#define SERVICE_DRAIN_TIMEOUT_MS 1000
+
 #define APP_INFO(fmt, args...) RTE_LOG(INFO, VIRTIO_L2FWD, fmt, ##args)
 
 #define APP_INFO_NH(fmt, args...) rte_log(RTE_LOG_INFO, RTE_LOGTYPE_VIRTIO_L2FWD, fmt, ##args)
@@ -87,11 +93,19 @@ struct lcore_virtio_rx {
 	struct l2_virtio_tx_node_ctx *virtio_tx;
 };
 
+/* Range of virtio queue pairs managed by a service lcore */
+struct lcore_virtio_shard {
+	uint16_t qp_start;
+	uint16_t nb_qps;
+};
+
 /* Lcore conf */
 struct lcore_conf {
 	/* Fast path accessed */
 	uint64_t netdev_map;
-	uint16_t netdev_qp_count[DAO_VIRTIO_DEV_MAX];
+	/* Devices whose queue pairs are being handed over to another service lcore */
+	uint64_t drain_map;
+	struct lcore_virtio_shard netdev_shard[DAO_VIRTIO_DEV_MAX];
 
 	uint16_t nb_virtio_rx;
 	struct lcore_virtio_rx virtio_rx[MAX_VIRTIO_RX_PER_LCORE];
@@ -100,8 +114,8 @@ struct lcore_conf {
 	uint32_t weight;
 
 	bool service_lcore;
-	int dev2mem_id;
-	int mem2dev_id;
+	int16_t dev2mem_ids[MAX_DMA_STRIPES];
+	int16_t mem2dev_ids[MAX_DMA_STRIPES];
 	int nb_vchans;
 	struct rte_graph *graph;
 	char name[RTE_GRAPH_NAMESIZE];
@@ -162,6 +176,13 @@ static uint16_t dev2mem_cnt;
 static uint16_t mem2dev_cnt;
 static int wrkr_dma_devs;
 static uint16_t dma_flush_thr;
+static bool dma_adaptive;
+static uint32_t dma_dbell_deadline_us;
+static uint16_t nb_dma_stripes = 1;
+static struct dao_virtio_netdev_intr_coalesce intr_coalesce;
+static bool virtio_event_idx;
+static uint16_t nb_service_lcores = 1;
+static uint16_t desc_throttle;
 static uint32_t pktmbuf_count = 128 * 1024;
 
 static bool override_dma_vfid;
@@ -325,7 +346,7 @@ check_virtio_config(void)
 	nb_lcores += 1;
 
 	/* 2 dma devices for control */
-	wrkr_dma_devs = 2 + (nb_lcores * 2);
+	wrkr_dma_devs = 2 + (nb_lcores * 2 * nb_dma_stripes);
 	if (nb_dma_devs < wrkr_dma_devs) {
 		APP_INFO("%u DMA devices not enough, need at least %u for %u lcores,"
 			 " 1 ctrl thread, 1 service core\n",
@@ -333,6 +354,12 @@ check_virtio_config(void)
 		return -1;
 	}
 
+	if (wrkr_dma_devs / 2 > (int)RTE_DIM(dev2mem_ids)) {
+		APP_INFO("%u DMA devices per direction exceed max %u\n", wrkr_dma_devs / 2,
+			 (uint32_t)RTE_DIM(dev2mem_ids));
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -419,7 +446,13 @@ print_usage(const char *prgname)
 		" [--per-port-pool]"
 		" [--disable-tx-mseg]"
 		" [--num-pkt-cap]"
-		" [--enable-l4-csum]\n\n"
+		" [--enable-l4-csum]"
+		" [--dma-adaptive DEADLINE_US]"
+		" [--dma-stripe NUM]"
+		" [--intr-coalesce PKTS,USECS|adaptive]"
+		" [--event-idx]"
+		" [--service-lcores NUM]"
+		" [--desc-throttle NUM]\n\n"
 
 		"  -p PORTMASK_L[,PORTMASK_H]: Hexadecimal bitmask of ports to configure\n"
 		"  -v VIRTIOMASK_L[,VIRTIOMASK_H]: Hexadecimal bitmask of virtio to configure\n"
@@ -442,10 +475,45 @@ print_usage(const char *prgname)
 		"  --pcap-enable: Enables pcap capture\n"
 		"  --pcap-num-cap NUMPKT: Number of packets to capture\n"
 		"  --pcap-file-name NAME: Pcap file name\n"
-		"  --enable-l4-csum: Enable IPv4 L4 checksum offload capability\n\n",
+		"  --enable-l4-csum: Enable IPv4 L4 checksum offload capability\n"
+		"  --dma-adaptive DEADLINE_US: Adapt DMA flush threshold and doorbells to load,\n"
+		"           deferring a doorbell by at most DEADLINE_US\n"
+		"  --dma-stripe NUM: Stripe virtio queues of an lcore over NUM DMA devices per\n"
+		"           direction. Default is 1\n"
+		"  --intr-coalesce PKTS,USECS|adaptive: Hold virtio Host Rx interrupts till PKTS\n"
+		"           buffers are used or USECS elapse, or tune them to packet rate\n"
+		"  --event-idx: Offer virtio event index for packed virtqueues\n"
+		"  --service-lcores NUM: Number of lcores sharing virtio descriptor management.\n"
+		"           Default is 1\n"
+		"  --desc-throttle NUM: Fetch at most NUM virtio descriptors ahead of workers\n"
+		"           per queue. Default is 0, fetch all available descriptors\n\n",
 		prgname);
 }
 
+static int
+parse_intr_coalesce(const char *q_arg, struct dao_virtio_netdev_intr_coalesce *conf)
+{
+	unsigned long max_pkts, usecs;
+	char *end = NULL;
+
+	memset(conf, 0, sizeof(*conf));
+	if (!strcmp(q_arg, "adaptive")) {
+		conf->adaptive = true;
+		return 0;
+	}
+
+	max_pkts = strtoul(q_arg, &end, 0);
+	if (end == NULL || *end != ',' || max_pkts > UINT16_MAX)
+		return -1;
+	usecs = strtoul(end + 1, &end, 0);
+	if (end == NULL || *end != '\0' || usecs > UINT16_MAX)
+		return -1;
+
+	conf->max_pkts = max_pkts;
+	conf->usecs = usecs;
+	return 0;
+}
+
 static uint64_t
 parse_num_pkt_cap(const char *num_pkt_cap)
 {
@@ -692,6 +760,12 @@ static const char short_options[] = "p:" /* portmask */
 #define CMD_LINE_OPT_NUM_PKT_CAP   "pcap-num-cap"
 #define CMD_LINE_OPT_PCAP_FILENAME "pcap-file-name"
 #define CMD_LINE_OPT_ENA_L4_CSUM   "enable-l4-csum"
+#define CMD_LINE_OPT_DMA_ADAPTIVE  "dma-adaptive"
+#define CMD_LINE_OPT_DMA_STRIPE    "dma-stripe"
+#define CMD_LINE_OPT_INTR_COALESCE "intr-coalesce"
+#define CMD_LINE_OPT_EVENT_IDX     "event-idx"
+#define CMD_LINE_OPT_SERVICE_LCORES "service-lcores"
+#define CMD_LINE_OPT_DESC_THROTTLE "desc-throttle"
 enum {
 	/* Long options mapped to a short option */
 
@@ -710,6 +784,12 @@ enum {
 	CMD_LINE_OPT_PARSE_NUM_PKT_CAP,
 	CMD_LINE_OPT_PCAP_FILENAME_CAP,
 	CMD_LINE_OPT_PARSE_ENA_L4_CSUM,
+	CMD_LINE_OPT_PARSE_DMA_ADAPTIVE,
+	CMD_LINE_OPT_PARSE_DMA_STRIPE,
+	CMD_LINE_OPT_PARSE_INTR_COALESCE,
+	CMD_LINE_OPT_PARSE_EVENT_IDX,
+	CMD_LINE_OPT_PARSE_SERVICE_LCORES,
+	CMD_LINE_OPT_PARSE_DESC_THROTTLE,
 };
 
 static const struct option lgopts[] = {
@@ -724,6 +804,12 @@ static const struct option lgopts[] = {
 	{CMD_LINE_OPT_NUM_PKT_CAP, 1, 0, CMD_LINE_OPT_PARSE_NUM_PKT_CAP},
 	{CMD_LINE_OPT_PCAP_FILENAME, 1, 0, CMD_LINE_OPT_PCAP_FILENAME_CAP},
 	{CMD_LINE_OPT_ENA_L4_CSUM, 0, 0, CMD_LINE_OPT_PARSE_ENA_L4_CSUM},
+	{CMD_LINE_OPT_DMA_ADAPTIVE, 1, 0, CMD_LINE_OPT_PARSE_DMA_ADAPTIVE},
+	{CMD_LINE_OPT_DMA_STRIPE, 1, 0, CMD_LINE_OPT_PARSE_DMA_STRIPE},
+	{CMD_LINE_OPT_INTR_COALESCE, 1, 0, CMD_LINE_OPT_PARSE_INTR_COALESCE},
+	{CMD_LINE_OPT_EVENT_IDX, 0, 0, CMD_LINE_OPT_PARSE_EVENT_IDX},
+	{CMD_LINE_OPT_SERVICE_LCORES, 1, 0, CMD_LINE_OPT_PARSE_SERVICE_LCORES},
+	{CMD_LINE_OPT_DESC_THROTTLE, 1, 0, CMD_LINE_OPT_PARSE_DESC_THROTTLE},
 	{NULL, 0, 0, 0},
 };
 
@@ -734,11 +820,13 @@ parse_args(int argc, char **argv)
 	uint16_t portid, virtio_devid, j;
 	uint64_t virtio_mask_dflt = 0;
 	uint64_t eth_mask_dflt = 0;
-	uint16_t service_lcore = 0;
+	uint64_t service_mask = 0;
 	char *prgname = argv[0];
+	uint16_t nb_fp_lcores;
 	char *str, *saveptr;
 	int option_index;
 	char **argvopt;
+	uint64_t val;
 	uint8_t lcore;
 	int opt, rc;
 	int i;
@@ -754,53 +842,6 @@ parse_args(int argc, char **argv)
 		virtio_map[virtio_devid].id = virtio_devid;
 	}
 
-	/* Setup lcore mask of ethdev and virtio dev to default
-	 * One for service lcore, one for main lcore and rest divided
-	 * among ethdev and virtio.
-	 */
-	for (lcore = 0; lcore < RTE_MAX_LCORE; lcore++) {
-		if (!rte_lcore_is_enabled(lcore) || (lcore == rte_get_main_lcore()))
-			continue;
-
-		service_lcore = lcore;
-		break;
-	}
-
-	j = 0;
-	lcore = 0;
-	for (; lcore < RTE_MAX_LCORE; lcore++) {
-		if (j == (rte_lcore_count() - 2) / 2)
-			break;
-		if (!rte_lcore_is_enabled(lcore) || (lcore == rte_get_main_lcore()) ||
-		    lcore == service_lcore)
-			continue;
-
-		eth_mask_dflt |= RTE_BIT64(lcore);
-		j++;
-	}
-
-	j = 0;
-	for (; lcore < RTE_MAX_LCORE; lcore++) {
-		if (j == (rte_lcore_count() - 2) / 2)
-			break;
-		if (!rte_lcore_is_enabled(lcore) || (lcore == rte_get_main_lcore()) ||
-		    lcore == service_lcore)
-			continue;
-
-		virtio_mask_dflt |= RTE_BIT64(lcore);
-		j++;
-	}
-
-	if (!eth_mask_dflt || !virtio_mask_dflt) {
-		APP_ERR("At least 4 cores are required, please increase the cores\n");
-		return -1;
-	}
-
-	for (i = 0; i < RTE_MAX_ETHPORTS; i++)
-		lcore_eth_mask[i] = eth_mask_dflt;
-	for (i = 0; i < DAO_VIRTIO_DEV_MAX; i++)
-		lcore_virtio_mask[i] = virtio_mask_dflt;
-
 	argvopt = argv;
 
 	/* Error or normal output strings. */
@@ -936,12 +977,119 @@ parse_args(int argc, char **argv)
 			enable_l4_csum = true;
 			break;
 
+		case CMD_LINE_OPT_PARSE_DMA_ADAPTIVE:
+			dma_adaptive = true;
+			dma_dbell_deadline_us = parse_uint(optarg);
+			APP_INFO("DMA adaptive flush enabled, deadline %uus\n", dma_dbell_deadline_us);
+			break;
+
+		case CMD_LINE_OPT_PARSE_DMA_STRIPE:
+			val = parse_uint(optarg);
+			if (val < 1 || val > MAX_DMA_STRIPES) {
+				APP_ERR("Invalid number of DMA stripes\n");
+				print_usage(prgname);
+				return -1;
+			}
+			nb_dma_stripes = val;
+			break;
+
+		case CMD_LINE_OPT_PARSE_INTR_COALESCE:
+			if (parse_intr_coalesce(optarg, &intr_coalesce)) {
+				APP_ERR("Invalid interrupt coalescing config\n");
+				print_usage(prgname);
+				return -1;
+			}
+			break;
+
+		case CMD_LINE_OPT_PARSE_EVENT_IDX:
+			APP_INFO("Virtio event index is enabled\n");
+			virtio_event_idx = true;
+			break;
+
+		case CMD_LINE_OPT_PARSE_SERVICE_LCORES:
+			val = parse_uint(optarg);
+			if (val < 1 || val > RTE_MAX_LCORE) {
+				APP_ERR("Invalid number of service lcores\n");
+				print_usage(prgname);
+				return -1;
+			}
+			nb_service_lcores = val;
+			break;
+
+		case CMD_LINE_OPT_PARSE_DESC_THROTTLE:
+			val = parse_uint(optarg);
+			if (val > UINT16_MAX ||
+			    (val && val < DAO_VIRTIO_NETDEV_DESC_THROTTLE_MIN)) {
+				APP_ERR("Invalid descriptor fetch throttle window\n");
+				print_usage(prgname);
+				return -1;
+			}
+			desc_throttle = val;
+			break;
+
 		default:
 			print_usage(prgname);
 			return -1;
 		}
 	}
 
+	/* Setup lcore mask of ethdev and virtio dev to default
+	 * Service lcores, one for main lcore and rest divided
+	 * among ethdev and virtio.
+	 */
+	j = 0;
+	for (lcore = 0; lcore < RTE_MAX_LCORE; lcore++) {
+		if (j == nb_service_lcores)
+			break;
+		if (!rte_lcore_is_enabled(lcore) || (lcore == rte_get_main_lcore()))
+			continue;
+
+		service_mask |= RTE_BIT64(lcore);
+		j++;
+	}
+
+	nb_fp_lcores = (rte_lcore_count() - 1 - j) / 2;
+	j = 0;
+	lcore = 0;
+	for (; lcore < RTE_MAX_LCORE; lcore++) {
+		if (j == nb_fp_lcores)
+			break;
+		if (!rte_lcore_is_enabled(lcore) || (lcore == rte_get_main_lcore()) ||
+		    (service_mask & RTE_BIT64(lcore)))
+			continue;
+
+		eth_mask_dflt |= RTE_BIT64(lcore);
+		j++;
+	}
+
+	j = 0;
+	for (; lcore < RTE_MAX_LCORE; lcore++) {
+		if (j == nb_fp_lcores)
+			break;
+		if (!rte_lcore_is_enabled(lcore) || (lcore == rte_get_main_lcore()) ||
+		    (service_mask & RTE_BIT64(lcore)))
+			continue;
+
+		virtio_mask_dflt |= RTE_BIT64(lcore);
+		j++;
+	}
+
+	if (!eth_mask_dflt || !virtio_mask_dflt) {
+		APP_ERR("At least %u cores are required, please increase the cores\n",
+			nb_service_lcores + 3);
+		return -1;
+	}
+
+	/* Lcore mapping given in command line takes precedence */
+	for (i = 0; i < RTE_MAX_ETHPORTS; i++) {
+		if (!lcore_eth_mask[i])
+			lcore_eth_mask[i] = eth_mask_dflt;
+	}
+	for (i = 0; i < DAO_VIRTIO_DEV_MAX; i++) {
+		if (!lcore_virtio_mask[i])
+			lcore_virtio_mask[i] = virtio_mask_dflt;
+	}
+
 	if (optind >= 0)
 		argv[optind - 1] = prgname;
 	rc = optind - 1;
@@ -1091,6 +1239,41 @@ signal_handler(int signum)
 
 static struct dao_dma_stats prev_stats[RTE_MAX_LCORE];
 
+static uint16_t
+dma_lat_hist_pct(uint64_t *hist, uint16_t nb_buckets, uint16_t pct)
+{
+	uint64_t total = 0, sum = 0;
+	uint16_t i;
+
+	for (i = 0; i < nb_buckets; i++)
+		total += hist[i];
+
+	for (i = 0; i < nb_buckets; i++) {
+		sum += hist[i];
+		if (sum * 100 >= total * pct)
+			break;
+	}
+	return i;
+}
+
+static void
+print_vchan_dma_lat_stats(uint16_t lcore_id, bool dev2mem, uint16_t vchan)
+{
+	struct dao_dma_vchan_lat_stats lat;
+
+	if (dao_dma_lat_stats_get(lcore_id, dev2mem, vchan, &lat))
+		return;
+
+	/* Histogram buckets are log2, print upper bound of percentile bucket */
+	APP_INFO("lcore %2u.....%s[%u]: lat p50 <2^%u p99 <2^%u cycles, depth p99 <2^%u, "
+		 "ptrs/dbell p50 <2^%u\n",
+		 lcore_id, dev2mem ? "dev2mem" : "mem2dev", vchan,
+		 dma_lat_hist_pct(lat.lat, DAO_DMA_LAT_HIST_SZ, 50),
+		 dma_lat_hist_pct(lat.lat, DAO_DMA_LAT_HIST_SZ, 99),
+		 dma_lat_hist_pct(lat.depth, DAO_DMA_DEPTH_HIST_SZ, 99),
+		 dma_lat_hist_pct(lat.dbell_ptrs, DAO_DMA_DBELL_PTRS_HIST_SZ, 50));
+}
+
 static void
 print_lcore_dma_stats(uint16_t lcore_id)
 {
@@ -1106,11 +1289,14 @@ print_lcore_dma_stats(uint16_t lcore_id)
 		diff.ptrs = curr->ptrs - prev->ptrs;
 		diff.dbells = curr->dbells - prev->dbells;
 		diff.enq_errs = curr->enq_errs - prev->enq_errs;
+		diff.cpu_ops = curr->cpu_ops - prev->cpu_ops;
 		if (curr->ops)
 			APP_INFO(
-				"lcore %2u.....dev2mem[%u]: %2lu ptrs/op, %2lu ops/dbell %lu err\n",
+				"lcore %2u.....dev2mem[%u]: %2lu ptrs/op, %2lu ops/dbell %lu err %lu cpu\n",
 				lcore_id, i, diff.ptrs / diff.ops, diff.ops / diff.dbells,
-				diff.enq_errs);
+				diff.enq_errs, diff.cpu_ops);
+		if (curr->ops && dao_dma_has_lat_stats_feature())
+			print_vchan_dma_lat_stats(lcore_id, true, i);
 	}
 	for (i = 0; i < stats.nb_mem2dev; i++) {
 		curr = &stats.mem2dev[i];
@@ -1119,11 +1305,14 @@ print_lcore_dma_stats(uint16_t lcore_id)
 		diff.ptrs = curr->ptrs - prev->ptrs;
 		diff.dbells = curr->dbells - prev->dbells;
 		diff.enq_errs = curr->enq_errs - prev->enq_errs;
+		diff.cpu_ops = curr->cpu_ops - prev->cpu_ops;
 		if (curr->ops)
 			APP_INFO(
-				"lcore %2u.....mem2dev[%u]: %2lu ptrs/op, %2lu ops/dbell %lu err\n",
+				"lcore %2u.....mem2dev[%u]: %2lu ptrs/op, %2lu ops/dbell %lu err %lu cpu\n",
 				lcore_id, i, diff.ptrs / diff.ops, diff.ops / diff.dbells,
-				diff.enq_errs);
+				diff.enq_errs, diff.cpu_ops);
+		if (curr->ops && dao_dma_has_lat_stats_feature())
+			print_vchan_dma_lat_stats(lcore_id, false, i);
 	}
 	prev_stats[lcore_id] = stats;
 }
@@ -1154,7 +1343,7 @@ print_stats(void)
 }
 
 static __rte_always_inline uint16_t
-l2_virtio_desc_process(uint64_t netdev_map, uint16_t *netdev_qp_count)
+l2_virtio_desc_process(uint64_t netdev_map, struct lcore_virtio_shard *netdev_shard)
 {
 	uint16_t dev_id = 0;
 
@@ -1164,18 +1353,65 @@ l2_virtio_desc_process(uint64_t netdev_map, uint16_t *netdev_qp_count)
 			dev_id++;
 			continue;
 		}
-		dao_virtio_net_desc_manage(dev_id, netdev_qp_count[dev_id]);
+		dao_virtio_net_desc_manage_qps(dev_id, netdev_shard[dev_id].qp_start,
+					       netdev_shard[dev_id].nb_qps);
 		netdev_map >>= 1;
 		dev_id++;
 	}
 	return 0;
 }
 
+static __rte_noinline void
+l2_virtio_desc_drain(struct lcore_conf *qconf, uint64_t drain_map)
+{
+	struct lcore_virtio_shard *shard;
+	uint16_t dev_id;
+
+	while (drain_map) {
+		dev_id = rte_ctz64(drain_map);
+		drain_map &= ~RTE_BIT64(dev_id);
+
+		/* Complete DMA in flight on this lcore before queues move to another lcore */
+		shard = &qconf->netdev_shard[dev_id];
+		if (!dao_virtio_net_desc_manage_quiesce(dev_id, shard->qp_start, shard->nb_qps))
+			__atomic_fetch_and(&qconf->drain_map, ~RTE_BIT64(dev_id), __ATOMIC_RELEASE);
+	}
+}
+
+static int
+lcore_dma_setup(struct lcore_conf *qconf, bool autofree)
+{
+	int rc, i, j;
+
+	/* Queues of lcore are striped over its DMA devices by queue id */
+	if (nb_dma_stripes > 1) {
+		rc = dao_dma_lcore_dev2mem_stripe_set(qconf->dev2mem_ids, nb_dma_stripes,
+						      qconf->nb_vchans, dma_flush_thr);
+		rc |= dao_dma_lcore_mem2dev_stripe_set(qconf->mem2dev_ids, nb_dma_stripes,
+						       qconf->nb_vchans, dma_flush_thr);
+	} else {
+		rc = dao_dma_lcore_dev2mem_set(qconf->dev2mem_ids[0], qconf->nb_vchans,
+					       dma_flush_thr);
+		rc |= dao_dma_lcore_mem2dev_set(qconf->mem2dev_ids[0], qconf->nb_vchans,
+						dma_flush_thr);
+	}
+
+	for (j = 0; autofree && j < nb_dma_stripes; j++)
+		for (i = 0; i < qconf->nb_vchans; i++)
+			rc |= dao_dma_lcore_mem2dev_autofree_set(qconf->mem2dev_ids[j], i,
+								 virtio_netdev_autofree);
+	if (dma_adaptive)
+		rc |= dao_dma_lcore_flush_adaptive_set(true, dma_dbell_deadline_us);
+
+	return rc;
+}
+
 static int
 service_main_loop(void *conf)
 {
 	struct rte_rcu_qsbr *qs_v;
 	struct lcore_conf *qconf;
+	uint64_t drain_map;
 	uint32_t lcore_id;
 	int rc;
 
@@ -1186,8 +1422,7 @@ service_main_loop(void *conf)
 	qs_v = qconf->qs_v;
 
 	/* Set per lcore DMA device id */
-	rc = dao_dma_lcore_dev2mem_set(qconf->dev2mem_id, qconf->nb_vchans, dma_flush_thr);
-	rc |= dao_dma_lcore_mem2dev_set(qconf->mem2dev_id, qconf->nb_vchans, dma_flush_thr);
+	rc = lcore_dma_setup(qconf, false);
 	if (rc) {
 		APP_ERR("Error in setting DMA device on lcore\n");
 		return -1;
@@ -1201,7 +1436,13 @@ service_main_loop(void *conf)
 
 	while (likely(!force_quit)) {
 		/* Process virtio descriptors */
-		l2_virtio_desc_process(qconf->netdev_map, qconf->netdev_qp_count);
+		l2_virtio_desc_process(__atomic_load_n(&qconf->netdev_map, __ATOMIC_ACQUIRE),
+				       qconf->netdev_shard);
+
+		/* Quiesce queues being handed over to another service lcore */
+		drain_map = __atomic_load_n(&qconf->drain_map, __ATOMIC_ACQUIRE);
+		if (unlikely(drain_map))
+			l2_virtio_desc_drain(qconf, drain_map);
 
 		/* Flush and submit DMA ops */
 		dao_dma_flush_submit();
@@ -1222,7 +1463,7 @@ graph_main_loop(void *conf)
 	struct lcore_conf *qconf;
 	struct rte_graph *graph;
 	uint32_t lcore_id;
-	int rc, i;
+	int rc;
 
 	RTE_SET_USED(conf);
 
@@ -1237,12 +1478,7 @@ graph_main_loop(void *conf)
 	}
 
 	/* Set per lcore DMA device id */
-	rc = dao_dma_lcore_dev2mem_set(qconf->dev2mem_id, qconf->nb_vchans, dma_flush_thr);
-	rc |= dao_dma_lcore_mem2dev_set(qconf->mem2dev_id, qconf->nb_vchans, dma_flush_thr);
-	for (i = 0; i < qconf->nb_vchans; i++)
-		rc |= dao_dma_lcore_mem2dev_autofree_set(qconf->mem2dev_id, i,
-							 virtio_netdev_autofree);
-
+	rc = lcore_dma_setup(qconf, true);
 	if (rc) {
 		APP_ERR("Error in setting DMA device on lcore\n");
 		return -1;
@@ -1324,7 +1560,19 @@ dump_lcore_info(void)
 			continue;
 
 		if (qconf->service_lcore) {
-			APP_INFO("\tService lcore %u\n", lcore_id);
+			APP_INFO("\tService lcore %u ... ", lcore_id);
+			map = qconf->netdev_map;
+			q_id = 0;
+			while (map) {
+				if (map & 0x1)
+					APP_INFO_NH("virtio_qp=%d,%d-%d ", q_id,
+						    qconf->netdev_shard[q_id].qp_start,
+						    qconf->netdev_shard[q_id].qp_start +
+							    qconf->netdev_shard[q_id].nb_qps - 1);
+				q_id++;
+				map = map >> 1;
+			}
+			APP_INFO_NH("\n");
 			continue;
 		}
 
@@ -1420,7 +1668,7 @@ ethdev_reset(uint16_t portid)
 }
 
 static void
-clear_lcore_queue_mapping(uint16_t virtio_devid)
+clear_lcore_queue_mapping(uint16_t virtio_devid, bool drain)
 {
 	struct l2_virtio_rx_node_ctx *virtio_rx;
 	struct l2_ethdev_rx_node_ctx *ethdev_rx;
@@ -1464,8 +1712,22 @@ clear_lcore_queue_mapping(uint16_t virtio_devid)
 			ethdev_rx->rx_q_count = 0;
 		}
 
-		if (qconf->service_lcore)
+		if (!qconf->service_lcore)
+			continue;
+
+		if (qconf->netdev_map & RTE_BIT64(virtio_devid)) {
 			qconf->netdev_map &= ~RTE_BIT64(virtio_devid);
+			/* Update lcore weight */
+			qconf->weight -= qconf->netdev_shard[virtio_devid].nb_qps;
+			/* Service lcore quiesces the queues it managed before they are remapped */
+			if (drain)
+				__atomic_fetch_or(&qconf->drain_map, RTE_BIT64(virtio_devid),
+						  __ATOMIC_RELEASE);
+		}
+		/* Nothing to hand over when device is reset */
+		if (!drain)
+			__atomic_fetch_and(&qconf->drain_map, ~RTE_BIT64(virtio_devid),
+					   __ATOMIC_RELEASE);
 	}
 	rte_io_wmb();
 	dump_lcore_info();
@@ -1558,15 +1820,41 @@ reconfig_ethdev(uint16_t portid, uint16_t q_count)
 	return 0;
 }
 
+static int
+wait_lcore_queue_drain(uint16_t virtio_devid)
+{
+	uint64_t timeout;
+	uint32_t lcore_id;
+
+	timeout = rte_get_timer_cycles() + (rte_get_timer_hz() * SERVICE_DRAIN_TIMEOUT_MS) / 1000;
+	for (lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+		if (rte_lcore_is_enabled(lcore_id) == 0 || !lcore_conf[lcore_id].service_lcore)
+			continue;
+
+		while (__atomic_load_n(&lcore_conf[lcore_id].drain_map, __ATOMIC_ACQUIRE) &
+		       RTE_BIT64(virtio_devid)) {
+			if (rte_get_timer_cycles() > timeout) {
+				APP_ERR("virtio_dev=%d: lcore %u failed to quiesce queues\n",
+					virtio_devid, lcore_id);
+				return -ETIMEDOUT;
+			}
+			rte_pause();
+		}
+	}
+	return 0;
+}
+
 static int
 setup_lcore_queue_mapping(uint16_t virtio_devid, uint16_t virt_q_count)
 {
+	uint16_t nb_shards, shard, qp_start, nb_qps;
 	struct l2_virtio_rx_node_ctx *virtio_rx;
 	struct l2_ethdev_rx_node_ctx *ethdev_rx;
 	uint16_t virt_rx_q, eth_rx_q;
 	struct lcore_conf *qconf;
 	uint32_t lcore_id, idx;
 	uint16_t i, q_id;
+	int rc;
 
 	virt_rx_q = virt_q_count / 2;
 	eth_rx_q = (virtio_map[virtio_devid].type == ETHDEV_NEXT) ? virt_rx_q : 0;
@@ -1646,17 +1934,43 @@ setup_lcore_queue_mapping(uint16_t virtio_devid, uint16_t virt_q_count)
 		}
 	}
 
-	/* Add virtio device to service lcore */
-	for (lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
-		if (rte_lcore_is_enabled(lcore_id) == 0)
-			continue;
-		qconf = &lcore_conf[lcore_id];
+	/* Queue pairs can move to another service lcore only after their owner quiesced them */
+	rc = wait_lcore_queue_drain(virtio_devid);
+	if (rc)
+		return rc;
 
-		if (qconf->service_lcore) {
-			qconf->netdev_map |= RTE_BIT64(virtio_devid);
-			qconf->netdev_qp_count[virtio_devid] = virt_q_count / 2;
+	/* Split virtio queue pairs into shards, each managed by least loaded service lcore */
+	nb_shards = RTE_MIN(nb_service_lcores, RTE_MAX(virt_rx_q / SERVICE_SHARD_QP_MIN, 1));
+	qp_start = 0;
+	for (shard = 0; shard < nb_shards; shard++) {
+		nb_qps = virt_rx_q / nb_shards + (shard < virt_rx_q % nb_shards);
+
+		qconf = NULL;
+		for (lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
+			if (rte_lcore_is_enabled(lcore_id) == 0)
+				continue;
+
+			/* A service lcore manages one shard per device */
+			if (!lcore_conf[lcore_id].service_lcore ||
+			    lcore_conf[lcore_id].netdev_map & RTE_BIT64(virtio_devid))
+				continue;
+
+			if (!qconf || lcore_conf[lcore_id].weight < qconf->weight)
+				qconf = &lcore_conf[lcore_id];
+		}
+		if (!qconf) {
+			APP_ERR("virtio_dev=%d: no service lcore for queue pairs %u-%u\n",
+				virtio_devid, qp_start, virt_rx_q - 1);
 			break;
 		}
+
+		qconf->netdev_shard[virtio_devid].qp_start = qp_start;
+		qconf->netdev_shard[virtio_devid].nb_qps = nb_qps;
+		/* Update lcore weight */
+		qconf->weight += nb_qps;
+		/* Add virtio device to service lcore */
+		__atomic_fetch_or(&qconf->netdev_map, RTE_BIT64(virtio_devid), __ATOMIC_RELEASE);
+		qp_start += nb_qps;
 	}
 
 	dump_lcore_info();
@@ -2054,16 +2368,19 @@ hash_report_enable(uint16_t virtio_devid)
 static int
 chksum_offload_configure(uint16_t virtio_devid)
 {
-	uint64_t csum_offload, tx_offloads, rx_offloads, tso_offload;
+	uint64_t csum_offload, tx_offloads, rx_offloads, tso_offload, feature_bits;
 	struct rte_eth_conf *local_port_conf;
 	uint16_t virt_q_count, portid;
+	bool sw_uso = false;
 	int rc;
 
-#define TX_OFFLOADS (RTE_ETH_TX_OFFLOAD_IPV4_CKSUM | RTE_ETH_TX_OFFLOAD_TCP_TSO)
+#define TX_OFFLOADS                                                                                \
+	(RTE_ETH_TX_OFFLOAD_IPV4_CKSUM | RTE_ETH_TX_OFFLOAD_TCP_TSO | RTE_ETH_TX_OFFLOAD_UDP_TSO)
 #define RX_OFFLOADS (RTE_ETH_RX_OFFLOAD_CHECKSUM)
 
-	csum_offload = dao_virtio_netdev_feature_bits_get(virtio_devid) & 0x3;
-	tso_offload = dao_virtio_netdev_feature_bits_get(virtio_devid) & 0XFFFF;
+	feature_bits = dao_virtio_netdev_feature_bits_get(virtio_devid);
+	csum_offload = feature_bits & 0x3;
+	tso_offload = feature_bits & 0XFFFF;
 
 	portid = virtio_map[virtio_devid].id;
 	local_port_conf = &eth_dev_conf[portid];
@@ -2077,9 +2394,17 @@ chksum_offload_configure(uint16_t virtio_devid)
 		if (tso_offload & RTE_BIT64(VIRTIO_NET_F_HOST_TSO4) ||
 		    tso_offload & RTE_BIT64(VIRTIO_NET_F_HOST_TSO6))
 			tx_offloads |= RTE_ETH_TX_OFFLOAD_TCP_TSO;
+		/* Segment UDP in software when ethdev cannot */
+		if (feature_bits & RTE_BIT64(VIRTIO_NET_F_HOST_USO)) {
+			if (eth_dev_info[portid].tx_offload_capa & RTE_ETH_TX_OFFLOAD_UDP_TSO)
+				tx_offloads |= RTE_ETH_TX_OFFLOAD_UDP_TSO;
+			else
+				sw_uso = true;
+		}
 	}
 	if (csum_offload & RTE_BIT64(VIRTIO_NET_F_GUEST_CSUM))
 		rx_offloads |= RTE_ETH_RX_OFFLOAD_CHECKSUM;
+	l2_ethdev_sw_uso[portid] = sw_uso;
 
 	if ((local_port_conf->txmode.offloads == tx_offloads) &&
 	    (local_port_conf->rxmode.offloads == rx_offloads)) {
@@ -2144,13 +2469,13 @@ rss_reta_configure(uint16_t virtio_devid, struct virtio_net_ctrl_rss *rss)
 	int rc;
 
 	if (rss == NULL) {
-		clear_lcore_queue_mapping(virtio_devid);
+		clear_lcore_queue_mapping(virtio_devid, true);
 		/* Synchronize RCU */
 		rte_rcu_qsbr_synchronize(qs_v, RTE_QSBR_THRID_INVALID);
 		return 0;
 	}
 
-	clear_lcore_queue_mapping(virtio_devid);
+	clear_lcore_queue_mapping(virtio_devid, true);
 
 	/* Get active virt queue count */
 	virt_q_count = dao_virtio_netdev_queue_count(virtio_devid);
@@ -2244,13 +2569,13 @@ mq_configure(uint16_t virtio_devid, bool qmap_set)
 	int rc;
 
 	if (!qmap_set) {
-		clear_lcore_queue_mapping(virtio_devid);
+		clear_lcore_queue_mapping(virtio_devid, true);
 		/* Synchronize RCU */
 		rte_rcu_qsbr_synchronize(qs_v, RTE_QSBR_THRID_INVALID);
 		return 0;
 	}
 
-	clear_lcore_queue_mapping(virtio_devid);
+	clear_lcore_queue_mapping(virtio_devid, true);
 
 	/* Get active virt queue count */
 	virt_q_count = dao_virtio_netdev_queue_count(virtio_devid);
@@ -2310,7 +2635,7 @@ virtio_dev_status_cb(uint16_t virtio_devid, uint8_t status)
 	switch (status) {
 	case VIRTIO_DEV_RESET:
 	case VIRTIO_DEV_NEEDS_RESET:
-		clear_lcore_queue_mapping(virtio_devid);
+		clear_lcore_queue_mapping(virtio_devid, false);
 		reset_ethdev = true;
 		break;
 	case VIRTIO_DEV_DRIVER_OK:
@@ -2768,16 +3093,18 @@ setup_dma_devices(void)
 		if (!qconf->nb_ethdev_rx && !qconf->nb_virtio_rx && !qconf->service_lcore)
 			continue;
 
-		if (dev2mem_idx == dev2mem_cnt || mem2dev_idx == mem2dev_cnt)
+		if (dev2mem_idx + nb_dma_stripes > dev2mem_cnt ||
+		    mem2dev_idx + nb_dma_stripes > mem2dev_cnt)
 			rte_exit(EXIT_FAILURE, "Not enough dma devices for workers\n");
 
-		/* Assign DMA device id */
-		qconf->dev2mem_id = dev2mem_ids[dev2mem_idx++];
-		qconf->mem2dev_id = mem2dev_ids[mem2dev_idx++];
+		/* Assign DMA device ids, all configured alike for virtio devices */
+		for (i = 0; i < nb_dma_stripes; i++) {
+			qconf->dev2mem_ids[i] = dev2mem_ids[dev2mem_idx++];
+			qconf->mem2dev_ids[i] = mem2dev_ids[mem2dev_idx++];
+			APP_INFO("\tlcore %u ... dev2mem=%u mem2dev=%u\n", lcore_id,
+				 qconf->dev2mem_ids[i], qconf->mem2dev_ids[i]);
+		}
 		qconf->nb_vchans = nb_virtio_netdevs;
-
-		APP_INFO("\tlcore %u ... dev2mem=%u mem2dev=%u\n", lcore_id, qconf->dev2mem_id,
-			 qconf->mem2dev_id);
 	}
 	APP_INFO("\n");
 }
@@ -2824,6 +3151,8 @@ setup_virtio_devices(void)
 		netdev_conf.pool = per_port_pool ? v_pktmbuf_pool[virtio_devid] : v_pktmbuf_pool[0];
 		netdev_conf.dma_vchan = virtio_netdev_dma_vchans[virtio_devid];
 		netdev_conf.mtu = 0;
+		if (virtio_event_idx)
+			netdev_conf.flags |= DAO_VIRTIO_NETDEV_EVENT_IDX;
 		if (virtio_map[virtio_devid].type == ETHDEV_NEXT) {
 			struct rte_eth_link eth_link;
 
@@ -2874,6 +3203,14 @@ setup_virtio_devices(void)
 		if (rc)
 			rte_exit(EXIT_FAILURE, "Failed to init virtio device\n");
 
+		rc = dao_virtio_netdev_intr_coalesce_set(virtio_devid, &intr_coalesce);
+		if (rc)
+			rte_exit(EXIT_FAILURE, "Failed to set virtio interrupt coalescing\n");
+
+		rc = dao_virtio_netdev_desc_fetch_throttle_set(virtio_devid, desc_throttle);
+		if (rc)
+			rte_exit(EXIT_FAILURE, "Failed to set virtio descriptor fetch throttle\n");
+
 		/* Clone virtio rx and tx nodes for this ethdev */
 		snprintf(name, sizeof(name), "%u", virtio_devid);
 		node_reg = l2_virtio_rx_node_get();
@@ -2998,7 +3335,7 @@ main(int argc, char **argv)
 	};
 	struct rte_graph_cluster_stats_param s_param;
 	struct rte_graph_param graph_conf;
-	bool service_lcore_flag = false;
+	uint16_t nb_service = 0;
 	const char **node_patterns;
 	struct lcore_conf *qconf;
 	struct rte_node *node;
@@ -3047,18 +3384,23 @@ main(int argc, char **argv)
 		if (rte_lcore_is_enabled(lcore_id) == 0 || lcore_id == rte_get_main_lcore())
 			continue;
 
-		/* Pick one non FP lcore for misc */
+		/* Pick non FP lcores for misc */
 		if (lcore_conf[lcore_id].nb_virtio_rx == 0 &&
 		    lcore_conf[lcore_id].nb_ethdev_rx == 0) {
 			lcore_conf[lcore_id].service_lcore = true;
-			service_lcore_flag = true;
-			break;
+			if (++nb_service == nb_service_lcores)
+				break;
 		}
 	}
 
-	if (!service_lcore_flag)
+	if (!nb_service)
 		rte_exit(EXIT_FAILURE, "LCORE not available for service lcore\n");
 
+	if (nb_service < nb_service_lcores) {
+		APP_INFO("Only %u lcores available for service\n", nb_service);
+		nb_service_lcores = nb_service;
+	}
+
 	/* Alloc mempools */
 	setup_mempools();
 
@@ -13,11 +13,15 @@
 
 #include <rte_eal.h>
 
+#include <rte_cycles.h>
 #include <rte_dmadev.h>
+#include <rte_io.h>
 #include <rte_lcore.h>
+#include <rte_memcpy.h>
 #include <rte_vect.h>
 
 #include <dao_config.h>
+#include <dao_vect.h>
 
 #include "dao_log.h"
 
@@ -30,25 +34,64 @@
 /** DMA Max VCHAN per lcore */
 #define DAO_DMA_MAX_VCHAN_PER_LCORE 128
 
-/** DMA inflight event meta data */
+/** DMA adaptive mode, submitted ops in flight up to which vchan is treated idle */
+#define DAO_DMA_ADAPT_IDLE_DEPTH 2u
+
+/** DMA adaptive mode, ops to coalesce per doorbell on a busy vchan */
+#define DAO_DMA_ADAPT_DBELL_OPS 4u
+
+/** DMA inflight event meta data max, actual ring is sized from device max descriptors */
 #define DAO_DMA_MAX_INFLIGHT_MDATA 4096
 
+/** DMA latency histogram buckets, bucket N counts ops taking [2^(N-1), 2^N) cycles */
+#define DAO_DMA_LAT_HIST_SZ 32
+
+/** DMA in-flight depth histogram buckets in log2 ops */
+#define DAO_DMA_DEPTH_HIST_SZ 16
+
+/** DMA pointers per doorbell histogram buckets in log2 pointers */
+#define DAO_DMA_DBELL_PTRS_HIST_SZ 16
+
+/** DMA per vchan latency and occupancy histograms */
+struct dao_dma_vchan_lat_stats {
+	/** Flush to completion latency in log2 cycles */
+	uint64_t lat[DAO_DMA_LAT_HIST_SZ];
+	/** Ops in flight on vchan sampled at each flush, log2 */
+	uint64_t depth[DAO_DMA_DEPTH_HIST_SZ];
+	/** Pointers submitted per doorbell, log2 */
+	uint64_t dbell_ptrs[DAO_DMA_DBELL_PTRS_HIST_SZ];
+};
+
+/** DMA per vchan latency instrumentation state */
+struct dao_dma_vchan_lat {
+	/** Flush timestamp of each in-flight op, indexed as meta data ring */
+	uint64_t *op_ts;
+	/** Pointers flushed since last doorbell */
+	uint32_t dbell_ptrs;
+	/** Histograms */
+	struct dao_dma_vchan_lat_stats stats;
+};
+
 /** DMA inflight event completion meta data */
 struct dao_dma_cmpl_mdata {
-	/** Pending counter address */
-	uint16_t *pend_ptr[DAO_DMA_MAX_POINTER];
-	/** Pending value */
-	uint16_t pend_val[DAO_DMA_MAX_POINTER];
+	/** Count */
+	uint16_t cnt;
 	/** Completion val to write */
 	uint16_t val[DAO_DMA_MAX_POINTER];
+	/** Pending value */
+	uint16_t pend_val[DAO_DMA_MAX_POINTER];
 	/** Completion address to write */
 	uint16_t *ptr[DAO_DMA_MAX_POINTER];
-	/** Count */
-	uint16_t cnt;
+	/** Pending counter address */
+	uint16_t *pend_ptr[DAO_DMA_MAX_POINTER];
 };
 
 /** DMA per vchan state */
 struct dao_dma_vchan_state {
+	/* First cache line is all that enqueue, flush and completion touch besides SGE's.
+	 * Fields after SGE's are used only by error paths and optional modes, adaptive
+	 * flush, completion notification and latency stats.
+	 */
 	/** Tail index */
 	uint16_t tail;
 	/** Head index */
@@ -57,22 +100,25 @@ struct dao_dma_vchan_state {
 	int16_t devid;
 	/** DMA device vchan */
 	uint8_t vchan;
-	uint8_t rsvd;
+	/** DMA flush threshold */
+	uint8_t flush_thr;
 	/** Source pointer index */
 	uint16_t src_i;
 	/** Destination pointer index */
 	uint16_t dst_i;
-	/** DMA flush threshold */
-	uint8_t flush_thr;
-	/** DMA auto free enabled */
-	uint8_t auto_free : 1;
-	uint8_t rsvd2 : 7;
 	/** DMA pending ops */
 	uint16_t pend_ops;
-	/** DMA source SGE's */
-	struct rte_dma_sge src[DAO_DMA_MAX_POINTER];
-	/** DMA destination SGE's */
-	struct rte_dma_sge dst[DAO_DMA_MAX_POINTER];
+	/** Completion meta data ring mask */
+	uint16_t mdata_mask;
+	/** DMA auto free enabled */
+	uint8_t auto_free : 1;
+	/** Ring doorbell with each op at flush, set by adaptive mode */
+	uint8_t imm_submit : 1;
+	uint8_t rsvd : 6;
+	/** Index in lcore pending vchan bitmap */
+	uint8_t pend_idx;
+	/** DMA events meta data ring */
+	struct dao_dma_cmpl_mdata *mdata;
 	/** DMA pointers count */
 	uint64_t ptrs;
 	/** DMA ops count */
@@ -81,10 +127,32 @@ struct dao_dma_vchan_state {
 	uint64_t dbells;
 	/** DMA enqueue errors */
 	uint64_t dma_enq_errs;
+	/** DMA source SGE's */
+	struct rte_dma_sge src[DAO_DMA_MAX_POINTER] __rte_cache_aligned;
+	/** DMA destination SGE's */
+	struct rte_dma_sge dst[DAO_DMA_MAX_POINTER] __rte_cache_aligned;
 	/** DMA completion errors */
 	uint64_t dma_compl_errs;
-	/** DMA events meta data */
-	struct dao_dma_cmpl_mdata mdata[DAO_DMA_MAX_INFLIGHT_MDATA];
+	/** Timestamp of oldest op not yet submitted, adaptive mode */
+	uint64_t pend_tsc;
+	/** Tail at last adaptive update */
+	uint16_t adapt_tail;
+	/** Tail to reach for pending completion notification */
+	uint16_t notify_tail;
+	/** Configured flush threshold, adaptive mode lower bound */
+	uint8_t flush_thr_min;
+	/** Max bytes of a meta data transfer done by CPU, zero disables */
+	uint32_t cpu_copy_thr;
+	/** Latency instrumentation, allocated when enabled at build */
+	struct dao_dma_vchan_lat *lat;
+	/** CPU copy window start IOVA */
+	rte_iova_t win_iova;
+	/** CPU copy window mapped address */
+	uintptr_t win_va;
+	/** CPU copy window length */
+	uint64_t win_len;
+	/** Transfers done by CPU */
+	uint64_t cpu_ops;
 } __rte_cache_aligned;
 
 /** DMA per lcore vchan info */
@@ -93,10 +161,34 @@ struct dao_dma_vchan_info {
 	uint16_t nb_dev2mem;
 	/** Number of mem2dev vchans */
 	uint16_t nb_mem2dev;
-	/** Dev2mem vchan state */
-	struct dao_dma_vchan_state dev2mem[DAO_DMA_MAX_VCHAN_PER_LCORE];
-	/** Mem2dev vchan state */
-	struct dao_dma_vchan_state mem2dev[DAO_DMA_MAX_VCHAN_PER_LCORE];
+	/** Adaptive flush and doorbell coalescing enabled */
+	uint8_t adaptive;
+	/** Number of dev2mem devices queues are striped over */
+	uint8_t nb_dev2mem_stripes;
+	/** Number of mem2dev devices queues are striped over */
+	uint8_t nb_mem2dev_stripes;
+	/** Vchans per striped dev2mem device */
+	uint16_t dev2mem_stride;
+	/** Vchans per striped mem2dev device */
+	uint16_t mem2dev_stride;
+	/** Adaptive mode max cycles an op waits for doorbell across flush submits */
+	uint64_t dbell_deadline;
+	/** Completion notification requests posted to lcore */
+	uint32_t notify_posted;
+	/** Completion notification requests taken by lcore */
+	uint32_t notify_taken;
+	/** Completion notification request being drained */
+	void *notify_req;
+	/** Completion notification request ring */
+	struct rte_ring *notify_ring;
+	/** Bitmap of vchans with unflushed pointers or unsubmitted ops.
+	 * Dev2mem vchans take the lower half of the bits, mem2dev the upper half.
+	 */
+	uint64_t pend_bmap[(2 * DAO_DMA_MAX_VCHAN_PER_LCORE) / 64];
+	/** Dev2mem vchan state, allocated on assignment */
+	struct dao_dma_vchan_state *dev2mem[DAO_DMA_MAX_VCHAN_PER_LCORE];
+	/** Mem2dev vchan state, allocated on assignment */
+	struct dao_dma_vchan_state *mem2dev[DAO_DMA_MAX_VCHAN_PER_LCORE];
 } __rte_cache_aligned;
 
 /** DMA per vchan stats */
@@ -109,6 +201,8 @@ struct dao_dma_vchan_stats {
 	uint64_t dbells;
 	/** DMA enqueue errors */
 	uint64_t enq_errs;
+	/** Transfers done by CPU instead of DMA */
+	uint64_t cpu_ops;
 };
 
 /** DMA stats */
@@ -146,6 +240,115 @@ int dao_dma_flush_submit(void);
  */
 int dao_dma_stats_get(uint16_t lcore_id, struct dao_dma_stats *stats);
 
+/**
+ * Assign multiple dev2mem dma devices to an lcore and stripe queues over them.
+ *
+ * Each device contributes ``nb_vchans`` vchans. ``dao_dma_lcore_dev2mem_get``
+ * maps a vchan and a queue key to one device, so all ops of a queue use the
+ * same vchan state and keep their completion order.
+ *
+ * @param dma_devids
+ *   Array of DMA device ids to assign to lcore.
+ * @param nb_devs
+ *   Number of DMA devices in array.
+ * @param nb_vchans
+ *   Number of vchans to use from each DMA device.
+ * @param flush_thr
+ *   Flush threshold.
+ * @return
+ *   Zero on success.
+ */
+int dao_dma_lcore_dev2mem_stripe_set(const int16_t *dma_devids, uint16_t nb_devs,
+				     uint16_t nb_vchans, uint16_t flush_thr);
+
+/**
+ * Assign multiple mem2dev dma devices to an lcore and stripe queues over them.
+ *
+ * @param dma_devids
+ *   Array of DMA device ids to assign to lcore.
+ * @param nb_devs
+ *   Number of DMA devices in array.
+ * @param nb_vchans
+ *   Number of vchans to use from each DMA device.
+ * @param flush_thr
+ *   Flush threshold.
+ * @return
+ *   Zero on success.
+ *
+ * @see dao_dma_lcore_dev2mem_stripe_set()
+ */
+int dao_dma_lcore_mem2dev_stripe_set(const int16_t *dma_devids, uint16_t nb_devs,
+				     uint16_t nb_vchans, uint16_t flush_thr);
+
+/**
+ * Let small meta data transfers of a mem2dev vchan use CPU stores.
+ *
+ * Transfers issued through ``dao_dma_enq_meta_x1`` of at most ``thr`` bytes
+ * whose destination lies in the window are written by CPU through the
+ * window mapping. CPU stores can become visible before ops still in flight
+ * on the vchan, so only transfers not depending on earlier ops of the vchan
+ * should go through ``dao_dma_enq_meta_x1``.
+ *
+ * @param mem2dev_id
+ *   Mem2dev DMA device id assigned to lcore.
+ * @param vchan
+ *   Vchan of DMA device.
+ * @param thr
+ *   Max transfer length in bytes done by CPU, zero disables.
+ * @param win_iova
+ *   Host IOVA at start of window.
+ * @param win_va
+ *   Address the window is mapped at.
+ * @param win_len
+ *   Window length.
+ * @return
+ *   Zero on success.
+ */
+int dao_dma_lcore_mem2dev_cpu_copy_set(int16_t mem2dev_id, uint16_t vchan, uint32_t thr,
+				       rte_iova_t win_iova, void *win_va, size_t win_len);
+
+/**
+ * Enable adaptive flush threshold and doorbell coalescing on lcore vchans.
+ *
+ * Flush threshold of a vchan grows up to DAO_DMA_MAX_POINTER while more than
+ * one op is flushed between ``dao_dma_flush_submit`` calls, and falls back to
+ * the threshold given at vchan assignment otherwise. A vchan with few ops in
+ * flight rings doorbell with each op at flush, a busy vchan coalesces
+ * doorbells until DAO_DMA_ADAPT_DBELL_OPS ops are pending or deadline expires.
+ * Flush threshold is not lowered below pointers already in the vchan SGE's.
+ *
+ * Deadline only bounds the delay coalescing adds, it never rings a doorbell
+ * earlier than non adaptive mode would. There is no timer, expiry is checked
+ * by ``dao_dma_flush_submit``, so doorbell of a busy vchan is rung at the
+ * first call after deadline and lcore has to keep calling it.
+ *
+ * @param enable
+ *   Enable or disable adaptive mode.
+ * @param deadline_us
+ *   Max time an op waits for doorbell on a busy vchan. Zero submits on every
+ *   ``dao_dma_flush_submit`` call.
+ * @return
+ *   Zero on success.
+ */
+int dao_dma_lcore_flush_adaptive_set(bool enable, uint32_t deadline_us);
+
+/**
+ * Get DMA latency and occupancy histograms of a vchan.
+ *
+ * @param lcore_id
+ *   Lcore to get stats from.
+ * @param dev2mem
+ *   True for dev2mem vchan, false for mem2dev vchan.
+ * @param vchan
+ *   Vchan index in lcore.
+ * @param stats
+ *   Address to store stats.
+ * @return
+ *   Zero on success, -ENOTSUP if not enabled at build.
+ */
+int dao_dma_lat_stats_get(uint16_t lcore_id, bool dev2mem, uint16_t vchan,
+			  struct dao_dma_vchan_lat_stats *stats);
+
 /**
  * Assign dev2mem dma device to an lcore.
  *
@@ -217,12 +420,61 @@ int16_t dao_dma_ctrl_dev2mem(void);
 int16_t dao_dma_ctrl_mem2dev(void);
 
 /**
- *  Check and wait for all DMA requests to complete
+ * DMA completion notification callback.
+ *
+ * @param vchan
+ *    Vchan ID notification was requested on.
+ * @param arg
+ *    Argument given at request.
+ */
+typedef void (*dao_dma_compl_cb_t)(uint16_t vchan, void *arg);
+
+/**
+ * Request notification once DMA ops on a vchan of all lcores complete.
+ *
+ * Each lcore owning the vchan takes the request in ``dao_dma_flush_submit``
+ * or ``dao_dma_compl_poll``, and waits for ops enqueued till then without
+ * blocking. Callback is invoked from the lcore completing last, or from the
+ * caller when no lcore owns the vchan, so it should only signal the waiter
+ * e.g. by writing an eventfd.
+ *
+ * @param vchan
+ *    Vchan ID
+ * @param cb
+ *    Callback to invoke on completion.
+ * @param arg
+ *    Argument to callback.
+ * @return
+ *    Zero on success, -ENOSPC if request could not be posted to an lcore,
+ *    callback still fires once posted lcores complete.
+ */
+int dao_dma_compl_notify(uint16_t vchan, dao_dma_compl_cb_t cb, void *arg);
+
+/**
+ * Progress completion notification requests of calling lcore.
+ *
+ * Non-blocking, called by ``dao_dma_flush_submit``. Lcores owning vchans but
+ * not calling ``dao_dma_flush_submit`` need to call this from their loop.
+ */
+void dao_dma_compl_poll(void);
+
+/**
+ *  Wait for all DMA requests on a vchan to complete.
+ *
+ * Sleeps till owning lcores report completion through ``dao_dma_compl_notify``.
+ * After 100ms, requests of worker lcores not running a launched function are
+ * progressed by the caller, polling their vchans directly, so a stopped lcore
+ * does not hang the wait. Such lcores must not be relaunched while a wait is
+ * in progress. Main lcore is always treated as running, if it or a running
+ * worker owning the vchan does not poll, wait gives up after 1s.
  *
  * @param vchan
  *    Vchan ID
+ * @return
+ *    Zero on success, -ETIMEDOUT if owning lcores did not complete in time,
+ *    -ENOMEM on allocation failure.
  */
-void dao_dma_compl_wait(uint16_t vchan);
+int dao_dma_compl_wait(uint16_t vchan);
 
 /**
  * Tests DMA stats support
@@ -240,6 +492,233 @@ dao_dma_has_stats_feature(void)
 #endif
 }
 
+/**
+ * Tests DMA latency stats support
+ *
+ * @return
+ *    1 if DMA latency stats is supported, 0 otherwise.
+ */
+static __rte_always_inline int
+dao_dma_has_lat_stats_feature(void)
+{
+#if DAO_DMA_LAT_STATS
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Get log2 histogram bucket of a value.
+ *
+ * @param val
+ *    Value to classify, zero falls in bucket zero.
+ * @param nb_buckets
+ *    Number of buckets, last bucket holds all larger values.
+ * @return
+ *    Bucket index.
+ */
+static __rte_always_inline uint16_t
+dao_dma_lat_bucket(uint64_t val, const uint16_t nb_buckets)
+{
+	uint16_t b = rte_fls_u64(val);
+
+	return RTE_MIN(b, nb_buckets - 1);
+}
+
+/**
+ * Record flush of the op just enqueued before tail for latency stats.
+ *
+ * @param vchan
+ *    Vchan state pointer
+ */
+static __rte_always_inline void
+dao_dma_lat_flush_mark(struct dao_dma_vchan_state *vchan)
+{
+	struct dao_dma_vchan_lat *lat = vchan->lat;
+	uint16_t depth = vchan->tail - vchan->head;
+
+	lat->op_ts[(uint16_t)(vchan->tail - 1) & vchan->mdata_mask] = rte_rdtsc();
+	lat->stats.depth[dao_dma_lat_bucket(depth, DAO_DMA_DEPTH_HIST_SZ)]++;
+	lat->dbell_ptrs += vchan->src_i;
+}
+
+/**
+ * Record completion of ops from head for latency stats.
+ *
+ * @param vchan
+ *    Vchan state pointer
+ * @param cmpl
+ *    Number of ops completed
+ */
+static __rte_always_inline void
+dao_dma_lat_compl_mark(struct dao_dma_vchan_state *vchan, uint16_t cmpl)
+{
+	struct dao_dma_vchan_lat *lat = vchan->lat;
+	uint64_t now;
+	uint16_t i;
+
+	if (!cmpl)
+		return;
+
+	now = rte_rdtsc();
+	for (i = 0; i < cmpl; i++) {
+		uint64_t ts = lat->op_ts[(uint16_t)(vchan->head + i) & vchan->mdata_mask];
+
+		lat->stats.lat[dao_dma_lat_bucket(now - ts, DAO_DMA_LAT_HIST_SZ)]++;
+	}
+}
+
+/**
+ * Record doorbell for latency stats.
+ *
+ * @param vchan
+ *    Vchan state pointer
+ */
+static __rte_always_inline void
+dao_dma_lat_dbell_mark(struct dao_dma_vchan_state *vchan)
+{
+	struct dao_dma_vchan_lat *lat = vchan->lat;
+
+	lat->stats.dbell_ptrs[dao_dma_lat_bucket(lat->dbell_ptrs, DAO_DMA_DBELL_PTRS_HIST_SZ)]++;
+	lat->dbell_ptrs = 0;
+}
+
+/**
+ * Tests software DMA backend support
+ *
+ * @return
+ *    1 if DMA ops are executed by CPU, 0 if by DMA device.
+ */
+static __rte_always_inline int
+dao_dma_has_sw_backend(void)
+{
+#if DAO_DMA_SW_BACKEND
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/**
+ * Execute DMA op built in vchan SGE's using CPU copies.
+ *
+ * Software backend requires IOVA as VA so SGE addresses are CPU addressable.
+ * Source and destination lists may be split differently, copy follows both.
+ *
+ * @param vchan
+ *    Vchan state pointer
+ */
+static __rte_always_inline void
+dao_dma_sw_copy_sg(struct dao_dma_vchan_state *vchan)
+{
+	struct rte_dma_sge *src = vchan->src;
+	struct rte_dma_sge *dst = vchan->dst;
+	uint32_t s_off = 0, d_off = 0, len;
+	uint16_t s = 0, d = 0;
+
+	while (s < vchan->src_i && d < vchan->dst_i) {
+		len = RTE_MIN(src[s].length - s_off, dst[d].length - d_off);
+		rte_memcpy((void *)(uintptr_t)(dst[d].addr + d_off),
+			   (const void *)(uintptr_t)(src[s].addr + s_off), len);
+		s_off += len;
+		d_off += len;
+		if (s_off == src[s].length) {
+			s_off = 0;
+			s++;
+		}
+		if (d_off == dst[d].length) {
+			d_off = 0;
+			d++;
+		}
+	}
+}
+
+/**
+ * Fetch number of DMA ops completed on vchan.
+ *
+ * Software backend completes ops at flush, so all ops till tail are done.
+ *
+ * @param vchan
+ *    Vchan state pointer
+ * @param has_err
+ *    Set to true if DMA device reported an error
+ * @return
+ *    Number of completed ops.
+ */
+static __rte_always_inline uint16_t
+dao_dma_completed(struct dao_dma_vchan_state *vchan, bool *has_err)
+{
+	if (dao_dma_has_sw_backend()) {
+		RTE_SET_USED(has_err);
+		return RTE_MIN((uint16_t)(vchan->tail - vchan->head), 128);
+	}
+
+	return rte_dma_completed(vchan->devid, vchan->vchan, 128, NULL, has_err);
+}
+
+/**
+ * Mark vchan as having pending work for ``dao_dma_flush_submit``.
+ *
+ * Enqueue helpers mark the vchan themselves, this is needed only when
+ * SGE's are filled directly through ``dao_dma_sge_src``/``dao_dma_sge_dst``.
+ *
+ * @param vchan
+ *    Vchan state pointer
+ */
+static __rte_always_inline void
+dao_dma_vchan_pend_mark(struct dao_dma_vchan_state *vchan)
+{
+	struct dao_dma_vchan_info *vchan_info = RTE_PER_LCORE(dao_dma_vchan_info);
+	uint8_t idx = vchan->pend_idx;
+
+	vchan_info->pend_bmap[idx >> 6] |= RTE_BIT64(idx & 0x3F);
+}
+
+/**
+ * Get lcore dev2mem vchan state to use for a queue.
+ *
+ * @param vchan
+ *    Vchan index within a DMA device.
+ * @param key
+ *    Queue key, same key always maps to same vchan state.
+ * @return
+ *    Vchan state pointer.
+ */
+static __rte_always_inline struct dao_dma_vchan_state *
+dao_dma_lcore_dev2mem_get(uint16_t vchan, uint16_t key)
+{
+	struct dao_dma_vchan_info *vchan_info = RTE_PER_LCORE(dao_dma_vchan_info);
+	uint8_t nb_stripes = vchan_info->nb_dev2mem_stripes;
+
+	if (likely(nb_stripes <= 1))
+		return vchan_info->dev2mem[vchan];
+
+	return vchan_info->dev2mem[(key % nb_stripes) * vchan_info->dev2mem_stride + vchan];
+}
+
+/**
+ * Get lcore mem2dev vchan state to use for a queue.
+ *
+ * @param vchan
+ *    Vchan index within a DMA device.
+ * @param key
+ *    Queue key, same key always maps to same vchan state.
+ * @return
+ *    Vchan state pointer.
+ */
+static __rte_always_inline struct dao_dma_vchan_state *
+dao_dma_lcore_mem2dev_get(uint16_t vchan, uint16_t key)
+{
+	struct dao_dma_vchan_info *vchan_info = RTE_PER_LCORE(dao_dma_vchan_info);
+	uint8_t nb_stripes = vchan_info->nb_mem2dev_stripes;
+
+	if (likely(nb_stripes <= 1))
+		return vchan_info->mem2dev[vchan];
+
+	return vchan_info->mem2dev[(key % nb_stripes) * vchan_info->mem2dev_stride + vchan];
+}
+
 /**
  * Get DMA operation status
  *
@@ -285,6 +764,20 @@ dao_dma_flush(struct dao_dma_vchan_state *vchan, const uint8_t avail)
 		   (dst_avail >= (int)avail || !vchan->dst_i)))
 		goto exit;
 
+	/* Keep an unused meta data slot for the op being built at tail */
+	if (unlikely((uint16_t)(vchan->tail - vchan->head) >= vchan->mdata_mask))
+		return false;
+
+	if (dao_dma_has_sw_backend()) {
+		dao_dma_sw_copy_sg(vchan);
+		/* Op is complete, nothing to submit */
+		vchan->tail++;
+		goto done;
+	}
+
+	if (vchan->imm_submit)
+		flags |= RTE_DMA_OP_FLAG_SUBMIT;
+
 	rc = rte_dma_copy_sg(vchan->devid, vchan->vchan, vchan->src, vchan->dst, vchan->src_i,
 			     vchan->dst_i, flags);
 	if (unlikely(rc < 0)) {
@@ -293,7 +786,20 @@ dao_dma_flush(struct dao_dma_vchan_state *vchan, const uint8_t avail)
 		return false;
 	}
 	vchan->tail++;
-	vchan->pend_ops++;
+	if (vchan->imm_submit) {
+		/* Doorbell covers ops left pending before this one too */
+		vchan->pend_ops = 0;
+		if (dao_dma_has_stats_feature())
+			vchan->dbells++;
+	} else {
+		vchan->pend_ops++;
+	}
+done:
+	if (dao_dma_has_lat_stats_feature()) {
+		dao_dma_lat_flush_mark(vchan);
+		if (vchan->imm_submit)
+			dao_dma_lat_dbell_mark(vchan);
+	}
 	if (dao_dma_has_stats_feature()) {
 		vchan->ptrs += vchan->src_i;
 		vchan->ops++;
@@ -379,6 +885,71 @@ dao_dma_enq_x1(struct dao_dma_vchan_state *vchan, rte_iova_t src, uint32_t src_l
 
 	vchan->src_i = src_i + 1;
 	vchan->dst_i = dst_i + 1;
+	dao_dma_vchan_pend_mark(vchan);
+}
+
+/**
+ * Write small transfer to host window using CPU stores.
+ *
+ * @param vchan
+ *    Vchan state pointer
+ * @param src
+ *    source data IOVA, CPU addressable
+ * @param dst
+ *    Destination data IOVA within window
+ * @param len
+ *    Data length
+ */
+static __rte_always_inline void
+dao_dma_cpu_copy(struct dao_dma_vchan_state *vchan, rte_iova_t src, rte_iova_t dst, uint32_t len)
+{
+	volatile uint8_t *d = (volatile uint8_t *)(vchan->win_va + (dst - vchan->win_iova));
+	const uint8_t *s = (const uint8_t *)(uintptr_t)src;
+
+	/* Device mapping needs naturally aligned accesses */
+	if (!(((uintptr_t)d | (uintptr_t)s | len) & 0x7)) {
+		for (; len; len -= 8, d += 8, s += 8)
+			rte_write64_relaxed(*(const uint64_t *)s, d);
+	} else {
+		for (; len; len--, d++, s++)
+			rte_write8_relaxed(*s, d);
+	}
+	rte_io_wmb();
+}
+
+/**
+ * Enqueue one meta data DMA pointer pair, small transfers may be done by CPU.
+ *
+ * Transfer is done by CPU only when no pointers are waiting to be flushed on
+ * the vchan, so that it cannot overtake them. Space in vchan state is checked
+ * by caller before calling this API
+ *
+ * @param vchan
+ *    Vchan state pointer
+ * @param src
+ *    source data IOVA
+ * @param dst
+ *    Destination data IOVA
+ * @param len
+ *    Data length
+ * @return
+ *    True if transfer was done by CPU, false if enqueued to DMA.
+ */
+static __rte_always_inline bool
+dao_dma_enq_meta_x1(struct dao_dma_vchan_state *vchan, rte_iova_t src, rte_iova_t dst,
+		    uint32_t len)
+{
+	/* Keep order with pointers not yet flushed */
+	if (len <= vchan->cpu_copy_thr && !vchan->src_i && dst >= vchan->win_iova &&
+	    dst + len <= vchan->win_iova + vchan->win_len) {
+		dao_dma_cpu_copy(vchan, src, dst, len);
+		if (dao_dma_has_stats_feature())
+			vchan->cpu_ops++;
+		return true;
+	}
+
+	dao_dma_enq_x1(vchan, src, len, dst, len);
+	return false;
 }
 
 /**
@@ -403,6 +974,7 @@ dao_dma_enq_dst_x1(struct dao_dma_vchan_state *vchan, rte_iova_t dst, uint32_t d
 	vchan->dst[dst_i].length = dst_len;
 
 	vchan->dst_i = dst_i + 1;
+	dao_dma_vchan_pend_mark(vchan);
 }
 
 /**
@@ -427,6 +999,7 @@ dao_dma_enq_src_x1(struct dao_dma_vchan_state *vchan, rte_iova_t src, uint32_t s
 	vchan->src[src_i].length = src_len;
 
 	vchan->src_i = src_i + 1;
+	dao_dma_vchan_pend_mark(vchan);
 }
 
 /**
@@ -450,6 +1023,8 @@ dao_dma_enq_x4(struct dao_dma_vchan_state *vchan, uint64x2_t *vsrc, uint64x2_t *
 	int src_avail = vchan->flush_thr - src_i;
 	int i;
 
+	dao_dma_vchan_pend_mark(vchan);
+
 	src = vchan->src + src_i;
 	dst = vchan->dst + dst_i;
 	if (src_avail >= 4) {
@@ -515,11 +1090,13 @@ dao_dma_check_compl(struct dao_dma_vchan_state *vchan)
 	bool has_err = 0;
 
 	/* Fetch all DMA completed status */
-	cmpl = rte_dma_completed(vchan->devid, vchan->vchan, 128, NULL, &has_err);
+	cmpl = dao_dma_completed(vchan, &has_err);
 	if (unlikely(has_err)) {
 		vchan->dma_compl_errs++;
 		cmpl += 1;
 	}
+	if (dao_dma_has_lat_stats_feature())
+		dao_dma_lat_compl_mark(vchan, cmpl);
 	vchan->head += cmpl;
 }
 
@@ -535,26 +1112,29 @@ dao_dma_check_compl(struct dao_dma_vchan_state *vchan)
 static __rte_always_inline void
 dao_dma_check_meta_compl(struct dao_dma_vchan_state *vchan, const int mem_order)
 {
+	struct dao_dma_cmpl_mdata *mdata;
 	uint32_t cmpl, i, j, idx = 0;
 	bool has_err = 0;
 
 	/* Fetch all DMA completed status */
-	cmpl = rte_dma_completed(vchan->devid, vchan->vchan, 128, NULL, &has_err);
+	cmpl = dao_dma_completed(vchan, &has_err);
 	if (unlikely(has_err)) {
 		vchan->dma_compl_errs++;
 		cmpl += 1;
 	}
+	if (dao_dma_has_lat_stats_feature())
+		dao_dma_lat_compl_mark(vchan, cmpl);
 	for (i = vchan->head; i < vchan->head + cmpl; i++) {
-		idx = i % DAO_DMA_MAX_INFLIGHT_MDATA;
-		for (j = 0; j < vchan->mdata[idx].cnt; j++) {
+		idx = i & vchan->mdata_mask;
+		mdata = &vchan->mdata[idx];
+		for (j = 0; j < mdata->cnt; j++) {
 			if (mem_order)
-				__atomic_store_n(vchan->mdata[idx].ptr[j], vchan->mdata[idx].val[j],
-						 __ATOMIC_RELAXED);
+				__atomic_store_n(mdata->ptr[j], mdata->val[j], __ATOMIC_RELAXED);
 			else
-				*vchan->mdata[idx].ptr[j] = vchan->mdata[idx].val[j];
-			*vchan->mdata[idx].pend_ptr[j] -= vchan->mdata[idx].pend_val[j];
+				*mdata->ptr[j] = mdata->val[j];
+			*mdata->pend_ptr[j] -= mdata->pend_val[j];
 		}
-		vchan->mdata[idx].cnt = 0;
+		mdata->cnt = 0;
 	}
 	vchan->head += cmpl;
 }
@@ -579,14 +1159,15 @@ static __rte_always_inline void
 dao_dma_update_cmpl_meta(struct dao_dma_vchan_state *vchan, uint16_t *ptr, uint16_t val,
 			 uint16_t *pend_ptr, uint16_t pend_val, uint16_t tail)
 {
-	uint16_t idx = tail % DAO_DMA_MAX_INFLIGHT_MDATA;
-	uint16_t j = vchan->mdata[idx].cnt;
-
-	vchan->mdata[idx].ptr[j] = ptr;
-	vchan->mdata[idx].val[j] = val;
-	vchan->mdata[idx].pend_ptr[j] = pend_ptr;
-	vchan->mdata[idx].pend_val[j] = pend_val;
-	vchan->mdata[idx].cnt = j + 1;
+	struct dao_dma_cmpl_mdata *mdata = &vchan->mdata[tail & vchan->mdata_mask];
+	uint16_t j = mdata->cnt;
+
+	mdata->ptr[j] = ptr;
+	mdata->val[j] = val;
+	mdata->pend_ptr[j] = pend_ptr;
+	mdata->pend_val[j] = pend_val;
+	mdata->cnt = j + 1;
+	dao_dma_vchan_pend_mark(vchan);
 }
 
 #endif /* __INCLUDE_DAO_DMA_H__ */
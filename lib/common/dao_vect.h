@@ -0,0 +1,291 @@
+/* SPDX-License-Identifier: Marvell-MIT
+ * Copyright (c) 2024 Marvell.
+ */
+
+/**
+ * @file
+ *
+ * DAO vector helpers
+ *
+ * Fast path kernels are written against the 128-bit NEON intrinsic subset
+ * defined here. On arm64 these are the NEON intrinsics themselves. On other
+ * architectures same named helpers are provided using SSE when available at
+ * build time, or generic C otherwise, so kernels build and behave the same
+ * off-target. Defining DAO_VECT_FORCE_GENERIC before inclusion selects the
+ * generic C helpers for one translation unit, e.g. to test them on SSE hosts.
+ */
+
+#ifndef __INCLUDE_DAO_VECT_H__
+#define __INCLUDE_DAO_VECT_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include <rte_common.h>
+#include <rte_vect.h>
+
+#include <dao_config.h>
+
+#if !defined(RTE_ARCH_ARM64)
+
+#if DAO_VECT_GENERIC || defined(DAO_VECT_FORCE_GENERIC) || !defined(__SSE4_1__)
+/** Generic C implementation of vector helpers in use */
+#define DAO_VECT_IMPL_GENERIC 1
+#else
+/** SSE implementation of vector helpers in use */
+#define DAO_VECT_IMPL_SSE 1
+#endif
+
+/** 16 x 8-bit unsigned vector */
+typedef uint8_t uint8x16_t __attribute__((vector_size(16), aligned(16)));
+/** 4 x 32-bit unsigned vector */
+typedef uint32_t uint32x4_t __attribute__((vector_size(16), aligned(16)));
+/** 2 x 64-bit unsigned vector */
+typedef uint64_t uint64x2_t __attribute__((vector_size(16), aligned(16)));
+
+/** Load 2 x 64-bit lanes from unaligned memory */
+static __rte_always_inline uint64x2_t
+vld1q_u64(const uint64_t *p)
+{
+	uint64x2_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+/** Load 4 x 32-bit lanes from unaligned memory */
+static __rte_always_inline uint32x4_t
+vld1q_u32(const uint32_t *p)
+{
+	uint32x4_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+/** Store 2 x 64-bit lanes to unaligned memory */
+static __rte_always_inline void
+vst1q_u64(uint64_t *p, uint64x2_t v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+
+/** Broadcast 32-bit value to all lanes */
+static __rte_always_inline uint32x4_t
+vdupq_n_u32(uint32_t x)
+{
+	return (uint32x4_t){x, x, x, x};
+}
+
+/** Broadcast 64-bit value to all lanes */
+static __rte_always_inline uint64x2_t
+vdupq_n_u64(uint64_t x)
+{
+	return (uint64x2_t){x, x};
+}
+
+/** Get 32-bit lane */
+static __rte_always_inline uint32_t
+vgetq_lane_u32(uint32x4_t v, const int lane)
+{
+	return v[lane];
+}
+
+/** Get 64-bit lane */
+static __rte_always_inline uint64_t
+vgetq_lane_u64(uint64x2_t v, const int lane)
+{
+	return v[lane];
+}
+
+/** Set 32-bit lane */
+static __rte_always_inline uint32x4_t
+vsetq_lane_u32(uint32_t x, uint32x4_t v, const int lane)
+{
+	v[lane] = x;
+	return v;
+}
+
+/** Set 64-bit lane */
+static __rte_always_inline uint64x2_t
+vsetq_lane_u64(uint64_t x, uint64x2_t v, const int lane)
+{
+	v[lane] = x;
+	return v;
+}
+
+/** Lane wise 64-bit add */
+static __rte_always_inline uint64x2_t
+vaddq_u64(uint64x2_t a, uint64x2_t b)
+{
+	return a + b;
+}
+
+/** Lane wise 32-bit subtract */
+static __rte_always_inline uint32x4_t
+vsubq_u32(uint32x4_t a, uint32x4_t b)
+{
+	return a - b;
+}
+
+/** Lane wise 64-bit subtract */
+static __rte_always_inline uint64x2_t
+vsubq_u64(uint64x2_t a, uint64x2_t b)
+{
+	return a - b;
+}
+
+/** Bitwise and */
+static __rte_always_inline uint32x4_t
+vandq_u32(uint32x4_t a, uint32x4_t b)
+{
+	return a & b;
+}
+
+/** Bitwise and */
+static __rte_always_inline uint64x2_t
+vandq_u64(uint64x2_t a, uint64x2_t b)
+{
+	return a & b;
+}
+
+/** Bitwise or */
+static __rte_always_inline uint32x4_t
+vorrq_u32(uint32x4_t a, uint32x4_t b)
+{
+	return a | b;
+}
+
+/** Lane wise 8-bit shift right */
+static __rte_always_inline uint8x16_t
+vshrq_n_u8(uint8x16_t v, const int n)
+{
+	return v >> n;
+}
+
+/** Lane wise 32-bit shift right */
+static __rte_always_inline uint32x4_t
+vshrq_n_u32(uint32x4_t v, const int n)
+{
+	return v >> n;
+}
+
+/** Lane wise 64-bit shift right */
+static __rte_always_inline uint64x2_t
+vshrq_n_u64(uint64x2_t v, const int n)
+{
+	return v >> n;
+}
+
+/** Lane wise 32-bit unsigned greater than, all ones on true */
+static __rte_always_inline uint32x4_t
+vcgtq_u32(uint32x4_t a, uint32x4_t b)
+{
+	return (uint32x4_t)(a > b);
+}
+
+/** Lane wise 32-bit unsigned less than, all ones on true */
+static __rte_always_inline uint32x4_t
+vcltq_u32(uint32x4_t a, uint32x4_t b)
+{
+	return (uint32x4_t)(a < b);
+}
+
+/** Lane wise 64-bit compare with zero, all ones on true */
+static __rte_always_inline uint64x2_t
+vceqzq_u64(uint64x2_t a)
+{
+	return (uint64x2_t)(a == 0);
+}
+
+/** Lane wise 32-bit unsigned minimum */
+static __rte_always_inline uint32x4_t
+vminq_u32(uint32x4_t a, uint32x4_t b)
+{
+#ifdef DAO_VECT_IMPL_SSE
+	return (uint32x4_t)_mm_min_epu32((__m128i)a, (__m128i)b);
+#else
+	uint32x4_t m = (uint32x4_t)(a < b);
+
+	return (a & m) | (b & ~m);
+#endif
+}
+
+/** Pairwise 64-bit add, low lane from a and high lane from b */
+static __rte_always_inline uint64x2_t
+vpaddq_u64(uint64x2_t a, uint64x2_t b)
+{
+	return (uint64x2_t){a[0] + a[1], b[0] + b[1]};
+}
+
+/** Interleave even 32-bit lanes */
+static __rte_always_inline uint32x4_t
+vtrn1q_u32(uint32x4_t a, uint32x4_t b)
+{
+	return (uint32x4_t){a[0], b[0], a[2], b[2]};
+}
+
+/** Interleave odd 32-bit lanes */
+static __rte_always_inline uint32x4_t
+vtrn2q_u32(uint32x4_t a, uint32x4_t b)
+{
+	return (uint32x4_t){a[1], b[1], a[3], b[3]};
+}
+
+/** Concatenate even 32-bit lanes */
+static __rte_always_inline uint32x4_t
+vuzp1q_u32(uint32x4_t a, uint32x4_t b)
+{
+	return (uint32x4_t){a[0], a[2], b[0], b[2]};
+}
+
+/** Interleave low 32-bit halves */
+static __rte_always_inline uint32x4_t
+vzip1q_u32(uint32x4_t a, uint32x4_t b)
+{
+	return (uint32x4_t){a[0], b[0], a[1], b[1]};
+}
+
+/** Interleave high 32-bit halves */
+static __rte_always_inline uint32x4_t
+vzip2q_u32(uint32x4_t a, uint32x4_t b)
+{
+	return (uint32x4_t){a[2], b[2], a[3], b[3]};
+}
+
+/** Interleave low 64-bit lanes */
+static __rte_always_inline uint64x2_t
+vzip1q_u64(uint64x2_t a, uint64x2_t b)
+{
+	return (uint64x2_t){a[0], b[0]};
+}
+
+/** Interleave high 64-bit lanes */
+static __rte_always_inline uint64x2_t
+vzip2q_u64(uint64x2_t a, uint64x2_t b)
+{
+	return (uint64x2_t){a[1], b[1]};
+}
+
+/** Byte table lookup, out of range index yields zero */
+static __rte_always_inline uint8x16_t
+vqtbl1q_u8(uint8x16_t t, uint8x16_t idx)
+{
+#ifdef DAO_VECT_IMPL_SSE
+	/* pshufb zeroes only on bit 7, force it for indexes 16..127 too */
+	__m128i oor = _mm_cmpgt_epi8((__m128i)idx, _mm_set1_epi8(15));
+
+	return (uint8x16_t)_mm_shuffle_epi8((__m128i)t, _mm_or_si128((__m128i)idx, oor));
+#else
+	uint8x16_t r;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		r[i] = idx[i] < 16 ? t[idx[i] & 0xF] : 0;
+	return r;
+#endif
+}
+
+#endif /* !RTE_ARCH_ARM64 */
+
+#endif /* __INCLUDE_DAO_VECT_H__ */
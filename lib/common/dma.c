@@ -4,7 +4,34 @@
 
 #include "dao_dma.h"
 
+#include <rte_launch.h>
 #include <rte_malloc.h>
+#include <rte_ring.h>
+#include <rte_spinlock.h>
+
+/* Completion notification requests an lcore can have outstanding */
+#define DMA_COMPL_NOTIFY_RING_SZ 64
+
+/* Time after which completion wait progresses requests of stopped lcores itself */
+#define DMA_COMPL_WAIT_TIMEOUT_MS 100
+
+/* Time after which completion wait gives up on lcores that do not poll */
+#define DMA_COMPL_WAIT_MAX_MS 1000
+
+struct dma_compl_req {
+	dao_dma_compl_cb_t cb;
+	void *arg;
+	/* Lcores yet to complete */
+	uint32_t pend;
+	uint16_t vchan;
+};
+
+/* Completion waiter state, shared with callback which can outlive a timed out wait */
+struct dma_compl_waiter {
+	uint32_t done;
+	/* Waiter and callback references */
+	uint32_t ref;
+};
 
 /* DMA device to used for worker cores */
 RTE_DEFINE_PER_LCORE(struct dao_dma_vchan_info *, dao_dma_vchan_info);
@@ -14,17 +41,86 @@ struct dao_dma_vchan_info *vchan_info_p[RTE_MAX_LCORE];
 static int16_t dma_ctrl_dev2mem_id = -1;
 static int16_t dma_ctrl_mem2dev_id = -1;
 
-int
-dao_dma_lcore_dev2mem_set(int16_t dma_devid, uint16_t nb_vchans, uint16_t flush_thr)
+/* Serializes completion waiters polling vchans of stopped lcores */
+static rte_spinlock_t dma_compl_wait_lock = RTE_SPINLOCK_INITIALIZER;
+
+static void
+dma_vchan_state_free(struct dao_dma_vchan_state *state)
+{
+	if (state->lat)
+		rte_free(state->lat->op_ts);
+	rte_free(state->lat);
+	rte_free(state->mdata);
+	rte_free(state);
+}
+
+static struct dao_dma_vchan_state *
+dma_vchan_state_alloc(int16_t dma_devid, uint16_t vchan, uint16_t flush_thr)
+{
+	struct dao_dma_vchan_state *state;
+	struct rte_dma_info info;
+	uint32_t nb_mdata;
+
+	RTE_BUILD_BUG_ON(offsetof(struct dao_dma_vchan_state, src) != RTE_CACHE_LINE_SIZE);
+	RTE_BUILD_BUG_ON(2 * DAO_DMA_MAX_VCHAN_PER_LCORE > UINT8_MAX + 1);
+
+	/* Ops in flight are bounded by vchan descriptors, which device caps at max_desc.
+	 * Current burst capacity is not used as it shrinks with ops already in flight.
+	 */
+	nb_mdata = DAO_DMA_MAX_INFLIGHT_MDATA;
+	if (!rte_dma_info_get(dma_devid, &info) && info.max_desc >= 2)
+		nb_mdata = RTE_MIN(rte_align32pow2(info.max_desc), DAO_DMA_MAX_INFLIGHT_MDATA);
+
+	state = rte_zmalloc_socket("dao_dma_vchan_state", sizeof(*state), RTE_CACHE_LINE_SIZE,
+				   rte_socket_id());
+	if (!state)
+		return NULL;
+
+	state->mdata = rte_zmalloc_socket("dao_dma_cmpl_mdata",
+					  nb_mdata * sizeof(struct dao_dma_cmpl_mdata),
+					  RTE_CACHE_LINE_SIZE, rte_socket_id());
+	if (!state->mdata)
+		goto free;
+
+	if (dao_dma_has_lat_stats_feature()) {
+		state->lat = rte_zmalloc_socket("dao_dma_vchan_lat", sizeof(struct dao_dma_vchan_lat),
+						RTE_CACHE_LINE_SIZE, rte_socket_id());
+		if (!state->lat)
+			goto free;
+		state->lat->op_ts = rte_zmalloc_socket("dao_dma_op_ts", nb_mdata * sizeof(uint64_t),
+						       RTE_CACHE_LINE_SIZE, rte_socket_id());
+		if (!state->lat->op_ts)
+			goto free;
+	}
+
+	state->mdata_mask = nb_mdata - 1;
+	state->devid = dma_devid;
+	state->vchan = vchan;
+	state->flush_thr = flush_thr;
+	state->flush_thr_min = flush_thr;
+	return state;
+free:
+	dma_vchan_state_free(state);
+	return NULL;
+}
+
+static int
+dma_lcore_vchans_set(int16_t dma_devid, uint16_t nb_vchans, uint16_t flush_thr, bool dev2mem)
 {
 	struct dao_dma_vchan_info *vchan_info = RTE_PER_LCORE(dao_dma_vchan_info);
-	uint16_t vchan_idx, i;
+	struct dao_dma_vchan_state **states;
+	uint16_t vchan_idx, *nb_states, i;
 
 	if (!rte_dma_is_valid(dma_devid)) {
 		dao_err("Invalid dma device for worker cores");
 		return -1;
 	}
 
+	if (dao_dma_has_sw_backend() && rte_eal_iova_mode() != RTE_IOVA_VA) {
+		dao_err("Software DMA backend needs IOVA as VA mode");
+		return -ENOTSUP;
+	}
+
 	if (!flush_thr)
 		flush_thr = DAO_DMA_MAX_POINTER_THR_DFLT;
 
@@ -34,16 +130,29 @@ dao_dma_lcore_dev2mem_set(int16_t dma_devid, uint16_t nb_vchans, uint16_t flush_
 	}
 
 	if (!vchan_info) {
+		char name[RTE_RING_NAMESIZE];
+
 		vchan_info = rte_zmalloc("vchan_info", sizeof(struct dao_dma_vchan_info),
 					 RTE_CACHE_LINE_SIZE);
 		if (!vchan_info)
 			return -ENOMEM;
+
+		snprintf(name, sizeof(name), "dao_dma_notify_%u", rte_lcore_id());
+		vchan_info->notify_ring = rte_ring_create(name, DMA_COMPL_NOTIFY_RING_SZ,
+							  rte_socket_id(), RING_F_SC_DEQ);
+		if (!vchan_info->notify_ring) {
+			rte_free(vchan_info);
+			return -ENOMEM;
+		}
 		RTE_PER_LCORE(dao_dma_vchan_info) = vchan_info;
 
 		vchan_info_p[rte_lcore_id()] = vchan_info;
 	}
 
-	vchan_idx = vchan_info->nb_dev2mem;
+	states = dev2mem ? vchan_info->dev2mem : vchan_info->mem2dev;
+	nb_states = dev2mem ? &vchan_info->nb_dev2mem : &vchan_info->nb_mem2dev;
+
+	vchan_idx = *nb_states;
 	if (vchan_idx + nb_vchans >= DAO_DMA_MAX_VCHAN_PER_LCORE) {
 		dao_err("Cannot have more than %u dma rings per lcore",
 			DAO_DMA_MAX_VCHAN_PER_LCORE);
@@ -51,63 +160,98 @@ dao_dma_lcore_dev2mem_set(int16_t dma_devid, uint16_t nb_vchans, uint16_t flush_
 	}
 
 	for (i = 0; i < nb_vchans; i++) {
-		vchan_info->dev2mem[vchan_idx + i].devid = dma_devid;
-		vchan_info->dev2mem[vchan_idx + i].vchan = i;
-		vchan_info->dev2mem[vchan_idx + i].flush_thr = flush_thr;
+		states[vchan_idx + i] = dma_vchan_state_alloc(dma_devid, i, flush_thr);
+		if (!states[vchan_idx + i])
+			goto free;
+		states[vchan_idx + i]->pend_idx =
+			vchan_idx + i + (dev2mem ? 0 : DAO_DMA_MAX_VCHAN_PER_LCORE);
 	}
-	vchan_info->nb_dev2mem += nb_vchans;
+	*nb_states += nb_vchans;
 
-	dao_dbg("Lcore=%u, dev2mem_id=%d, vchans=%u, flush_thr=%d", rte_lcore_id(), dma_devid,
-		nb_vchans, flush_thr);
+	dao_dbg("Lcore=%u, %s_id=%d, vchans=%u, flush_thr=%d", rte_lcore_id(),
+		dev2mem ? "dev2mem" : "mem2dev", dma_devid, nb_vchans, flush_thr);
 	return 0;
+free:
+	dao_err("Failed to allocate dma vchan state");
+	while (i--) {
+		dma_vchan_state_free(states[vchan_idx + i]);
+		states[vchan_idx + i] = NULL;
+	}
+	return -ENOMEM;
+}
+
+int
+dao_dma_lcore_dev2mem_set(int16_t dma_devid, uint16_t nb_vchans, uint16_t flush_thr)
+{
+	return dma_lcore_vchans_set(dma_devid, nb_vchans, flush_thr, true);
 }
 
 int
 dao_dma_lcore_mem2dev_set(int16_t dma_devid, uint16_t nb_vchans, uint16_t flush_thr)
+{
+	return dma_lcore_vchans_set(dma_devid, nb_vchans, flush_thr, false);
+}
+
+static int
+dma_lcore_stripe_set(const int16_t *dma_devids, uint16_t nb_devs, uint16_t nb_vchans,
+		     uint16_t flush_thr, bool dev2mem)
 {
 	struct dao_dma_vchan_info *vchan_info = RTE_PER_LCORE(dao_dma_vchan_info);
-	uint16_t vchan_idx, i;
+	struct dao_dma_vchan_state **states;
+	uint16_t *nb_states, i;
+	int rc;
 
-	if (!rte_dma_is_valid(dma_devid)) {
-		dao_err("Invalid dma device for worker cores");
-		return -1;
+	if (!nb_devs || nb_devs > UINT8_MAX || !nb_vchans) {
+		dao_err("Invalid dma stripe config, devs=%u vchans=%u", nb_devs, nb_vchans);
+		return -EINVAL;
 	}
 
-	if (!flush_thr)
-		flush_thr = DAO_DMA_MAX_POINTER_THR_DFLT;
-
-	if (flush_thr > DAO_DMA_MAX_POINTER) {
-		dao_err("Unsupported flush threshold %u\n", flush_thr);
-		return -1;
+	if (vchan_info && (dev2mem ? vchan_info->nb_dev2mem : vchan_info->nb_mem2dev)) {
+		dao_err("Lcore already has %s vchans assigned", dev2mem ? "dev2mem" : "mem2dev");
+		return -EEXIST;
 	}
 
-	if (!vchan_info) {
-		vchan_info = rte_zmalloc("vchan_info", sizeof(struct dao_dma_vchan_info),
-					 RTE_CACHE_LINE_SIZE);
-		if (!vchan_info)
-			return -ENOMEM;
-		RTE_PER_LCORE(dao_dma_vchan_info) = vchan_info;
-
-		vchan_info_p[rte_lcore_id()] = vchan_info;
+	for (i = 0; i < nb_devs; i++) {
+		rc = dma_lcore_vchans_set(dma_devids[i], nb_vchans, flush_thr, dev2mem);
+		if (rc)
+			goto free;
 	}
 
-	vchan_idx = vchan_info->nb_mem2dev;
-	if (vchan_idx + nb_vchans >= DAO_DMA_MAX_VCHAN_PER_LCORE) {
-		dao_err("Cannot have more than %u dma rings per lcore",
-			DAO_DMA_MAX_VCHAN_PER_LCORE);
-		return -1;
+	vchan_info = RTE_PER_LCORE(dao_dma_vchan_info);
+	if (dev2mem) {
+		vchan_info->nb_dev2mem_stripes = nb_devs;
+		vchan_info->dev2mem_stride = nb_vchans;
+	} else {
+		vchan_info->nb_mem2dev_stripes = nb_devs;
+		vchan_info->mem2dev_stride = nb_vchans;
 	}
-
-	for (i = 0; i < nb_vchans; i++) {
-		vchan_info->mem2dev[vchan_idx + i].devid = dma_devid;
-		vchan_info->mem2dev[vchan_idx + i].vchan = i;
-		vchan_info->mem2dev[vchan_idx + i].flush_thr = flush_thr;
+	return 0;
+free:
+	vchan_info = RTE_PER_LCORE(dao_dma_vchan_info);
+	if (!vchan_info)
+		return rc;
+	states = dev2mem ? vchan_info->dev2mem : vchan_info->mem2dev;
+	nb_states = dev2mem ? &vchan_info->nb_dev2mem : &vchan_info->nb_mem2dev;
+	while (*nb_states) {
+		(*nb_states)--;
+		dma_vchan_state_free(states[*nb_states]);
+		states[*nb_states] = NULL;
 	}
-	vchan_info->nb_mem2dev += nb_vchans;
+	return rc;
+}
 
-	dao_dbg("Lcore=%u, mem2dev_id=%d, vchans=%u, flush_thr=%d", rte_lcore_id(), dma_devid,
-		nb_vchans, flush_thr);
-	return 0;
+int
+dao_dma_lcore_dev2mem_stripe_set(const int16_t *dma_devids, uint16_t nb_devs, uint16_t nb_vchans,
+				 uint16_t flush_thr)
+{
+	return dma_lcore_stripe_set(dma_devids, nb_devs, nb_vchans, flush_thr, true);
+}
+
+int
+dao_dma_lcore_mem2dev_stripe_set(const int16_t *dma_devids, uint16_t nb_devs, uint16_t nb_vchans,
+				 uint16_t flush_thr)
+{
+	return dma_lcore_stripe_set(dma_devids, nb_devs, nb_vchans, flush_thr, false);
 }
 
 int
@@ -119,10 +263,14 @@ dao_dma_lcore_mem2dev_autofree_set(int16_t mem2dev_id, uint16_t vchan, bool enab
 	if (!vchan_info)
 		return -ENOMEM;
 
+	/* CPU copies cannot free source buffers to the device pool */
+	if (dao_dma_has_sw_backend() && enable)
+		return -ENOTSUP;
+
 	for (i = 0; i < vchan_info->nb_mem2dev; i++) {
-		if (vchan_info->mem2dev[i].devid == mem2dev_id &&
-		    vchan_info->mem2dev[i].vchan == vchan) {
-			vchan_info->mem2dev[i].auto_free = enable;
+		if (vchan_info->mem2dev[i]->devid == mem2dev_id &&
+		    vchan_info->mem2dev[i]->vchan == vchan) {
+			vchan_info->mem2dev[i]->auto_free = enable;
 			break;
 		}
 	}
@@ -132,6 +280,41 @@ dao_dma_lcore_mem2dev_autofree_set(int16_t mem2dev_id, uint16_t vchan, bool enab
 	return 0;
 }
 
+int
+dao_dma_lcore_mem2dev_cpu_copy_set(int16_t mem2dev_id, uint16_t vchan, uint32_t thr,
+				   rte_iova_t win_iova, void *win_va, size_t win_len)
+{
+	struct dao_dma_vchan_info *vchan_info = RTE_PER_LCORE(dao_dma_vchan_info);
+	struct dao_dma_vchan_state *state;
+	int i;
+
+	if (!vchan_info)
+		return -ENOMEM;
+
+	/* Source of CPU copy is used as address */
+	if (thr && (rte_eal_iova_mode() != RTE_IOVA_VA || !win_va || !win_len)) {
+		dao_err("CPU copy needs IOVA as VA and a mapped window");
+		return -EINVAL;
+	}
+
+	for (i = 0; i < vchan_info->nb_mem2dev; i++) {
+		state = vchan_info->mem2dev[i];
+		if (state->devid == mem2dev_id && state->vchan == vchan)
+			break;
+	}
+
+	if (i == vchan_info->nb_mem2dev)
+		return -ENOENT;
+
+	state->win_iova = win_iova;
+	state->win_va = (uintptr_t)win_va;
+	state->win_len = win_len;
+	state->cpu_copy_thr = thr;
+	dao_dbg("Lcore=%u, mem2dev_id=%d, vchan=%u, cpu copy thr=%u", rte_lcore_id(), mem2dev_id,
+		vchan, thr);
+	return 0;
+}
+
 int
 dao_dma_ctrl_dev_set(int16_t dev2mem_id, int16_t mem2dev_devid)
 {
@@ -169,17 +352,19 @@ dao_dma_stats_get(uint16_t lcore_id, struct dao_dma_stats *stats)
 
 		stats->nb_dev2mem = vchan_info->nb_dev2mem;
 		for (i = 0; i < vchan_info->nb_dev2mem; i++) {
-			stats->dev2mem[i].ptrs = vchan_info->dev2mem[i].ptrs;
-			stats->dev2mem[i].ops = vchan_info->dev2mem[i].ops;
-			stats->dev2mem[i].dbells = vchan_info->dev2mem[i].dbells;
-			stats->dev2mem[i].enq_errs = vchan_info->dev2mem[i].dma_enq_errs;
+			stats->dev2mem[i].ptrs = vchan_info->dev2mem[i]->ptrs;
+			stats->dev2mem[i].ops = vchan_info->dev2mem[i]->ops;
+			stats->dev2mem[i].dbells = vchan_info->dev2mem[i]->dbells;
+			stats->dev2mem[i].enq_errs = vchan_info->dev2mem[i]->dma_enq_errs;
+			stats->dev2mem[i].cpu_ops = vchan_info->dev2mem[i]->cpu_ops;
 		}
 		stats->nb_mem2dev = vchan_info->nb_mem2dev;
 		for (i = 0; i < vchan_info->nb_mem2dev; i++) {
-			stats->mem2dev[i].ptrs = vchan_info->mem2dev[i].ptrs;
-			stats->mem2dev[i].ops = vchan_info->mem2dev[i].ops;
-			stats->mem2dev[i].dbells = vchan_info->mem2dev[i].dbells;
-			stats->mem2dev[i].enq_errs = vchan_info->mem2dev[i].dma_enq_errs;
+			stats->mem2dev[i].ptrs = vchan_info->mem2dev[i]->ptrs;
+			stats->mem2dev[i].ops = vchan_info->mem2dev[i]->ops;
+			stats->mem2dev[i].dbells = vchan_info->mem2dev[i]->dbells;
+			stats->mem2dev[i].enq_errs = vchan_info->mem2dev[i]->dma_enq_errs;
+			stats->mem2dev[i].cpu_ops = vchan_info->mem2dev[i]->cpu_ops;
 		}
 	} else {
 		return -ENOENT;
@@ -187,66 +372,358 @@ dao_dma_stats_get(uint16_t lcore_id, struct dao_dma_stats *stats)
 	return 0;
 }
 
+int
+dao_dma_lat_stats_get(uint16_t lcore_id, bool dev2mem, uint16_t vchan,
+		      struct dao_dma_vchan_lat_stats *stats)
+{
+	struct dao_dma_vchan_info *vchan_info;
+	struct dao_dma_vchan_state *state;
+
+	memset(stats, 0, sizeof(*stats));
+	if (!dao_dma_has_lat_stats_feature())
+		return -ENOTSUP;
+
+	if (lcore_id >= RTE_MAX_LCORE || !vchan_info_p[lcore_id])
+		return -ENOENT;
+
+	vchan_info = vchan_info_p[lcore_id];
+	if (vchan >= (dev2mem ? vchan_info->nb_dev2mem : vchan_info->nb_mem2dev))
+		return -ENOENT;
+
+	state = dev2mem ? vchan_info->dev2mem[vchan] : vchan_info->mem2dev[vchan];
+	/* Histograms are updated by owner lcore without sync, values are approximate */
+	memcpy(stats, &state->lat->stats, sizeof(*stats));
+	return 0;
+}
+
+static __rte_always_inline void
+dma_vchan_submit(struct dao_dma_vchan_state *state)
+{
+	rte_dma_submit(state->devid, state->vchan);
+	state->pend_ops = 0;
+	if (dao_dma_has_stats_feature())
+		state->dbells++;
+	if (dao_dma_has_lat_stats_feature())
+		dao_dma_lat_dbell_mark(state);
+}
+
+/* Returns true when doorbell of pending ops is deferred to a later call */
+static __rte_always_inline bool
+dma_vchan_adapt(struct dao_dma_vchan_state *state, uint64_t deadline, uint64_t now)
+{
+	uint16_t arrived = state->tail - state->adapt_tail;
+	uint16_t depth = state->tail - state->head - state->pend_ops;
+
+	state->adapt_tail = state->tail;
+
+	/* SGE's filling up more than once between calls, batch more per op */
+	if (arrived > 1) {
+		if (state->flush_thr < DAO_DMA_MAX_POINTER)
+			state->flush_thr++;
+	} else if (state->flush_thr > state->flush_thr_min &&
+		   state->flush_thr > RTE_MAX(state->src_i, state->dst_i)) {
+		/* Never below pointers left by a failed flush, avail would go negative */
+		state->flush_thr--;
+	}
+
+	/* Idle DMA queue, ring doorbell with each op instead of waiting for next call */
+	state->imm_submit = depth <= DAO_DMA_ADAPT_IDLE_DEPTH;
+
+	if (!state->pend_ops)
+		return false;
+
+	if (!state->pend_tsc)
+		state->pend_tsc = now;
+
+	if (!state->imm_submit && state->pend_ops < DAO_DMA_ADAPT_DBELL_OPS &&
+	    now - state->pend_tsc < deadline)
+		return true;
+
+	dma_vchan_submit(state);
+	state->pend_tsc = 0;
+	return false;
+}
+
 int
 dao_dma_flush_submit(void)
 {
 	struct dao_dma_vchan_info *vchan_info = RTE_PER_LCORE(dao_dma_vchan_info);
-	uint16_t i = 0, nb_dev2mem, nb_mem2dev;
 	struct dao_dma_vchan_state *state;
+	uint64_t now = 0;
+	uint16_t w, idx;
+	uint64_t bmap;
+
+	if (vchan_info->adaptive)
+		now = rte_rdtsc();
+
+	/* Visit only vchans that were enqueued to since last call */
+	for (w = 0; w < RTE_DIM(vchan_info->pend_bmap); w++) {
+		bmap = vchan_info->pend_bmap[w];
+		if (likely(!bmap))
+			continue;
+		vchan_info->pend_bmap[w] = 0;
 
-	nb_dev2mem = vchan_info->nb_dev2mem;
-	nb_mem2dev = vchan_info->nb_mem2dev;
+		while (bmap) {
+			idx = (w << 6) + rte_ctz64(bmap);
+			bmap &= bmap - 1;
 
-	for (i = 0; i < nb_dev2mem; i++) {
-		state = &vchan_info->dev2mem[i];
+			state = idx < DAO_DMA_MAX_VCHAN_PER_LCORE ?
+					vchan_info->dev2mem[idx] :
+					vchan_info->mem2dev[idx - DAO_DMA_MAX_VCHAN_PER_LCORE];
 
-		dao_dma_flush(state, DAO_DMA_MAX_POINTER);
+			/* Retry on next call if pointers could not be flushed */
+			if (unlikely(!dao_dma_flush(state, DAO_DMA_MAX_POINTER)))
+				vchan_info->pend_bmap[w] |= RTE_BIT64(idx & 0x3F);
 
-		if (likely(state->pend_ops)) {
-			rte_dma_submit(state->devid, state->vchan);
-			state->pend_ops = 0;
-			if (dao_dma_has_stats_feature())
-				state->dbells++;
+			if (vchan_info->adaptive) {
+				if (dma_vchan_adapt(state, vchan_info->dbell_deadline, now))
+					vchan_info->pend_bmap[w] |= RTE_BIT64(idx & 0x3F);
+				continue;
+			}
+
+			if (likely(state->pend_ops))
+				dma_vchan_submit(state);
 		}
 	}
 
-	for (i = 0; i < nb_mem2dev; i++) {
-		state = &vchan_info->mem2dev[i];
-		dao_dma_flush(state, DAO_DMA_MAX_POINTER);
+	dao_dma_compl_poll();
+	return 0;
+}
 
-		if (likely(state->pend_ops)) {
-			rte_dma_submit(state->devid, state->vchan);
-			state->pend_ops = 0;
-			if (dao_dma_has_stats_feature())
-				state->dbells++;
-		}
+int
+dao_dma_lcore_flush_adaptive_set(bool enable, uint32_t deadline_us)
+{
+	struct dao_dma_vchan_info *vchan_info = RTE_PER_LCORE(dao_dma_vchan_info);
+	struct dao_dma_vchan_state *state;
+	int i;
+
+	if (!vchan_info)
+		return -ENOMEM;
+
+	/* Software backend has no doorbell to coalesce */
+	if (dao_dma_has_sw_backend() && enable)
+		return -ENOTSUP;
+
+	for (i = 0; i < 2 * DAO_DMA_MAX_VCHAN_PER_LCORE; i++) {
+		state = i < DAO_DMA_MAX_VCHAN_PER_LCORE ?
+				vchan_info->dev2mem[i] :
+				vchan_info->mem2dev[i - DAO_DMA_MAX_VCHAN_PER_LCORE];
+		if (!state)
+			continue;
+		state->flush_thr = RTE_MAX(state->flush_thr_min,
+					   RTE_MAX(state->src_i, state->dst_i));
+		state->imm_submit = 0;
+		state->adapt_tail = state->tail;
+		/* Ops pending on disable are submitted by next flush submit */
+		state->pend_tsc = 0;
+		dao_dma_vchan_pend_mark(state);
 	}
 
+	vchan_info->dbell_deadline = (rte_get_tsc_hz() * deadline_us) / 1000000;
+	vchan_info->adaptive = enable;
+	dao_dbg("Lcore=%u, adaptive flush %s, deadline=%uus", rte_lcore_id(),
+		enable ? "enabled" : "disabled", deadline_us);
 	return 0;
 }
 
+static void
+dma_compl_notify_done(struct dma_compl_req *req)
+{
+	if (__atomic_sub_fetch(&req->pend, 1, __ATOMIC_ACQ_REL))
+		return;
+
+	req->cb(req->vchan, req->arg);
+	rte_free(req);
+}
+
+/* Returns true when ops of vchan on all stripes reached notify tail */
+static bool
+dma_vchans_notify_check(struct dao_dma_vchan_state **states, uint16_t nb_states,
+			uint8_t nb_stripes, uint16_t stride, uint16_t vchan, bool snap)
+{
+	struct dao_dma_vchan_state *state;
+	bool done = true;
+	uint16_t i, idx;
+
+	/* Vchan of a queue can be on any of the striped devices */
+	for (i = 0; i < RTE_MAX(nb_stripes, 1); i++) {
+		idx = i * stride + vchan;
+		if (idx >= nb_states)
+			break;
+		state = states[idx];
+		if (snap) {
+			dao_dma_flush(state, DAO_DMA_MAX_POINTER);
+			if (state->pend_ops)
+				dma_vchan_submit(state);
+			state->notify_tail = state->tail;
+		}
+		if ((int16_t)(state->head - state->notify_tail) < 0)
+			dao_dma_check_meta_compl(state, 1);
+		if ((int16_t)(state->head - state->notify_tail) < 0)
+			done = false;
+	}
+	return done;
+}
+
+static void
+dma_compl_notify_process(struct dao_dma_vchan_info *vchan_info)
+{
+	struct dma_compl_req *req = vchan_info->notify_req;
+	bool snap = false, d2m, m2d;
+
+	if (!req) {
+		if (rte_ring_sc_dequeue(vchan_info->notify_ring, (void **)&req))
+			return;
+		vchan_info->notify_taken++;
+		vchan_info->notify_req = req;
+		snap = true;
+	}
+
+	/* Ops flushed after the request was taken are not waited for */
+	d2m = dma_vchans_notify_check(vchan_info->dev2mem, vchan_info->nb_dev2mem,
+				      vchan_info->nb_dev2mem_stripes, vchan_info->dev2mem_stride,
+				      req->vchan, snap);
+	m2d = dma_vchans_notify_check(vchan_info->mem2dev, vchan_info->nb_mem2dev,
+				      vchan_info->nb_mem2dev_stripes, vchan_info->mem2dev_stride,
+				      req->vchan, snap);
+	if (!d2m || !m2d)
+		return;
+
+	vchan_info->notify_req = NULL;
+	dma_compl_notify_done(req);
+}
+
 void
-dao_dma_compl_wait(uint16_t vchan)
+dao_dma_compl_poll(void)
+{
+	struct dao_dma_vchan_info *vchan_info = RTE_PER_LCORE(dao_dma_vchan_info);
+
+	if (!vchan_info)
+		return;
+
+	if (unlikely(vchan_info->notify_req ||
+		     __atomic_load_n(&vchan_info->notify_posted, __ATOMIC_ACQUIRE) !=
+			     vchan_info->notify_taken))
+		dma_compl_notify_process(vchan_info);
+}
+
+int
+dao_dma_compl_notify(uint16_t vchan, dao_dma_compl_cb_t cb, void *arg)
 {
-	struct dao_dma_vchan_state *dev2mem, *mem2dev;
 	struct dao_dma_vchan_info *vchan_info;
+	struct dma_compl_req *req;
 	uint32_t lcore_id;
+	int rc = 0;
+
+	req = rte_zmalloc("dao_dma_compl_req", sizeof(*req), 0);
+	if (!req)
+		return -ENOMEM;
+
+	req->cb = cb;
+	req->arg = arg;
+	req->vchan = vchan;
+	/* Hold a reference while posting so callback fires only after all posts */
+	req->pend = 1;
 
 	for (lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++) {
-		if (rte_lcore_is_enabled(lcore_id) == 0 || lcore_id == rte_get_main_lcore())
+		if (rte_lcore_is_enabled(lcore_id) == 0)
 			continue;
 
 		vchan_info = vchan_info_p[lcore_id];
 		if (!vchan_info)
 			continue;
-		/* All queues use same vchan */
-		dev2mem = &vchan_info->dev2mem[vchan];
-		mem2dev = &vchan_info->mem2dev[vchan];
-		while (dev2mem->head != dev2mem->tail)
-			dao_dma_check_compl(dev2mem);
+		if (vchan >= vchan_info->nb_dev2mem || vchan >= vchan_info->nb_mem2dev)
+			continue;
+
+		__atomic_add_fetch(&req->pend, 1, __ATOMIC_RELAXED);
+		if (rte_ring_mp_enqueue(vchan_info->notify_ring, req)) {
+			dao_err("Completion notify ring full on lcore %u", lcore_id);
+			__atomic_sub_fetch(&req->pend, 1, __ATOMIC_RELAXED);
+			rc = -ENOSPC;
+			continue;
+		}
+		__atomic_add_fetch(&vchan_info->notify_posted, 1, __ATOMIC_RELEASE);
+	}
+
+	dma_compl_notify_done(req);
+	return rc;
+}
+
+static void
+dma_compl_waiter_put(struct dma_compl_waiter *waiter)
+{
+	if (!__atomic_sub_fetch(&waiter->ref, 1, __ATOMIC_ACQ_REL))
+		rte_free(waiter);
+}
+
+static void
+dma_compl_wait_cb(uint16_t vchan, void *arg)
+{
+	struct dma_compl_waiter *waiter = arg;
 
-		while (mem2dev->head != mem2dev->tail)
-			dao_dma_check_compl(mem2dev);
+	RTE_SET_USED(vchan);
+	__atomic_store_n(&waiter->done, 1, __ATOMIC_RELEASE);
+	dma_compl_waiter_put(waiter);
+}
+
+/* Progress requests posted to worker lcores that are not running a launched function */
+static void
+dma_compl_stopped_lcores_poll(void)
+{
+	struct dao_dma_vchan_info *vchan_info;
+	uint32_t lcore_id;
+
+	rte_spinlock_lock(&dma_compl_wait_lock);
+	RTE_LCORE_FOREACH_WORKER(lcore_id) {
+		vchan_info = vchan_info_p[lcore_id];
+		if (!vchan_info || lcore_id == rte_lcore_id())
+			continue;
+		if (rte_eal_get_lcore_state(lcore_id) == RUNNING)
+			continue;
+
+		if (vchan_info->notify_req ||
+		    __atomic_load_n(&vchan_info->notify_posted, __ATOMIC_ACQUIRE) !=
+			    vchan_info->notify_taken)
+			dma_compl_notify_process(vchan_info);
+	}
+	rte_spinlock_unlock(&dma_compl_wait_lock);
+}
+
+int
+dao_dma_compl_wait(uint16_t vchan)
+{
+	struct dma_compl_waiter *waiter;
+	uint64_t timeout, deadline;
+	int rc = 0;
+
+	waiter = rte_zmalloc("dao_dma_compl_waiter", sizeof(*waiter), 0);
+	if (!waiter)
+		return -ENOMEM;
+	waiter->ref = 2;
+
+	if (dao_dma_compl_notify(vchan, dma_compl_wait_cb, waiter))
+		dao_err("Not all lcores notified for vchan %u completion", vchan);
+
+	timeout = rte_get_timer_cycles() + (rte_get_timer_hz() * DMA_COMPL_WAIT_TIMEOUT_MS) / 1000;
+	deadline = rte_get_timer_cycles() + (rte_get_timer_hz() * DMA_COMPL_WAIT_MAX_MS) / 1000;
+	while (!__atomic_load_n(&waiter->done, __ATOMIC_ACQUIRE)) {
+		/* Caller may own the vchan itself */
+		dao_dma_compl_poll();
+
+		/* Owning lcore may have stopped, its vchan state is free to poll */
+		if (rte_get_timer_cycles() > timeout)
+			dma_compl_stopped_lcores_poll();
+
+		/* Main lcore or a running worker owning the vchan is not polling */
+		if (rte_get_timer_cycles() > deadline) {
+			dao_err("Timed out waiting for vchan %u completion", vchan);
+			rc = -ETIMEDOUT;
+			break;
+		}
+		rte_delay_us_sleep(10);
 	}
 	rte_io_wmb();
+	/* Callback frees the waiter if it has not fired yet */
+	dma_compl_waiter_put(waiter);
+	return rc;
 }
@@ -6,7 +6,9 @@
 #define __INCLUDE_VIRTIO_H__
 
 /** Device feature lower 32 bits */
-#define VIRTIO_F_ANY_LAYOUT 27
+#define VIRTIO_F_ANY_LAYOUT     27
+#define VIRTIO_F_INDIRECT_DESC  28
+#define VIRTIO_F_RING_EVENT_IDX 29
 
 /** Device feature higher 32 bits */
 #define VIRTIO_F_VERSION_1         32
@@ -34,6 +36,11 @@
 #define VIRT_PACKED_RING_DESC_F_AVAIL_USED                                                         \
 	(VIRT_PACKED_RING_DESC_F_AVAIL | VIRT_PACKED_RING_DESC_F_USED)
 
+/** This means the driver does not want to be interrupted on used buffers (split ring) */
+#define VRING_AVAIL_F_NO_INTERRUPT 1
+/** This means the device does not want to be notified on avail buffers (split ring) */
+#define VRING_USED_F_NO_NOTIFY 1
+
 #define RING_EVENT_FLAGS_ENABLE  0x0
 #define RING_EVENT_FLAGS_DISABLE 0x1
 #define RING_EVENT_FLAGS_DESC    0x2
@@ -74,4 +81,44 @@ struct vring_packed_desc {
 	uint16_t flags;
 };
 
+/** Virtio split ring descriptor */
+struct vring_desc {
+	/** Buffer address */
+	uint64_t addr;
+	/** Length */
+	uint32_t len;
+	/** Descriptor flags */
+	uint16_t flags;
+	/** Next descriptor index when VRING_DESC_F_NEXT is set */
+	uint16_t next;
+};
+
+/** Virtio split ring available ring header, followed by ring entries */
+struct vring_avail {
+	/** Flags */
+	uint16_t flags;
+	/** Index of next available ring entry to be written by driver */
+	uint16_t idx;
+	/** Ring of descriptor chain heads */
+	uint16_t ring[];
+};
+
+/** Virtio split ring used element */
+struct vring_used_elem {
+	/** Index of start of used descriptor chain */
+	uint32_t id;
+	/** Total length of the descriptor chain which was written to */
+	uint32_t len;
+};
+
+/** Virtio split ring used ring header, followed by ring entries */
+struct vring_used {
+	/** Flags */
+	uint16_t flags;
+	/** Index of next used ring entry to be written by device */
+	uint16_t idx;
+	/** Ring of used elements */
+	struct vring_used_elem ring[];
+};
+
 #endif /* __INCLUDE_VIRTIO_H__ */
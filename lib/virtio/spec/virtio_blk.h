@@ -0,0 +1,89 @@
+/* SPDX-License-Identifier: Marvell-Proprietary
+ * Copyright (c) 2024 Marvell
+ */
+
+#ifndef __INCLUDE_VIRTIO_BLK_H__
+#define __INCLUDE_VIRTIO_BLK_H__
+
+#include <stdint.h>
+
+/** The feature bitmap for virtio blk */
+#define VIRTIO_BLK_F_SIZE_MAX     1  /** Indicates maximum segment size */
+#define VIRTIO_BLK_F_SEG_MAX      2  /** Indicates maximum # of segments */
+#define VIRTIO_BLK_F_GEOMETRY     4  /** Legacy geometry available */
+#define VIRTIO_BLK_F_RO           5  /** Disk is read-only */
+#define VIRTIO_BLK_F_BLK_SIZE     6  /** Block size of disk is available */
+#define VIRTIO_BLK_F_FLUSH        9  /** Cache flush command support */
+#define VIRTIO_BLK_F_TOPOLOGY     10 /** Topology information is available */
+#define VIRTIO_BLK_F_CONFIG_WCE   11 /** Writeback mode available in config */
+#define VIRTIO_BLK_F_MQ           12 /** Support more than one vq */
+#define VIRTIO_BLK_F_DISCARD      13 /** DISCARD is supported */
+#define VIRTIO_BLK_F_WRITE_ZEROES 14 /** WRITE ZEROES is supported */
+
+/** Request types */
+#define VIRTIO_BLK_T_IN           0
+#define VIRTIO_BLK_T_OUT          1
+#define VIRTIO_BLK_T_FLUSH        4
+#define VIRTIO_BLK_T_GET_ID       8
+#define VIRTIO_BLK_T_DISCARD      11
+#define VIRTIO_BLK_T_WRITE_ZEROES 13
+
+/** Request status */
+#define VIRTIO_BLK_S_OK     0
+#define VIRTIO_BLK_S_IOERR  1
+#define VIRTIO_BLK_S_UNSUPP 2
+
+/** Sector size used by request header and capacity, independent of block size */
+#define VIRTIO_BLK_SECTOR_SHIFT 9
+
+/** Length of device id string returned by VIRTIO_BLK_T_GET_ID */
+#define VIRTIO_BLK_ID_BYTES 20
+
+struct virtio_blk_geometry {
+	uint16_t cylinders;
+	uint8_t heads;
+	uint8_t sectors;
+} __rte_packed;
+
+struct virtio_blk_config {
+	/** The capacity (in 512-byte sectors) */
+	uint64_t capacity;
+	/** The maximum segment size (if VIRTIO_BLK_F_SIZE_MAX) */
+	uint32_t size_max;
+	/** The maximum number of segments (if VIRTIO_BLK_F_SEG_MAX) */
+	uint32_t seg_max;
+	/** Geometry of the device (if VIRTIO_BLK_F_GEOMETRY) */
+	struct virtio_blk_geometry geometry;
+	/** Block size of device (if VIRTIO_BLK_F_BLK_SIZE) */
+	uint32_t blk_size;
+	/** Topology of the device (if VIRTIO_BLK_F_TOPOLOGY) */
+	uint8_t physical_block_exp;
+	uint8_t alignment_offset;
+	uint16_t min_io_size;
+	uint32_t opt_io_size;
+	/** Writeback mode (if VIRTIO_BLK_F_CONFIG_WCE) */
+	uint8_t wce;
+	uint8_t unused;
+	/** Number of vqs, only available when VIRTIO_BLK_F_MQ is set */
+	uint16_t num_queues;
+	/** Discard and write zeroes limits (if VIRTIO_BLK_F_DISCARD, VIRTIO_BLK_F_WRITE_ZEROES) */
+	uint32_t max_discard_sectors;
+	uint32_t max_discard_seg;
+	uint32_t discard_sector_alignment;
+	uint32_t max_write_zeroes_sectors;
+	uint32_t max_write_zeroes_seg;
+	uint8_t write_zeroes_may_unmap;
+	uint8_t unused1[3];
+} __rte_packed;
+
+/** Request header, first device readable bytes of each request */
+struct virtio_blk_outhdr {
+	/** VIRTIO_BLK_T* */
+	uint32_t type;
+	/** io priority. */
+	uint32_t ioprio;
+	/** Sector (ie. 512 byte offset) */
+	uint64_t sector;
+};
+
+#endif /* __INCLUDE_VIRTIO_BLK_H__ */
@@ -27,6 +27,18 @@ struct virtio_ctrl_queue {
 	struct virtio_dev *dev;
 
 	uint16_t sd_desc_off;
+	/* Split ring info */
+	uintptr_t avail_base;
+	uintptr_t used_base;
+	uint16_t used_idx;
+	uint16_t sd_avail_ent;
+	uint16_t sd_used_idx;
+	/* Avail index read back after publishing avail_event, with event index */
+	uint16_t avail_event;
+	uint16_t sd_avail_idx;
+	struct vring_used_elem sd_used_elem;
+	/* Shadow of indirect descriptor table */
+	uint64_t sd_ind_desc[DAO_DMA_MAX_POINTER * 2];
 	/* Shadow Ring space */
 	uint64_t sd_desc_base[] __rte_cache_aligned;
 } __rte_cache_aligned;
@@ -181,45 +193,70 @@ virtio_config_populate(struct virtio_dev *dev)
 }
 
 static int
-process_descs(struct virtio_ctrl_queue *q, struct rte_dma_sge *cmd_src, struct rte_dma_sge *cmd_dst,
-	      uint16_t nb_desc)
+cq_dma_copy_sync(struct virtio_dev *dev, int16_t dma_devid, rte_iova_t src, rte_iova_t dst,
+		 uint32_t len)
 {
-	uintptr_t sd_desc_base = (uintptr_t)q->sd_desc_base;
-	int16_t dev2mem = dao_dma_ctrl_dev2mem();
-	uintptr_t desc_base = q->desc_base;
-	uint32_t i, j, len, tot_len = 0;
-	struct virtio_dev *dev = q->dev;
-	rte_iova_t src, dst;
-	uint16_t off, cnt;
 	bool has_err = 0;
 	uint16_t tmo_ms;
+	uint16_t cnt;
 	int rc;
 
-	/* Start DMA of descriptors */
-	off = DESC_OFF(q->sd_desc_off);
-	src = (rte_iova_t)DESC_PTR_OFF(desc_base, off, 0);
-	dst = (rte_iova_t)DESC_PTR_OFF(sd_desc_base, off, 0);
-
-	rc = rte_dma_copy(dev2mem, q->dma_vchan, src, dst, nb_desc << 4, RTE_DMA_OP_FLAG_SUBMIT);
-	if (rc < 0) {
-		dao_err("[dev %u] Couldn't submit dma for cq descriptors", dev->dev_id);
-		return -ENOMEM;
-	}
+	rc = rte_dma_copy(dma_devid, dev->dma_vchan, src, dst, len, RTE_DMA_OP_FLAG_SUBMIT);
+	if (rc < 0)
+		return rc;
 
 	tmo_ms = VIRTIO_DMA_TMO_MS;
 	do {
 		rte_delay_us_sleep(1000);
-		cnt = rte_dma_completed(dev2mem, q->dma_vchan, 1, NULL, &has_err);
-		tmo_ms--;
+		cnt = rte_dma_completed(dma_devid, dev->dma_vchan, 1, NULL, &has_err);
 		if (unlikely(has_err))
-			dao_err("[dev %u] DMA failed for cq descriptors", dev->dev_id);
-		if (!tmo_ms) {
-			dao_err("[dev %u] DMA timeout for cq descriptors", dev->dev_id);
+			return -EIO;
+		if (!--tmo_ms)
 			return -EFAULT;
-		}
 	} while (cnt != 1);
 
-	for (i = off, j = 0; i < (off + nb_desc); i++, j++) {
+	return 0;
+}
+
+static int
+process_cmd(struct virtio_ctrl_queue *q, uint16_t off, struct rte_dma_sge *cmd_src,
+	    struct rte_dma_sge *cmd_dst, uint16_t *nb_desc)
+{
+	uintptr_t sd_desc_base = (uintptr_t)q->sd_desc_base;
+	int16_t dev2mem = dao_dma_ctrl_dev2mem();
+	uint32_t i, j, len, tot_len = 0;
+	struct virtio_dev *dev = q->dev;
+	bool has_err = 0;
+	uint64_t d_flags;
+	uint16_t tmo_ms;
+	uint16_t cnt;
+	int rc;
+
+	d_flags = *DESC_PTR_OFF(sd_desc_base, off, 8);
+	d_flags = virtio_dev_is_split(dev) ? (d_flags >> 32) : (d_flags >> 48);
+	if (d_flags & VRING_DESC_F_INDIRECT) {
+		/* Command is described by an indirect table, fetch the table and
+		 * gather the command from its entries instead.
+		 */
+		len = *DESC_PTR_OFF(sd_desc_base, off, 8) & (RTE_BIT64(32) - 1);
+		if (!len || len > sizeof(q->sd_ind_desc) || (len % DESC_ENTRY_SZ)) {
+			dao_err("[dev %u] Invalid cq indirect table len=%u", dev->dev_id, len);
+			return -EINVAL;
+		}
+
+		rc = cq_dma_copy_sync(dev, dev2mem, *DESC_PTR_OFF(sd_desc_base, off, 0),
+				      (rte_iova_t)q->sd_ind_desc, len);
+		if (rc < 0) {
+			dao_err("[dev %u] DMA failed for cq indirect table, rc=%d", dev->dev_id,
+				rc);
+			return rc;
+		}
+		sd_desc_base = (uintptr_t)q->sd_ind_desc;
+		*nb_desc = len / DESC_ENTRY_SZ;
+		off = 0;
+	}
+
+	for (i = off, j = 0; i < (off + *nb_desc); i++, j++) {
 		len = *DESC_PTR_OFF(sd_desc_base, i, 8) & (RTE_BIT64(32) - 1);
 		cmd_src[j].addr = *DESC_PTR_OFF(sd_desc_base, i, 0);
 		cmd_src[j].length = len;
@@ -235,7 +272,7 @@ process_descs(struct virtio_ctrl_queue *q, struct rte_dma_sge *cmd_src, struct r
 	}
 
 	cmd_dst[0].length = tot_len;
-	rc = rte_dma_copy_sg(dev2mem, q->dma_vchan, cmd_src, cmd_dst, nb_desc, 1,
+	rc = rte_dma_copy_sg(dev2mem, q->dma_vchan, cmd_src, cmd_dst, *nb_desc, 1,
 			     RTE_DMA_OP_FLAG_SUBMIT);
 	if (rc < 0) {
 		dao_err("[dev %u] Couldn't submit dma for cq command", dev->dev_id);
@@ -259,6 +296,185 @@ process_descs(struct virtio_ctrl_queue *q, struct rte_dma_sge *cmd_src, struct r
 	return 0;
 }
 
+static int
+process_descs(struct virtio_ctrl_queue *q, struct rte_dma_sge *cmd_src, struct rte_dma_sge *cmd_dst,
+	      uint16_t *nb_desc)
+{
+	uintptr_t sd_desc_base = (uintptr_t)q->sd_desc_base;
+	int16_t dev2mem = dao_dma_ctrl_dev2mem();
+	uintptr_t desc_base = q->desc_base;
+	struct virtio_dev *dev = q->dev;
+	rte_iova_t src, dst;
+	bool has_err = 0;
+	uint16_t off, cnt;
+	uint16_t tmo_ms;
+	int rc;
+
+	/* Start DMA of descriptors */
+	off = DESC_OFF(q->sd_desc_off);
+	src = (rte_iova_t)DESC_PTR_OFF(desc_base, off, 0);
+	dst = (rte_iova_t)DESC_PTR_OFF(sd_desc_base, off, 0);
+
+	rc = rte_dma_copy(dev2mem, q->dma_vchan, src, dst, *nb_desc << 4, RTE_DMA_OP_FLAG_SUBMIT);
+	if (rc < 0) {
+		dao_err("[dev %u] Couldn't submit dma for cq descriptors", dev->dev_id);
+		return -ENOMEM;
+	}
+
+	tmo_ms = VIRTIO_DMA_TMO_MS;
+	do {
+		rte_delay_us_sleep(1000);
+		cnt = rte_dma_completed(dev2mem, q->dma_vchan, 1, NULL, &has_err);
+		tmo_ms--;
+		if (unlikely(has_err))
+			dao_err("[dev %u] DMA failed for cq descriptors", dev->dev_id);
+		if (!tmo_ms) {
+			dao_err("[dev %u] DMA timeout for cq descriptors", dev->dev_id);
+			return -EFAULT;
+		}
+	} while (cnt != 1);
+
+	return process_cmd(q, off, cmd_src, cmd_dst, nb_desc);
+}
+
+static int
+process_split_descs(struct virtio_ctrl_queue *q, uint16_t *head, struct rte_dma_sge *cmd_src,
+		    struct rte_dma_sge *cmd_dst, uint16_t *nb_desc)
+{
+	uintptr_t sd_desc_base = (uintptr_t)q->sd_desc_base;
+	int16_t dev2mem = dao_dma_ctrl_dev2mem();
+	struct virtio_dev *dev = q->dev;
+	uint16_t q_sz = q->q_sz;
+	struct vring_desc *desc;
+	uint16_t idx, cnt = 0;
+	rte_iova_t src;
+	int rc;
+
+	/* Fetch head of the next descriptor chain from avail ring */
+	src = (rte_iova_t)(q->avail_base + offsetof(struct vring_avail, ring) +
+			   DESC_OFF(q->sd_desc_off) * sizeof(uint16_t));
+	rc = cq_dma_copy_sync(dev, dev2mem, src, (rte_iova_t)&q->sd_avail_ent, sizeof(uint16_t));
+	if (rc < 0) {
+		dao_err("[dev %u] DMA failed for cq avail ring, rc=%d", dev->dev_id, rc);
+		return rc;
+	}
+
+	/* Walk the chain gathering descriptors to start of shadow ring */
+	*head = q->sd_avail_ent & (q_sz - 1);
+	idx = *head;
+	do {
+		if (cnt == DAO_DMA_MAX_POINTER) {
+			dao_err("[dev %u] cq descriptor chain too long", dev->dev_id);
+			return -EINVAL;
+		}
+
+		src = (rte_iova_t)DESC_PTR_OFF(q->desc_base, idx, 0);
+		desc = (struct vring_desc *)DESC_PTR_OFF(sd_desc_base, cnt, 0);
+		rc = cq_dma_copy_sync(dev, dev2mem, src, (rte_iova_t)desc, DESC_ENTRY_SZ);
+		if (rc < 0) {
+			dao_err("[dev %u] DMA failed for cq descriptor, rc=%d", dev->dev_id, rc);
+			return rc;
+		}
+		idx = desc->next & (q_sz - 1);
+		cnt++;
+	} while (desc->flags & VRING_DESC_F_NEXT);
+
+	*nb_desc = cnt;
+	return process_cmd(q, 0, cmd_src, cmd_dst, nb_desc);
+}
+
+/* With event index, driver kicks only when avail index passes avail_event. Publish avail index
+ * processed as avail_event and read back avail index to catch commands added meanwhile.
+ * Returns avail offset to process till.
+ */
+static uint16_t
+virtio_cq_split_avail_event(struct virtio_dev *dev, uint16_t next_off)
+{
+	int16_t dev2mem = dao_dma_ctrl_dev2mem();
+	int16_t mem2dev = dao_dma_ctrl_mem2dev();
+	struct virtio_ctrl_queue *q = dev->cq;
+	uint16_t q_sz = q->q_sz;
+	rte_iova_t src, dst;
+	int rc;
+
+	if (!(dev->feature_bits & RTE_BIT64(VIRTIO_F_RING_EVENT_IDX)) ||
+	    q->avail_event == q->used_idx)
+		return next_off;
+
+	q->avail_event = q->used_idx;
+	dst = (rte_iova_t)(q->used_base + offsetof(struct vring_used, ring) +
+			   q_sz * sizeof(struct vring_used_elem));
+	rc = cq_dma_copy_sync(dev, mem2dev, (rte_iova_t)&q->avail_event, dst, sizeof(uint16_t));
+	if (rc < 0) {
+		dao_err("[dev %u] DMA failed for cq avail event, rc=%d", dev->dev_id, rc);
+		return next_off;
+	}
+
+	src = (rte_iova_t)(q->avail_base + offsetof(struct vring_avail, idx));
+	rc = cq_dma_copy_sync(dev, dev2mem, src, (rte_iova_t)&q->sd_avail_idx, sizeof(uint16_t));
+	if (rc < 0) {
+		dao_err("[dev %u] DMA failed for cq avail index, rc=%d", dev->dev_id, rc);
+		return next_off;
+	}
+	return split_idx_to_desc_off(q->sd_avail_idx, q_sz);
+}
+
+static void
+virtio_cq_split_cmd_process(struct virtio_dev *dev)
+{
+	struct rte_dma_sge cmd_src[15], cmd_dst[15];
+	int16_t mem2dev = dao_dma_ctrl_mem2dev();
+	struct virtio_ctrl_queue *q = dev->cq;
+	uint16_t nb_desc, head, next_off;
+	uint16_t q_sz = q->q_sz;
+	uint32_t notify_data;
+	rte_iova_t dst;
+	int rc;
+
+	notify_data = *q->notify_addr;
+	/* Notify data carries avail index for split ring */
+	next_off = split_idx_to_desc_off((notify_data >> 16) & 0xFFFF, q_sz);
+
+	for (;;) {
+		if (q->sd_desc_off == next_off) {
+			next_off = virtio_cq_split_avail_event(dev, next_off);
+			if (q->sd_desc_off == next_off)
+				break;
+		}
+
+		rc = process_split_descs(q, &head, cmd_src, cmd_dst, &nb_desc);
+		if (rc < 0)
+			return;
+
+		dev_cbs[dev->dev_type].cq_cmd_process(dev, cmd_src, cmd_dst, nb_desc);
+		rte_free((void *)cmd_dst[0].addr);
+
+		/* Return the chain with last device writable descriptor as used length */
+		q->sd_used_elem.id = head;
+		q->sd_used_elem.len = cmd_src[nb_desc - 1].length;
+		dst = (rte_iova_t)(q->used_base + offsetof(struct vring_used, ring) +
+				   (q->used_idx & (q_sz - 1)) * sizeof(struct vring_used_elem));
+		rc = cq_dma_copy_sync(dev, mem2dev, (rte_iova_t)&q->sd_used_elem, dst,
+				      sizeof(struct vring_used_elem));
+		if (rc < 0) {
+			dao_err("[dev %u] DMA failed for cq used ring, rc=%d", dev->dev_id, rc);
+			return;
+		}
+
+		q->sd_used_idx = q->used_idx + 1;
+		dst = (rte_iova_t)(q->used_base + offsetof(struct vring_used, idx));
+		rc = cq_dma_copy_sync(dev, mem2dev, (rte_iova_t)&q->sd_used_idx, dst,
+				      sizeof(uint16_t));
+		if (rc < 0) {
+			dao_err("[dev %u] DMA failed for cq used index, rc=%d", dev->dev_id, rc);
+			return;
+		}
+
+		q->used_idx++;
+		q->sd_desc_off = desc_off_add(q->sd_desc_off, 1, q_sz);
+	}
+}
+
 static void
 virtio_cq_cmd_process(struct virtio_dev *dev)
 {
@@ -274,6 +490,8 @@ virtio_cq_cmd_process(struct virtio_dev *dev)
 	int rc;
 
 	q = dev->cq;
+	if (virtio_dev_is_split(dev))
+		return virtio_cq_split_cmd_process(dev);
 
 	q_sz = q->q_sz;
 	desc_base = q->desc_base;
@@ -290,7 +508,7 @@ virtio_cq_cmd_process(struct virtio_dev *dev)
 	if (!nb_desc)
 		return;
 
-	rc = process_descs(q, cmd_src, cmd_dst, nb_desc);
+	rc = process_descs(q, cmd_src, cmd_dst, &nb_desc);
 	if (rc < 0)
 		return;
 
@@ -373,7 +591,7 @@ virtio_setup_cq_info(struct virtio_dev *dev)
 		return 0;
 
 	dao_dbg("[dev %u] Setting qid=%u as CQ", dev->dev_id, qid);
-	/* Setup only enabled queues assuming packed virt queue */
+	/* Setup only enabled queues, shadow ring holds a chain of descriptors for split ring */
 	shadow_area = RTE_ALIGN(q_conf->queue_size * 16 + 8, RTE_CACHE_LINE_SIZE);
 	cq = rte_zmalloc("virtio_ctrl_queue", sizeof(*cq) + shadow_area, RTE_CACHE_LINE_SIZE);
 	if (!cq) {
@@ -387,9 +605,17 @@ virtio_setup_cq_info(struct virtio_dev *dev)
 	cq->dev = dev;
 
 	cq->notify_addr = (uint32_t *)(dev->notify_base + (qid * dev->notify_off_mltpr));
-	/* Initial queue wrap counter is 1 as per spec? */
-	cq->sd_desc_off = RTE_BIT64(15);
-	cq->last_off = RTE_BIT64(15);
+	cq->avail_base = (((uint64_t)q_conf->queue_avail_hi << 32) | (q_conf->queue_avail_lo));
+	cq->used_base = (((uint64_t)q_conf->queue_used_hi << 32) | (q_conf->queue_used_lo));
+	if (virtio_dev_is_split(dev)) {
+		/* Split ring indices start from zero */
+		cq->sd_desc_off = 0;
+		cq->last_off = 0;
+	} else {
+		/* Initial queue wrap counter is 1 as per spec? */
+		cq->sd_desc_off = RTE_BIT64(15);
+		cq->last_off = RTE_BIT64(15);
+	}
 	dev->cq = cq;
 
 	/* Register window for polling on control queue notify data */
@@ -936,6 +1162,8 @@ virtio_device_id_get(struct virtio_dev *dev)
 		return VIRTIO_ID_NET;
 	case VIRTIO_DEV_TYPE_CRYPTO:
 		return VIRTIO_ID_CRYPTO;
+	case VIRTIO_DEV_TYPE_BLK:
+		return VIRTIO_ID_BLOCK;
 	default:
 		/* Host kernel vdpa driver treats 0 as invalid device id */
 		dao_err("[dev %u] Invalid device type %u", dev->dev_id, dev->dev_type);
@@ -43,6 +43,7 @@
 enum virtio_dev_type {
 	VIRTIO_DEV_TYPE_NET,
 	VIRTIO_DEV_TYPE_CRYPTO,
+	VIRTIO_DEV_TYPE_BLK,
 	VIRTIO_DEV_TYPE_MAX,
 };
 
@@ -262,6 +263,19 @@ desc_off_diff(uint16_t a, uint16_t b, uint16_t q_sz)
 		       (q_sz - (b & (RTE_BIT64(15) - 1)) + DESC_OFF(a));
 }
 
+/* Convert split virtqueue free running ring index to offset with wrap bit */
+static __rte_always_inline uint16_t
+split_idx_to_desc_off(uint16_t idx, uint16_t q_sz)
+{
+	return (idx & (q_sz - 1)) | ((idx & q_sz) ? RTE_BIT64(15) : 0);
+}
+
+static __rte_always_inline bool
+virtio_dev_is_split(struct virtio_dev *dev)
+{
+	return !(dev->feature_bits & RTE_BIT64(VIRTIO_F_RING_PACKED));
+}
+
 int virtio_dev_init(struct virtio_dev *dev);
 int virtio_dev_fini(struct virtio_dev *dev);
 void virtio_dev_feature_bits_set(struct virtio_dev *dev, uint64_t feature_bits);
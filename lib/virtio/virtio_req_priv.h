@@ -0,0 +1,416 @@
+/* SPDX-License-Identifier: Marvell-Proprietary
+ * Copyright (c) 2024 Marvell.
+ */
+#ifndef __INCLUDE_VIRTIO_REQ_PRIV_H__
+#define __INCLUDE_VIRTIO_REQ_PRIV_H__
+
+#include <rte_cycles.h>
+
+#include "virtio_dev_priv.h"
+
+/* Request queue helpers shared by packed virtqueue devices serving a request per
+ * descriptor chain, with device readable buffers followed by device writable ones
+ * ending in a status byte, like virtio blk and virtio crypto. Requests are returned
+ * in ring order, each used descriptor taking position of its chain head.
+ */
+
+/* Request state, advanced by DMA completion meta or by backend completion */
+enum virtio_req_state {
+	VIRTIO_REQ_FREE = 0,
+	/* Readable buffers being gathered */
+	VIRTIO_REQ_GATHER,
+	VIRTIO_REQ_GATHERED,
+	/* With backend */
+	VIRTIO_REQ_SUBMITTED,
+	/* Status is final, result is yet to reach driver */
+	VIRTIO_REQ_DONE,
+	/* Result and status being written to writable buffers */
+	VIRTIO_REQ_WRITE,
+	VIRTIO_REQ_WRITTEN,
+};
+
+/* Request context common part, first member of device request context */
+struct virtio_req {
+	uint16_t state;
+	/* Descriptors in chain and how many of them are device readable */
+	uint16_t nb_desc;
+	uint16_t nb_rd;
+	uint8_t status;
+	/* Bytes of device readable and writable buffers */
+	uint32_t rd_len;
+	uint32_t wr_len;
+	/* Result bytes to write back ahead of status, zero on failure */
+	uint32_t dst_len;
+};
+
+/* Gather destination of request readable buffers, leading hdr_len bytes go to hdr */
+struct virtio_req_dst {
+	rte_iova_t hdr;
+	rte_iova_t data;
+	uint32_t hdr_len;
+};
+
+struct virtio_req_ring {
+	/* Fast path */
+	uintptr_t desc_base __rte_cache_aligned;
+	uint32_t *notify_addr;
+	/* Shadow descriptors laid out by ring position */
+	uint64_t *sd_desc_base;
+	/* Device request contexts, indexed by ring position of chain head */
+	uintptr_t reqs;
+	uint16_t req_sz;
+	uint16_t q_sz;
+	/* Device stats counter of DMA space failures, NULL without stats */
+	uint64_t *dma_fails;
+
+	/* Ring offsets with wrap bit, in order sd_desc_off >= parse_off >= submit_off >=
+	 * scatter_off >= used_off.
+	 */
+	uint16_t sd_desc_off __rte_cache_aligned;
+	uint16_t pend_sd_desc;
+	uint16_t parse_off;
+	uint16_t submit_off;
+	uint16_t scatter_off;
+	uint16_t used_off;
+	/* Gather and scatter DMA ops not yet completed */
+	uint16_t pend_dma;
+	/* Requests with backend */
+	uint16_t inflight;
+	/* DMA op after which last batch of used descriptors is visible to driver */
+	uint16_t pend_intr_idx;
+	uint8_t pend_intr;
+};
+
+/* Device hook to check a walked chain and pick gather destinations. Returns 0 to gather
+ * readable buffers, positive if request is done without gather with status already set
+ * and negative to retry request later.
+ */
+typedef int (*virtio_req_prep_t)(struct virtio_req_ring *ring, struct virtio_req *req,
+				 bool inval, struct virtio_req_dst *dst);
+
+/* Device hook giving source of result of a request with non zero dst_len */
+typedef rte_iova_t (*virtio_req_result_t)(struct virtio_req_ring *ring, struct virtio_req *req);
+
+/* Device hook releasing resources of a request returned to driver */
+typedef void (*virtio_req_release_t)(struct virtio_req_ring *ring, struct virtio_req *req);
+
+/* Device hook collecting completions from backend, returns number collected */
+typedef uint16_t (*virtio_req_poll_t)(struct virtio_req_ring *ring);
+
+static __rte_always_inline struct virtio_req *
+virtio_req_get(struct virtio_req_ring *ring, uint16_t off)
+{
+	return (struct virtio_req *)(ring->reqs + (size_t)DESC_OFF(off) * ring->req_sz);
+}
+
+static __rte_always_inline void
+virtio_req_dma_fail(struct virtio_req_ring *ring)
+{
+	if (ring->dma_fails)
+		(*ring->dma_fails)++;
+}
+
+static inline void
+virtio_req_ring_init(struct virtio_req_ring *ring, uintptr_t desc_base, uint32_t *notify_addr,
+		     uint16_t q_sz, uint64_t *sd_desc_base, void *reqs, uint16_t req_sz,
+		     uint64_t *dma_fails)
+{
+	ring->desc_base = desc_base;
+	ring->notify_addr = notify_addr;
+	ring->q_sz = q_sz;
+	ring->sd_desc_base = sd_desc_base;
+	ring->reqs = (uintptr_t)reqs;
+	ring->req_sz = req_sz;
+	ring->dma_fails = dma_fails;
+
+	/* Packed ring wrap counter starts at 1 */
+	ring->sd_desc_off = RTE_BIT64(15);
+	ring->parse_off = ring->sd_desc_off;
+	ring->submit_off = ring->sd_desc_off;
+	ring->scatter_off = ring->sd_desc_off;
+	ring->used_off = ring->sd_desc_off;
+}
+
+/* Shadow descriptors made available by driver since last fetch */
+static __rte_always_inline void
+virtio_req_desc_fetch(struct virtio_req_ring *ring, struct dao_dma_vchan_state *dev2mem)
+{
+	uintptr_t sd_desc_base = (uintptr_t)ring->sd_desc_base;
+	uint16_t q_sz = ring->q_sz;
+	uint16_t next_off, off;
+	uint16_t nb_desc, cnt;
+	uint32_t notify_data;
+	uint16_t i;
+
+	/* Include the wrap bit to check if there are descriptors */
+	notify_data = __atomic_load_n(ring->notify_addr, __ATOMIC_RELAXED);
+	next_off = (notify_data >> 16) & 0xFFFF;
+	off = desc_off_add(ring->sd_desc_off, ring->pend_sd_desc, q_sz);
+	if (next_off == off)
+		return;
+
+	/* Two pointers in case the fetch wraps around end of ring */
+	if (!dao_dma_flush(dev2mem, 2)) {
+		virtio_req_dma_fail(ring);
+		return;
+	}
+
+	nb_desc = desc_off_diff(next_off, off, q_sz);
+	cnt = nb_desc;
+	off = DESC_OFF(off);
+	do {
+		i = (off + nb_desc) > q_sz ? (q_sz - off) : nb_desc;
+		dao_dma_enq_x1(dev2mem, (rte_iova_t)DESC_PTR_OFF(ring->desc_base, off, 0),
+			       i * DESC_ENTRY_SZ, (rte_iova_t)DESC_PTR_OFF(sd_desc_base, off, 0),
+			       i * DESC_ENTRY_SZ);
+		off = (off + i) & (q_sz - 1);
+		nb_desc -= i;
+	} while (nb_desc);
+
+	ring->pend_sd_desc += cnt;
+	next_off = desc_off_add(ring->sd_desc_off, ring->pend_sd_desc, q_sz);
+	dao_dma_update_cmpl_meta(dev2mem, &ring->sd_desc_off, next_off, &ring->pend_sd_desc, cnt,
+				 dev2mem->tail);
+}
+
+/* Gather device readable buffers of each new request chain to destinations picked by
+ * device, stopping at a chain not yet fully shadowed.
+ */
+static __rte_always_inline void
+virtio_req_gather(struct virtio_req_ring *ring, struct dao_dma_vchan_state *dev2mem,
+		  virtio_req_prep_t prep)
+{
+	uintptr_t sd_desc_base = (uintptr_t)ring->sd_desc_base;
+	uint16_t sd_desc_off = ring->sd_desc_off;
+	uint16_t nb_desc, nb_rd, avail, pos;
+	uint32_t rd_len, wr_len, hdr_left;
+	uint16_t off = ring->parse_off;
+	uint16_t q_sz = ring->q_sz;
+	struct virtio_req_dst dst;
+	struct virtio_req *req;
+	rte_iova_t src, to;
+	uint32_t len, n;
+	bool inval;
+	uint64_t w;
+	uint16_t i;
+	int rc;
+
+	while (off != sd_desc_off) {
+		/* Walk the chain within shadowed descriptors */
+		avail = desc_off_diff(sd_desc_off, off, q_sz);
+		nb_desc = 0;
+		nb_rd = 0;
+		rd_len = 0;
+		wr_len = 0;
+		inval = false;
+		do {
+			if (nb_desc == avail)
+				goto exit;
+
+			pos = desc_off_add(off, nb_desc, q_sz);
+			w = *DESC_PTR_OFF(sd_desc_base, pos, 8);
+			len = w & (RTE_BIT64(32) - 1);
+			if ((w >> 48) & VRING_DESC_F_WRITE) {
+				wr_len += len;
+			} else {
+				/* Device readable buffers precede writable ones */
+				inval |= !!wr_len;
+				rd_len += len;
+				nb_rd++;
+			}
+			nb_desc++;
+		} while ((w >> 48) & VRING_DESC_F_NEXT);
+
+		req = virtio_req_get(ring, off);
+		req->nb_desc = nb_desc;
+		req->nb_rd = nb_rd;
+		req->rd_len = rd_len;
+		req->wr_len = wr_len;
+		req->dst_len = 0;
+		req->status = 0;
+
+		/* Status byte needs a writable buffer. Each readable buffer takes a DMA
+		 * pointer at gather and each writable buffer plus status one at scatter.
+		 */
+		inval |= !wr_len || nb_rd > DAO_DMA_MAX_POINTER;
+		inval |= (uint16_t)(nb_desc - nb_rd) >= DAO_DMA_MAX_POINTER;
+
+		/* A readable buffer split between header and data takes an extra pointer */
+		if (!inval && !dao_dma_flush(dev2mem, nb_rd + 1)) {
+			virtio_req_dma_fail(ring);
+			break;
+		}
+
+		rc = prep(ring, req, inval, &dst);
+		if (unlikely(rc < 0))
+			break;
+		if (unlikely(rc > 0)) {
+			req->state = VIRTIO_REQ_DONE;
+			off = desc_off_add(off, nb_desc, q_sz);
+			continue;
+		}
+
+		hdr_left = dst.hdr_len;
+		to = hdr_left ? dst.hdr : dst.data;
+		for (i = 0; i < nb_rd; i++) {
+			pos = desc_off_add(off, i, q_sz);
+			src = *DESC_PTR_OFF(sd_desc_base, pos, 0);
+			len = *DESC_PTR_OFF(sd_desc_base, pos, 8) & (RTE_BIT64(32) - 1);
+			if (hdr_left && len) {
+				n = RTE_MIN(len, hdr_left);
+				dao_dma_enq_x1(dev2mem, src, n, to, n);
+				to += n;
+				src += n;
+				len -= n;
+				hdr_left -= n;
+				if (!hdr_left)
+					to = dst.data;
+			}
+			if (!len)
+				continue;
+			dao_dma_enq_x1(dev2mem, src, len, to, len);
+			to += len;
+		}
+
+		req->state = VIRTIO_REQ_GATHER;
+		ring->pend_dma++;
+		dao_dma_update_cmpl_meta(dev2mem, &req->state, VIRTIO_REQ_GATHERED, &ring->pend_dma,
+					 1, dev2mem->tail);
+		off = desc_off_add(off, nb_desc, q_sz);
+	}
+exit:
+	ring->parse_off = off;
+}
+
+/* Write result and status of done requests to device writable buffers, in ring order */
+static __rte_always_inline void
+virtio_req_scatter(struct virtio_req_ring *ring, struct dao_dma_vchan_state *mem2dev,
+		   virtio_req_result_t result)
+{
+	uintptr_t sd_desc_base = (uintptr_t)ring->sd_desc_base;
+	uint16_t off = ring->scatter_off;
+	uint16_t q_sz = ring->q_sz;
+	struct virtio_req *req;
+	uint32_t remain, len, n;
+	rte_iova_t src, addr;
+	uint16_t pos, i;
+
+	while (off != ring->submit_off) {
+		req = virtio_req_get(ring, off);
+		if (req->state != VIRTIO_REQ_DONE)
+			break;
+
+		/* Nowhere to write status for a malformed chain, just return it */
+		if (unlikely(!req->wr_len)) {
+			req->state = VIRTIO_REQ_WRITTEN;
+			off = desc_off_add(off, req->nb_desc, q_sz);
+			continue;
+		}
+
+		/* A pointer per writable buffer and one for status */
+		if (!dao_dma_flush(mem2dev, req->nb_desc - req->nb_rd + 1)) {
+			virtio_req_dma_fail(ring);
+			break;
+		}
+
+		remain = req->dst_len;
+		src = remain ? result(ring, req) : 0;
+		addr = 0;
+		len = 0;
+		for (i = req->nb_rd; i < req->nb_desc; i++) {
+			pos = desc_off_add(off, i, q_sz);
+			addr = *DESC_PTR_OFF(sd_desc_base, pos, 0);
+			len = *DESC_PTR_OFF(sd_desc_base, pos, 8) & (RTE_BIT64(32) - 1);
+			n = RTE_MIN(len, remain);
+			if (!n)
+				continue;
+			dao_dma_enq_x1(mem2dev, src, n, addr, n);
+			src += n;
+			remain -= n;
+		}
+
+		/* Status is the last byte of writable buffers */
+		dao_dma_enq_x1(mem2dev, (rte_iova_t)&req->status, 1, addr + len - 1, 1);
+
+		req->state = VIRTIO_REQ_WRITE;
+		ring->pend_dma++;
+		dao_dma_update_cmpl_meta(mem2dev, &req->state, VIRTIO_REQ_WRITTEN, &ring->pend_dma,
+					 1, mem2dev->tail);
+		off = desc_off_add(off, req->nb_desc, q_sz);
+	}
+	ring->scatter_off = off;
+}
+
+/* Return requests whose result reached the host as used descriptors */
+static __rte_always_inline uint16_t
+virtio_req_used(struct virtio_req_ring *ring, struct dao_dma_vchan_state *mem2dev,
+		virtio_req_release_t release)
+{
+	uintptr_t sd_desc_base = (uintptr_t)ring->sd_desc_base;
+	uintptr_t desc_base = ring->desc_base;
+	uint16_t off = ring->used_off;
+	uint16_t q_sz = ring->q_sz;
+	struct virtio_req *req;
+	uint64_t used, buf_id;
+	uint16_t nb_used = 0;
+	uint16_t last;
+	uint32_t len;
+
+	while (off != ring->scatter_off) {
+		req = virtio_req_get(ring, off);
+		if (req->state != VIRTIO_REQ_WRITTEN)
+			break;
+
+		if (!dao_dma_flush(mem2dev, 1)) {
+			virtio_req_dma_fail(ring);
+			break;
+		}
+
+		/* Used descriptor takes position of chain head and buffer id of its last */
+		last = desc_off_add(off, req->nb_desc - 1, q_sz);
+		buf_id = (*DESC_PTR_OFF(sd_desc_base, last, 8) >> 32) & 0xFFFF;
+		len = req->wr_len ? req->dst_len + 1 : 0;
+		used = (off & RTE_BIT64(15)) ? VIRT_PACKED_RING_DESC_F_AVAIL_USED : 0;
+		if (len)
+			used |= (uint64_t)VRING_DESC_F_WRITE << 48;
+		*DESC_PTR_OFF(sd_desc_base, off, 8) = used | buf_id << 32 | len;
+
+		dao_dma_enq_x1(mem2dev, (rte_iova_t)DESC_PTR_OFF(sd_desc_base, off, 8), 8,
+			       (rte_iova_t)DESC_PTR_OFF(desc_base, off, 8), 8);
+
+		release(ring, req);
+		req->state = VIRTIO_REQ_FREE;
+		off = desc_off_add(off, req->nb_desc, q_sz);
+		nb_used++;
+	}
+
+	if (!nb_used)
+		return 0;
+
+	ring->used_off = off;
+	/* Batch is visible to driver once its last used descriptor DMA completes */
+	ring->pend_intr_idx = mem2dev->tail;
+	ring->pend_intr = 1;
+	return nb_used;
+}
+
+/* Wait up to tmo_ms for backend to complete requests in flight, returns those left */
+static inline uint16_t
+virtio_req_queue_drain(struct virtio_req_ring *ring, uint16_t tmo_ms, virtio_req_poll_t poll)
+{
+	uint16_t nb_cpls;
+
+	while (ring->inflight && tmo_ms) {
+		nb_cpls = poll(ring);
+		if (!nb_cpls) {
+			rte_delay_us_sleep(1000);
+			tmo_ms--;
+			continue;
+		}
+		ring->inflight -= nb_cpls;
+	}
+
+	return ring->inflight;
+}
+
+#endif /* __INCLUDE_VIRTIO_REQ_PRIV_H__ */
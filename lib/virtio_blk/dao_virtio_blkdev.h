@@ -0,0 +1,290 @@
+/* SPDX-License-Identifier: Marvell-Proprietary
+ * Copyright (c) 2024 Marvell
+ */
+
+/**
+ * @file
+ *
+ * DAO virtio blk library
+ *
+ * Emulates a virtio block device over PEM and serves its request queues using
+ * a pluggable storage backend. Each request queue is mapped to one backend
+ * queue and is expected to be polled by a single lcore. A backend built on
+ * io_uring serving a file or a block device is provided by the library.
+ */
+
+#ifndef __INCLUDE_DAO_VIRTIO_BLK_H__
+#define __INCLUDE_DAO_VIRTIO_BLK_H__
+
+#include <dao_virtio.h>
+#include <dao_util.h>
+
+#include <spec/virtio_blk.h>
+
+/** Requests in flight per request queue when not configured */
+#define DAO_VIRTIO_BLKDEV_QUEUE_DEPTH_DFLT 64
+/** Max bytes per data segment when not configured */
+#define DAO_VIRTIO_BLKDEV_SEG_SIZE_DFLT (16 * 1024)
+
+/** Backend I/O types */
+enum dao_virtio_blkdev_io_type {
+	/** Read from backend to buffer */
+	DAO_VIRTIO_BLKDEV_IO_READ,
+	/** Write buffer to backend */
+	DAO_VIRTIO_BLKDEV_IO_WRITE,
+	/** Flush backend volatile cache */
+	DAO_VIRTIO_BLKDEV_IO_FLUSH,
+};
+
+/** Backend I/O */
+struct dao_virtio_blkdev_io {
+	/** I/O type */
+	enum dao_virtio_blkdev_io_type type;
+	/** Request tag to return on completion */
+	uint16_t tag;
+	/** Data length in bytes, zero for flush */
+	uint32_t len;
+	/** Byte offset on backend */
+	uint64_t offset;
+	/** Data buffer, within buffer area given at backend queue setup */
+	void *buf;
+};
+
+/** Backend I/O completion */
+struct dao_virtio_blkdev_cpl {
+	/** Request tag of completed I/O */
+	uint16_t tag;
+	/** Bytes transferred on success, negative errno on failure */
+	int32_t res;
+};
+
+/** Backend queue setup, buf_area holds data buffers of all I/Os of the queue */
+typedef int (*dao_virtio_blkdev_queue_setup_t)(void *ctx, uint16_t qid, uint16_t depth,
+					       void *buf_area, size_t buf_sz, void **qctx);
+/** Backend queue release, called once no I/O is in flight or after drain timeout */
+typedef void (*dao_virtio_blkdev_queue_release_t)(void *qctx);
+/** Submit I/Os on backend queue, returns number of I/Os accepted */
+typedef uint16_t (*dao_virtio_blkdev_submit_t)(void *qctx, struct dao_virtio_blkdev_io *ios,
+					       uint16_t nb_ios);
+/** Poll completions of backend queue, returns number of completions filled */
+typedef uint16_t (*dao_virtio_blkdev_poll_t)(void *qctx, struct dao_virtio_blkdev_cpl *cpls,
+					     uint16_t nb_cpls);
+
+/** Virtio blk backend operations */
+struct dao_virtio_blkdev_backend_ops {
+	/** Backend queue setup */
+	dao_virtio_blkdev_queue_setup_t queue_setup;
+	/** Backend queue release */
+	dao_virtio_blkdev_queue_release_t queue_release;
+	/** Backend I/O submit */
+	dao_virtio_blkdev_submit_t submit;
+	/** Backend I/O completion poll */
+	dao_virtio_blkdev_poll_t poll;
+};
+
+/** Virtio blk storage backend */
+struct dao_virtio_blkdev_backend {
+	/** Backend operations */
+	const struct dao_virtio_blkdev_backend_ops *ops;
+	/** Backend context passed to queue setup */
+	void *ctx;
+	/** Capacity in bytes, rounded down to block size */
+	uint64_t capacity;
+	/** Logical block size in bytes, power of two and at least 512 */
+	uint32_t blk_size;
+	/** Backend rejects writes */
+	bool read_only;
+	/** Backend has volatile cache to be flushed */
+	bool flush;
+};
+
+/* End of structure dao_virtio_blkdev_backend. */
+
+/** Virtio blk device configuration */
+struct dao_virtio_blkdev_conf {
+	/** PEM device ID */
+	uint16_t pem_devid;
+	/** Vchan to use for this virtio dev */
+	uint16_t dma_vchan;
+	/** Max request queues limit, zero for as many as device supports */
+	uint16_t max_queues_limit;
+	/** Requests in flight per queue, zero for DAO_VIRTIO_BLKDEV_QUEUE_DEPTH_DFLT */
+	uint16_t queue_depth;
+	/** Max bytes per data segment, zero for DAO_VIRTIO_BLKDEV_SEG_SIZE_DFLT */
+	uint32_t seg_size_max;
+	/** Storage backend */
+	struct dao_virtio_blkdev_backend backend;
+};
+
+/* End of structure dao_virtio_blkdev_conf. */
+
+/** Virtio blk device queue stats */
+struct dao_virtio_blkdev_queue_stats {
+	/** Read requests submitted to backend */
+	uint64_t read_reqs;
+	/** Write requests submitted to backend */
+	uint64_t write_reqs;
+	/** Flush requests submitted to backend */
+	uint64_t flush_reqs;
+	/** Bytes read from backend */
+	uint64_t read_bytes;
+	/** Bytes written to backend */
+	uint64_t write_bytes;
+	/** Requests completed back to driver */
+	uint64_t deq_reqs;
+	/** Requests failed by backend */
+	uint64_t err_reqs;
+	/** Requests rejected as not supported or malformed without reaching backend */
+	uint64_t inval_reqs;
+	/** Data buffer or backend queue full events */
+	uint64_t busy;
+	/** DMA flush failures, due to DMA ring being full or DMA enqueue errors */
+	uint64_t dma_fails;
+	/** Interrupts raised to host */
+	uint64_t intrs;
+	/** Interrupts suppressed by driver event */
+	uint64_t intrs_suppressed;
+};
+
+/** Virtio blk device data */
+struct dao_virtio_blkdev {
+	/** Array of virtio request queue pointers */
+	void *qs[DAO_VIRTIO_MAX_QUEUES] __rte_cache_aligned;
+#define DAO_VIRTIO_BLKDEV_MEM_SZ 8192
+	uint8_t reserved[DAO_VIRTIO_BLKDEV_MEM_SZ];
+};
+
+/** Virtio blk devices */
+extern struct dao_virtio_blkdev dao_virtio_blkdevs[];
+
+/** Device status callback */
+typedef int (*dao_virtio_blkdev_status_cb_t)(uint16_t devid, uint8_t status);
+
+/** Virtio blk device callbacks */
+struct dao_virtio_blkdev_cbs {
+	/** Device status callback */
+	dao_virtio_blkdev_status_cb_t status_cb;
+};
+
+/* End of structure dao_virtio_blkdev_cbs. */
+
+/**
+ * Virtio blk device initialize.
+ *
+ * @param devid
+ *    Virtio blk device ID
+ * @param conf
+ *    Virtio blk device config.
+ * @return
+ *    Zero on success.
+ */
+int dao_virtio_blkdev_init(uint16_t devid, struct dao_virtio_blkdev_conf *conf);
+
+/**
+ * Virtio blk device cleanup.
+ *
+ * @param devid
+ *    Virtio blk device ID
+ * @return
+ *    Zero on success.
+ */
+int dao_virtio_blkdev_fini(uint16_t devid);
+
+/**
+ * Virtio blk device callback register
+ *
+ * @param cbs
+ *    Application callbacks for virtio blk devices
+ */
+void dao_virtio_blkdev_cb_register(struct dao_virtio_blkdev_cbs *cbs);
+
+/**
+ * Virtio blk device callback unregister
+ */
+void dao_virtio_blkdev_cb_unregister(void);
+
+/**
+ * Get blk device request queue count.
+ *
+ * @param devid
+ *    Virtio blk device ID.
+ * @return
+ *    Number of request queues negotiated on success. Negative on failure.
+ */
+int dao_virtio_blkdev_queue_count(uint16_t devid);
+
+/**
+ * Serve requests of a virtio blk request queue.
+ *
+ * Fetches new requests from host, submits them in bursts to the backend queue
+ * and returns completed requests to host with one interrupt per batch, subject
+ * to driver event suppression. DMA ops are batched in lcore vchan state, caller
+ * is expected to call dao_dma_flush_submit() in its loop as well.
+ *
+ * @param devid
+ *    Virtio blk device ID.
+ * @param qid
+ *    Request queue ID.
+ * @return
+ *    Number of requests returned to host.
+ */
+uint16_t dao_virtio_blkdev_process(uint16_t devid, uint16_t qid);
+
+/**
+ * Get virtio blk request queue stats.
+ *
+ * @param devid
+ *    Virtio blk device ID.
+ * @param qid
+ *    Request queue ID.
+ * @param stats
+ *    Pointer to stats to fill.
+ * @return
+ *    Zero on success.
+ */
+int dao_virtio_blkdev_stats_get(uint16_t devid, uint16_t qid,
+				struct dao_virtio_blkdev_queue_stats *stats);
+
+/**
+ * Reset stats of all request queues of a virtio blk device.
+ *
+ * @param devid
+ *    Virtio blk device ID.
+ * @return
+ *    Zero on success.
+ */
+int dao_virtio_blkdev_stats_reset(uint16_t devid);
+
+/** Open backing file read-only */
+#define DAO_VIRTIO_BLKDEV_URING_RDONLY DAO_BIT(0)
+/** Bypass page cache with O_DIRECT */
+#define DAO_VIRTIO_BLKDEV_URING_DIRECT DAO_BIT(1)
+
+/**
+ * Open an io_uring backend on a file or block device.
+ *
+ * Each request queue gets its own io_uring instance with the backing file and
+ * the queue data buffers registered, so that I/O is issued with fixed file and
+ * fixed buffer operations.
+ *
+ * @param path
+ *    Path of regular file or block device.
+ * @param flags
+ *    DAO_VIRTIO_BLKDEV_URING_* flags.
+ * @param backend
+ *    Backend to fill, to be passed in dao_virtio_blkdev_conf.
+ * @return
+ *    Zero on success. Negative errno on failure.
+ */
+int dao_virtio_blkdev_uring_open(const char *path, uint32_t flags,
+				 struct dao_virtio_blkdev_backend *backend);
+
+/**
+ * Close an io_uring backend, after all devices using it are cleaned up.
+ *
+ * @param backend
+ *    Backend filled by dao_virtio_blkdev_uring_open().
+ */
+void dao_virtio_blkdev_uring_close(struct dao_virtio_blkdev_backend *backend);
+
+#endif /* __INCLUDE_DAO_VIRTIO_BLK_H__ */
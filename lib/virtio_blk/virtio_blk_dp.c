@@ -0,0 +1,378 @@
+/* SPDX-License-Identifier: Marvell-Proprietary
+ * Copyright (c) 2024 Marvell.
+ */
+#include <rte_malloc.h>
+
+#include "dao_virtio_blkdev.h"
+#include "virtio_dev_priv.h"
+#include "virtio_req_priv.h"
+#include "virtio_blk_priv.h"
+
+#define VIRTIO_BLK_STATS_ADD(q, field, val)                                                        \
+	do {                                                                                       \
+		if (virtio_blk_has_stats_feature())                                                \
+			(q)->stats.field += (val);                                                 \
+	} while (0)
+
+static __rte_always_inline struct virtio_blk_req *
+virtio_blk_req_get(struct virtio_blk_queue *q, uint16_t off)
+{
+	return (struct virtio_blk_req *)virtio_req_get(&q->ring, off);
+}
+
+static __rte_always_inline uint8_t *
+virtio_blk_slot_buf(struct virtio_blk_queue *q, uint16_t slot)
+{
+	return q->buf_area + (size_t)slot * q->slot_sz;
+}
+
+/* Gather header of each new request to its context and write data to a slot buffer */
+static __rte_always_inline int
+virtio_blk_req_prep(struct virtio_req_ring *ring, struct virtio_req *vreq, bool inval,
+		    struct virtio_req_dst *dst)
+{
+	struct virtio_blk_queue *q = container_of(ring, struct virtio_blk_queue, ring);
+	struct virtio_blk_req *req = (struct virtio_blk_req *)vreq;
+	uint32_t rd_len = vreq->rd_len;
+	uint32_t wr_len = vreq->wr_len;
+
+	req->slot = VIRTIO_BLK_SLOT_NONE;
+
+	/* Request needs header to parse. Data of either direction must fit a slot and,
+	 * with a buffer split between header and data, take no more DMA pointers than an
+	 * op holds.
+	 */
+	inval |= rd_len < VIRTIO_BLK_REQ_HDR_SZ;
+	inval |= rd_len - VIRTIO_BLK_REQ_HDR_SZ > q->slot_sz || wr_len - 1 > q->slot_sz;
+	inval |= vreq->nb_rd >= DAO_DMA_MAX_POINTER;
+	if (unlikely(inval)) {
+		vreq->status = VIRTIO_BLK_S_IOERR;
+		VIRTIO_BLK_STATS_ADD(q, inval_reqs, 1);
+		return 1;
+	}
+
+	/* Requests with data of either direction need a slot */
+	if (rd_len > VIRTIO_BLK_REQ_HDR_SZ || wr_len > 1) {
+		if (unlikely(!q->nb_free_slots)) {
+			VIRTIO_BLK_STATS_ADD(q, busy, 1);
+			return -ENOSPC;
+		}
+		req->slot = q->free_slots[--q->nb_free_slots];
+	}
+
+	/* Leading bytes are header, any layout of header and data is accepted */
+	dst->hdr = (rte_iova_t)&req->hdr;
+	dst->hdr_len = VIRTIO_BLK_REQ_HDR_SZ;
+	dst->data = req->slot != VIRTIO_BLK_SLOT_NONE ?
+			    (rte_iova_t)virtio_blk_slot_buf(q, req->slot) : 0;
+	return 0;
+}
+
+static __rte_always_inline uint8_t
+virtio_blk_req_parse(struct virtio_blk_queue *q, struct virtio_blk_req *req,
+		     struct dao_virtio_blkdev_io *io)
+{
+	uint32_t len;
+
+	io->offset = req->hdr.sector << VIRTIO_BLK_SECTOR_SHIFT;
+	io->buf = NULL;
+	switch (req->hdr.type) {
+	case VIRTIO_BLK_T_IN:
+		/* Read data goes ahead of status in writable buffers */
+		if (req->req.rd_len != VIRTIO_BLK_REQ_HDR_SZ)
+			return VIRTIO_BLK_S_IOERR;
+		io->type = DAO_VIRTIO_BLKDEV_IO_READ;
+		len = req->req.wr_len - 1;
+		req->req.dst_len = len;
+		break;
+	case VIRTIO_BLK_T_OUT:
+		if (q->read_only)
+			return VIRTIO_BLK_S_IOERR;
+		io->type = DAO_VIRTIO_BLKDEV_IO_WRITE;
+		len = req->req.rd_len - VIRTIO_BLK_REQ_HDR_SZ;
+		break;
+	case VIRTIO_BLK_T_FLUSH:
+		if (!q->flush)
+			return VIRTIO_BLK_S_UNSUPP;
+		io->type = DAO_VIRTIO_BLKDEV_IO_FLUSH;
+		io->offset = 0;
+		io->len = 0;
+		return VIRTIO_BLK_S_OK;
+	default:
+		return VIRTIO_BLK_S_UNSUPP;
+	}
+
+	/* Data must be whole blocks within capacity */
+	if (!len || ((io->offset | len) & q->blk_mask) ||
+	    req->hdr.sector > (q->capacity >> VIRTIO_BLK_SECTOR_SHIFT) ||
+	    len > q->capacity - io->offset)
+		return VIRTIO_BLK_S_IOERR;
+
+	io->len = len;
+	io->buf = virtio_blk_slot_buf(q, req->slot);
+	return VIRTIO_BLK_S_OK;
+}
+
+static __rte_always_inline void
+virtio_blk_io_stats(struct virtio_blk_queue *q, struct dao_virtio_blkdev_io *ios, uint16_t nb_ios)
+{
+	uint16_t i;
+
+	if (!virtio_blk_has_stats_feature())
+		return;
+
+	for (i = 0; i < nb_ios; i++) {
+		switch (ios[i].type) {
+		case DAO_VIRTIO_BLKDEV_IO_READ:
+			q->stats.read_reqs++;
+			q->stats.read_bytes += ios[i].len;
+			break;
+		case DAO_VIRTIO_BLKDEV_IO_WRITE:
+			q->stats.write_reqs++;
+			q->stats.write_bytes += ios[i].len;
+			break;
+		default:
+			q->stats.flush_reqs++;
+			break;
+		}
+	}
+}
+
+/* Hand gathered requests to backend queue, in ring order */
+static __rte_always_inline void
+virtio_blk_req_submit(struct virtio_blk_queue *q)
+{
+	struct dao_virtio_blkdev_io ios[VIRTIO_BLK_BURST];
+	uint16_t offs[VIRTIO_BLK_BURST];
+	struct virtio_req_ring *ring = &q->ring;
+	uint16_t off = ring->submit_off;
+	struct virtio_blk_req *req;
+	uint16_t nb_ios = 0, nb_enq;
+	uint8_t status;
+	uint16_t i;
+
+	while (off != ring->parse_off && nb_ios < VIRTIO_BLK_BURST) {
+		req = virtio_blk_req_get(q, off);
+		if (req->req.state == VIRTIO_REQ_GATHER)
+			break;
+
+		/* Requests failed earlier are already done, skip past them */
+		if (req->req.state == VIRTIO_REQ_GATHERED) {
+			status = virtio_blk_req_parse(q, req, &ios[nb_ios]);
+			if (likely(status == VIRTIO_BLK_S_OK)) {
+				ios[nb_ios].tag = DESC_OFF(off);
+				offs[nb_ios++] = off;
+			} else {
+				req->req.dst_len = 0;
+				req->req.status = status;
+				req->req.state = VIRTIO_REQ_DONE;
+				VIRTIO_BLK_STATS_ADD(q, inval_reqs, 1);
+			}
+		}
+		off = desc_off_add(off, req->req.nb_desc, ring->q_sz);
+	}
+
+	if (!nb_ios) {
+		ring->submit_off = off;
+		return;
+	}
+
+	nb_enq = q->ops->submit(q->qctx, ios, nb_ios);
+	for (i = 0; i < nb_enq; i++)
+		virtio_blk_req_get(q, offs[i])->req.state = VIRTIO_REQ_SUBMITTED;
+	ring->inflight += nb_enq;
+	virtio_blk_io_stats(q, ios, nb_enq);
+
+	if (unlikely(nb_enq < nb_ios)) {
+		/* Parsing is repeated on retry once backend queue has room */
+		VIRTIO_BLK_STATS_ADD(q, busy, 1);
+		off = offs[nb_enq];
+	}
+	ring->submit_off = off;
+}
+
+/* Collect completed I/O, backend may complete them out of order */
+static __rte_always_inline void
+virtio_blk_req_complete(struct virtio_blk_queue *q)
+{
+	struct dao_virtio_blkdev_cpl cpls[VIRTIO_BLK_BURST];
+	struct virtio_blk_req *req;
+	uint16_t nb_cpls, i;
+	int32_t expected;
+
+	nb_cpls = q->ops->poll(q->qctx, cpls, VIRTIO_BLK_BURST);
+	for (i = 0; i < nb_cpls; i++) {
+		req = virtio_blk_req_get(q, cpls[i].tag);
+		/* Short transfer is an error as requests lie within capacity */
+		expected = req->hdr.type == VIRTIO_BLK_T_FLUSH ? 0 :
+			   req->hdr.type == VIRTIO_BLK_T_IN   ? (int32_t)req->req.dst_len :
+								(int32_t)(req->req.rd_len -
+									  VIRTIO_BLK_REQ_HDR_SZ);
+		if (likely(cpls[i].res == expected)) {
+			req->req.status = VIRTIO_BLK_S_OK;
+		} else {
+			req->req.status = VIRTIO_BLK_S_IOERR;
+			req->req.dst_len = 0;
+			VIRTIO_BLK_STATS_ADD(q, err_reqs, 1);
+		}
+		req->req.state = VIRTIO_REQ_DONE;
+	}
+	q->ring.inflight -= nb_cpls;
+}
+
+/* Read data of a done request is written back from its slot buffer */
+static __rte_always_inline rte_iova_t
+virtio_blk_req_result(struct virtio_req_ring *ring, struct virtio_req *vreq)
+{
+	struct virtio_blk_queue *q = container_of(ring, struct virtio_blk_queue, ring);
+
+	return (rte_iova_t)virtio_blk_slot_buf(q, ((struct virtio_blk_req *)vreq)->slot);
+}
+
+static __rte_always_inline void
+virtio_blk_req_release(struct virtio_req_ring *ring, struct virtio_req *vreq)
+{
+	struct virtio_blk_queue *q = container_of(ring, struct virtio_blk_queue, ring);
+	struct virtio_blk_req *req = (struct virtio_blk_req *)vreq;
+
+	if (req->slot != VIRTIO_BLK_SLOT_NONE)
+		q->free_slots[q->nb_free_slots++] = req->slot;
+	req->slot = VIRTIO_BLK_SLOT_NONE;
+}
+
+/* Check if used offset moving from old to new passed driver event offset */
+static __rte_always_inline bool
+virtio_blk_need_event(uint16_t event, uint16_t new, uint16_t old, uint16_t q_sz)
+{
+	uint16_t mask = (q_sz << 1) - 1;
+
+	/* Offsets carry wrap counter in bit 15, linearize them over two laps of ring */
+	event = (event & (q_sz - 1)) | ((event & RTE_BIT64(15)) ? q_sz : 0);
+	new = DESC_OFF(new) | ((new & RTE_BIT64(15)) ? q_sz : 0);
+	old = DESC_OFF(old) | ((old & RTE_BIT64(15)) ? q_sz : 0);
+
+	return ((uint16_t)(new - event - 1) & mask) < ((uint16_t)(new - old) & mask);
+}
+
+static __rte_always_inline void
+virtio_blk_event_signal(struct virtio_blk_queue *q)
+{
+	struct vring_packed_desc_event *event;
+	bool signal;
+
+	event = (struct vring_packed_desc_event *)((uintptr_t)q->sd_desc_base +
+						   q->ring.q_sz * DESC_ENTRY_SZ);
+	if (q->event_idx && event->desc_event_flags == RING_EVENT_FLAGS_DESC)
+		signal = virtio_blk_need_event(event->desc_event_off_wrap, q->intr_event_off,
+					       q->intr_sig_off, q->ring.q_sz);
+	else
+		signal = event->desc_event_flags != RING_EVENT_FLAGS_DISABLE;
+
+	q->pend_event = 0;
+	if (signal) {
+		__atomic_store_n(q->cb_notify_addr, 1, __ATOMIC_RELAXED);
+		__atomic_store_n(q->cb_intr_addr, (1UL << 59), __ATOMIC_RELAXED);
+		VIRTIO_BLK_STATS_ADD(q, intrs, 1);
+	} else {
+		VIRTIO_BLK_STATS_ADD(q, intrs_suppressed, 1);
+	}
+	/* Requests used after event fetch are checked against a fresh event */
+	q->intr_sig_off = q->intr_event_off;
+}
+
+/* One interrupt per batch of used requests, subject to driver event suppression */
+static __rte_always_inline void
+virtio_blk_intr_process(struct virtio_blk_queue *q, struct dao_dma_vchan_state *dev2mem,
+			struct dao_dma_vchan_state *mem2dev)
+{
+	uint32_t len = sizeof(struct vring_packed_desc_event);
+	struct virtio_req_ring *ring = &q->ring;
+	uintptr_t sd_driver_area;
+
+	if (!q->cb_intr_addr) {
+		ring->pend_intr = 0;
+		return;
+	}
+
+	if (q->pend_event) {
+		if (dao_dma_op_status(dev2mem, q->pend_event_idx))
+			virtio_blk_event_signal(q);
+		return;
+	}
+
+	if (!ring->pend_intr || !dao_dma_op_status(mem2dev, ring->pend_intr_idx))
+		return;
+
+	/* Driver event is fetched after used descriptors are visible so that a
+	 * driver re-enabling events after its last poll is not missed.
+	 */
+	if (!dao_dma_flush(dev2mem, 1)) {
+		VIRTIO_BLK_STATS_ADD(q, dma_fails, 1);
+		return;
+	}
+
+	sd_driver_area = (uintptr_t)q->sd_desc_base + ring->q_sz * DESC_ENTRY_SZ;
+	dao_dma_enq_x1(dev2mem, (rte_iova_t)q->driver_area, len, (rte_iova_t)sd_driver_area, len);
+	q->pend_event_idx = dev2mem->tail;
+	q->pend_event = 1;
+	ring->pend_intr = 0;
+	q->intr_event_off = q->intr_used_off;
+}
+
+uint16_t
+dao_virtio_blkdev_process(uint16_t devid, uint16_t qid)
+{
+	struct dao_virtio_blkdev *virtio_blkdev = &dao_virtio_blkdevs[devid];
+	struct virtio_blk_queue *q = virtio_blkdev->qs[qid];
+	struct dao_dma_vchan_state *dev2mem, *mem2dev;
+	uint16_t nb_used;
+
+	if (unlikely(!q))
+		return 0;
+
+	dev2mem = dao_dma_lcore_dev2mem_get(q->dma_vchan, devid);
+	mem2dev = dao_dma_lcore_mem2dev_get(q->dma_vchan, devid);
+
+	/* Fetch all DMA completed status */
+	dao_dma_check_meta_compl(dev2mem, 1 /* ATOMIC update */);
+	dao_dma_check_meta_compl(mem2dev, 1 /* ATOMIC update */);
+
+	virtio_blk_intr_process(q, dev2mem, mem2dev);
+
+	virtio_req_desc_fetch(&q->ring, dev2mem);
+	virtio_req_gather(&q->ring, dev2mem, virtio_blk_req_prep);
+	if (q->ring.inflight)
+		virtio_blk_req_complete(q);
+	virtio_blk_req_submit(q);
+	virtio_req_scatter(&q->ring, mem2dev, virtio_blk_req_result);
+
+	nb_used = virtio_req_used(&q->ring, mem2dev, virtio_blk_req_release);
+	if (!nb_used)
+		return 0;
+
+	q->intr_used_off = q->ring.used_off;
+	VIRTIO_BLK_STATS_ADD(q, deq_reqs, nb_used);
+	return nb_used;
+}
+
+static uint16_t
+virtio_blk_drain_poll(struct virtio_req_ring *ring)
+{
+	struct virtio_blk_queue *q = container_of(ring, struct virtio_blk_queue, ring);
+	struct dao_virtio_blkdev_cpl cpls[VIRTIO_BLK_BURST];
+
+	return q->ops->poll(q->qctx, cpls, VIRTIO_BLK_BURST);
+}
+
+void
+virtio_blk_queue_drain(struct virtio_blk_queue *q)
+{
+	uint16_t left;
+
+	/* Backend I/O in flight still references slot buffers */
+	left = virtio_req_queue_drain(&q->ring, VIRTIO_BLK_DRAIN_TMO_MS, virtio_blk_drain_poll);
+
+	/* Backend queue release cancels and waits for whatever is left */
+	if (left)
+		dao_err("[qid %u] %u I/Os not completed by backend", q->qid, left);
+}
@@ -0,0 +1,116 @@
+/* SPDX-License-Identifier: Marvell-Proprietary
+ * Copyright (c) 2024 Marvell.
+ */
+#ifndef __INCLUDE_VIRTIO_BLK_PRIV_H__
+#define __INCLUDE_VIRTIO_BLK_PRIV_H__
+
+/* Requests handed to backend or fetched back in one go */
+#define VIRTIO_BLK_BURST 32
+
+/* Data segments per request, leaving DMA pointers for header, status and a
+ * buffer split between header and data.
+ */
+#define VIRTIO_BLK_SEG_MAX (DAO_DMA_MAX_POINTER - 3)
+
+/* Request header gathered ahead of data */
+#define VIRTIO_BLK_REQ_HDR_SZ sizeof(struct virtio_blk_outhdr)
+
+/* Request without a data buffer slot */
+#define VIRTIO_BLK_SLOT_NONE UINT16_MAX
+
+/* Time to wait for backend to complete in flight I/O on reset */
+#define VIRTIO_BLK_DRAIN_TMO_MS 3000
+
+/* Request context, indexed by ring position of chain head */
+struct virtio_blk_req {
+	struct virtio_req req;
+	struct virtio_blk_outhdr hdr;
+	/* Data buffer slot */
+	uint16_t slot;
+} __rte_aligned(64);
+
+struct virtio_blk_queue {
+	/* Descriptor fetch, request gather, scatter and used ring state */
+	struct virtio_req_ring ring;
+
+	/* Fast path */
+	uint16_t qid __rte_cache_aligned;
+	uint16_t dma_vchan;
+	uint8_t read_only;
+	uint8_t flush;
+	uint64_t capacity;
+	uint32_t blk_mask;
+	const struct dao_virtio_blkdev_backend_ops *ops;
+	void *qctx;
+	/* Data buffers, one slot per request in flight */
+	uint8_t *buf_area;
+	uint32_t slot_sz;
+	uint16_t nb_free_slots;
+	uint16_t *free_slots;
+
+	/* Interrupt and driver event suppression */
+	uint64_t *cb_intr_addr;
+	uint32_t *cb_notify_addr;
+	uint64_t driver_area;
+	uint8_t event_idx;
+
+	/* Used offset made visible to driver, at driver event fetch and at last signal */
+	uint16_t intr_used_off __rte_cache_aligned;
+	uint16_t intr_event_off;
+	uint16_t intr_sig_off;
+	uint16_t pend_event_idx;
+	uint8_t pend_event;
+
+	struct dao_virtio_blkdev_queue_stats stats;
+	/* Stats snapshot at last reset */
+	struct dao_virtio_blkdev_queue_stats stats_base;
+
+	/* Shadow descriptors laid out by ring position, followed by driver event area */
+	uint64_t sd_desc_base[] __rte_cache_aligned;
+} __rte_cache_aligned;
+
+struct virtio_blkdev {
+	struct virtio_dev dev;
+	struct dao_virtio_blkdev_backend backend;
+	/* Request queues offered to driver */
+	uint16_t nb_qs;
+	uint16_t queue_depth;
+	uint32_t seg_size_max;
+
+	struct virtio_blk_queue *qs[DAO_VIRTIO_MAX_QUEUES] __rte_cache_aligned;
+};
+
+extern struct dao_virtio_blkdev_cbs blk_user_cbs;
+
+void virtio_blk_queue_drain(struct virtio_blk_queue *q);
+
+static __rte_always_inline int
+virtio_blk_has_stats_feature(void)
+{
+#if DAO_VIRTIO_STATS
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+static inline struct virtio_blkdev *
+virtio_blkdev_priv(struct dao_virtio_blkdev *blkdev)
+{
+	return (struct virtio_blkdev *)blkdev->reserved;
+}
+
+static inline struct virtio_blkdev *
+virtio_dev_to_blkdev(struct virtio_dev *dev)
+{
+	return (struct virtio_blkdev *)dev;
+}
+
+static inline struct dao_virtio_blkdev *
+virtio_blkdev_to_dao(struct virtio_blkdev *blkdev)
+{
+	return (struct dao_virtio_blkdev *)((uintptr_t)blkdev -
+					    offsetof(struct dao_virtio_blkdev, reserved));
+}
+
+#endif /* __INCLUDE_VIRTIO_BLK_PRIV_H__ */
@@ -0,0 +1,244 @@
+/* SPDX-License-Identifier: Marvell-Proprietary
+ * Copyright (c) 2024 Marvell.
+ */
+#include <fcntl.h>
+#include <liburing.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <rte_malloc.h>
+
+#include "dao_virtio_blkdev.h"
+#include "virtio_dev_priv.h"
+
+/* Completions reaped per poll */
+#define VIRTIO_BLK_URING_CQE_BATCH 32
+
+struct virtio_blk_uring {
+	int fd;
+};
+
+struct virtio_blk_uring_queue {
+	struct io_uring ring;
+	uint16_t qid;
+};
+
+static int
+virtio_blk_uring_queue_setup(void *ctx, uint16_t qid, uint16_t depth, void *buf_area,
+			     size_t buf_sz, void **qctx)
+{
+	struct virtio_blk_uring *ur = ctx;
+	struct virtio_blk_uring_queue *uq;
+	struct iovec iov;
+	int rc;
+
+	uq = rte_zmalloc("virtio_blk_uring_queue", sizeof(*uq), RTE_CACHE_LINE_SIZE);
+	if (!uq)
+		return -ENOMEM;
+
+	/* Completion ring defaults to twice the submission ring, enough for a full queue */
+	rc = io_uring_queue_init(depth, &uq->ring, 0);
+	if (rc < 0) {
+		dao_err("[qid %u] io_uring init failed, rc=%d", qid, rc);
+		rte_free(uq);
+		return rc;
+	}
+
+	/* Fixed file and fixed buffer avoid per I/O file reference and page pinning */
+	rc = io_uring_register_files(&uq->ring, &ur->fd, 1);
+	if (rc < 0) {
+		dao_err("[qid %u] io_uring file register failed, rc=%d", qid, rc);
+		goto exit_ring;
+	}
+
+	iov.iov_base = buf_area;
+	iov.iov_len = buf_sz;
+	rc = io_uring_register_buffers(&uq->ring, &iov, 1);
+	if (rc < 0) {
+		dao_err("[qid %u] io_uring buffer register of %zu bytes failed, rc=%d", qid, buf_sz,
+			rc);
+		goto exit_ring;
+	}
+
+	uq->qid = qid;
+	*qctx = uq;
+	return 0;
+
+exit_ring:
+	io_uring_queue_exit(&uq->ring);
+	rte_free(uq);
+	return rc;
+}
+
+static void
+virtio_blk_uring_queue_release(void *qctx)
+{
+	struct virtio_blk_uring_queue *uq = qctx;
+
+	/* Ring teardown cancels and reaps I/O still in flight */
+	io_uring_queue_exit(&uq->ring);
+	rte_free(uq);
+}
+
+static uint16_t
+virtio_blk_uring_submit(void *qctx, struct dao_virtio_blkdev_io *ios, uint16_t nb_ios)
+{
+	struct virtio_blk_uring_queue *uq = qctx;
+	struct io_uring_sqe *sqe;
+	uint16_t i;
+	int rc;
+
+	for (i = 0; i < nb_ios; i++) {
+		sqe = io_uring_get_sqe(&uq->ring);
+		if (!sqe)
+			break;
+
+		switch (ios[i].type) {
+		case DAO_VIRTIO_BLKDEV_IO_READ:
+			io_uring_prep_read_fixed(sqe, 0, ios[i].buf, ios[i].len, ios[i].offset, 0);
+			break;
+		case DAO_VIRTIO_BLKDEV_IO_WRITE:
+			io_uring_prep_write_fixed(sqe, 0, ios[i].buf, ios[i].len, ios[i].offset, 0);
+			break;
+		default:
+			io_uring_prep_fsync(sqe, 0, IORING_FSYNC_DATASYNC);
+			break;
+		}
+		sqe->flags |= IOSQE_FIXED_FILE;
+		io_uring_sqe_set_data(sqe, (void *)(uintptr_t)ios[i].tag);
+	}
+
+	if (!i)
+		return 0;
+
+	/* One syscall per burst. Entries not consumed stay in submission ring and go
+	 * with next submit or poll.
+	 */
+	rc = io_uring_submit(&uq->ring);
+	if (unlikely(rc < 0 && rc != -EAGAIN && rc != -EBUSY))
+		dao_err("[qid %u] io_uring submit failed, rc=%d", uq->qid, rc);
+	return i;
+}
+
+static uint16_t
+virtio_blk_uring_poll(void *qctx, struct dao_virtio_blkdev_cpl *cpls, uint16_t nb_cpls)
+{
+	struct virtio_blk_uring_queue *uq = qctx;
+	struct io_uring_cqe *cqes[VIRTIO_BLK_URING_CQE_BATCH];
+	uint16_t nb, i;
+
+	nb_cpls = RTE_MIN(nb_cpls, VIRTIO_BLK_URING_CQE_BATCH);
+	if (unlikely(io_uring_sq_ready(&uq->ring)))
+		io_uring_submit(&uq->ring);
+
+	nb = io_uring_peek_batch_cqe(&uq->ring, cqes, nb_cpls);
+	for (i = 0; i < nb; i++) {
+		cpls[i].tag = (uint16_t)(uintptr_t)io_uring_cqe_get_data(cqes[i]);
+		cpls[i].res = cqes[i]->res;
+	}
+	io_uring_cq_advance(&uq->ring, nb);
+	return nb;
+}
+
+static const struct dao_virtio_blkdev_backend_ops virtio_blk_uring_ops = {
+	.queue_setup = virtio_blk_uring_queue_setup,
+	.queue_release = virtio_blk_uring_queue_release,
+	.submit = virtio_blk_uring_submit,
+	.poll = virtio_blk_uring_poll,
+};
+
+int
+dao_virtio_blkdev_uring_open(const char *path, uint32_t flags,
+			     struct dao_virtio_blkdev_backend *backend)
+{
+	struct virtio_blk_uring *ur;
+	uint64_t capacity;
+	uint32_t blk_size;
+	struct stat st;
+	int lbs, oflags;
+	int fd, rc;
+
+	if (!path || !backend)
+		return -EINVAL;
+
+	oflags = flags & DAO_VIRTIO_BLKDEV_URING_RDONLY ? O_RDONLY : O_RDWR;
+	if (flags & DAO_VIRTIO_BLKDEV_URING_DIRECT)
+		oflags |= O_DIRECT;
+
+	fd = open(path, oflags);
+	if (fd < 0) {
+		rc = -errno;
+		dao_err("Failed to open %s, rc=%d", path, rc);
+		return rc;
+	}
+
+	if (fstat(fd, &st) < 0) {
+		rc = -errno;
+		goto close_fd;
+	}
+
+	if (S_ISBLK(st.st_mode)) {
+		if (ioctl(fd, BLKGETSIZE64, &capacity) < 0 || ioctl(fd, BLKSSZGET, &lbs) < 0) {
+			rc = -errno;
+			dao_err("Failed to get size of block device %s, rc=%d", path, rc);
+			goto close_fd;
+		}
+		blk_size = lbs;
+	} else if (S_ISREG(st.st_mode)) {
+		capacity = st.st_size;
+		/* Direct I/O on a file is aligned to file system block */
+		blk_size = flags & DAO_VIRTIO_BLKDEV_URING_DIRECT ? (uint32_t)st.st_blksize :
+								    1U << VIRTIO_BLK_SECTOR_SHIFT;
+	} else {
+		dao_err("%s is neither a regular file nor a block device", path);
+		rc = -ENOTSUP;
+		goto close_fd;
+	}
+
+	capacity = RTE_ALIGN_FLOOR(capacity, (uint64_t)blk_size);
+	if (!capacity) {
+		dao_err("%s is smaller than a block of %u bytes", path, blk_size);
+		rc = -EINVAL;
+		goto close_fd;
+	}
+
+	ur = rte_zmalloc("virtio_blk_uring", sizeof(*ur), 0);
+	if (!ur) {
+		rc = -ENOMEM;
+		goto close_fd;
+	}
+	ur->fd = fd;
+
+	memset(backend, 0, sizeof(*backend));
+	backend->ops = &virtio_blk_uring_ops;
+	backend->ctx = ur;
+	backend->capacity = capacity;
+	backend->blk_size = blk_size;
+	backend->read_only = !!(flags & DAO_VIRTIO_BLKDEV_URING_RDONLY);
+	/* Page cache or device write cache is made durable with fdatasync */
+	backend->flush = !backend->read_only;
+
+	dao_dbg("Opened %s: capacity %" PRIu64 " blk_size %u", path, capacity, blk_size);
+	return 0;
+
+close_fd:
+	close(fd);
+	return rc;
+}
+
+void
+dao_virtio_blkdev_uring_close(struct dao_virtio_blkdev_backend *backend)
+{
+	struct virtio_blk_uring *ur;
+
+	if (!backend || backend->ops != &virtio_blk_uring_ops)
+		return;
+
+	ur = backend->ctx;
+	close(ur->fd);
+	rte_free(ur);
+	backend->ctx = NULL;
+	backend->ops = NULL;
+}
@@ -0,0 +1,413 @@
+/* SPDX-License-Identifier: Marvell-Proprietary
+ * Copyright (c) 2024 Marvell.
+ */
+#include <rte_malloc.h>
+
+#include "dao_virtio_blkdev.h"
+#include "virtio_dev_priv.h"
+#include "virtio_req_priv.h"
+#include "virtio_blk_priv.h"
+
+/** Virtio blk devices */
+struct dao_virtio_blkdev dao_virtio_blkdevs[DAO_VIRTIO_DEV_MAX + 1];
+
+struct dao_virtio_blkdev_cbs blk_user_cbs;
+
+static int
+virtio_blkdev_feature_validate(struct virtio_dev *dev, uint64_t feature_bits)
+{
+	if ((feature_bits | dev->dev_feature_bits) != dev->dev_feature_bits) {
+		dao_err("[dev %u] Invalid feature bits negotiated 0x%" PRIx64 "(dev %" PRIx64 ")",
+			dev->dev_id, feature_bits, dev->dev_feature_bits);
+		return -EINVAL;
+	}
+
+	/* Request queues are served only as packed virtqueue */
+	if (!(feature_bits & RTE_BIT64(VIRTIO_F_RING_PACKED))) {
+		dao_err("[dev %u] Split virtqueue is not supported for virtio blk", dev->dev_id);
+		return -ENOTSUP;
+	}
+
+	return 0;
+}
+
+static void
+virtio_blkdev_cb_interrupt_conf(struct virtio_blkdev *blkdev)
+{
+	struct virtio_dev *dev = &blkdev->dev;
+	struct virtio_blk_queue *q;
+	uint32_t i, intr_idx;
+
+	if (!dev->nb_cb_intrs)
+		return;
+
+	/* Driver event is fetched per batch of used requests, so every queue gets an
+	 * interrupt even if driver starts with events disabled.
+	 */
+	intr_idx = 0;
+	for (i = 0; i < blkdev->nb_qs; i++) {
+		q = blkdev->qs[i];
+		if (!q)
+			continue;
+
+		q->cb_notify_addr = q->ring.notify_addr + 1;
+		__atomic_store_n(q->cb_notify_addr, 0, __ATOMIC_RELAXED);
+		q->event_idx = !!(dev->feature_bits & RTE_BIT64(VIRTIO_F_RING_EVENT_IDX));
+		q->cb_intr_addr = dev->cb_intr_addr[intr_idx];
+		intr_idx = (intr_idx + 1) % dev->nb_cb_intrs;
+	}
+
+	dao_dbg("[dev %u] Enabled driver events for %u queues", dev->dev_id, blkdev->nb_qs);
+}
+
+static void
+virtio_blkdev_queue_free(struct virtio_blk_queue *q)
+{
+	if (q->qctx)
+		q->ops->queue_release(q->qctx);
+	rte_free(q->buf_area);
+	rte_free(q);
+}
+
+static int
+virtio_blkdev_populate_queue_info(struct virtio_blkdev *blkdev, uint16_t queue_id)
+{
+	struct dao_virtio_blkdev *dao_blkdev = virtio_blkdev_to_dao(blkdev);
+	struct dao_virtio_blkdev_backend *be = &blkdev->backend;
+	struct virtio_dev *dev = &blkdev->dev;
+	struct virtio_queue_conf *q_conf;
+	uint32_t shadow_area, req_area;
+	struct virtio_blk_req *reqs;
+	struct virtio_blk_queue *q;
+	uint16_t depth, i;
+	size_t buf_sz;
+	int rc;
+
+	if (queue_id >= blkdev->nb_qs)
+		return -EINVAL;
+
+	q_conf = &dev->queue_conf[queue_id];
+	if (!q_conf->queue_enable || blkdev->qs[queue_id] != NULL)
+		return 0;
+
+	/* Shadow descriptors followed by driver event area, then request contexts and
+	 * free data buffer slots.
+	 */
+	depth = RTE_MIN(blkdev->queue_depth, q_conf->queue_size);
+	shadow_area = RTE_ALIGN(q_conf->queue_size * DESC_ENTRY_SZ + 8, RTE_CACHE_LINE_SIZE);
+	req_area = q_conf->queue_size * sizeof(struct virtio_blk_req);
+	q = rte_zmalloc("virtio_blk_queue",
+			sizeof(*q) + shadow_area + req_area + depth * sizeof(uint16_t),
+			RTE_CACHE_LINE_SIZE);
+	if (!q) {
+		dao_err("[dev %u] Failed to allocate memory for virtio queue", dev->dev_id);
+		return -ENOMEM;
+	}
+
+	reqs = (struct virtio_blk_req *)((uintptr_t)(q + 1) + shadow_area);
+	virtio_req_ring_init(&q->ring,
+			     ((uint64_t)q_conf->queue_desc_hi << 32) | (q_conf->queue_desc_lo),
+			     (uint32_t *)(dev->notify_base + (queue_id * dev->notify_off_mltpr)),
+			     q_conf->queue_size, q->sd_desc_base, reqs, sizeof(*reqs),
+			     virtio_blk_has_stats_feature() ? &q->stats.dma_fails : NULL);
+	q->driver_area = (((uint64_t)q_conf->queue_avail_hi << 32) | (q_conf->queue_avail_lo));
+	q->qid = queue_id;
+	q->dma_vchan = dev->dma_vchan;
+	q->free_slots = (uint16_t *)((uintptr_t)reqs + req_area);
+
+	q->intr_used_off = q->ring.sd_desc_off;
+	q->intr_event_off = q->ring.sd_desc_off;
+	q->intr_sig_off = q->ring.sd_desc_off;
+
+	q->ops = be->ops;
+	q->capacity = be->capacity;
+	q->blk_mask = be->blk_size - 1;
+	q->read_only = be->read_only;
+	q->flush = !!(dev->feature_bits & RTE_BIT64(VIRTIO_BLK_F_FLUSH));
+
+	/* Page aligned so that backend can do direct I/O on data buffers */
+	q->slot_sz = VIRTIO_BLK_SEG_MAX * blkdev->seg_size_max;
+	buf_sz = (size_t)q->slot_sz * depth;
+	q->buf_area = rte_zmalloc("virtio_blk_buf", buf_sz, RTE_PGSIZE_4K);
+	if (!q->buf_area) {
+		dao_err("[dev %u] Failed to allocate %zu bytes of queue%u data buffers",
+			dev->dev_id, buf_sz, queue_id);
+		rc = -ENOMEM;
+		goto free_queue;
+	}
+	for (i = 0; i < depth; i++)
+		q->free_slots[i] = depth - 1 - i;
+	q->nb_free_slots = depth;
+
+	rc = be->ops->queue_setup(be->ctx, queue_id, depth, q->buf_area, buf_sz, &q->qctx);
+	if (rc) {
+		dao_err("[dev %u] Backend queue%u setup failed, rc=%d", dev->dev_id, queue_id, rc);
+		q->qctx = NULL;
+		goto free_queue;
+	}
+
+	blkdev->qs[queue_id] = q;
+	dao_blkdev->qs[queue_id] = q;
+
+	dao_dbg("[dev %u] Adding queue%d: desc_base %p q_sz %u depth %u", dev->dev_id, queue_id,
+		(void *)q->ring.desc_base, q->ring.q_sz, depth);
+	return 0;
+
+free_queue:
+	virtio_blkdev_queue_free(q);
+	return rc;
+}
+
+static int
+virtio_blkdev_queue_enable(struct virtio_dev *dev, uint16_t queue_id)
+{
+	struct virtio_blkdev *blkdev = virtio_dev_to_blkdev(dev);
+
+	return virtio_blkdev_populate_queue_info(blkdev, queue_id);
+}
+
+static void
+virtio_blkdev_clear_queue_info(struct virtio_blkdev *blkdev)
+{
+	struct dao_virtio_blkdev *dao_blkdev = virtio_blkdev_to_dao(blkdev);
+	uint32_t i;
+
+	for (i = 0; i < blkdev->nb_qs; i++) {
+		if (!blkdev->qs[i])
+			continue;
+
+		virtio_blk_queue_drain(blkdev->qs[i]);
+		virtio_blkdev_queue_free(blkdev->qs[i]);
+		blkdev->qs[i] = NULL;
+		dao_blkdev->qs[i] = NULL;
+	}
+}
+
+static void
+virtio_blkdev_cq_cmd_process(struct virtio_dev *dev, struct rte_dma_sge *src,
+			     struct rte_dma_sge *dst, uint16_t nb_desc)
+{
+	RTE_SET_USED(src);
+	RTE_SET_USED(dst);
+	RTE_SET_USED(nb_desc);
+
+	/* Virtio blk has no control queue */
+	dao_err("[dev %u] Unexpected control queue command", dev->dev_id);
+}
+
+static int
+virtio_blkdev_status_cb(struct virtio_dev *dev, uint8_t status)
+{
+	struct virtio_blkdev *blkdev = virtio_dev_to_blkdev(dev);
+	int rc = 0;
+
+	if (status & VIRTIO_DEV_DRIVER_OK) {
+		virtio_blkdev_cb_interrupt_conf(blkdev);
+	} else if (status == VIRTIO_DEV_RESET) {
+		if (blk_user_cbs.status_cb)
+			rc = blk_user_cbs.status_cb(dev->dev_id, status);
+
+		/* Application stopped polling the queues, wait for DMA and drain them */
+		dao_dma_compl_wait(dev->dma_vchan);
+		virtio_blkdev_clear_queue_info(blkdev);
+		return rc;
+	}
+
+	if (blk_user_cbs.status_cb)
+		rc = blk_user_cbs.status_cb(dev->dev_id, status);
+	return rc;
+}
+
+static uint16_t
+virtio_blkdev_cq_id_get(struct virtio_dev *dev, uint64_t feature_bits)
+{
+	struct virtio_blkdev *blkdev = virtio_dev_to_blkdev(dev);
+
+	RTE_SET_USED(feature_bits);
+
+	/* No control queue, point past request queues to a queue driver never enables */
+	return blkdev->nb_qs;
+}
+
+void
+dao_virtio_blkdev_cb_register(struct dao_virtio_blkdev_cbs *cbs)
+{
+	blk_user_cbs = *cbs;
+}
+
+void
+dao_virtio_blkdev_cb_unregister(void)
+{
+	memset(&blk_user_cbs, 0, sizeof(blk_user_cbs));
+}
+
+int
+dao_virtio_blkdev_init(uint16_t devid, struct dao_virtio_blkdev_conf *conf)
+{
+	struct dao_virtio_blkdev *virtio_blkdev = &dao_virtio_blkdevs[devid];
+	struct virtio_blkdev *blkdev = virtio_blkdev_priv(virtio_blkdev);
+	struct dao_virtio_blkdev_backend *be = &conf->backend;
+	volatile struct virtio_blk_config *dev_cfg;
+	struct virtio_dev *dev = &blkdev->dev;
+	uint64_t feature_bits;
+	int max_qs;
+	int rc;
+
+	RTE_BUILD_BUG_ON(sizeof(struct virtio_blkdev) > DAO_VIRTIO_BLKDEV_MEM_SZ);
+
+	if (!be->ops || !be->ops->queue_setup || !be->ops->queue_release || !be->ops->submit ||
+	    !be->ops->poll) {
+		dao_err("[dev %u] Invalid backend ops", devid);
+		return -EINVAL;
+	}
+
+	if (be->blk_size < (1U << VIRTIO_BLK_SECTOR_SHIFT) || !rte_is_power_of_2(be->blk_size) ||
+	    be->capacity < be->blk_size) {
+		dao_err("[dev %u] Invalid backend block size %u or capacity %" PRIu64, devid,
+			be->blk_size, be->capacity);
+		return -EINVAL;
+	}
+
+	blkdev->seg_size_max = conf->seg_size_max ? conf->seg_size_max :
+						    DAO_VIRTIO_BLKDEV_SEG_SIZE_DFLT;
+	if (blkdev->seg_size_max < be->blk_size || blkdev->seg_size_max & (be->blk_size - 1)) {
+		dao_err("[dev %u] Segment size %u not a multiple of block size %u", devid,
+			blkdev->seg_size_max, be->blk_size);
+		return -EINVAL;
+	}
+
+	max_qs = virtio_dev_max_virtio_queues(conf->pem_devid, devid);
+	if (max_qs < 0)
+		return max_qs;
+
+	/* One queue is left for the control queue id that is never enabled */
+	blkdev->nb_qs = RTE_MIN(max_qs - 1, (int)DAO_VIRTIO_MAX_QUEUES - 1);
+	if (conf->max_queues_limit)
+		blkdev->nb_qs = RTE_MIN(blkdev->nb_qs, conf->max_queues_limit);
+	if (!blkdev->nb_qs) {
+		dao_err("[dev %u] No request queues available", devid);
+		return -ENOSPC;
+	}
+
+	blkdev->queue_depth =
+		conf->queue_depth ? conf->queue_depth : DAO_VIRTIO_BLKDEV_QUEUE_DEPTH_DFLT;
+	blkdev->backend = *be;
+
+	dev->dev_id = devid;
+	dev->dev_type = VIRTIO_DEV_TYPE_BLK;
+	dev->pem_devid = conf->pem_devid;
+	dev->dma_vchan = conf->dma_vchan;
+	/* Base device needs room for three queues even with a single request queue */
+	dev->max_virtio_queues_limit = RTE_MAX(blkdev->nb_qs + 1, 3);
+
+	/* Initialize base virtio device */
+	rc = virtio_dev_init(dev);
+	if (rc)
+		return rc;
+
+	feature_bits = RTE_BIT64(VIRTIO_BLK_F_SIZE_MAX) | RTE_BIT64(VIRTIO_BLK_F_SEG_MAX) |
+		       RTE_BIT64(VIRTIO_BLK_F_BLK_SIZE) | RTE_BIT64(VIRTIO_F_RING_EVENT_IDX);
+	if (blkdev->nb_qs > 1)
+		feature_bits |= RTE_BIT64(VIRTIO_BLK_F_MQ);
+	if (be->read_only)
+		feature_bits |= RTE_BIT64(VIRTIO_BLK_F_RO);
+	if (be->flush)
+		feature_bits |= RTE_BIT64(VIRTIO_BLK_F_FLUSH);
+	virtio_dev_feature_bits_set(dev, feature_bits);
+
+	/* Setup blk device config */
+	dev_cfg = (volatile struct virtio_blk_config *)dev->dev_cfg;
+	dao_dev_memset(dev_cfg, 0, sizeof(*dev_cfg));
+	dev_cfg->capacity = be->capacity >> VIRTIO_BLK_SECTOR_SHIFT;
+	dev_cfg->size_max = blkdev->seg_size_max;
+	dev_cfg->seg_max = VIRTIO_BLK_SEG_MAX;
+	dev_cfg->blk_size = be->blk_size;
+	dev_cfg->num_queues = blkdev->nb_qs;
+
+	/* One time setup */
+	dev_cbs[VIRTIO_DEV_TYPE_BLK].dev_status = virtio_blkdev_status_cb;
+	dev_cbs[VIRTIO_DEV_TYPE_BLK].cq_cmd_process = virtio_blkdev_cq_cmd_process;
+	dev_cbs[VIRTIO_DEV_TYPE_BLK].cq_id_get = virtio_blkdev_cq_id_get;
+	dev_cbs[VIRTIO_DEV_TYPE_BLK].queue_enable = virtio_blkdev_queue_enable;
+	dev_cbs[VIRTIO_DEV_TYPE_BLK].feature_validate = virtio_blkdev_feature_validate;
+	return 0;
+}
+
+int
+dao_virtio_blkdev_fini(uint16_t devid)
+{
+	struct dao_virtio_blkdev *virtio_blkdev = &dao_virtio_blkdevs[devid];
+	struct virtio_blkdev *blkdev = virtio_blkdev_priv(virtio_blkdev);
+
+	return virtio_dev_fini(&blkdev->dev);
+}
+
+int
+dao_virtio_blkdev_queue_count(uint16_t devid)
+{
+	struct dao_virtio_blkdev *virtio_blkdev = &dao_virtio_blkdevs[devid];
+	struct virtio_blkdev *blkdev = virtio_blkdev_priv(virtio_blkdev);
+	struct virtio_dev *dev = &blkdev->dev;
+
+	if (!dev->driver_ok)
+		return -EINVAL;
+
+	/* Driver without VIRTIO_BLK_F_MQ uses only the first queue */
+	if (!(dev->feature_bits & RTE_BIT64(VIRTIO_BLK_F_MQ)))
+		return 1;
+
+	return blkdev->nb_qs;
+}
+
+int
+dao_virtio_blkdev_stats_get(uint16_t devid, uint16_t qid,
+			    struct dao_virtio_blkdev_queue_stats *stats)
+{
+	struct dao_virtio_blkdev *virtio_blkdev = &dao_virtio_blkdevs[devid];
+	struct virtio_blkdev *blkdev = virtio_blkdev_priv(virtio_blkdev);
+	struct virtio_blk_queue *q;
+
+	if (!virtio_blk_has_stats_feature())
+		return -ENOTSUP;
+
+	if (qid >= DAO_VIRTIO_MAX_QUEUES - 1 || !stats)
+		return -EINVAL;
+
+	q = blkdev->qs[qid];
+	if (!q)
+		return -ENOENT;
+
+	stats->read_reqs = q->stats.read_reqs - q->stats_base.read_reqs;
+	stats->write_reqs = q->stats.write_reqs - q->stats_base.write_reqs;
+	stats->flush_reqs = q->stats.flush_reqs - q->stats_base.flush_reqs;
+	stats->read_bytes = q->stats.read_bytes - q->stats_base.read_bytes;
+	stats->write_bytes = q->stats.write_bytes - q->stats_base.write_bytes;
+	stats->deq_reqs = q->stats.deq_reqs - q->stats_base.deq_reqs;
+	stats->err_reqs = q->stats.err_reqs - q->stats_base.err_reqs;
+	stats->inval_reqs = q->stats.inval_reqs - q->stats_base.inval_reqs;
+	stats->busy = q->stats.busy - q->stats_base.busy;
+	stats->dma_fails = q->stats.dma_fails - q->stats_base.dma_fails;
+	stats->intrs = q->stats.intrs - q->stats_base.intrs;
+	stats->intrs_suppressed = q->stats.intrs_suppressed - q->stats_base.intrs_suppressed;
+	return 0;
+}
+
+int
+dao_virtio_blkdev_stats_reset(uint16_t devid)
+{
+	struct dao_virtio_blkdev *virtio_blkdev = &dao_virtio_blkdevs[devid];
+	struct virtio_blkdev *blkdev = virtio_blkdev_priv(virtio_blkdev);
+	struct virtio_blk_queue *q;
+	uint32_t i;
+
+	if (!virtio_blk_has_stats_feature())
+		return -ENOTSUP;
+
+	/* Counters are owned by request queue lcores, keep a snapshot instead of clearing */
+	for (i = 0; i < DAO_VIRTIO_MAX_QUEUES - 1; i++) {
+		q = blkdev->qs[i];
+		if (q)
+			q->stats_base = q->stats;
+	}
+	return 0;
+}
@@ -0,0 +1,176 @@
+/* SPDX-License-Identifier: Marvell-Proprietary
+ * Copyright (c) 2024 Marvell
+ */
+
+/**
+ * @file
+ *
+ * DAO virtio crypto library
+ *
+ * Emulates a virtio crypto device over PEM and serves its data queue requests
+ * using a DPDK cryptodev. Each data queue is mapped to one queue pair of the
+ * cryptodev and is expected to be polled by a single lcore.
+ */
+
+#ifndef __INCLUDE_DAO_VIRTIO_CRYPTO_H__
+#define __INCLUDE_DAO_VIRTIO_CRYPTO_H__
+
+#include <dao_virtio.h>
+#include <dao_util.h>
+
+#include <spec/virtio_crypto.h>
+
+/** Max sessions per virtio crypto device when not configured */
+#define DAO_VIRTIO_CRYPTODEV_SESSIONS_DFLT 1024
+
+/** Virtio crypto device configuration */
+struct dao_virtio_cryptodev_conf {
+	/** PEM device ID */
+	uint16_t pem_devid;
+	/** Vchan to use for this virtio dev */
+	uint16_t dma_vchan;
+	/** Max data queues limit, zero for as many as device supports */
+	uint16_t max_data_queues_limit;
+	/**
+	 * Cryptodev ID to dispatch requests to.
+	 *
+	 * Cryptodev needs to be configured and started by application before
+	 * driver sets DRIVER_OK on the virtio crypto device.
+	 */
+	uint8_t cdev_id;
+	/** Cryptodev queue pair of data queue zero, data queue N uses cdev_qp_base + N */
+	uint16_t cdev_qp_base;
+	/** Mempool to gather request data, mbuf data room limits request size */
+	struct rte_mempool *pool;
+	/** Max symmetric sessions, zero for DAO_VIRTIO_CRYPTODEV_SESSIONS_DFLT */
+	uint16_t max_sessions;
+};
+
+/* End of structure dao_virtio_cryptodev_conf. */
+
+/** Virtio crypto device queue stats */
+struct dao_virtio_cryptodev_queue_stats {
+	/** Requests submitted to cryptodev */
+	uint64_t enq_reqs;
+	/** Requests completed back to driver */
+	uint64_t deq_reqs;
+	/** Requests completed with error status */
+	uint64_t err_reqs;
+	/** Requests rejected as not supported or malformed without reaching cryptodev */
+	uint64_t inval_reqs;
+	/** Mbuf or crypto op allocation failures */
+	uint64_t alloc_fails;
+	/** DMA flush failures, due to DMA ring being full or DMA enqueue errors */
+	uint64_t dma_fails;
+};
+
+/** Virtio crypto device data */
+struct dao_virtio_cryptodev {
+	/** Array of virtio data queue pointers */
+	void *qs[DAO_VIRTIO_MAX_QUEUES] __rte_cache_aligned;
+#define DAO_VIRTIO_CRYPTODEV_MEM_SZ 8192
+	uint8_t reserved[DAO_VIRTIO_CRYPTODEV_MEM_SZ];
+};
+
+/** Virtio crypto devices */
+extern struct dao_virtio_cryptodev dao_virtio_cryptodevs[];
+
+/** Device status callback */
+typedef int (*dao_virtio_cryptodev_status_cb_t)(uint16_t devid, uint8_t status);
+
+/** Virtio crypto device callbacks */
+struct dao_virtio_cryptodev_cbs {
+	/** Device status callback */
+	dao_virtio_cryptodev_status_cb_t status_cb;
+};
+
+/* End of structure dao_virtio_cryptodev_cbs. */
+
+/**
+ * Virtio crypto device initialize.
+ *
+ * @param devid
+ *    Virtio crypto device ID
+ * @param conf
+ *    Virtio crypto device config.
+ * @return
+ *    Zero on success.
+ */
+int dao_virtio_cryptodev_init(uint16_t devid, struct dao_virtio_cryptodev_conf *conf);
+
+/**
+ * Virtio crypto device cleanup.
+ *
+ * @param devid
+ *    Virtio crypto device ID
+ * @return
+ *    Zero on success.
+ */
+int dao_virtio_cryptodev_fini(uint16_t devid);
+
+/**
+ * Virtio crypto device callback register
+ *
+ * @param cbs
+ *    Application callbacks for virtio crypto devices
+ */
+void dao_virtio_cryptodev_cb_register(struct dao_virtio_cryptodev_cbs *cbs);
+
+/**
+ * Virtio crypto device callback unregister
+ */
+void dao_virtio_cryptodev_cb_unregister(void);
+
+/**
+ * Get crypto device data queue count.
+ *
+ * @param devid
+ *    Virtio crypto device ID.
+ * @return
+ *    Number of data queues configured on success. Negative on failure.
+ */
+int dao_virtio_cryptodev_queue_count(uint16_t devid);
+
+/**
+ * Serve requests of a virtio crypto data queue.
+ *
+ * Fetches new requests from host, dispatches them in bursts to cryptodev queue
+ * pair of the data queue and returns completed requests to host. DMA ops are
+ * batched in lcore vchan state, caller is expected to call dao_dma_flush_submit()
+ * in its loop as well.
+ *
+ * @param devid
+ *    Virtio crypto device ID.
+ * @param qid
+ *    Data queue ID.
+ * @return
+ *    Number of requests returned to host.
+ */
+uint16_t dao_virtio_cryptodev_process(uint16_t devid, uint16_t qid);
+
+/**
+ * Get virtio crypto data queue stats.
+ *
+ * @param devid
+ *    Virtio crypto device ID.
+ * @param qid
+ *    Data queue ID.
+ * @param stats
+ *    Pointer to stats to fill.
+ * @return
+ *    Zero on success.
+ */
+int dao_virtio_cryptodev_stats_get(uint16_t devid, uint16_t qid,
+				   struct dao_virtio_cryptodev_queue_stats *stats);
+
+/**
+ * Reset stats of all data queues of a virtio crypto device.
+ *
+ * @param devid
+ *    Virtio crypto device ID.
+ * @return
+ *    Zero on success.
+ */
+int dao_virtio_cryptodev_stats_reset(uint16_t devid);
+
+#endif /* __INCLUDE_DAO_VIRTIO_CRYPTO_H__ */
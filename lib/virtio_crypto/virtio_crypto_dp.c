@@ -0,0 +1,300 @@
+/* SPDX-License-Identifier: Marvell-Proprietary
+ * Copyright (c) 2024 Marvell.
+ */
+#include <rte_cryptodev.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+
+#include "dao_virtio_cryptodev.h"
+#include "virtio_dev_priv.h"
+#include "virtio_req_priv.h"
+#include "virtio_crypto_priv.h"
+
+#define VIRTIO_CRYPTO_STATS_ADD(q, field, val)                                                     \
+	do {                                                                                       \
+		if (virtio_crypto_has_stats_feature())                                             \
+			(q)->stats.field += (val);                                                 \
+	} while (0)
+
+static __rte_always_inline struct virtio_crypto_req *
+virtio_crypto_req_get(struct virtio_crypto_queue *q, uint16_t off)
+{
+	return (struct virtio_crypto_req *)virtio_req_get(&q->ring, off);
+}
+
+/* Gather device readable buffers of each new request chain to an mbuf */
+static __rte_always_inline int
+virtio_crypto_req_prep(struct virtio_req_ring *ring, struct virtio_req *vreq, bool inval,
+		       struct virtio_req_dst *dst)
+{
+	struct virtio_crypto_queue *q = container_of(ring, struct virtio_crypto_queue, ring);
+	struct virtio_crypto_req *req = (struct virtio_crypto_req *)vreq;
+	struct rte_mbuf *m;
+
+	req->mbuf = NULL;
+
+	/* Request needs header to parse and has to fit an mbuf */
+	inval |= vreq->rd_len < VIRTIO_CRYPTO_REQ_HDR_SZ || vreq->rd_len > q->max_req_sz;
+	if (unlikely(inval)) {
+		vreq->status = VIRTIO_CRYPTO_BADMSG;
+		VIRTIO_CRYPTO_STATS_ADD(q, inval_reqs, 1);
+		return 1;
+	}
+
+	m = rte_pktmbuf_alloc(q->mp);
+	if (unlikely(!m)) {
+		VIRTIO_CRYPTO_STATS_ADD(q, alloc_fails, 1);
+		return -ENOMEM;
+	}
+	m->data_len = vreq->rd_len;
+	m->pkt_len = vreq->rd_len;
+	req->mbuf = m;
+
+	/* Header, IV and source data are kept contiguous */
+	dst->hdr_len = 0;
+	dst->data = rte_pktmbuf_mtod(m, rte_iova_t);
+	return 0;
+}
+
+static __rte_always_inline uint8_t
+virtio_crypto_req_parse(struct virtio_crypto_queue *q, struct virtio_crypto_req *req, void **sess)
+{
+	struct virtio_crypto_op_data_req *hdr;
+	struct virtio_crypto_cipher_para *para;
+	struct virtio_crypto_sess *vsess;
+	uint64_t session_id;
+
+	hdr = rte_pktmbuf_mtod(req->mbuf, struct virtio_crypto_op_data_req *);
+	if ((hdr->header.opcode != VIRTIO_CRYPTO_CIPHER_ENCRYPT &&
+	     hdr->header.opcode != VIRTIO_CRYPTO_CIPHER_DECRYPT) ||
+	    hdr->u.sym_req.op_type != VIRTIO_CRYPTO_SYM_OP_CIPHER)
+		return VIRTIO_CRYPTO_NOTSUPP;
+
+	session_id = hdr->header.session_id;
+	if (session_id >= q->max_sessions)
+		return VIRTIO_CRYPTO_INVSESS;
+
+	vsess = &q->sess_tbl[session_id];
+	*sess = __atomic_load_n(&vsess->sess, __ATOMIC_ACQUIRE);
+	if (!*sess)
+		return VIRTIO_CRYPTO_INVSESS;
+
+	/* Cipher result is written in place of source and is of the same length */
+	para = &hdr->u.sym_req.u.cipher.para;
+	if (para->iv_len != vsess->iv_len || para->dst_data_len != para->src_data_len ||
+	    (uint64_t)VIRTIO_CRYPTO_REQ_HDR_SZ + para->iv_len + para->src_data_len >
+		    req->req.rd_len ||
+	    (uint64_t)para->dst_data_len + 1 > req->req.wr_len)
+		return VIRTIO_CRYPTO_BADMSG;
+
+	req->data_off = VIRTIO_CRYPTO_REQ_HDR_SZ + para->iv_len;
+	req->req.dst_len = para->dst_data_len;
+	return VIRTIO_CRYPTO_OK;
+}
+
+/* Hand gathered requests to cryptodev queue pair, in ring order */
+static __rte_always_inline void
+virtio_crypto_req_submit(struct virtio_crypto_queue *q)
+{
+	struct rte_crypto_op *ops[VIRTIO_CRYPTO_BURST];
+	uint16_t offs[VIRTIO_CRYPTO_BURST];
+	void *sess[VIRTIO_CRYPTO_BURST];
+	struct virtio_req_ring *ring = &q->ring;
+	uint16_t off = ring->submit_off;
+	struct virtio_crypto_req *req;
+	uint16_t nb_ops = 0, nb_enq;
+	struct rte_crypto_op *op;
+	uint8_t status;
+	uint8_t *iv;
+	uint16_t i;
+
+	while (off != ring->parse_off && nb_ops < VIRTIO_CRYPTO_BURST) {
+		req = virtio_crypto_req_get(q, off);
+		if (req->req.state == VIRTIO_REQ_GATHER)
+			break;
+
+		/* Requests failed earlier are already done, skip past them */
+		if (req->req.state == VIRTIO_REQ_GATHERED) {
+			status = virtio_crypto_req_parse(q, req, &sess[nb_ops]);
+			if (likely(status == VIRTIO_CRYPTO_OK)) {
+				offs[nb_ops++] = off;
+			} else {
+				req->req.dst_len = 0;
+				req->req.status = status;
+				req->req.state = VIRTIO_REQ_DONE;
+				VIRTIO_CRYPTO_STATS_ADD(q, inval_reqs, 1);
+			}
+		}
+		off = desc_off_add(off, req->req.nb_desc, ring->q_sz);
+	}
+
+	if (!nb_ops) {
+		ring->submit_off = off;
+		return;
+	}
+
+	/* Parsing is repeated on retry, requests stay gathered till ops are available */
+	if (unlikely(rte_crypto_op_bulk_alloc(q->op_mp, RTE_CRYPTO_OP_TYPE_SYMMETRIC, ops,
+					      nb_ops) != nb_ops)) {
+		VIRTIO_CRYPTO_STATS_ADD(q, alloc_fails, 1);
+		return;
+	}
+
+	for (i = 0; i < nb_ops; i++) {
+		req = virtio_crypto_req_get(q, offs[i]);
+		op = ops[i];
+
+		rte_crypto_op_attach_sym_session(op, sess[i]);
+		op->sym->m_src = req->mbuf;
+		op->sym->cipher.data.offset = req->data_off;
+		op->sym->cipher.data.length = req->req.dst_len;
+
+		/* IV follows request header */
+		iv = rte_crypto_op_ctod_offset(op, uint8_t *, VIRTIO_CRYPTO_IV_OFF);
+		rte_memcpy(iv, rte_pktmbuf_mtod_offset(req->mbuf, uint8_t *,
+						       VIRTIO_CRYPTO_REQ_HDR_SZ),
+			   req->data_off - VIRTIO_CRYPTO_REQ_HDR_SZ);
+		*rte_crypto_op_ctod_offset(op, uint16_t *, VIRTIO_CRYPTO_SLOT_OFF) =
+			DESC_OFF(offs[i]);
+	}
+
+	nb_enq = rte_cryptodev_enqueue_burst(q->cdev_id, q->cdev_qp, ops, nb_ops);
+	for (i = 0; i < nb_enq; i++)
+		virtio_crypto_req_get(q, offs[i])->req.state = VIRTIO_REQ_SUBMITTED;
+	ring->inflight += nb_enq;
+	VIRTIO_CRYPTO_STATS_ADD(q, enq_reqs, nb_enq);
+
+	if (unlikely(nb_enq < nb_ops)) {
+		/* Retry rest once queue pair has room */
+		rte_mempool_put_bulk(q->op_mp, (void **)&ops[nb_enq], nb_ops - nb_enq);
+		off = offs[nb_enq];
+	}
+	ring->submit_off = off;
+}
+
+/* Collect completed ops, cryptodev may return them out of order */
+static __rte_always_inline void
+virtio_crypto_req_dequeue(struct virtio_crypto_queue *q)
+{
+	struct rte_crypto_op *ops[VIRTIO_CRYPTO_BURST];
+	struct virtio_crypto_req *req;
+	uint16_t nb_ops, slot, i;
+
+	nb_ops = rte_cryptodev_dequeue_burst(q->cdev_id, q->cdev_qp, ops, VIRTIO_CRYPTO_BURST);
+	if (!nb_ops)
+		return;
+
+	for (i = 0; i < nb_ops; i++) {
+		slot = *rte_crypto_op_ctod_offset(ops[i], uint16_t *, VIRTIO_CRYPTO_SLOT_OFF);
+		req = virtio_crypto_req_get(q, slot);
+		if (likely(ops[i]->status == RTE_CRYPTO_OP_STATUS_SUCCESS)) {
+			req->req.status = VIRTIO_CRYPTO_OK;
+		} else {
+			req->req.status = VIRTIO_CRYPTO_ERR;
+			req->req.dst_len = 0;
+			VIRTIO_CRYPTO_STATS_ADD(q, err_reqs, 1);
+		}
+		req->req.state = VIRTIO_REQ_DONE;
+	}
+
+	rte_mempool_put_bulk(q->op_mp, (void **)ops, nb_ops);
+	q->ring.inflight -= nb_ops;
+}
+
+/* Cipher result is written back from the mbuf, in place of source data */
+static __rte_always_inline rte_iova_t
+virtio_crypto_req_result(struct virtio_req_ring *ring, struct virtio_req *vreq)
+{
+	struct virtio_crypto_req *req = (struct virtio_crypto_req *)vreq;
+
+	RTE_SET_USED(ring);
+	return rte_pktmbuf_mtod_offset(req->mbuf, rte_iova_t, req->data_off);
+}
+
+static __rte_always_inline void
+virtio_crypto_req_release(struct virtio_req_ring *ring, struct virtio_req *vreq)
+{
+	struct virtio_crypto_req *req = (struct virtio_crypto_req *)vreq;
+
+	RTE_SET_USED(ring);
+	if (req->mbuf)
+		rte_pktmbuf_free(req->mbuf);
+	req->mbuf = NULL;
+}
+
+uint16_t
+dao_virtio_cryptodev_process(uint16_t devid, uint16_t qid)
+{
+	struct dao_virtio_cryptodev *virtio_cryptodev = &dao_virtio_cryptodevs[devid];
+	struct virtio_crypto_queue *q = virtio_cryptodev->qs[qid];
+	struct dao_dma_vchan_state *dev2mem, *mem2dev;
+	struct virtio_req_ring *ring;
+	uint16_t nb_used;
+
+	if (unlikely(!q))
+		return 0;
+
+	ring = &q->ring;
+	dev2mem = dao_dma_lcore_dev2mem_get(q->dma_vchan, devid);
+	mem2dev = dao_dma_lcore_mem2dev_get(q->dma_vchan, devid);
+
+	/* Fetch all DMA completed status */
+	dao_dma_check_meta_compl(dev2mem, 1 /* ATOMIC update */);
+	dao_dma_check_meta_compl(mem2dev, 1 /* ATOMIC update */);
+
+	if (ring->pend_intr && dao_dma_op_status(mem2dev, ring->pend_intr_idx)) {
+		ring->pend_intr = 0;
+		if (q->cb_intr_addr) {
+			__atomic_store_n(q->cb_notify_addr, 1, __ATOMIC_RELAXED);
+			__atomic_store_n(q->cb_intr_addr, (1UL << 59), __ATOMIC_RELAXED);
+		}
+	}
+
+	virtio_req_desc_fetch(ring, dev2mem);
+	virtio_req_gather(ring, dev2mem, virtio_crypto_req_prep);
+	if (ring->inflight)
+		virtio_crypto_req_dequeue(q);
+	virtio_crypto_req_submit(q);
+	virtio_req_scatter(ring, mem2dev, virtio_crypto_req_result);
+
+	nb_used = virtio_req_used(ring, mem2dev, virtio_crypto_req_release);
+	VIRTIO_CRYPTO_STATS_ADD(q, deq_reqs, nb_used);
+	return nb_used;
+}
+
+static uint16_t
+virtio_crypto_drain_poll(struct virtio_req_ring *ring)
+{
+	struct virtio_crypto_queue *q = container_of(ring, struct virtio_crypto_queue, ring);
+	struct rte_crypto_op *ops[VIRTIO_CRYPTO_BURST];
+	uint16_t nb_ops;
+
+	nb_ops = rte_cryptodev_dequeue_burst(q->cdev_id, q->cdev_qp, ops, VIRTIO_CRYPTO_BURST);
+	if (nb_ops)
+		rte_mempool_put_bulk(q->op_mp, (void **)ops, nb_ops);
+	return nb_ops;
+}
+
+void
+virtio_crypto_queue_drain(struct virtio_crypto_queue *q)
+{
+	struct virtio_crypto_req *req;
+	uint16_t left, i;
+
+	/* Ops with cryptodev still reference request mbufs */
+	left = virtio_req_queue_drain(&q->ring, VIRTIO_CRYPTO_DRAIN_TMO_MS,
+				      virtio_crypto_drain_poll);
+	if (left)
+		dao_err("[qid %u] %u crypto ops not returned by cryptodev", q->qid, left);
+
+	for (i = 0; i < q->ring.q_sz; i++) {
+		req = virtio_crypto_req_get(q, i);
+		if (!req->mbuf)
+			continue;
+		/* Leak rather than free mbufs cryptodev may still write to */
+		if (left && req->req.state == VIRTIO_REQ_SUBMITTED)
+			continue;
+		rte_pktmbuf_free(req->mbuf);
+		req->mbuf = NULL;
+	}
+}
@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: Marvell-Proprietary
+ * Copyright (c) 2024 Marvell.
+ */
+#ifndef __INCLUDE_VIRTIO_CRYPTO_PRIV_H__
+#define __INCLUDE_VIRTIO_CRYPTO_PRIV_H__
+
+/* Requests handed to cryptodev or fetched back in one go */
+#define VIRTIO_CRYPTO_BURST 32
+
+/* Crypto ops per data queue in op pool */
+#define VIRTIO_CRYPTO_OPS_PER_QUEUE 1024
+
+/* Largest IV accepted from driver, AES block size */
+#define VIRTIO_CRYPTO_IV_MAX 16
+
+/* Crypto op private area holds IV followed by request slot */
+#define VIRTIO_CRYPTO_IV_OFF    (sizeof(struct rte_crypto_op) + sizeof(struct rte_crypto_sym_op))
+#define VIRTIO_CRYPTO_SLOT_OFF  (VIRTIO_CRYPTO_IV_OFF + VIRTIO_CRYPTO_IV_MAX)
+#define VIRTIO_CRYPTO_OP_PRIV_SZ (VIRTIO_CRYPTO_IV_MAX + sizeof(uint16_t))
+
+/* Request header gathered ahead of IV and source data */
+#define VIRTIO_CRYPTO_REQ_HDR_SZ sizeof(struct virtio_crypto_op_data_req)
+
+/* Time to wait for cryptodev to give back in flight ops on reset */
+#define VIRTIO_CRYPTO_DRAIN_TMO_MS 1000
+
+/* Request context, indexed by ring position of chain head */
+struct virtio_crypto_req {
+	struct virtio_req req;
+	/* Offset of source data in mbuf, past request header and IV */
+	uint16_t data_off;
+	struct rte_mbuf *mbuf;
+} __rte_aligned(32);
+
+struct virtio_crypto_sess {
+	void *sess;
+	uint16_t iv_len;
+};
+
+struct virtio_crypto_queue {
+	/* Descriptor fetch, request gather, scatter and used ring state */
+	struct virtio_req_ring ring;
+
+	/* Fast path */
+	uint16_t qid __rte_cache_aligned;
+	uint16_t dma_vchan;
+	uint16_t cdev_qp;
+	uint8_t cdev_id;
+	struct rte_mempool *mp;
+	struct rte_mempool *op_mp;
+	struct virtio_crypto_sess *sess_tbl;
+	uint16_t max_sessions;
+	uint32_t max_req_sz;
+	uint64_t *cb_intr_addr;
+	uint32_t *cb_notify_addr;
+
+	struct dao_virtio_cryptodev_queue_stats stats __rte_cache_aligned;
+	/* Stats snapshot at last reset */
+	struct dao_virtio_cryptodev_queue_stats stats_base;
+
+	/* Shadow descriptors laid out by ring position */
+	uint64_t sd_desc_base[] __rte_cache_aligned;
+} __rte_cache_aligned;
+
+struct virtio_cryptodev {
+	struct virtio_dev dev;
+	uint8_t cdev_id;
+	uint16_t cdev_qp_base;
+	struct rte_mempool *pool;
+	struct rte_mempool *op_mp;
+	struct rte_mempool *sess_mp;
+	struct virtio_crypto_sess *sess_tbl;
+	uint16_t max_sessions;
+
+	struct virtio_crypto_queue *qs[DAO_VIRTIO_MAX_QUEUES] __rte_cache_aligned;
+};
+
+extern struct dao_virtio_cryptodev_cbs crypto_user_cbs;
+
+void virtio_crypto_queue_drain(struct virtio_crypto_queue *q);
+
+static __rte_always_inline int
+virtio_crypto_has_stats_feature(void)
+{
+#if DAO_VIRTIO_STATS
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+static inline struct virtio_cryptodev *
+virtio_cryptodev_priv(struct dao_virtio_cryptodev *cryptodev)
+{
+	return (struct virtio_cryptodev *)cryptodev->reserved;
+}
+
+static inline struct virtio_cryptodev *
+virtio_dev_to_cryptodev(struct virtio_dev *dev)
+{
+	return (struct virtio_cryptodev *)dev;
+}
+
+static inline struct dao_virtio_cryptodev *
+virtio_cryptodev_to_dao(struct virtio_cryptodev *cryptodev)
+{
+	return (struct dao_virtio_cryptodev *)((uintptr_t)cryptodev -
+					       offsetof(struct dao_virtio_cryptodev, reserved));
+}
+
+#endif /* __INCLUDE_VIRTIO_CRYPTO_PRIV_H__ */
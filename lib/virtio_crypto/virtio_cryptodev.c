@@ -0,0 +1,615 @@
+/* SPDX-License-Identifier: Marvell-Proprietary
+ * Copyright (c) 2024 Marvell.
+ */
+#include <rte_cryptodev.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+
+#include "dao_virtio_cryptodev.h"
+#include "virtio_dev_priv.h"
+#include "virtio_req_priv.h"
+#include "virtio_crypto_priv.h"
+
+/** Virtio crypto devices */
+struct dao_virtio_cryptodev dao_virtio_cryptodevs[DAO_VIRTIO_DEV_MAX + 1];
+
+struct dao_virtio_cryptodev_cbs crypto_user_cbs;
+
+/* Cipher algorithms that can be offered when cryptodev supports them */
+static const struct {
+	uint32_t virtio_algo;
+	enum rte_crypto_cipher_algorithm algo;
+	uint16_t iv_len;
+} virtio_crypto_cipher_algos[] = {
+	{VIRTIO_CRYPTO_CIPHER_AES_ECB, RTE_CRYPTO_CIPHER_AES_ECB, 0},
+	{VIRTIO_CRYPTO_CIPHER_AES_CBC, RTE_CRYPTO_CIPHER_AES_CBC, 16},
+	{VIRTIO_CRYPTO_CIPHER_AES_CTR, RTE_CRYPTO_CIPHER_AES_CTR, 16},
+	{VIRTIO_CRYPTO_CIPHER_AES_XTS, RTE_CRYPTO_CIPHER_AES_XTS, 16},
+	{VIRTIO_CRYPTO_CIPHER_DES_CBC, RTE_CRYPTO_CIPHER_DES_CBC, 8},
+	{VIRTIO_CRYPTO_CIPHER_3DES_ECB, RTE_CRYPTO_CIPHER_3DES_ECB, 0},
+	{VIRTIO_CRYPTO_CIPHER_3DES_CBC, RTE_CRYPTO_CIPHER_3DES_CBC, 8},
+	{VIRTIO_CRYPTO_CIPHER_3DES_CTR, RTE_CRYPTO_CIPHER_3DES_CTR, 8},
+};
+
+static int
+virtio_cryptodev_dma_sync(struct virtio_dev *dev, int16_t dma_devid, rte_iova_t src,
+			  rte_iova_t dst, uint32_t len)
+{
+	bool has_err = 0;
+	uint16_t tmo_ms;
+	uint16_t cnt;
+	int rc;
+
+	rc = rte_dma_copy(dma_devid, dev->dma_vchan, src, dst, len, RTE_DMA_OP_FLAG_SUBMIT);
+	if (rc < 0)
+		return rc;
+
+	tmo_ms = VIRTIO_DMA_TMO_MS;
+	do {
+		rte_delay_us_sleep(1000);
+		cnt = rte_dma_completed(dma_devid, dev->dma_vchan, 1, NULL, &has_err);
+		if (unlikely(has_err))
+			return -EIO;
+		if (!--tmo_ms)
+			return -EFAULT;
+	} while (cnt != 1);
+
+	return 0;
+}
+
+static int
+virtio_cryptodev_feature_validate(struct virtio_dev *dev, uint64_t feature_bits)
+{
+	if ((feature_bits | dev->dev_feature_bits) != dev->dev_feature_bits) {
+		dao_err("[dev %u] Invalid feature bits negotiated 0x%" PRIx64 "(dev %" PRIx64 ")",
+			dev->dev_id, feature_bits, dev->dev_feature_bits);
+		return -EINVAL;
+	}
+
+	/* Data queues are served only as packed virtqueue */
+	if (!(feature_bits & RTE_BIT64(VIRTIO_F_RING_PACKED))) {
+		dao_err("[dev %u] Split virtqueue is not supported for virtio crypto",
+			dev->dev_id);
+		return -ENOTSUP;
+	}
+
+	return 0;
+}
+
+static int
+virtio_crypto_queue_event_flag(struct virtio_dev *dev, struct virtio_crypto_queue *q,
+			       uint64_t driver_area)
+{
+	struct vring_packed_desc_event *sd_driver_area;
+	int16_t dev2mem = dao_dma_ctrl_dev2mem();
+	int rc;
+
+	sd_driver_area = (struct vring_packed_desc_event *)((uintptr_t)q->sd_desc_base +
+							    q->ring.q_sz * DESC_ENTRY_SZ);
+	rc = virtio_cryptodev_dma_sync(dev, dev2mem, driver_area, (rte_iova_t)sd_driver_area,
+				       sizeof(*sd_driver_area));
+	if (rc < 0) {
+		dao_err("[dev %u] DMA failed for virtqueue driver area, rc=%d", dev->dev_id, rc);
+		return rc;
+	}
+
+	return sd_driver_area->desc_event_flags;
+}
+
+static void
+virtio_cryptodev_cb_interrupt_conf(struct virtio_cryptodev *cryptodev)
+{
+	uint32_t max_dqs = cryptodev->dev.max_virtio_queues - 1;
+	struct virtio_dev *dev = &cryptodev->dev;
+	struct virtio_queue_conf *q_conf;
+	struct virtio_crypto_queue *q;
+	uint32_t i, intr_idx;
+	uint64_t driver_area;
+	int event_flag;
+
+	if (!dev->nb_cb_intrs)
+		return;
+
+	intr_idx = 0;
+	for (i = 0; i < max_dqs; i++) {
+		q = cryptodev->qs[i];
+		if (!q)
+			continue;
+
+		/* Driver polling a queue does not want used buffer notifications */
+		q_conf = &dev->queue_conf[i];
+		driver_area = ((uint64_t)q_conf->queue_avail_hi << 32) | q_conf->queue_avail_lo;
+		event_flag = virtio_crypto_queue_event_flag(dev, q, driver_area);
+		if (event_flag < 0 || event_flag == RING_EVENT_FLAGS_DISABLE)
+			continue;
+
+		q->cb_notify_addr = q->ring.notify_addr + 1;
+		__atomic_store_n(q->cb_notify_addr, 0, __ATOMIC_RELAXED);
+		q->cb_intr_addr = dev->cb_intr_addr[intr_idx];
+		intr_idx = (intr_idx + 1) % dev->nb_cb_intrs;
+	}
+
+	dao_dbg("[dev %u] Enabled driver events for %u queues", dev->dev_id, max_dqs);
+}
+
+static int
+virtio_cryptodev_populate_queue_info(struct virtio_cryptodev *cryptodev, uint16_t queue_id)
+{
+	struct dao_virtio_cryptodev *dao_cryptodev = virtio_cryptodev_to_dao(cryptodev);
+	uint32_t max_dqs = cryptodev->dev.max_virtio_queues - 1;
+	struct virtio_dev *dev = &cryptodev->dev;
+	struct virtio_queue_conf *q_conf;
+	struct virtio_crypto_req *reqs;
+	struct virtio_crypto_queue *q;
+	uint32_t shadow_area;
+	uint32_t req_area;
+
+	if (queue_id >= max_dqs)
+		return -EINVAL;
+
+	q_conf = &dev->queue_conf[queue_id];
+	if (!q_conf->queue_enable || cryptodev->qs[queue_id] != NULL)
+		return 0;
+
+	/* Shadow descriptors followed by driver event area, then request contexts */
+	shadow_area = RTE_ALIGN(q_conf->queue_size * DESC_ENTRY_SZ + 8, RTE_CACHE_LINE_SIZE);
+	req_area = q_conf->queue_size * sizeof(struct virtio_crypto_req);
+	q = rte_zmalloc("virtio_crypto_queue", sizeof(*q) + shadow_area + req_area,
+			RTE_CACHE_LINE_SIZE);
+	if (!q) {
+		dao_err("[dev %u] Failed to allocate memory for virtio queue", dev->dev_id);
+		return -ENOMEM;
+	}
+
+	reqs = (struct virtio_crypto_req *)((uintptr_t)(q + 1) + shadow_area);
+	virtio_req_ring_init(&q->ring,
+			     ((uint64_t)q_conf->queue_desc_hi << 32) | (q_conf->queue_desc_lo),
+			     (uint32_t *)(dev->notify_base + (queue_id * dev->notify_off_mltpr)),
+			     q_conf->queue_size, q->sd_desc_base, reqs, sizeof(*reqs),
+			     virtio_crypto_has_stats_feature() ? &q->stats.dma_fails : NULL);
+	q->qid = queue_id;
+	q->dma_vchan = dev->dma_vchan;
+
+	q->cdev_id = cryptodev->cdev_id;
+	q->cdev_qp = cryptodev->cdev_qp_base + queue_id;
+	q->mp = cryptodev->pool;
+	q->op_mp = cryptodev->op_mp;
+	q->sess_tbl = cryptodev->sess_tbl;
+	q->max_sessions = cryptodev->max_sessions;
+	q->max_req_sz = rte_pktmbuf_data_room_size(cryptodev->pool) - RTE_PKTMBUF_HEADROOM;
+
+	cryptodev->qs[queue_id] = q;
+	dao_cryptodev->qs[queue_id] = q;
+
+	dao_dbg("[dev %u] Adding queue%d: desc_base %p q_sz %u cdev qp %u", dev->dev_id, queue_id,
+		(void *)q->ring.desc_base, q->ring.q_sz, q->cdev_qp);
+	return 0;
+}
+
+static int
+virtio_cryptodev_queue_enable(struct virtio_dev *dev, uint16_t queue_id)
+{
+	struct virtio_cryptodev *cryptodev = virtio_dev_to_cryptodev(dev);
+
+	return virtio_cryptodev_populate_queue_info(cryptodev, queue_id);
+}
+
+static void
+virtio_cryptodev_clear_queue_info(struct virtio_cryptodev *cryptodev)
+{
+	struct dao_virtio_cryptodev *dao_cryptodev = virtio_cryptodev_to_dao(cryptodev);
+	uint32_t max_dqs = cryptodev->dev.max_virtio_queues - 1;
+	uint32_t i;
+
+	for (i = 0; i < max_dqs; i++) {
+		if (!cryptodev->qs[i])
+			continue;
+
+		virtio_crypto_queue_drain(cryptodev->qs[i]);
+		rte_free(cryptodev->qs[i]);
+		cryptodev->qs[i] = NULL;
+		dao_cryptodev->qs[i] = NULL;
+	}
+}
+
+static void
+virtio_cryptodev_sess_clear(struct virtio_cryptodev *cryptodev)
+{
+	void *sess;
+	uint16_t i;
+
+	for (i = 0; i < cryptodev->max_sessions; i++) {
+		sess = cryptodev->sess_tbl[i].sess;
+		if (!sess)
+			continue;
+		cryptodev->sess_tbl[i].sess = NULL;
+		rte_cryptodev_sym_session_free(cryptodev->cdev_id, sess);
+	}
+}
+
+static uint32_t
+crypto_cipher_session_create(struct virtio_cryptodev *cryptodev,
+			     struct virtio_crypto_op_ctrl_req *ctrl, uint8_t *key,
+			     uint32_t key_room, uint64_t *session_id)
+{
+	struct virtio_crypto_sym_create_session_req *req = &ctrl->u.sym_create_session;
+	struct virtio_crypto_cipher_session_para *para = &req->u.cipher.para;
+	struct rte_crypto_sym_xform xform;
+	uint16_t i, id;
+	void *sess;
+
+	if (req->op_type != VIRTIO_CRYPTO_SYM_OP_CIPHER)
+		return VIRTIO_CRYPTO_NOTSUPP;
+
+	for (i = 0; i < RTE_DIM(virtio_crypto_cipher_algos); i++)
+		if (virtio_crypto_cipher_algos[i].virtio_algo == para->algo)
+			break;
+	if (i == RTE_DIM(virtio_crypto_cipher_algos))
+		return VIRTIO_CRYPTO_NOTSUPP;
+
+	if (para->keylen > key_room)
+		return VIRTIO_CRYPTO_BADMSG;
+
+	for (id = 0; id < cryptodev->max_sessions; id++)
+		if (!cryptodev->sess_tbl[id].sess)
+			break;
+	if (id == cryptodev->max_sessions)
+		return VIRTIO_CRYPTO_NOSPC;
+
+	memset(&xform, 0, sizeof(xform));
+	xform.type = RTE_CRYPTO_SYM_XFORM_CIPHER;
+	xform.cipher.op = para->op == VIRTIO_CRYPTO_OP_ENCRYPT ? RTE_CRYPTO_CIPHER_OP_ENCRYPT :
+								  RTE_CRYPTO_CIPHER_OP_DECRYPT;
+	xform.cipher.algo = virtio_crypto_cipher_algos[i].algo;
+	xform.cipher.key.data = key;
+	xform.cipher.key.length = para->keylen;
+	xform.cipher.iv.offset = VIRTIO_CRYPTO_IV_OFF;
+	xform.cipher.iv.length = virtio_crypto_cipher_algos[i].iv_len;
+
+	sess = rte_cryptodev_sym_session_create(cryptodev->cdev_id, &xform, cryptodev->sess_mp);
+	if (!sess) {
+		dao_dbg("[dev %u] Failed to create session algo %u keylen %u, rte_errno=%d",
+			cryptodev->dev.dev_id, para->algo, para->keylen, rte_errno);
+		return rte_errno == ENOTSUP ? VIRTIO_CRYPTO_NOTSUPP : VIRTIO_CRYPTO_ERR;
+	}
+
+	cryptodev->sess_tbl[id].iv_len = xform.cipher.iv.length;
+	/* Publish session after IV length for data queue lcores */
+	__atomic_store_n(&cryptodev->sess_tbl[id].sess, sess, __ATOMIC_RELEASE);
+	*session_id = id;
+	return VIRTIO_CRYPTO_OK;
+}
+
+static uint32_t
+crypto_session_destroy(struct virtio_cryptodev *cryptodev, uint64_t session_id)
+{
+	void *sess;
+
+	if (session_id >= cryptodev->max_sessions)
+		return VIRTIO_CRYPTO_INVSESS;
+
+	/* Driver destroys a session only after its requests are completed */
+	sess = __atomic_exchange_n(&cryptodev->sess_tbl[session_id].sess, NULL, __ATOMIC_ACQ_REL);
+	if (!sess)
+		return VIRTIO_CRYPTO_INVSESS;
+
+	rte_cryptodev_sym_session_free(cryptodev->cdev_id, sess);
+	return VIRTIO_CRYPTO_OK;
+}
+
+static void
+virtio_cryptodev_cq_cmd_process(struct virtio_dev *dev, struct rte_dma_sge *src,
+				struct rte_dma_sge *dst, uint16_t nb_desc)
+{
+	struct virtio_crypto_op_ctrl_req *ctrl = (struct virtio_crypto_op_ctrl_req *)dst[0].addr;
+	struct virtio_cryptodev *cryptodev = virtio_dev_to_cryptodev(dev);
+	struct virtio_crypto_session_input *input;
+	int16_t mem2dev = dao_dma_ctrl_mem2dev();
+	uint32_t status = VIRTIO_CRYPTO_NOTSUPP;
+	uint32_t tot_len = dst[0].length;
+	uint64_t session_id = 0;
+	uint32_t in_len;
+	uint8_t *inhdr;
+	int rc;
+
+	/* Last device writable buffer is session input on create and status on destroy */
+	in_len = src[nb_desc - 1].length >= sizeof(*input) ? sizeof(*input) : 1;
+	if (nb_desc < 2 || tot_len < sizeof(*ctrl) + in_len) {
+		dao_err("[dev %u] Invalid cq command, nb_desc %u len %u", dev->dev_id, nb_desc,
+			tot_len);
+		return;
+	}
+
+	dao_dbg("[dev %u] cq opcode: 0x%x algo: %u nb_desc %d", dev->dev_id, ctrl->header.opcode,
+		ctrl->header.algo, nb_desc);
+	switch (ctrl->header.opcode) {
+	case VIRTIO_CRYPTO_CIPHER_CREATE_SESSION:
+		status = crypto_cipher_session_create(cryptodev, ctrl, (uint8_t *)(ctrl + 1),
+						      tot_len - sizeof(*ctrl) - in_len,
+						      &session_id);
+		break;
+	case VIRTIO_CRYPTO_CIPHER_DESTROY_SESSION:
+		status = crypto_session_destroy(cryptodev,
+						ctrl->u.destroy_session.session_id);
+		break;
+	default:
+		dao_warn("[dev %u] opcode 0x%x is not supported", dev->dev_id,
+			 ctrl->header.opcode);
+		break;
+	}
+
+	if (status != VIRTIO_CRYPTO_OK)
+		dao_dbg("[dev %u] cq opcode 0x%x failed, status %u", dev->dev_id,
+			ctrl->header.opcode, status);
+
+	/* Reuse gathered tail of the command to DMA result to the host */
+	if (in_len == sizeof(*input)) {
+		input = (struct virtio_crypto_session_input *)(dst[0].addr + tot_len - in_len);
+		input->session_id = session_id;
+		input->status = status;
+	} else {
+		inhdr = (uint8_t *)(dst[0].addr + tot_len - in_len);
+		*inhdr = status;
+	}
+
+	rc = virtio_cryptodev_dma_sync(dev, mem2dev, dst[0].addr + tot_len - in_len,
+				       src[nb_desc - 1].addr, in_len);
+	if (rc < 0)
+		dao_err("[dev %u] DMA failed for cq status, rc=%d", dev->dev_id, rc);
+}
+
+static int
+virtio_cryptodev_status_cb(struct virtio_dev *dev, uint8_t status)
+{
+	struct virtio_cryptodev *cryptodev = virtio_dev_to_cryptodev(dev);
+	int rc = 0;
+
+	if (status & VIRTIO_DEV_DRIVER_OK) {
+		virtio_cryptodev_cb_interrupt_conf(cryptodev);
+	} else if (status == VIRTIO_DEV_RESET) {
+		if (crypto_user_cbs.status_cb)
+			rc = crypto_user_cbs.status_cb(dev->dev_id, status);
+
+		/* Application stopped polling the queues, wait for DMA and drain them */
+		dao_dma_compl_wait(dev->dma_vchan);
+		virtio_cryptodev_clear_queue_info(cryptodev);
+		virtio_cryptodev_sess_clear(cryptodev);
+		return rc;
+	}
+
+	if (crypto_user_cbs.status_cb)
+		rc = crypto_user_cbs.status_cb(dev->dev_id, status);
+	return rc;
+}
+
+static uint16_t
+virtio_cryptodev_cq_id_get(struct virtio_dev *dev, uint64_t feature_bits)
+{
+	RTE_SET_USED(feature_bits);
+
+	/* Control queue follows the data queues */
+	return dev->max_virtio_queues - 1;
+}
+
+static void
+virtio_cryptodev_caps_get(struct virtio_cryptodev *cryptodev, uint32_t *algo_l,
+			  uint32_t *max_key_len)
+{
+	const struct rte_cryptodev_symmetric_capability *cap;
+	struct rte_cryptodev_sym_capability_idx idx;
+	uint16_t i;
+
+	*algo_l = 0;
+	*max_key_len = 0;
+	for (i = 0; i < RTE_DIM(virtio_crypto_cipher_algos); i++) {
+		idx.type = RTE_CRYPTO_SYM_XFORM_CIPHER;
+		idx.algo.cipher = virtio_crypto_cipher_algos[i].algo;
+		cap = rte_cryptodev_sym_capability_get(cryptodev->cdev_id, &idx);
+		if (!cap)
+			continue;
+
+		*algo_l |= RTE_BIT32(virtio_crypto_cipher_algos[i].virtio_algo);
+		*max_key_len = RTE_MAX(*max_key_len, (uint32_t)cap->cipher.key_size.max);
+	}
+}
+
+void
+dao_virtio_cryptodev_cb_register(struct dao_virtio_cryptodev_cbs *cbs)
+{
+	crypto_user_cbs = *cbs;
+}
+
+void
+dao_virtio_cryptodev_cb_unregister(void)
+{
+	memset(&crypto_user_cbs, 0, sizeof(crypto_user_cbs));
+}
+
+static void
+virtio_cryptodev_mem_free(struct virtio_cryptodev *cryptodev)
+{
+	rte_mempool_free(cryptodev->op_mp);
+	rte_mempool_free(cryptodev->sess_mp);
+	rte_free(cryptodev->sess_tbl);
+	cryptodev->op_mp = NULL;
+	cryptodev->sess_mp = NULL;
+	cryptodev->sess_tbl = NULL;
+}
+
+int
+dao_virtio_cryptodev_init(uint16_t devid, struct dao_virtio_cryptodev_conf *conf)
+{
+	struct dao_virtio_cryptodev *virtio_cryptodev = &dao_virtio_cryptodevs[devid];
+	struct virtio_cryptodev *cryptodev = virtio_cryptodev_priv(virtio_cryptodev);
+	volatile struct virtio_crypto_config *dev_cfg;
+	struct virtio_dev *dev = &cryptodev->dev;
+	char name[RTE_MEMPOOL_NAMESIZE];
+	uint32_t algo_l, max_key_len;
+	uint16_t nb_qps;
+	int rc;
+
+	RTE_BUILD_BUG_ON(sizeof(struct virtio_cryptodev) > DAO_VIRTIO_CRYPTODEV_MEM_SZ);
+
+	if (!rte_cryptodev_is_valid_dev(conf->cdev_id) || !conf->pool) {
+		dao_err("[dev %u] Invalid cryptodev %u or mempool", devid, conf->cdev_id);
+		return -EINVAL;
+	}
+
+	/* Each data queue needs its own queue pair of configured cryptodev */
+	nb_qps = rte_cryptodev_queue_pair_count(conf->cdev_id);
+	if (conf->cdev_qp_base >= nb_qps) {
+		dao_err("[dev %u] Cryptodev %u has %u queue pairs, qp base %u", devid,
+			conf->cdev_id, nb_qps, conf->cdev_qp_base);
+		return -EINVAL;
+	}
+	nb_qps -= conf->cdev_qp_base;
+	if (conf->max_data_queues_limit)
+		nb_qps = RTE_MIN(nb_qps, conf->max_data_queues_limit);
+	nb_qps = RTE_MIN(nb_qps, DAO_VIRTIO_MAX_QUEUES - 1);
+	/* Virtio device needs at least two data queues besides control queue */
+	if (nb_qps < 2) {
+		dao_err("[dev %u] Need at least 2 cryptodev queue pairs from qp base %u", devid,
+			conf->cdev_qp_base);
+		return -EINVAL;
+	}
+
+	dev->dev_id = devid;
+	dev->dev_type = VIRTIO_DEV_TYPE_CRYPTO;
+	dev->pem_devid = conf->pem_devid;
+	dev->dma_vchan = conf->dma_vchan;
+	dev->max_virtio_queues_limit = nb_qps + 1;
+
+	cryptodev->cdev_id = conf->cdev_id;
+	cryptodev->cdev_qp_base = conf->cdev_qp_base;
+	cryptodev->pool = conf->pool;
+	cryptodev->max_sessions =
+		conf->max_sessions ? conf->max_sessions : DAO_VIRTIO_CRYPTODEV_SESSIONS_DFLT;
+
+	cryptodev->sess_tbl = rte_zmalloc(NULL, cryptodev->max_sessions *
+						sizeof(struct virtio_crypto_sess), 0);
+	if (!cryptodev->sess_tbl) {
+		dao_err("[dev %u] Failed to allocate memory for session table", devid);
+		return -ENOMEM;
+	}
+
+	snprintf(name, sizeof(name), "vcrypto_sess_%u", devid);
+	cryptodev->sess_mp = rte_cryptodev_sym_session_pool_create(
+		name, cryptodev->max_sessions,
+		rte_cryptodev_sym_get_private_session_size(conf->cdev_id), 0, 0, rte_socket_id());
+	if (!cryptodev->sess_mp) {
+		dao_err("[dev %u] Failed to create session pool, rte_errno=%d", devid, rte_errno);
+		rc = -ENOMEM;
+		goto free_mem;
+	}
+
+	snprintf(name, sizeof(name), "vcrypto_op_%u", devid);
+	cryptodev->op_mp = rte_crypto_op_pool_create(
+		name, RTE_CRYPTO_OP_TYPE_SYMMETRIC, nb_qps * VIRTIO_CRYPTO_OPS_PER_QUEUE,
+		VIRTIO_CRYPTO_BURST * 2, VIRTIO_CRYPTO_OP_PRIV_SZ, rte_socket_id());
+	if (!cryptodev->op_mp) {
+		dao_err("[dev %u] Failed to create crypto op pool, rte_errno=%d", devid, rte_errno);
+		rc = -ENOMEM;
+		goto free_mem;
+	}
+
+	/* Initialize base virtio device */
+	rc = virtio_dev_init(dev);
+	if (rc)
+		goto free_mem;
+
+	/* Setup crypto device config, advertise only what cryptodev can do */
+	virtio_cryptodev_caps_get(cryptodev, &algo_l, &max_key_len);
+	dev_cfg = (volatile struct virtio_crypto_config *)dev->dev_cfg;
+	dao_dev_memset(dev_cfg, 0, sizeof(*dev_cfg));
+	dev_cfg->status = VIRTIO_CRYPTO_S_HW_READY;
+	dev_cfg->max_dataqueues = dev->max_virtio_queues - 1;
+	dev_cfg->crypto_services = RTE_BIT32(VIRTIO_CRYPTO_SERVICE_CIPHER);
+	dev_cfg->cipher_algo_l = algo_l;
+	dev_cfg->max_cipher_key_len = max_key_len;
+	dev_cfg->max_size = rte_pktmbuf_data_room_size(conf->pool) - RTE_PKTMBUF_HEADROOM -
+			    VIRTIO_CRYPTO_REQ_HDR_SZ - VIRTIO_CRYPTO_IV_MAX;
+
+	/* One time setup */
+	dev_cbs[VIRTIO_DEV_TYPE_CRYPTO].dev_status = virtio_cryptodev_status_cb;
+	dev_cbs[VIRTIO_DEV_TYPE_CRYPTO].cq_cmd_process = virtio_cryptodev_cq_cmd_process;
+	dev_cbs[VIRTIO_DEV_TYPE_CRYPTO].cq_id_get = virtio_cryptodev_cq_id_get;
+	dev_cbs[VIRTIO_DEV_TYPE_CRYPTO].queue_enable = virtio_cryptodev_queue_enable;
+	dev_cbs[VIRTIO_DEV_TYPE_CRYPTO].feature_validate = virtio_cryptodev_feature_validate;
+	return 0;
+
+free_mem:
+	virtio_cryptodev_mem_free(cryptodev);
+	return rc;
+}
+
+int
+dao_virtio_cryptodev_fini(uint16_t devid)
+{
+	struct dao_virtio_cryptodev *virtio_cryptodev = &dao_virtio_cryptodevs[devid];
+	struct virtio_cryptodev *cryptodev = virtio_cryptodev_priv(virtio_cryptodev);
+	int rc;
+
+	rc = virtio_dev_fini(&cryptodev->dev);
+	virtio_cryptodev_mem_free(cryptodev);
+	return rc;
+}
+
+int
+dao_virtio_cryptodev_queue_count(uint16_t devid)
+{
+	struct dao_virtio_cryptodev *virtio_cryptodev = &dao_virtio_cryptodevs[devid];
+	struct virtio_cryptodev *cryptodev = virtio_cryptodev_priv(virtio_cryptodev);
+	struct virtio_dev *dev = &cryptodev->dev;
+
+	if (!dev->driver_ok)
+		return -EINVAL;
+
+	return dev->max_virtio_queues - 1;
+}
+
+int
+dao_virtio_cryptodev_stats_get(uint16_t devid, uint16_t qid,
+			       struct dao_virtio_cryptodev_queue_stats *stats)
+{
+	struct dao_virtio_cryptodev *virtio_cryptodev = &dao_virtio_cryptodevs[devid];
+	struct virtio_cryptodev *cryptodev = virtio_cryptodev_priv(virtio_cryptodev);
+	struct virtio_crypto_queue *q;
+
+	if (!virtio_crypto_has_stats_feature())
+		return -ENOTSUP;
+
+	if (qid >= DAO_VIRTIO_MAX_QUEUES - 1 || !stats)
+		return -EINVAL;
+
+	q = cryptodev->qs[qid];
+	if (!q)
+		return -ENOENT;
+
+	stats->enq_reqs = q->stats.enq_reqs - q->stats_base.enq_reqs;
+	stats->deq_reqs = q->stats.deq_reqs - q->stats_base.deq_reqs;
+	stats->err_reqs = q->stats.err_reqs - q->stats_base.err_reqs;
+	stats->inval_reqs = q->stats.inval_reqs - q->stats_base.inval_reqs;
+	stats->alloc_fails = q->stats.alloc_fails - q->stats_base.alloc_fails;
+	stats->dma_fails = q->stats.dma_fails - q->stats_base.dma_fails;
+	return 0;
+}
+
+int
+dao_virtio_cryptodev_stats_reset(uint16_t devid)
+{
+	struct dao_virtio_cryptodev *virtio_cryptodev = &dao_virtio_cryptodevs[devid];
+	struct virtio_cryptodev *cryptodev = virtio_cryptodev_priv(virtio_cryptodev);
+	struct virtio_crypto_queue *q;
+	uint32_t i;
+
+	if (!virtio_crypto_has_stats_feature())
+		return -ENOTSUP;
+
+	/* Counters are owned by data queue lcores, keep a snapshot instead of clearing */
+	for (i = 0; i < DAO_VIRTIO_MAX_QUEUES - 1; i++) {
+		q = cryptodev->qs[i];
+		if (q)
+			q->stats_base = q->stats;
+	}
+	return 0;
+}
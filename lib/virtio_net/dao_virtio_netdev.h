@@ -43,6 +43,12 @@ struct dao_virtio_netdev_conf {
 	uint16_t pem_devid;
 	/** Config flags */
 #define DAO_VIRTIO_NETDEV_EXTBUF DAO_BIT_ULL(0)
+/** Offer split virtqueue instead of packed virtqueue to driver */
+#define DAO_VIRTIO_NETDEV_SPLIT_RING DAO_BIT_ULL(1)
+/** Offer VIRTIO_F_RING_EVENT_IDX to driver */
+#define DAO_VIRTIO_NETDEV_EVENT_IDX DAO_BIT_ULL(2)
+/** Allocate external buffers from library extbuf pool instead of extbuf callbacks */
+#define DAO_VIRTIO_NETDEV_EXTBUF_POOL DAO_BIT_ULL(3)
 	uint16_t flags;
 	union {
 		struct {
@@ -51,7 +57,12 @@ struct dao_virtio_netdev_conf {
 		};
 		/** Valid when DOS_VIRTIO_NETDEV_EXTBUF is set in flags */
 		struct {
+			/** Buffer size excluding descriptor data, virtio net header included */
 			uint16_t dataroom_size;
+			/** Buffers in library extbuf pool, with DAO_VIRTIO_NETDEV_EXTBUF_POOL */
+			uint32_t nb_extbufs;
+			/** NUMA socket of library extbuf pool or SOCKET_ID_ANY */
+			int extbuf_socket_id;
 		};
 	};
 	/** Vchan to use for this virtio dev */
@@ -76,6 +87,131 @@ struct dao_virtio_netdev_conf {
 
 /* End of structure dao_virtio_netdev_conf. */
 
+/** Virtio net device Host Rx queue interrupt coalescing config */
+struct dao_virtio_netdev_intr_coalesce {
+	/** Used buffers to accumulate before interrupting host, zero or one disables */
+	uint16_t max_pkts;
+	/** Microseconds to hold interrupt since first used buffer, zero disables */
+	uint16_t usecs;
+	/** Tune max_pkts and usecs per queue based on packet rate */
+	bool adaptive;
+};
+
+/** Minimum descriptor fetch throttle window of a virt queue */
+#define DAO_VIRTIO_NETDEV_DESC_THROTTLE_MIN 16
+
+/** Virtio net device queue descriptor occupancy */
+struct dao_virtio_netdev_queue_occupancy {
+	/** Descriptors in shadow ring ready for worker */
+	uint16_t ready;
+	/** Descriptors being fetched from host */
+	uint16_t inflight;
+	/** Descriptor fetch throttle window, zero when not limited */
+	uint16_t window;
+};
+
+/** Virtio net device queue stats, maintained only with virtio_stats build option */
+struct dao_virtio_netdev_queue_stats {
+	/** Packets dequeued from or enqueued to host */
+	uint64_t pkts;
+	/** Bytes of packets dequeued from or enqueued to host, excluding virtio net header */
+	uint64_t bytes;
+	/** Packets dropped by the queue */
+	uint64_t drops;
+	/** Buffer allocation failures */
+	uint64_t alloc_fails;
+	/** Enqueue bursts cut short for lack of host descriptors */
+	uint64_t no_desc;
+	/** Multi segment packets */
+	uint64_t mseg_pkts;
+	/** Packets with checksum offload requested on dequeue or validated on enqueue */
+	uint64_t csum_pkts;
+	/** Packets with segmentation offload on dequeue or coalesced on enqueue */
+	uint64_t gso_pkts;
+	/** DMA flush failures, due to DMA ring being full or DMA enqueue errors */
+	uint64_t dma_fails;
+	/** Descriptors fetched from host */
+	uint64_t desc_fetched;
+	/** Descriptors marked used to host */
+	uint64_t desc_used;
+	/** Max descriptors marked used in one pass, how far used marking lags datapath */
+	uint64_t compl_lag_max;
+};
+
+/** Software RSS hash algorithms */
+enum dao_virtio_netdev_rss_algo {
+	/** No software hash, packets without NIC hash are unclassified */
+	DAO_VIRTIO_NETDEV_RSS_ALGO_NONE = 0,
+	/** Toeplitz hash with guest key */
+	DAO_VIRTIO_NETDEV_RSS_ALGO_TOEPLITZ,
+	/** Toeplitz hash with guest key over address and port sorted tuple */
+	DAO_VIRTIO_NETDEV_RSS_ALGO_SYMMETRIC_TOEPLITZ,
+	/** CRC32 hash seeded from guest key */
+	DAO_VIRTIO_NETDEV_RSS_ALGO_CRC32,
+};
+
+/** Capture all virt queues of a device */
+#define DAO_VIRTIO_NETDEV_CAPTURE_ALL_QUEUES UINT16_MAX
+/** Bytes of a packet captured when not configured */
+#define DAO_VIRTIO_NETDEV_CAPTURE_SNAPLEN_DFLT 256
+/** Max bytes of a packet captured */
+#define DAO_VIRTIO_NETDEV_CAPTURE_SNAPLEN_MAX 9600
+/** Capture ring size when not configured */
+#define DAO_VIRTIO_NETDEV_CAPTURE_RING_SZ_DFLT 1024
+
+/** Capture filter, called on worker and packet is captured when it returns true */
+typedef bool (*dao_virtio_netdev_capture_filter_t)(uint16_t devid, uint16_t qid,
+						   struct rte_mbuf *mbuf);
+
+/** Virtio net device packet capture config */
+struct dao_virtio_netdev_capture_conf {
+	/** File descriptor to write pcapng to, closed when capture stops */
+	int fd;
+	/** Virt queue to capture or DAO_VIRTIO_NETDEV_CAPTURE_ALL_QUEUES */
+	uint16_t qid;
+	/** Capture one in sample_rate packets passing filter, zero or one for all */
+	uint32_t sample_rate;
+	/** Bytes of a packet to capture, zero for DAO_VIRTIO_NETDEV_CAPTURE_SNAPLEN_DFLT */
+	uint32_t snaplen;
+	/** Capture ring size, power of two, zero for DAO_VIRTIO_NETDEV_CAPTURE_RING_SZ_DFLT */
+	uint32_t ring_size;
+	/** Optional capture filter */
+	dao_virtio_netdev_capture_filter_t filter;
+};
+
+/* End of structure dao_virtio_netdev_capture_conf. */
+
+/** Packets a queue of weight one serves per burst call */
+#define DAO_VIRTIO_NETDEV_SHAPER_QUANTUM 32
+
+/** Virtio net device or virt queue shaper config */
+struct dao_virtio_netdev_shaper_conf {
+	/** Packets per second, zero for no packet rate limit */
+	uint64_t pps;
+	/** Bytes per second, zero for no byte rate limit */
+	uint64_t bps;
+	/** Packet bucket depth, zero for packets of one millisecond at pps */
+	uint32_t burst_pkts;
+	/** Byte bucket depth, zero for bytes of one millisecond at bps */
+	uint32_t burst_bytes;
+	/**
+	 * Queue weight, a queue serves at most weight * DAO_VIRTIO_NETDEV_SHAPER_QUANTUM
+	 * packets per burst call. Zero for no limit. Not used for device shaper.
+	 */
+	uint16_t weight;
+};
+
+/* End of structure dao_virtio_netdev_shaper_conf. */
+
+/** Size of virtio net device xstat name */
+#define DAO_VIRTIO_NETDEV_XSTAT_NAMESIZE 64
+
+/** Virtio net device xstat name */
+struct dao_virtio_netdev_xstat_name {
+	/** Name of the xstat */
+	char name[DAO_VIRTIO_NETDEV_XSTAT_NAMESIZE];
+};
+
 /** Virtio net device data */
 struct dao_virtio_netdev {
 	/** Array of virtio queue pointers */
@@ -86,6 +222,8 @@ struct dao_virtio_netdev {
 	uint16_t enq_fn_id;
 	/** Descriptors management function id */
 	uint16_t mgmt_fn_id;
+	/** Library extbuf pool, valid with DAO_VIRTIO_NETDEV_EXTBUF_POOL */
+	struct rte_mempool *extbuf_pool;
 	/** Table to find hash report based on packet type */
 #define DAO_VIRTIO_NETDEV_MEM_SZ 8192
 	uint8_t reserved[DAO_VIRTIO_NETDEV_MEM_SZ];
@@ -108,7 +246,7 @@ typedef uint16_t (*dao_virtio_net_deq_fn_t)(void *q, struct rte_mbuf **mbufs, ui
 /** Enqueue function */
 typedef uint16_t (*dao_virtio_net_enq_fn_t)(void *q, struct rte_mbuf **mbufs, uint16_t nb_mbufs);
 /** Management function */
-typedef int (*dao_net_desc_manage_fn_t)(uint16_t devid, uint16_t qp_count);
+typedef int (*dao_net_desc_manage_fn_t)(uint16_t devid, uint16_t qp_start, uint16_t nb_qps);
 
 /** Array of dequeue functions */
 extern dao_virtio_net_deq_fn_t dao_virtio_net_deq_fns[];
@@ -141,6 +279,8 @@ typedef int (*dao_virtio_netdev_mac_add_cb_t)(uint16_t devid, struct virtio_net_
 					      uint8_t type);
 /** Multi queue configure callback */
 typedef int (*dao_virtio_netdev_mq_cfg_t)(uint16_t devid, bool qmap_set);
+/** Queue pair state callback, called for each queue pair guest enables or disables */
+typedef int (*dao_virtio_netdev_qp_state_cb_t)(uint16_t devid, uint16_t qp, bool enable);
 /** VLAN filter add callback */
 typedef int (*dao_virtio_netdev_vlan_t)(uint16_t devid, uint16_t vlan_tci);
 typedef int (*dao_virtio_netdev_extbuf_get)(uint16_t devid, void *buffs[], uint16_t nb_buffs);
@@ -166,10 +306,16 @@ struct dao_virtio_netdev_cbs {
 	dao_virtio_netdev_vlan_t vlan_add;
 	/** VLAN filter del callback */
 	dao_virtio_netdev_vlan_t vlan_del;
-	/** Alloc extbuf */
+	/** Alloc extbuf, not used with DAO_VIRTIO_NETDEV_EXTBUF_POOL */
 	dao_virtio_netdev_extbuf_get extbuf_get;
-	/** Free extbuf */
+	/** Free extbuf, not used with DAO_VIRTIO_NETDEV_EXTBUF_POOL */
 	dao_virtio_netdev_extbuf_put extbuf_put;
+	/**
+	 * Queue pair state callback. When set, change of queue pair count by guest is
+	 * notified only for pairs added or removed, in place of mq_configure and of the
+	 * queue map clear through rss_cb.
+	 */
+	dao_virtio_netdev_qp_state_cb_t qp_state_cb;
 };
 
 /* End of structure dao_virtio_netdev_cbs. */
@@ -256,6 +402,137 @@ int dao_virtio_netdev_queue_count_max(uint16_t pem_devid, uint16_t devid);
  */
 int dao_virtio_netdev_link_sts_update(uint16_t devid, struct dao_virtio_netdev_link_info *info);
 
+/**
+ * Set interrupt coalescing of Host Rx queues.
+ *
+ * Interrupt to host for used buffers is held till either max_pkts buffers are used or
+ * usecs have elapsed since the first of them. Config applies to all Host Rx queues of
+ * the device including the ones enabled later.
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @param conf
+ *    Interrupt coalescing config.
+ * @return
+ *    Zero on success. Negative on failure.
+ */
+int dao_virtio_netdev_intr_coalesce_set(uint16_t devid,
+					struct dao_virtio_netdev_intr_coalesce *conf);
+
+/**
+ * Throttle descriptor fetch of all virt queues.
+ *
+ * Descriptor management keeps at most window descriptors fetched ahead of worker per
+ * queue, and fetches the next batch once worker has consumed half of them so that one
+ * half is in flight while the other is being consumed. This only holds back fetch, no
+ * descriptor is fetched earlier than without throttle. Window applies to all queues of
+ * the device including the ones enabled later.
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @param window
+ *    Number of descriptors, zero to fetch all available descriptors or at least
+ *    DAO_VIRTIO_NETDEV_DESC_THROTTLE_MIN.
+ * @return
+ *    Zero on success, -EINVAL on invalid device or window, -ENODEV if device is not
+ *    initialized.
+ */
+int dao_virtio_netdev_desc_fetch_throttle_set(uint16_t devid, uint16_t window);
+
+/**
+ * Set software RSS hash algorithm.
+ *
+ * Packets enqueued to host without RTE_MBUF_F_RX_RSS_HASH are hashed in software over
+ * the tuple selected by guest hash types, so that hash report negotiated by guest is
+ * given for all packets. With software RSS enabled, guest RSS config is accepted even
+ * without an RSS callback.
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @param algo
+ *    Hash algorithm, DAO_VIRTIO_NETDEV_RSS_ALGO_NONE to disable.
+ * @return
+ *    Zero on success, -EINVAL on invalid device or algorithm, -ENODEV if device is not
+ *    initialized.
+ */
+int dao_virtio_netdev_rss_algo_set(uint16_t devid, enum dao_virtio_netdev_rss_algo algo);
+
+/**
+ * Get descriptor occupancy of a virt queue.
+ *
+ * Expected to be called from worker core polling the queue.
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @param qid
+ *    Virt queue ID.
+ * @param occ
+ *    Pointer to store occupancy.
+ * @return
+ *    Zero on success. Negative on failure.
+ */
+int dao_virtio_netdev_queue_occupancy_get(uint16_t devid, uint16_t qid,
+					  struct dao_virtio_netdev_queue_occupancy *occ);
+
+/**
+ * Get stats of a virtio net device queue.
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @param qid
+ *    Virtio queue ID, even for Host Rx queue and odd for Host Tx queue.
+ * @param stats
+ *    Address to store stats.
+ * @return
+ *    Zero on success. Negative on failure.
+ */
+int dao_virtio_netdev_stats_get(uint16_t devid, uint16_t qid,
+				struct dao_virtio_netdev_queue_stats *stats);
+
+/**
+ * Reset stats of all queues of a virtio net device.
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @return
+ *    Zero on success. Negative on failure.
+ */
+int dao_virtio_netdev_stats_reset(uint16_t devid);
+
+/**
+ * Get names of extended stats of a virtio net device.
+ *
+ * Each active queue has a set of extended stats named host_rx_q<N>_<stat> for Host Rx queues
+ * and host_tx_q<N>_<stat> for Host Tx queues, N being the queue pair index.
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @param names
+ *    Array to store names, can be NULL to get number of extended stats.
+ * @param size
+ *    Size of names array.
+ * @return
+ *    Number of extended stats on success, more than size when names array is too small.
+ *    Negative on failure.
+ */
+int dao_virtio_netdev_xstats_names_get(uint16_t devid, struct dao_virtio_netdev_xstat_name *names,
+				       unsigned int size);
+
+/**
+ * Get values of extended stats of a virtio net device.
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @param values
+ *    Array to store values in the order of dao_virtio_netdev_xstats_names_get().
+ * @param size
+ *    Size of values array.
+ * @return
+ *    Number of extended stats on success, more than size when values array is too small.
+ *    Negative on failure.
+ */
+int dao_virtio_netdev_xstats_get(uint16_t devid, uint64_t *values, unsigned int size);
+
 /**
  * Get virtio net device header length.
  *
@@ -266,8 +543,179 @@ int dao_virtio_netdev_link_sts_update(uint16_t devid, struct dao_virtio_netdev_l
  */
 uint8_t dao_virtio_netdev_hdrlen_get(uint16_t devid);
 
+/**
+ * Quiesce descriptor management of a range of queue pairs.
+ *
+ * To be called from the service core currently managing the queue pairs, in place of
+ * dao_virtio_net_desc_manage_qps(), before handing them over to another service core.
+ * Descriptor DMA in flight on this core's DMA vchans is flushed and tracked to
+ * completion so that the next service core starts from a consistent shadow state.
+ * Caller is expected to keep submitting DMA with dao_dma_flush_submit() while retrying.
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @param qp_start
+ *    First queue pair of the range.
+ * @param nb_qps
+ *    Number of queue pairs in the range.
+ * @return
+ *    Zero when queue pairs are quiesced, -EAGAIN when DMA is still in flight.
+ */
+int dao_virtio_net_desc_manage_quiesce(uint16_t devid, uint16_t qp_start, uint16_t nb_qps);
+
+/**
+ * Start packet capture on virt queues of a virtio net device.
+ *
+ * Packets dequeued from host are captured with their virtio net header, packets enqueued
+ * to host are captured before the library builds their header, with mbuf offload flags
+ * and hash instead. Worker copies a captured packet to a pcapng block on a ring which is
+ * written to file by dao_virtio_netdev_capture_drain().
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @param conf
+ *    Capture config.
+ * @return
+ *    Zero on success. Negative on failure.
+ */
+int dao_virtio_netdev_capture_start(uint16_t devid, struct dao_virtio_netdev_capture_conf *conf);
+
+/**
+ * Write captured packets of a virtio net device to pcapng file.
+ *
+ * To be called periodically from a control thread while capture is running.
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @return
+ *    Number of packets written on success. Negative on failure.
+ */
+int dao_virtio_netdev_capture_drain(uint16_t devid);
+
+/**
+ * Stop packet capture of a virtio net device.
+ *
+ * Waits for workers to leave capture, writes remaining packets and closes the file.
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @return
+ *    Zero on success. Negative on failure.
+ */
+int dao_virtio_netdev_capture_stop(uint16_t devid);
+
+/**
+ * Set rate limits of host Rx or host Tx direction of a virtio net device.
+ *
+ * Packet and byte token buckets are refilled from TSC and shared by all queues of the
+ * direction. A burst is served while buckets have tokens and is charged after, so a
+ * bucket runs into deficit by at most a burst. Packets over limit are left in the
+ * virt queue on dequeue and not accepted on enqueue. Can be called at runtime.
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @param host_tx
+ *    True for host Tx queues i.e dequeue, false for host Rx queues i.e enqueue.
+ * @param conf
+ *    Shaper config, NULL to remove limits.
+ * @return
+ *    Zero on success. Negative on failure.
+ */
+int dao_virtio_netdev_shaper_set(uint16_t devid, bool host_tx,
+				 struct dao_virtio_netdev_shaper_conf *conf);
+
+/**
+ * Set rate limits and weight of a virt queue.
+ *
+ * Queue buckets are checked along with device buckets of the queue direction. Queues
+ * polled in turn by an lcore are served in proportion to their weight. Config applies
+ * to the queue even when it is set up later and can be changed at runtime.
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @param qid
+ *    Virt queue ID.
+ * @param conf
+ *    Shaper config, NULL to remove limits and weight.
+ * @return
+ *    Zero on success. Negative on failure.
+ */
+int dao_virtio_netdev_queue_shaper_set(uint16_t devid, uint16_t qid,
+				       struct dao_virtio_netdev_shaper_conf *conf);
+
 /* Fast path routines */
 
+/**
+ * Allocate buffers from library extbuf pool of a virtio net device.
+ *
+ * Buffers come from the calling lcore's pool cache, which is refilled in bulk from
+ * the common pool. Each buffer starts with struct dao_virtio_net_hdr and has
+ * dataroom_size bytes from its virtio net header onwards.
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @param buffs
+ *    Array to store buffer pointers.
+ * @param nb_buffs
+ *    Number of buffers to allocate.
+ * @return
+ *    Zero on success, all or none of the buffers are allocated. Negative on failure.
+ */
+static __rte_always_inline int
+dao_virtio_netdev_extbuf_alloc(uint16_t devid, void *buffs[], uint16_t nb_buffs)
+{
+	struct dao_virtio_netdev *netdev = &dao_virtio_netdevs[devid];
+
+	return rte_mempool_get_bulk(netdev->extbuf_pool, buffs, nb_buffs);
+}
+
+/**
+ * Free buffers to library extbuf pool of a virtio net device.
+ *
+ * Buffers go to the calling lcore's pool cache, which is flushed in bulk to the
+ * common pool once above its size.
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @param buffs
+ *    Array of buffer pointers, allocated from the same pool.
+ * @param nb_buffs
+ *    Number of buffers to free.
+ */
+static __rte_always_inline void
+dao_virtio_netdev_extbuf_free(uint16_t devid, void *buffs[], uint16_t nb_buffs)
+{
+	struct dao_virtio_netdev *netdev = &dao_virtio_netdevs[devid];
+
+	rte_mempool_put_bulk(netdev->extbuf_pool, buffs, nb_buffs);
+}
+
+/**
+ * Fetch virtio netdev descriptors and acknowledge completions of a range of queue pairs.
+ *
+ * Queue pairs of a device can be split across service cores with each core managing a
+ * disjoint range. Descriptor DMA is issued on the calling core's DMA vchans so that
+ * completions are always processed by the core owning the range.
+ *
+ * @param devid
+ *    Virtio net device ID.
+ * @param qp_start
+ *    First queue pair to manage.
+ * @param nb_qps
+ *    Number of queue pairs to manage.
+ * @return
+ *    Zero on success.
+ */
+static __rte_always_inline int
+dao_virtio_net_desc_manage_qps(uint16_t devid, uint16_t qp_start, uint16_t nb_qps)
+{
+	struct dao_virtio_netdev *netdev = &dao_virtio_netdevs[devid];
+	dao_net_desc_manage_fn_t mgmt_fn;
+	mgmt_fn = dao_net_desc_manage_fns[netdev->mgmt_fn_id];
+
+	return (*mgmt_fn)(devid, qp_start, nb_qps);
+}
+
 /**
  * Fetch virtio netdev descriptors and acknowledge completions.
  *
@@ -284,11 +732,7 @@ uint8_t dao_virtio_netdev_hdrlen_get(uint16_t devid);
 static __rte_always_inline int
 dao_virtio_net_desc_manage(uint16_t devid, uint16_t qp_count)
 {
-	struct dao_virtio_netdev *netdev = &dao_virtio_netdevs[devid];
-	dao_net_desc_manage_fn_t mgmt_fn;
-	mgmt_fn = dao_net_desc_manage_fns[netdev->mgmt_fn_id];
-
-	return (*mgmt_fn)(devid, qp_count);
+	return dao_virtio_net_desc_manage_qps(devid, 0, qp_count);
 }
 
 /**
@@ -333,7 +777,8 @@ dao_virtio_net_dequeue_burst(uint16_t devid, uint16_t qid,
  * @param nb_mbufs
  *    Number of pkts to send.
  * @return
- *    Number of mbufs sent to host.
+ *    Number of mbufs sent to host. mbufs coalesced to a preceding packet of the
+ *    burst are counted as sent.
  */
 static __rte_always_inline uint16_t
 dao_virtio_net_enqueue_burst(uint16_t devid, uint16_t qid,
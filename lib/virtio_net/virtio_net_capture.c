@@ -0,0 +1,310 @@
+/* SPDX-License-Identifier: Marvell-Proprietary
+ * Copyright (c) 2024 Marvell.
+ */
+
+#include <rte_errno.h>
+#include <rte_malloc.h>
+#include <rte_pcapng.h>
+#include <rte_ring.h>
+
+#include <dao_version.h>
+
+#include "dao_virtio_netdev.h"
+#include "spec/virtio_net.h"
+#include "virtio_dev_priv.h"
+#include "virtio_net_priv.h"
+
+/* Capture file has a single interface, on a port id unlikely to be an ethdev */
+#define VIRTIO_NET_CAPTURE_PORT (RTE_MAX_ETHPORTS - 1)
+
+#define VIRTIO_NET_CAPTURE_COMMENT_SZ 160
+
+/* Capture pool cache, capped by ring size */
+#define VIRTIO_NET_CAPTURE_CACHE_SZ 64
+
+static __rte_always_inline void
+virtio_net_capture_enqueue(struct virtio_net_capture *cap, struct rte_mbuf **pkts, uint16_t nb)
+{
+	uint16_t sent;
+
+	sent = rte_ring_enqueue_burst(cap->ring, (void **)pkts, nb, NULL);
+	if (unlikely(sent < nb)) {
+		rte_pktmbuf_free_bulk(&pkts[sent], nb - sent);
+		__atomic_fetch_add(&cap->drops, nb - sent, __ATOMIC_RELAXED);
+	}
+}
+
+/* Copy a packet passing filter and sampling to capture pool */
+static struct rte_mbuf *
+virtio_net_capture_copy(struct virtio_net_queue *q, struct virtio_net_capture *cap,
+			struct rte_mbuf *m, bool host_tx)
+{
+	char comment[VIRTIO_NET_CAPTURE_COMMENT_SZ];
+	enum rte_pcapng_direction dir;
+	struct virtio_net_hdr *hdr;
+	struct rte_mbuf *pkt;
+
+	if (cap->filter && !cap->filter(q->netdev_id, q->qid, m))
+		return NULL;
+	if (cap->sample_rate > 1 && ++q->cap_cnt < cap->sample_rate)
+		return NULL;
+	q->cap_cnt = 0;
+
+	dir = host_tx ? RTE_PCAPNG_DIRECTION_IN : RTE_PCAPNG_DIRECTION_OUT;
+	if (host_tx) {
+		/* Header of a dequeued packet is left in headroom ahead of data */
+		hdr = rte_pktmbuf_mtod_offset(m, struct virtio_net_hdr *, -q->virtio_hdr_sz);
+		snprintf(comment, sizeof(comment),
+			 "vnet_hdr flags 0x%x gso_type 0x%x hdr_len %u gso_size %u "
+			 "csum_start %u csum_offset %u num_buffers %u",
+			 hdr->flags, hdr->gso_type, hdr->hdr_len, hdr->gso_size, hdr->csum_start,
+			 hdr->csum_offset, hdr->num_buffers);
+	} else {
+		snprintf(comment, sizeof(comment),
+			 "ol_flags 0x%" PRIx64 " packet_type 0x%x hash 0x%x", m->ol_flags,
+			 m->packet_type, m->hash.rss);
+	}
+
+	pkt = rte_pcapng_copy(VIRTIO_NET_CAPTURE_PORT, q->qid, m, cap->mp, cap->snaplen, dir,
+			      comment);
+	if (unlikely(!pkt))
+		__atomic_fetch_add(&cap->drops, 1, __ATOMIC_RELAXED);
+	return pkt;
+}
+
+void
+virtio_net_capture_stage(struct virtio_net_queue *q, struct rte_mbuf **mbufs, uint16_t nb_mbufs,
+			 bool host_tx, struct virtio_net_capture_stage *st)
+{
+	struct virtio_net_capture *cap = q->cap;
+	struct rte_mbuf *pkt;
+	uint16_t i;
+
+	st->cap = cap;
+	st->nb = 0;
+
+	/* Pairs with stop clearing enabled before waiting for busy to drop */
+	__atomic_fetch_add(&cap->busy, 1, __ATOMIC_SEQ_CST);
+	if (unlikely(!__atomic_load_n(&cap->enabled, __ATOMIC_SEQ_CST)))
+		return;
+
+	nb_mbufs = RTE_MIN(nb_mbufs, VIRTIO_NET_CAPTURE_BURST);
+	for (i = 0; i < nb_mbufs; i++) {
+		pkt = virtio_net_capture_copy(q, cap, mbufs[i], host_tx);
+		if (!pkt)
+			continue;
+		st->pkts[st->nb] = pkt;
+		st->idx[st->nb++] = i;
+	}
+}
+
+void
+virtio_net_capture_commit(struct virtio_net_capture_stage *st, uint16_t nb_sent)
+{
+	struct virtio_net_capture *cap = st->cap;
+	uint16_t nb = 0;
+
+	/* Copies are in packet order, keep those of packets sent */
+	while (nb < st->nb && st->idx[nb] < nb_sent)
+		nb++;
+	if (nb)
+		virtio_net_capture_enqueue(cap, st->pkts, nb);
+	if (nb < st->nb)
+		rte_pktmbuf_free_bulk(&st->pkts[nb], st->nb - nb);
+
+	__atomic_fetch_sub(&cap->busy, 1, __ATOMIC_RELEASE);
+}
+
+void
+virtio_net_capture(struct virtio_net_queue *q, struct rte_mbuf **mbufs, uint16_t nb_mbufs,
+		   bool host_tx)
+{
+	struct virtio_net_capture_stage st;
+	uint16_t i, nb;
+
+	for (i = 0; i < nb_mbufs; i += nb) {
+		nb = RTE_MIN(nb_mbufs - i, VIRTIO_NET_CAPTURE_BURST);
+		virtio_net_capture_stage(q, mbufs + i, nb, host_tx, &st);
+		virtio_net_capture_commit(&st, nb);
+	}
+}
+
+static void
+virtio_net_capture_attach(struct virtio_netdev *netdev, struct virtio_net_capture *cap)
+{
+	uint32_t i;
+
+	for (i = 0; i < DAO_VIRTIO_MAX_QUEUES; i++) {
+		if (!netdev->qs[i])
+			continue;
+		if (cap && cap->qid != DAO_VIRTIO_NETDEV_CAPTURE_ALL_QUEUES && cap->qid != i)
+			continue;
+		__atomic_store_n(&netdev->qs[i]->cap, cap, __ATOMIC_RELEASE);
+	}
+}
+
+void
+virtio_net_capture_queue_setup(struct virtio_netdev *netdev, struct virtio_net_queue *q)
+{
+	struct virtio_net_capture *cap = &netdev->cap;
+
+	if (!cap->enabled)
+		return;
+	if (cap->qid == DAO_VIRTIO_NETDEV_CAPTURE_ALL_QUEUES || cap->qid == q->qid)
+		q->cap = cap;
+}
+
+int
+dao_virtio_netdev_capture_start(uint16_t devid, struct dao_virtio_netdev_capture_conf *conf)
+{
+	char name[RTE_MEMPOOL_NAMESIZE], ifname[32], appname[64];
+	struct virtio_net_capture *cap;
+	struct virtio_netdev *netdev;
+	uint32_t ring_size, snaplen;
+	int rc;
+
+	if (devid >= DAO_VIRTIO_DEV_MAX || !conf || conf->fd < 0)
+		return -EINVAL;
+
+	netdev = virtio_netdev_priv(&dao_virtio_netdevs[devid]);
+	cap = &netdev->cap;
+	if (cap->enabled)
+		return -EBUSY;
+
+	snaplen = conf->snaplen ? conf->snaplen : DAO_VIRTIO_NETDEV_CAPTURE_SNAPLEN_DFLT;
+	ring_size = conf->ring_size ? conf->ring_size : DAO_VIRTIO_NETDEV_CAPTURE_RING_SZ_DFLT;
+	if (snaplen > DAO_VIRTIO_NETDEV_CAPTURE_SNAPLEN_MAX || !rte_is_power_of_2(ring_size)) {
+		dao_err("[dev %u] Invalid capture snaplen %u or ring size %u", devid, snaplen,
+			ring_size);
+		return -EINVAL;
+	}
+
+	snprintf(name, sizeof(name), "virtio_net_cap_%u", devid);
+	cap->ring = rte_ring_create(name, ring_size, SOCKET_ID_ANY, RING_F_SC_DEQ);
+	if (!cap->ring) {
+		dao_err("[dev %u] Failed to create capture ring, rte_errno=%d", devid, rte_errno);
+		return -rte_errno;
+	}
+
+	/* Enough blocks to fill the ring while workers hold some in their caches */
+	cap->mp = rte_pktmbuf_pool_create(name, ring_size * 2,
+					  RTE_MIN(ring_size, VIRTIO_NET_CAPTURE_CACHE_SZ), 0,
+					  rte_pcapng_mbuf_size(snaplen), SOCKET_ID_ANY);
+	if (!cap->mp) {
+		dao_err("[dev %u] Failed to create capture pool, rte_errno=%d", devid, rte_errno);
+		rc = -rte_errno;
+		goto ring_free;
+	}
+
+	snprintf(appname, sizeof(appname), "DAO %s", dao_version());
+	cap->pcapng = rte_pcapng_fdopen(conf->fd, NULL, NULL, appname, NULL);
+	if (!cap->pcapng) {
+		dao_err("[dev %u] Failed to open pcapng, rte_errno=%d", devid, rte_errno);
+		rc = -rte_errno;
+		goto pool_free;
+	}
+
+	snprintf(ifname, sizeof(ifname), "virtio_net%u", devid);
+	rc = rte_pcapng_add_interface(cap->pcapng, VIRTIO_NET_CAPTURE_PORT, ifname, NULL, NULL);
+	if (rc < 0) {
+		dao_err("[dev %u] Failed to add pcapng interface, rc=%d", devid, rc);
+		goto pcapng_close;
+	}
+
+	cap->filter = conf->filter;
+	cap->sample_rate = conf->sample_rate;
+	cap->snaplen = snaplen;
+	cap->qid = conf->qid;
+	cap->drops = 0;
+	__atomic_store_n(&cap->enabled, 1, __ATOMIC_SEQ_CST);
+	virtio_net_capture_attach(netdev, cap);
+
+	dao_dbg("[dev %u] Capture started on queue %u", devid, conf->qid);
+	return 0;
+
+pcapng_close:
+	rte_pcapng_close(cap->pcapng);
+pool_free:
+	rte_mempool_free(cap->mp);
+ring_free:
+	rte_ring_free(cap->ring);
+	cap->pcapng = NULL;
+	cap->mp = NULL;
+	cap->ring = NULL;
+	return rc;
+}
+
+static int
+virtio_net_capture_write(uint16_t devid, struct virtio_net_capture *cap)
+{
+	struct rte_mbuf *pkts[VIRTIO_NET_CAPTURE_BURST];
+	unsigned int nb;
+	int total = 0;
+
+	do {
+		nb = rte_ring_sc_dequeue_burst(cap->ring, (void **)pkts, VIRTIO_NET_CAPTURE_BURST,
+					       NULL);
+		if (!nb)
+			break;
+
+		if (rte_pcapng_write_packets(cap->pcapng, pkts, nb) < 0) {
+			dao_err("[dev %u] Failed to write captured packets, errno=%d", devid,
+				errno);
+			rte_pktmbuf_free_bulk(pkts, nb);
+			return -errno;
+		}
+		rte_pktmbuf_free_bulk(pkts, nb);
+		total += nb;
+	} while (nb == VIRTIO_NET_CAPTURE_BURST);
+
+	return total;
+}
+
+int
+dao_virtio_netdev_capture_drain(uint16_t devid)
+{
+	struct virtio_net_capture *cap;
+
+	if (devid >= DAO_VIRTIO_DEV_MAX)
+		return -EINVAL;
+
+	cap = &virtio_netdev_priv(&dao_virtio_netdevs[devid])->cap;
+	if (!cap->enabled)
+		return -ENOENT;
+
+	return virtio_net_capture_write(devid, cap);
+}
+
+int
+dao_virtio_netdev_capture_stop(uint16_t devid)
+{
+	struct virtio_net_capture *cap;
+	struct virtio_netdev *netdev;
+	int rc;
+
+	if (devid >= DAO_VIRTIO_DEV_MAX)
+		return -EINVAL;
+
+	netdev = virtio_netdev_priv(&dao_virtio_netdevs[devid]);
+	cap = &netdev->cap;
+	if (!cap->enabled)
+		return -ENOENT;
+
+	/* Detach queues and wait for workers already in capture to leave */
+	__atomic_store_n(&cap->enabled, 0, __ATOMIC_SEQ_CST);
+	virtio_net_capture_attach(netdev, NULL);
+	while (__atomic_load_n(&cap->busy, __ATOMIC_SEQ_CST))
+		rte_pause();
+
+	rc = virtio_net_capture_write(devid, cap);
+	dao_dbg("[dev %u] Capture stopped, %" PRIu64 " packets dropped", devid,
+		__atomic_load_n(&cap->drops, __ATOMIC_RELAXED));
+
+	rte_pcapng_close(cap->pcapng);
+	rte_ring_free(cap->ring);
+	rte_mempool_free(cap->mp);
+	cap->pcapng = NULL;
+	cap->ring = NULL;
+	cap->mp = NULL;
+	return rc < 0 ? rc : 0;
+}
@@ -2,9 +2,13 @@
  * Copyright (c) 2024 Marvell.
  */
 
+#include <rte_ether.h>
 #include <rte_ip.h>
+#include <rte_udp.h>
 #include <rte_vect.h>
 
+#include <dao_vect.h>
+
 #include "dao_virtio_netdev.h"
 #include "virtio_dev_priv.h"
 
@@ -30,6 +34,13 @@ dao_virtio_net_deq_fn_t dao_virtio_net_deq_fns[VIRTIO_NET_DEQ_OFFLOAD_LAST << 1]
 	(RTE_MBUF_F_TX_IP_CKSUM | RTE_MBUF_F_TX_IPV6 | RTE_MBUF_F_TX_TCP_CKSUM |                   \
 	 RTE_MBUF_F_TX_TCP_SEG)
 
+#define TX_IPV4_UDP_GSO_OFFLOAD                                                                    \
+	(RTE_MBUF_F_TX_IP_CKSUM | RTE_MBUF_F_TX_IPV4 | RTE_MBUF_F_TX_UDP_CKSUM |                   \
+	 RTE_MBUF_F_TX_UDP_SEG)
+
+#define TX_IPV6_UDP_GSO_OFFLOAD                                                                    \
+	(RTE_MBUF_F_TX_IPV6 | RTE_MBUF_F_TX_UDP_CKSUM | RTE_MBUF_F_TX_UDP_SEG)
+
 void
 virtio_net_flush_deq(struct virtio_net_queue *q)
 {
@@ -62,6 +73,35 @@ virtio_net_flush_deq(struct virtio_net_queue *q)
 		rte_pktmbuf_free_bulk(&q->mbuf_arr[DESC_OFF(last_off)], nb_avail);
 }
 
+/* Get UDP GSO offload flags, L3 type is not part of virtio header so find it from ethertype
+ * past VLAN or QinQ tags. Tags are walked only within L2 and L3 headers ending at csum_start.
+ */
+static __rte_always_inline uint64_t
+virtio_net_uso_ol_flags(struct virtio_net_hdr *hdr, const uint16_t vhdr_sz, uint16_t *l3_len)
+{
+	uint8_t *l2 = (uint8_t *)((uintptr_t)hdr + vhdr_sz);
+	uint16_t off = offsetof(struct rte_ether_hdr, ether_type);
+	uint16_t ether_type;
+	int i;
+
+	ether_type = *(unaligned_uint16_t *)(l2 + off);
+	for (i = 0; i < 2; i++) {
+		if (ether_type != rte_cpu_to_be_16(RTE_ETHER_TYPE_VLAN) &&
+		    ether_type != rte_cpu_to_be_16(RTE_ETHER_TYPE_QINQ))
+			break;
+		off += sizeof(struct rte_vlan_hdr);
+		if (unlikely(off + sizeof(ether_type) > hdr->csum_start))
+			break;
+		ether_type = *(unaligned_uint16_t *)(l2 + off);
+	}
+
+	if (ether_type == rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV6)) {
+		*l3_len = sizeof(struct rte_ipv6_hdr);
+		return TX_IPV6_UDP_GSO_OFFLOAD;
+	}
+	return TX_IPV4_UDP_GSO_OFFLOAD;
+}
+
 static __rte_always_inline uint16_t
 post_process_pkts(struct virtio_net_queue *q, struct rte_mbuf **d_mbufs, uint16_t *nb_mbufs,
 		  const uint16_t flags)
@@ -81,9 +121,15 @@ post_process_pkts(struct virtio_net_queue *q, struct rte_mbuf **d_mbufs, uint16_
 	uint64x2_t flags01, flags23;
 	uint32x4_t d0, d1, len_mask;
 	struct virtio_net_hdr *hdr;
-	uint64_t ol_flags, dflags;
+	uint64_t ol_flags, dflags, drop;
 	int count, i, num = 0;
 	uint16_t l3_len = 0;
+	/* Descriptor flags are at bit 48 for packed and bit 32 for split */
+	const uint8_t shift = (flags & VIRTIO_NET_DEQ_OFFLOAD_SPLIT) ? 32 : 48;
+	const uint64_t drop_msk = (uint64_t)VIRTIO_NET_DESC_F_DROP << shift;
+	/* VRING_DESC_F_NEXT and VIRTIO_NET_DESC_F_DROP per 32-bit lane */
+	const uint64_t next_msk = (flags & VIRTIO_NET_DEQ_OFFLOAD_SPLIT) ? 0x0000000900000009 :
+									   0x0009000000090000;
 
 	doff = vdupq_n_u64(data_off);
 	mbuf_arr = q->mbuf_arr;
@@ -107,12 +153,12 @@ post_process_pkts(struct virtio_net_queue *q, struct rte_mbuf **d_mbufs, uint16_
 
 		flags01 = vtrn2q_u32(flags01, flags23);
 		const uint64x2_t xflags = {
-			0x0001000000010000,
-			0x0001000000010000,
+			next_msk,
+			next_msk,
 		};
 		flags01 = vandq_u64(flags01, xflags);
 		flags01 = vceqzq_u64(flags01);
-		/* If VRING_DESC_F_NEXT is set in any then process remaining mbufs in scalar way */
+		/* Any VRING_DESC_F_NEXT or drop set, process remaining mbufs in scalar way */
 		if (unlikely(!vgetq_lane_u64(flags01, 0) || !vgetq_lane_u64(flags01, 1)))
 			break;
 
@@ -204,21 +250,35 @@ post_process_pkts(struct virtio_net_queue *q, struct rte_mbuf **d_mbufs, uint16_
 		rte_prefetch0((uint8_t *)mbuf_arr[last_off + 1] + data_off);
 		mbuf0 = mbuf_arr[last_off];
 
-		dflags = (*DESC_PTR_OFF(desc_base, last_off, 8) >> 48) & VRING_DESC_F_NEXT;
+		dflags = *DESC_PTR_OFF(desc_base, last_off, 8) >> shift;
+		/* Drop packets failed or truncated at fetch. Split descriptor chains are walked
+		 * into indirect tables at fetch, drop any head still carrying next flag.
+		 */
+		drop = dflags & VIRTIO_NET_DESC_F_DROP;
+		if (flags & VIRTIO_NET_DEQ_OFFLOAD_SPLIT) {
+			drop |= dflags & VRING_DESC_F_NEXT;
+			dflags = 0;
+		}
+		dflags &= VRING_DESC_F_NEXT;
 
 		mbuf1 = mbuf0;
 		off = last_off;
 
-		/* Calculate additional segments required for mbuf-chain */
+		/* Calculate additional segments required for mbuf-chain, packet is dropped if
+		 * any of them failed.
+		 */
 		while (unlikely(dflags)) {
 			off = (off + 1) & (q_sz - 1);
-			dflags = (*DESC_PTR_OFF(desc_base, off, 8) >> 48) & VRING_DESC_F_NEXT;
+			dflags = *DESC_PTR_OFF(desc_base, off, 8) >> 48;
+			drop |= dflags & VIRTIO_NET_DESC_F_DROP;
+			dflags &= VRING_DESC_F_NEXT;
 			segs++;
 		}
 
 		if (unlikely((i + segs >= total_mbufs)))
 			break;
 
+		off = last_off;
 		/* Create mbuf chain from descriptors */
 		while (unlikely(segs)) {
 			/* Internal mbufs can also have chain based on descriptor length vs
@@ -228,6 +288,7 @@ post_process_pkts(struct virtio_net_queue *q, struct rte_mbuf **d_mbufs, uint16_
 				mbuf1 = mbuf1->next;
 
 			last_off = (last_off + 1) & (q_sz - 1);
+			*DESC_PTR_OFF(desc_base, last_off, 8) &= ~drop_msk;
 			mbuf2 = mbuf_arr[last_off];
 			mbuf1->next = mbuf2;
 			mbuf2->data_len += vhdr_sz;
@@ -240,6 +301,17 @@ post_process_pkts(struct virtio_net_queue *q, struct rte_mbuf **d_mbufs, uint16_
 			segs--;
 		}
 
+		if (unlikely(drop)) {
+			*DESC_PTR_OFF(desc_base, off, 8) &= ~drop_msk;
+			if (virtio_net_has_stats_feature())
+				q->wrkr_stats.drops++;
+			rte_pktmbuf_free(mbuf0);
+			last_off = (last_off + 1) & (q_sz - 1);
+			i++;
+			count = i;
+			continue;
+		}
+
 		d_mbufs[num++] = mbuf0;
 
 		if (flags & VIRTIO_NET_DEQ_OFFLOAD_CHECKSUM) {
@@ -260,6 +332,11 @@ post_process_pkts(struct virtio_net_queue *q, struct rte_mbuf **d_mbufs, uint16_
 							   VIRTIO_NET_HDR_GSO_TCPV6) {
 							l3_len = sizeof(struct rte_ipv6_hdr);
 							ol_flags = TX_IPV6_TCP_GSO_OFFLOAD;
+						} else if (hdr->gso_type ==
+							   VIRTIO_NET_HDR_GSO_UDP_L4) {
+							mbuf0->l4_len = sizeof(struct rte_udp_hdr);
+							ol_flags = virtio_net_uso_ol_flags(
+								hdr, vhdr_sz, &l3_len);
 						}
 					}
 				}
@@ -279,10 +356,108 @@ post_process_pkts(struct virtio_net_queue *q, struct rte_mbuf **d_mbufs, uint16_
 	return num;
 }
 
+/* Resolve indirect table of a descriptor into mbuf chain, table is already in shadow.
+ * Packets that cannot be resolved are marked in shadow descriptor to be dropped.
+ */
+static __rte_always_inline bool
+fetch_host_ind_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem, uint16_t off,
+		    uint32_t tbl_len, struct rte_mbuf *mbuf, const uint16_t flags)
+{
+	const uint8_t shift = (flags & VIRTIO_NET_DEQ_OFFLOAD_SPLIT) ? 32 : 48;
+	const uint64_t rearm_data = 0x100010000ULL | RTE_PKTMBUF_HEADROOM;
+	uint64_t *ind_desc = virtio_net_ind_ptr(q, off);
+	const uint16_t vhdr_sz = q->virtio_hdr_sz;
+	uint32_t nb_ind, len, cnt, room, tot_len;
+	uint16_t data_off = q->data_off;
+	uint16_t buf_len = q->buf_len;
+	struct rte_mbuf *mbuf0, *mbuf1;
+	uint32_t i, nb_ptrs, nb_ops;
+	rte_iova_t src, dst;
+
+	*((uint64_t *)&mbuf->rearm_data) = rearm_data + vhdr_sz;
+	mbuf->data_len = 0;
+	mbuf->next = NULL;
+	mbuf->ol_flags = 0;
+	mbuf0 = mbuf;
+
+	/* Only VIRTIO_NET_IND_DESC_MAX entries are fetched to shadow */
+	nb_ind = tbl_len / DESC_ENTRY_SZ;
+	if (unlikely(nb_ind > VIRTIO_NET_IND_DESC_MAX))
+		goto drop;
+
+	/* Make sure all ops of the packet fit so that it is never left half done */
+	tot_len = 0;
+	for (i = 0; i < nb_ind; i++)
+		tot_len += ind_desc[(i * 2) + 1] & (RTE_BIT64(32) - 1);
+	nb_ptrs = nb_ind + (tot_len / buf_len) + 1;
+	nb_ops = (nb_ptrs / dev2mem->flush_thr) + 2;
+	if (unlikely((uint16_t)(dev2mem->tail - dev2mem->head) + nb_ops >= dev2mem->mdata_mask))
+		return false;
+
+	dst = ((uintptr_t)mbuf) + data_off;
+	room = buf_len;
+	tot_len = 0;
+
+	for (i = 0; i < nb_ind; i++) {
+		src = ind_desc[i * 2];
+		len = ind_desc[(i * 2) + 1] & (RTE_BIT64(32) - 1);
+		while (len) {
+			if (unlikely(!room)) {
+				/* allocate new mbuf and attach it, drop packet on failure */
+				if (unlikely(rte_mempool_get(q->mp, (void **)&mbuf1))) {
+					if (virtio_net_has_stats_feature())
+						q->wrkr_stats.alloc_fails++;
+					goto drop;
+				}
+				*((uint64_t *)&mbuf1->rearm_data) = rearm_data;
+				mbuf1->data_len = 0;
+				mbuf1->next = NULL;
+				mbuf1->ol_flags = 0;
+				mbuf->next = mbuf1;
+				mbuf = mbuf1;
+				mbuf0->nb_segs++;
+				dst = ((uintptr_t)mbuf) + data_off;
+				room = buf_len;
+			}
+
+			/* Only DMA enqueue failure can fail the flush, truncated packet is
+			 * dropped
+			 */
+			if (unlikely(!dao_dma_flush(dev2mem, 1))) {
+				if (virtio_net_has_stats_feature())
+					q->wrkr_stats.dma_fails++;
+				goto drop;
+			}
+
+			cnt = RTE_MIN(len, room);
+			dao_dma_enq_x1(dev2mem, src, cnt, dst, cnt);
+			mbuf->data_len += cnt;
+			tot_len += cnt;
+			src += cnt;
+			dst += cnt;
+			room -= cnt;
+			len -= cnt;
+		}
+	}
+
+	/* Virtio header is at the start of the first segment */
+	if (unlikely(mbuf0->data_len < vhdr_sz))
+		goto drop;
+	mbuf0->data_len -= vhdr_sz;
+	mbuf0->pkt_len = tot_len - vhdr_sz;
+	return true;
+drop:
+	/* Chain built so far is freed with the packet after DMA completion */
+	*DESC_PTR_OFF(q->sd_desc_base, off, 8) |= (uint64_t)VIRTIO_NET_DESC_F_DROP << shift;
+	return true;
+}
+
 static __rte_always_inline uint16_t
 fetch_host_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem, uint16_t hint,
 		const uint16_t flags)
 {
+	const uint8_t shift = (flags & VIRTIO_NET_DEQ_OFFLOAD_SPLIT) ? 32 : 48;
+	const uint64_t drop_msk = (uint64_t)VIRTIO_NET_DESC_F_DROP << shift;
 	const uint64_t rearm_data = 0x100010000ULL | RTE_PKTMBUF_HEADROOM;
 	struct rte_dma_sge *src = NULL, *dst = NULL;
 	uintptr_t desc_base = (uintptr_t)q->sd_desc_base;
@@ -307,10 +482,17 @@ fetch_host_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
 	uint16_t used = 0;
 	int last_idx = 0;
 	uint16_t off, mbuf_off;
+	uint64_t ind_msk = 0;
 
 	sd_mbuf_off = q->sd_mbuf_off;
 
-	sd_desc_off = __atomic_load_n(&q->sd_desc_off, __ATOMIC_ACQUIRE);
+	/* With indirect descriptors, process only those whose tables have landed */
+	if (q->sd_ind_base) {
+		ind_msk = (uint64_t)VRING_DESC_F_INDIRECT << shift;
+		sd_desc_off = __atomic_load_n(&q->sd_ind_off, __ATOMIC_ACQUIRE);
+	} else {
+		sd_desc_off = __atomic_load_n(&q->sd_desc_off, __ATOMIC_ACQUIRE);
+	}
 	/* Return if already something is pending DMA or there are no descriptors to process */
 	if (unlikely(sd_desc_off == sd_mbuf_off))
 		return sd_mbuf_off;
@@ -328,8 +510,11 @@ fetch_host_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
 	mbuf_arr = q->mbuf_arr;
 
 	/* Flush to get minimum space */
-	if (!dao_dma_flush(dev2mem, 1))
+	if (!dao_dma_flush(dev2mem, 1)) {
+		if (virtio_net_has_stats_feature())
+			q->wrkr_stats.dma_fails++;
 		return sd_mbuf_off;
+	}
 
 	/* Start DMA of mbuf data */
 	count = nb_mbufs & ~(0x3u);
@@ -385,10 +570,16 @@ fetch_host_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
 		if (unlikely(nb_enq > 4))
 			break;
 
+		/* Descriptors pointing to indirect tables take scalar path */
+		xtmp0 = len01 | len23;
+		if (unlikely((vgetq_lane_u64(xtmp0, 0) | vgetq_lane_u64(xtmp0, 1)) & ind_msk))
+			break;
+
 		mbuf01 = vld1q_u64((uint64_t *)&mbuf_arr[off]);
 		mbuf23 = vld1q_u64((uint64_t *)&mbuf_arr[off + 2]);
 
-		if (flags & VIRTIO_NET_DEQ_OFFLOAD_NOINOR) {
+		if ((flags & VIRTIO_NET_DEQ_OFFLOAD_NOINOR) &&
+		    !(flags & VIRTIO_NET_DEQ_OFFLOAD_SPLIT)) {
 			flags01 = vzip2q_u64(desc0, desc1);
 			flags23 = vzip2q_u64(desc2, desc3);
 
@@ -486,8 +677,11 @@ fetch_host_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
 	}
 
 	/* Flush to get minimum space */
-	if (!dao_dma_flush(dev2mem, 1))
+	if (!dao_dma_flush(dev2mem, 1)) {
+		if (virtio_net_has_stats_feature())
+			q->wrkr_stats.dma_fails++;
 		goto exit;
+	}
 
 	while (i < nb_mbufs) {
 		mbuf = mbuf_arr[off];
@@ -496,7 +690,8 @@ fetch_host_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
 		slen = d_flags & (RTE_BIT64(32) - 1);
 		dlen = slen;
 
-		if (flags & VIRTIO_NET_DEQ_OFFLOAD_NOINOR) {
+		if ((flags & VIRTIO_NET_DEQ_OFFLOAD_NOINOR) &&
+		    !(flags & VIRTIO_NET_DEQ_OFFLOAD_SPLIT)) {
 			avail = !!(d_flags & VIRT_PACKED_RING_DESC_F_AVAIL);
 			d_flags &= ~VIRT_PACKED_RING_DESC_F_AVAIL_USED;
 
@@ -504,6 +699,13 @@ fetch_host_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
 			*DESC_PTR_OFF(desc_base, off, 8) = avail << 55 | avail << 63 | d_flags;
 		}
 
+		if (unlikely(d_flags & ind_msk)) {
+			if (!fetch_host_ind_data(q, dev2mem, off, slen, mbuf, flags))
+				goto exit;
+			mbuf0 = mbuf;
+			goto next;
+		}
+
 		/* Limit data to buffer length */
 		if (unlikely(slen > buf_len)) {
 			pend = slen - buf_len;
@@ -528,7 +730,16 @@ fetch_host_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
 		mbuf0 = mbuf;
 		while (unlikely(pend)) {
 			/* allocate new mbuf and attach it */
-			rte_mempool_get(q->mp, (void **)&mbuf1);
+			if (unlikely(rte_mempool_get(q->mp, (void **)&mbuf1))) {
+				if (virtio_net_has_stats_feature())
+					q->wrkr_stats.alloc_fails++;
+				/* Copy to buffers already attached, truncated packet is dropped */
+				src[0].length -= pend;
+				mbuf0->pkt_len -= pend;
+				pend = 0;
+				*DESC_PTR_OFF(desc_base, off, 8) |= drop_msk;
+				break;
+			}
 			*((uint64_t *)&mbuf1->rearm_data) = rearm_data;
 			dlen = pend;
 			if (unlikely(dlen > buf_len))
@@ -544,13 +755,17 @@ fetch_host_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
 			pend -= dlen;
 		}
 
+next:
 		i++;
 		off = (off + 1) & (q_sz - 1);
 		used = i;
 		last_idx = dev2mem->tail;
 		/* Flush on reaching max SG limit */
-		if (!dao_dma_flush(dev2mem, mbuf0->nb_segs))
+		if (!dao_dma_flush(dev2mem, mbuf0->nb_segs)) {
+			if (virtio_net_has_stats_feature())
+				q->wrkr_stats.dma_fails++;
 			goto exit;
+		}
 	}
 
 exit:
@@ -564,19 +779,36 @@ exit:
 	return sd_mbuf_off;
 }
 
+static __rte_always_inline void
+virtio_net_deq_stats(struct virtio_net_queue *q, struct rte_mbuf **mbufs, uint16_t nb_pkts)
+{
+	struct dao_virtio_netdev_queue_stats *stats = &q->wrkr_stats;
+	uint64_t ol_flags;
+	uint16_t i;
+
+	stats->pkts += nb_pkts;
+	for (i = 0; i < nb_pkts; i++) {
+		ol_flags = mbufs[i]->ol_flags;
+		stats->bytes += mbufs[i]->pkt_len;
+		stats->mseg_pkts += mbufs[i]->nb_segs > 1;
+		stats->csum_pkts += !!(ol_flags & RTE_MBUF_F_TX_L4_MASK);
+		stats->gso_pkts += !!(ol_flags & (RTE_MBUF_F_TX_TCP_SEG | RTE_MBUF_F_TX_UDP_SEG));
+	}
+}
+
 static __rte_always_inline int
 virtio_net_deq(struct virtio_net_queue *q, struct rte_mbuf **mbufs, uint16_t nb_mbufs,
 	       const uint16_t flags)
 {
-	struct dao_dma_vchan_info *vchan_info = RTE_PER_LCORE(dao_dma_vchan_info);
 	uint16_t dma_vchan = q->dma_vchan;
 	struct dao_dma_vchan_state *dev2mem;
+	struct virtio_net_shaper *shaper;
 	uint16_t nb_avail, last_off;
 	uint16_t sd_mbuf_off;
 	uint16_t q_sz;
 	int rc = 0;
 
-	dev2mem = &vchan_info->dev2mem[dma_vchan];
+	dev2mem = dao_dma_lcore_dev2mem_get(dma_vchan, q->qid);
 
 	rte_prefetch0(&q->last_off);
 	/* Update completed DMA ops */
@@ -596,8 +828,22 @@ virtio_net_deq(struct virtio_net_queue *q, struct rte_mbuf **mbufs, uint16_t nb_
 
 	nb_mbufs = RTE_MIN(nb_mbufs, nb_avail);
 
+	/* Packets over rate limit stay in virt queue */
+	shaper = q->shaper;
+	if (unlikely(shaper)) {
+		nb_mbufs = virtio_net_shaper_admit(shaper, nb_mbufs);
+		if (!nb_mbufs)
+			goto exit;
+	}
+
 	/* Post process packets and fill buffers */
 	rc = post_process_pkts(q, mbufs, &nb_mbufs, flags);
+	if (virtio_net_has_stats_feature())
+		virtio_net_deq_stats(q, mbufs, rc);
+	if (unlikely(shaper))
+		virtio_net_shaper_consume(shaper, mbufs, rc, 1);
+	if (unlikely(q->cap))
+		virtio_net_capture(q, mbufs, rc, true);
 
 	last_off = desc_off_add(last_off, nb_mbufs, q_sz);
 	__atomic_store_n(&q->last_off, last_off, __ATOMIC_RELEASE);
@@ -4,6 +4,8 @@
 
 #include <rte_vect.h>
 
+#include <dao_vect.h>
+
 #include "dao_virtio_netdev.h"
 #include "spec/virtio_net.h"
 #include "virtio_dev_priv.h"
@@ -40,11 +42,100 @@ virtio_net_flush_deq_ext(struct virtio_net_queue *q)
 	if (unlikely(!nb_avail))
 		return;
 
-	user_cbs.extbuf_put(q->netdev_id, &q->extbuf_arr[DESC_OFF(last_off)], nb_avail);
+	virtio_net_extbuf_put(q, &q->extbuf_arr[DESC_OFF(last_off)], nb_avail);
 	last_off = desc_off_add(last_off, nb_avail, q_sz);
 	nb_avail = sd_mbuf_off - last_off;
 	if (nb_avail)
-		user_cbs.extbuf_put(q->netdev_id, &q->extbuf_arr[DESC_OFF(last_off)], nb_avail);
+		virtio_net_extbuf_put(q, &q->extbuf_arr[DESC_OFF(last_off)], nb_avail);
+}
+
+/* Copy split descriptor chain, walked into indirect table shadow, back to back into linked
+ * external buffers. Chains that cannot be copied in full are marked in buffer to be dropped.
+ * Returns false to retry later when buffers cannot be allocated.
+ */
+static __rte_always_inline bool
+fetch_host_chain_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
+		      struct dao_virtio_net_hdr *buf, uint16_t off, uint64_t d_flags)
+{
+	struct dao_virtio_net_hdr *bufs[VIRTIO_NET_IND_DESC_MAX * 2], *head = buf;
+	uint64_t *tbl = virtio_net_ind_ptr(q, off);
+	uint32_t nb_ind, nb_bufs = 0, len, cnt, room;
+	uint16_t buf_len = q->buf_len;
+	uint32_t i, k = 0, nb_ops = 0;
+	uint64_t drop = 0, tot_len;
+	rte_iova_t src;
+	uintptr_t dst;
+
+	nb_ind = (d_flags & (RTE_BIT64(32) - 1)) / DESC_ENTRY_SZ;
+	if (likely(nb_ind <= VIRTIO_NET_IND_DESC_MAX &&
+		   !((d_flags >> 32) & VIRTIO_NET_DESC_F_DROP))) {
+		tot_len = 0;
+		for (i = 0; i < nb_ind; i++)
+			tot_len += tbl[(i * 2) + 1] & (RTE_BIT64(32) - 1);
+		nb_bufs = tot_len ? (tot_len - 1) / buf_len : 0;
+	}
+
+	if (unlikely(nb_ind > VIRTIO_NET_IND_DESC_MAX || nb_bufs > RTE_DIM(bufs) ||
+		     ((d_flags >> 32) & VIRTIO_NET_DESC_F_DROP))) {
+		/* Packet is dropped, head data is still copied so that buffer completes with
+		 * the rest of the batch.
+		 */
+		nb_ind = 1;
+		nb_bufs = 0;
+		drop = (uint64_t)VIRTIO_NET_DESC_F_DROP << 48;
+	} else if (nb_bufs && virtio_net_extbuf_get(q, (void **)bufs, nb_bufs) < 0) {
+		return false;
+	}
+
+	/* Chain flags are internal, only the rest of head flags are passed on */
+	d_flags = (d_flags >> 32) & ~(VRING_DESC_F_NEXT | VRING_DESC_F_INDIRECT |
+				      VIRTIO_NET_DESC_F_CHAIN | VIRTIO_NET_DESC_F_CHAIN_PEND);
+	buf->desc_data[0] = 0x0;
+	buf->desc_data[1] = ((d_flags & 0xFFFF) << 48) | drop;
+	dst = (uintptr_t)&buf->hdr;
+	room = buf_len;
+
+	for (i = 0; i < nb_ind; i++) {
+		src = tbl[i * 2];
+		len = tbl[(i * 2) + 1] & (RTE_BIT64(32) - 1);
+		if (drop)
+			len = RTE_MIN(len, (uint32_t)buf_len);
+		while (len) {
+			if (!room) {
+				bufs[k]->desc_data[0] = 0x0;
+				bufs[k]->desc_data[1] = 0;
+				buf->desc_data[0] = (uintptr_t)bufs[k];
+				buf = bufs[k++];
+				dst = (uintptr_t)&buf->hdr;
+				room = buf_len;
+			}
+
+			/* Space for first op is ensured by caller, only DMA enqueue failure can
+			 * fail the flush later. Truncated packet is dropped.
+			 */
+			if (unlikely(!dao_dma_flush(dev2mem, 1))) {
+				head->desc_data[1] |= (uint64_t)VIRTIO_NET_DESC_F_DROP << 48;
+				goto done;
+			}
+
+			cnt = RTE_MIN(len, room);
+			dao_dma_enq_x1(dev2mem, src, cnt, (rte_iova_t)dst, cnt);
+			buf->desc_data[1] += cnt;
+			src += cnt;
+			dst += cnt;
+			room -= cnt;
+			len -= cnt;
+			nb_ops++;
+		}
+	}
+
+	/* Chain without data still completes by a DMA op */
+	if (unlikely(!nb_ops))
+		dao_dma_enq_x1(dev2mem, tbl[0], 0, (rte_iova_t)dst, 0);
+done:
+	if (unlikely(k < nb_bufs))
+		virtio_net_extbuf_put(q, (void **)&bufs[k], nb_bufs - k);
+	return true;
 }
 
 static __rte_always_inline uint16_t
@@ -74,7 +165,11 @@ fetch_host_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
 		q->pend_sd_mbuf = 0;
 	}
 
-	sd_desc_off = __atomic_load_n(&q->sd_desc_off, __ATOMIC_ACQUIRE);
+	/* With split descriptor chains walked, process only those whose chains have landed */
+	if (q->sd_ind_base)
+		sd_desc_off = __atomic_load_n(&q->sd_ind_off, __ATOMIC_ACQUIRE);
+	else
+		sd_desc_off = __atomic_load_n(&q->sd_desc_off, __ATOMIC_ACQUIRE);
 	/* Return if already something is pending DMA or there are no descriptors to process */
 	if (unlikely(pend_sd_mbuf || sd_desc_off == sd_mbuf_off))
 		return sd_mbuf_off;
@@ -98,7 +193,17 @@ fetch_host_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
 		slen = d_flags & (RTE_BIT64(32) - 1);
 		dlen = slen;
 
-		if (flags & VIRTIO_NET_DEQ_OFFLOAD_NOINOR) {
+		if ((flags & VIRTIO_NET_DEQ_OFFLOAD_SPLIT) &&
+		    unlikely((d_flags >> 32) & VIRTIO_NET_DESC_F_CHAIN)) {
+			if (!fetch_host_chain_data(q, dev2mem, buf, off, d_flags))
+				goto exit;
+			goto next;
+		}
+
+		if (flags & VIRTIO_NET_DEQ_OFFLOAD_SPLIT) {
+			/* Move split descriptor flags to packed descriptor flags position */
+			d_flags = ((d_flags >> 32) & 0xFFFF) << 48 | slen;
+		} else if (flags & VIRTIO_NET_DEQ_OFFLOAD_NOINOR) {
 			avail = !!(d_flags & VIRT_PACKED_RING_DESC_F_AVAIL);
 			d_flags &= ~VIRT_PACKED_RING_DESC_F_AVAIL_USED;
 
@@ -124,7 +229,7 @@ fetch_host_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
 		buf->desc_data[1] = dlen | (d_flags & 0xFFFF000000000000);
 
 		while (unlikely(pend)) {
-			user_cbs.extbuf_get(q->netdev_id, (void **)&n_buf, 1);
+			virtio_net_extbuf_get(q, (void **)&n_buf, 1);
 			dlen = pend;
 			if (unlikely(dlen > buf_len))
 				dlen = buf_len;
@@ -139,6 +244,7 @@ fetch_host_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
 
 		dev2mem->src_i++;
 		dev2mem->dst_i++;
+next:
 		i++;
 		off = (off + 1) & (q_sz - 1);
 		used = i;
@@ -153,15 +259,41 @@ exit:
 		/* If we are here, it means there are no pending mbufs */
 		q->pend_sd_mbuf = used;
 		q->pend_sd_mbuf_idx = last_idx;
+		/* SGEs were filled in place, mark vchan for flush_submit */
+		dao_dma_vchan_pend_mark(dev2mem);
 	}
 
 	return sd_mbuf_off;
 }
 
+/* Drop split descriptor chains that could not be copied in full */
+static __rte_always_inline uint16_t
+virtio_net_deq_ext_drop(struct virtio_net_queue *q, void **vbufs, uint16_t nb_bufs)
+{
+	struct dao_virtio_net_hdr *buf, *n_buf;
+	uint16_t i, j = 0;
+
+	for (i = 0; i < nb_bufs; i++) {
+		buf = vbufs[i];
+		if (likely(!((buf->desc_data[1] >> 48) & VIRTIO_NET_DESC_F_DROP))) {
+			vbufs[j++] = buf;
+			continue;
+		}
+
+		if (virtio_net_has_stats_feature())
+			q->wrkr_stats.drops++;
+		while (buf) {
+			n_buf = (struct dao_virtio_net_hdr *)buf->desc_data[0];
+			virtio_net_extbuf_put(q, (void **)&buf, 1);
+			buf = n_buf;
+		}
+	}
+	return j;
+}
+
 static __rte_always_inline int
 virtio_net_deq_ext(struct virtio_net_queue *q, void **vbufs, uint16_t nb_bufs, const uint16_t flags)
 {
-	struct dao_dma_vchan_info *vchan_info = RTE_PER_LCORE(dao_dma_vchan_info);
 	struct dao_dma_vchan_state *dev2mem;
 	uint16_t dma_vchan = q->dma_vchan;
 	uint16_t nb_avail, last_off;
@@ -169,7 +301,7 @@ virtio_net_deq_ext(struct virtio_net_queue *q, void **vbufs, uint16_t nb_bufs, c
 	uint16_t q_sz;
 	int rc = 0;
 
-	dev2mem = &vchan_info->dev2mem[dma_vchan];
+	dev2mem = dao_dma_lcore_dev2mem_get(dma_vchan, q->qid);
 
 	rte_prefetch0(&q->last_off);
 	/* Update completed DMA ops */
@@ -191,11 +323,14 @@ virtio_net_deq_ext(struct virtio_net_queue *q, void **vbufs, uint16_t nb_bufs, c
 
 	/* Memcpy DMA'ed buf pointers */
 	memcpy(vbufs, &q->extbuf_arr[DESC_OFF(last_off)], nb_bufs << 3);
-
 	last_off = desc_off_add(last_off, nb_bufs, q_sz);
 	__atomic_store_n(&q->last_off, last_off, __ATOMIC_RELEASE);
 
 	rc = nb_bufs;
+	if ((flags & VIRTIO_NET_DEQ_OFFLOAD_SPLIT) && q->sd_ind_base)
+		rc = virtio_net_deq_ext_drop(q, vbufs, nb_bufs);
+	if (virtio_net_has_stats_feature())
+		q->wrkr_stats.pkts += rc;
 exit:
 	return rc;
 }
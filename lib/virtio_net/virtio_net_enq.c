@@ -2,6 +2,10 @@
  * Copyright (c) 2024 Marvell.
  */
 
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_tcp.h>
+
 #include "dao_virtio_netdev.h"
 #include "virtio_dev_priv.h"
 
@@ -139,6 +143,313 @@ calculate_nb_enq(uint64_t *sd_desc_base, uint16_t off, uint32_t slen, uint16_t q
 	return dlen >= slen ? nb_enq : UINT16_MAX;
 }
 
+/* Receive coalescing state of a run of TCP segments in a burst */
+struct virtio_net_gro {
+	uint16_t l3_len;
+	uint16_t hdr_len;
+	uint16_t mss;
+	/* Cumulative payload length till each packet of run */
+	uint32_t tot_len[VIRTIO_NET_GRO_MAX_PKTS];
+};
+
+static __rte_always_inline bool
+gro_tcp_ptype(struct rte_mbuf *m)
+{
+	return (m->packet_type & RTE_PTYPE_L4_MASK) == RTE_PTYPE_L4_TCP;
+}
+
+static __rte_always_inline bool
+gro_tcp_parse(struct rte_mbuf *m, uint16_t *l3_len, uint16_t *hdr_len, uint16_t *plen)
+{
+	const uint32_t ptype_msk = RTE_PTYPE_L2_MASK | RTE_PTYPE_TUNNEL_MASK | RTE_PTYPE_L4_MASK;
+	uint32_t ptype = m->packet_type;
+	struct rte_ipv4_hdr *ip4;
+	struct rte_ipv6_hdr *ip6;
+	struct rte_tcp_hdr *tcp;
+	uint16_t ip_len;
+
+	/* Only single segment TCP packets with hardware verified checksum */
+	if ((ptype & ptype_msk) != (RTE_PTYPE_L2_ETHER | RTE_PTYPE_L4_TCP) || m->nb_segs != 1 ||
+	    (m->ol_flags & RTE_MBUF_F_RX_L4_CKSUM_MASK) != RTE_MBUF_F_RX_L4_CKSUM_GOOD)
+		return false;
+
+	if (RTE_ETH_IS_IPV4_HDR(ptype)) {
+		ip4 = rte_pktmbuf_mtod_offset(m, struct rte_ipv4_hdr *, RTE_ETHER_HDR_LEN);
+		if (ip4->version_ihl != RTE_IPV4_VHL_DEF ||
+		    (ip4->fragment_offset &
+		     rte_cpu_to_be_16(RTE_IPV4_HDR_MF_FLAG | RTE_IPV4_HDR_OFFSET_MASK)) ||
+		    (m->ol_flags & RTE_MBUF_F_RX_IP_CKSUM_MASK) != RTE_MBUF_F_RX_IP_CKSUM_GOOD)
+			return false;
+		*l3_len = sizeof(struct rte_ipv4_hdr);
+		ip_len = rte_be_to_cpu_16(ip4->total_length);
+	} else if (RTE_ETH_IS_IPV6_HDR(ptype)) {
+		ip6 = rte_pktmbuf_mtod_offset(m, struct rte_ipv6_hdr *, RTE_ETHER_HDR_LEN);
+		if (ip6->proto != IPPROTO_TCP)
+			return false;
+		*l3_len = sizeof(struct rte_ipv6_hdr);
+		ip_len = rte_be_to_cpu_16(ip6->payload_len) + sizeof(struct rte_ipv6_hdr);
+	} else {
+		return false;
+	}
+
+	/* Plain ACK segments with data, PSH is allowed to end the run */
+	tcp = rte_pktmbuf_mtod_offset(m, struct rte_tcp_hdr *, RTE_ETHER_HDR_LEN + *l3_len);
+	if ((tcp->tcp_flags & ~RTE_TCP_PSH_FLAG) != RTE_TCP_ACK_FLAG)
+		return false;
+
+	*hdr_len = RTE_ETHER_HDR_LEN + *l3_len + ((tcp->data_off & 0xf0) >> 2);
+	if (ip_len + RTE_ETHER_HDR_LEN <= *hdr_len || ip_len + RTE_ETHER_HDR_LEN > m->data_len)
+		return false;
+
+	*plen = ip_len + RTE_ETHER_HDR_LEN - *hdr_len;
+	return true;
+}
+
+/* Find run of in order segments of same flow at the start of mbufs, only of address families
+ * in gro_flags for which guest takes GSO packets.
+ */
+static __rte_always_inline uint16_t
+gro_tcp_run(struct rte_mbuf **mbufs, uint16_t nb_mbufs, struct virtio_net_gro *gro,
+	    uint8_t gro_flags)
+{
+	uint16_t l3_len, hdr_len, plen, addr_off, addr_sz, i;
+	struct rte_tcp_hdr *tcp0, *tcp;
+	uint8_t *l3_0, *l3;
+	uint32_t seq;
+
+	nb_mbufs = RTE_MIN(nb_mbufs, VIRTIO_NET_GRO_MAX_PKTS);
+	if (nb_mbufs < 2 || !gro_tcp_parse(mbufs[0], &gro->l3_len, &gro->hdr_len, &gro->mss))
+		return 1;
+
+	if (!(gro_flags & ((gro->l3_len == sizeof(struct rte_ipv4_hdr)) ? VIRTIO_NET_GRO_F_IPV4 :
+									  VIRTIO_NET_GRO_F_IPV6)))
+		return 1;
+
+	l3_0 = rte_pktmbuf_mtod_offset(mbufs[0], uint8_t *, RTE_ETHER_HDR_LEN);
+	tcp0 = (struct rte_tcp_hdr *)(l3_0 + gro->l3_len);
+	if (gro->l3_len == sizeof(struct rte_ipv4_hdr)) {
+		addr_off = offsetof(struct rte_ipv4_hdr, src_addr);
+		addr_sz = 2 * sizeof(rte_be32_t);
+	} else {
+		addr_off = offsetof(struct rte_ipv6_hdr, src_addr);
+		addr_sz = 2 * sizeof(((struct rte_ipv6_hdr *)0)->src_addr);
+	}
+
+	gro->tot_len[0] = gro->mss;
+	seq = rte_be_to_cpu_32(tcp0->sent_seq) + gro->mss;
+	tcp = tcp0;
+	for (i = 1; i < nb_mbufs; i++) {
+		/* Segment with PSH or shorter than MSS ends the run */
+		if ((tcp->tcp_flags & RTE_TCP_PSH_FLAG) ||
+		    gro->tot_len[i - 1] != (uint32_t)i * gro->mss)
+			break;
+
+		if (!gro_tcp_parse(mbufs[i], &l3_len, &hdr_len, &plen) || l3_len != gro->l3_len ||
+		    hdr_len != gro->hdr_len || plen > gro->mss)
+			break;
+
+		l3 = rte_pktmbuf_mtod_offset(mbufs[i], uint8_t *, RTE_ETHER_HDR_LEN);
+		tcp = (struct rte_tcp_hdr *)(l3 + l3_len);
+		/* Same flow, same ack and options, next in sequence */
+		if (memcmp(l3 + addr_off, l3_0 + addr_off, addr_sz) ||
+		    tcp->src_port != tcp0->src_port || tcp->dst_port != tcp0->dst_port ||
+		    tcp->recv_ack != tcp0->recv_ack || rte_be_to_cpu_32(tcp->sent_seq) != seq ||
+		    memcmp(tcp + 1, tcp0 + 1, hdr_len - RTE_ETHER_HDR_LEN - l3_len -
+						  sizeof(struct rte_tcp_hdr)))
+			break;
+
+		/* Coalesced packet has to fit IP length */
+		if (gro->tot_len[i - 1] + plen + hdr_len - RTE_ETHER_HDR_LEN > UINT16_MAX)
+			break;
+
+		gro->tot_len[i] = gro->tot_len[i - 1] + plen;
+		seq += plen;
+	}
+
+	return i;
+}
+
+/* Chain payload of a run to its first packet and fix up headers for guest GSO */
+static __rte_always_inline void
+gro_tcp_merge(struct rte_mbuf **mbufs, uint16_t nb_pkts, struct virtio_net_gro *gro,
+	      struct virtio_net_hdr *hdr)
+{
+	struct rte_mbuf *m0 = mbufs[0], *m, *prev;
+	uint16_t hdr_len = gro->hdr_len;
+	uint32_t tot_len, plen;
+	struct rte_ipv4_hdr *ip4;
+	struct rte_ipv6_hdr *ip6;
+	struct rte_tcp_hdr *tcp;
+	uint8_t tcp_flags = 0;
+	uint16_t i;
+
+	tot_len = gro->tot_len[nb_pkts - 1];
+	m0->data_len = hdr_len + gro->mss;
+	m0->pkt_len = hdr_len + tot_len;
+	m0->nb_segs = nb_pkts;
+	prev = m0;
+	for (i = 1; i < nb_pkts; i++) {
+		m = mbufs[i];
+		plen = gro->tot_len[i] - gro->tot_len[i - 1];
+		tcp = rte_pktmbuf_mtod_offset(m, struct rte_tcp_hdr *,
+					      RTE_ETHER_HDR_LEN + gro->l3_len);
+		tcp_flags |= tcp->tcp_flags;
+
+		/* Strip headers from coalesced segments */
+		m->data_off += hdr_len;
+		m->data_len = plen;
+		m->pkt_len = plen;
+		m->nb_segs = 1;
+		m->next = NULL;
+		prev->next = m;
+		prev = m;
+	}
+
+	/* Checksum is left partial with pseudo header sum as guest may resegment */
+	tcp = rte_pktmbuf_mtod_offset(m0, struct rte_tcp_hdr *, RTE_ETHER_HDR_LEN + gro->l3_len);
+	tcp->tcp_flags |= (tcp_flags & RTE_TCP_PSH_FLAG);
+	if (gro->l3_len == sizeof(struct rte_ipv4_hdr)) {
+		ip4 = rte_pktmbuf_mtod_offset(m0, struct rte_ipv4_hdr *, RTE_ETHER_HDR_LEN);
+		ip4->total_length = rte_cpu_to_be_16(hdr_len - RTE_ETHER_HDR_LEN + tot_len);
+		ip4->hdr_checksum = 0;
+		ip4->hdr_checksum = rte_ipv4_cksum(ip4);
+		tcp->cksum = rte_ipv4_phdr_cksum(ip4, 0);
+		hdr->gso_type = VIRTIO_NET_HDR_GSO_TCPV4;
+	} else {
+		ip6 = rte_pktmbuf_mtod_offset(m0, struct rte_ipv6_hdr *, RTE_ETHER_HDR_LEN);
+		ip6->payload_len = rte_cpu_to_be_16(hdr_len - RTE_ETHER_HDR_LEN - gro->l3_len +
+						    tot_len);
+		tcp->cksum = rte_ipv6_phdr_cksum(ip6, 0);
+		hdr->gso_type = VIRTIO_NET_HDR_GSO_TCPV6;
+	}
+
+	hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+	hdr->hdr_len = hdr_len;
+	hdr->gso_size = gro->mss;
+	hdr->csum_start = RTE_ETHER_HDR_LEN + gro->l3_len;
+	hdr->csum_offset = offsetof(struct rte_tcp_hdr, cksum);
+}
+
+static __rte_always_inline void
+enq_hdr_fill(struct virtio_net_hdr *hdr, struct rte_mbuf *m, uint8_t *hrp, const uint16_t flags)
+{
+	hdr->flags = 0;
+	hdr->gso_type = 0;
+	hdr->gso_size = 0;
+	hdr->csum_start = 0;
+	hdr->csum_offset = 0;
+
+	if ((flags & VIRTIO_NET_ENQ_OFFLOAD_CHECKSUM) &&
+	    !(m->ol_flags & (RTE_MBUF_F_RX_IP_CKSUM_BAD | RTE_MBUF_F_RX_L4_CKSUM_BAD)))
+		hdr->flags = VIRTIO_NET_HDR_F_DATA_VALID;
+
+	if (flags & VIRTIO_NET_ENQ_OFFLOAD_HASH_REPORT) {
+		hdr->hash_value = m->hash.rss;
+		hdr->hash_report = 0;
+		if (hdr->hash_value)
+			hdr->hash_report = mbuf_pkt_type_to_virtio_hash_report(hrp, m->packet_type);
+	}
+}
+
+/* Enqueue a run of single segment packets to mergeable buffers. Descriptor spans of the
+ * run are computed first from guest buffer lengths, then each packet goes as one source
+ * pointer, so that DMA auto free sees one pointer per mbuf, and a destination pointer per
+ * descriptor. This is a scalar restructure of the mseg path, packets are handled one at a
+ * time and only the destination pointer and the descriptor write back of each guest buffer
+ * use a 128 bit store.
+ */
+static __rte_always_inline uint16_t
+push_enq_mrg(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev,
+	     struct rte_mbuf **mbufs, uint16_t nb_mbufs, uint16_t *qoff, uint16_t avail_desc,
+	     uint16_t *used, uint16_t *last_idx, const uint16_t flags)
+{
+	const uint64x2_t desc_mask = {
+		~0ULL,
+		~(VIRT_PACKED_RING_DESC_F_USED | (RTE_BIT64(32) - 1)),
+	};
+	const uint64x2_t avail_mask = {0, VIRT_PACKED_RING_DESC_F_AVAIL};
+	const uint64x2_t addr_mask = {~0ULL, 0};
+	uint16_t spans[VIRTIO_NET_ENQ_MRG_BURST];
+	struct rte_mbuf **mbuf_arr = q->mbuf_arr;
+	uint16_t virtio_hdr_sz = q->virtio_hdr_sz;
+	uint64_t *sd_desc_base = q->sd_desc_base;
+	uint16_t nb_pkts, nb_desc = 0, span, i, j;
+	uint16_t off = *qoff, q_sz = q->q_sz;
+	uint32_t len, buf_len, dlen;
+	struct virtio_net_hdr *hdr;
+	struct rte_dma_sge *dst;
+	uint64x2_t desc, vlen;
+	struct rte_mbuf *m;
+
+	nb_mbufs = RTE_MIN(nb_mbufs, VIRTIO_NET_ENQ_MRG_BURST);
+	for (nb_pkts = 0; nb_pkts < nb_mbufs; nb_pkts++) {
+		m = mbufs[nb_pkts];
+		/* Chained mbufs and TCP segments to coalesce are left to scalar path */
+		if (m->nb_segs != 1 || ((flags & VIRTIO_NET_ENQ_OFFLOAD_GRO) && gro_tcp_ptype(m)))
+			break;
+
+		len = m->pkt_len + virtio_hdr_sz;
+		span = 0;
+		while (len && nb_desc + span < avail_desc) {
+			buf_len = *DESC_PTR_OFF(sd_desc_base, off, 8) & (RTE_BIT64(32) - 1);
+			len -= RTE_MIN(len, buf_len);
+			off = (off + 1) & (q_sz - 1);
+			span++;
+		}
+		if (len || span > mem2dev->flush_thr)
+			break;
+		spans[nb_pkts] = span;
+		nb_desc += span;
+	}
+
+	off = *qoff;
+	for (i = 0; i < nb_pkts; i++) {
+		m = mbufs[i];
+		span = spans[i];
+		if (!dao_dma_flush(mem2dev, span))
+			break;
+
+		hdr = rte_pktmbuf_mtod_offset(m, struct virtio_net_hdr *, -virtio_hdr_sz);
+		enq_hdr_fill(hdr, m, q->hash_report, flags);
+		hdr->num_buffers = span;
+
+		len = m->pkt_len + virtio_hdr_sz;
+		dao_dma_enq_src_x1(mem2dev, (uintptr_t)hdr, len);
+
+		dst = dao_dma_sge_dst(mem2dev);
+		for (j = 0; j < span; j++) {
+			desc = vld1q_u64(DESC_PTR_OFF(sd_desc_base, off, 0));
+			buf_len = vgetq_lane_u64(desc, 1) & (RTE_BIT64(32) - 1);
+			dlen = RTE_MIN(len, buf_len);
+			len -= dlen;
+			vlen = vsetq_lane_u64(dlen, vdupq_n_u64(0), 1);
+
+			/* Destination is guest buffer with length filled */
+			vst1q_u64((uint64_t *)&dst[j], (desc & addr_mask) | vlen);
+
+			/* Set USED same as AVAIL and fill length in descriptor */
+			desc = (desc & desc_mask) | ((desc & avail_mask) << 8) | vlen;
+			vst1q_u64(DESC_PTR_OFF(sd_desc_base, off, 0), desc);
+
+			mbuf_arr[off] = j ? NULL : m;
+			off = (off + 1) & (q_sz - 1);
+		}
+		mem2dev->dst_i += span;
+#ifdef RTE_LIBRTE_MEMPOOL_DEBUG
+		/* When fast free is enabled, all the buffers would be freed by DPI to NPA
+		 * Mark them as put since SW didnot not be freeing them.
+		 */
+		if (!(flags & VIRTIO_NET_ENQ_OFFLOAD_NOFF))
+			RTE_MEMPOOL_CHECK_COOKIES(m->pool, (void **)&m, 1, 0);
+#endif
+		*used += span;
+		*last_idx = mem2dev->tail;
+	}
+
+	*qoff = off;
+	return i;
+}
+
 static __rte_always_inline int
 push_enq_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev,
 	      struct rte_mbuf **mbufs, uint16_t nb_mbufs, const uint16_t flags)
@@ -162,6 +473,7 @@ push_enq_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev,
 	uint64x2_t len_olflags2, len_olflags3;
 	uint16_t sd_off, avail_sd, avail_mbuf;
 	uint32x4_t ol_flags, xlen, ylen, h0213;
+	struct virtio_net_gro gro;
 	uint64x2_t xflags01, xflags23;
 	uint8_t *hrp = q->hash_report;
 	uint64x2_t vdst[4], vsrc[4];
@@ -170,11 +482,15 @@ push_enq_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev,
 	uint16_t used = 0, i = 0;
 	uint16_t q_sz = q->q_sz;
 	uint64_t d_flags, avail;
-	uint32_t len, buf_len;
+	uint32_t len, buf_len, gro_len;
+	uint16_t nb_pkts, prev_used;
 
 	/* Check for minimum space */
-	if (!dao_dma_flush(mem2dev, 1))
+	if (!dao_dma_flush(mem2dev, 1)) {
+		if (virtio_net_has_stats_feature())
+			q->wrkr_stats.dma_fails++;
 		goto exit;
+	}
 
 	if (flags & VIRTIO_NET_ENQ_OFFLOAD_MSEG) {
 		sd_off = __atomic_load_n(&q->sd_desc_off, __ATOMIC_ACQUIRE);
@@ -223,6 +539,12 @@ push_enq_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev,
 				break;
 		}
 
+		/* Leave TCP packets to scalar path for coalescing */
+		if ((flags & VIRTIO_NET_ENQ_OFFLOAD_GRO) &&
+		    (gro_tcp_ptype(mbufs[i]) || gro_tcp_ptype(mbufs[i + 1]) ||
+		     gro_tcp_ptype(mbufs[i + 2]) || gro_tcp_ptype(mbufs[i + 3])))
+			break;
+
 		dataoff_iova0 =
 			vsetq_lane_u64(((struct rte_mbuf *)mbuf0)->data_off, vld1q_u64(mbuf0), 1);
 		len_olflags0 = vld1q_u64(mbuf0 + 3);
@@ -426,47 +748,57 @@ push_enq_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev,
 	}
 
 	while (i < nb_mbufs) {
+		/* Runs of single segment packets take mergeable buffers without scalar walk */
+		if (flags & VIRTIO_NET_ENQ_OFFLOAD_MSEG) {
+			prev_used = used;
+			nb_pkts = push_enq_mrg(q, mem2dev, &mbufs[i], nb_mbufs - i, &off,
+					       RTE_MIN(avail_sd, avail_mbuf), &used, &last_idx,
+					       flags);
+			if (nb_pkts) {
+				avail_sd -= used - prev_used;
+				avail_mbuf -= used - prev_used;
+				i += nb_pkts;
+				continue;
+			}
+		}
+
 		mbuf0 = (uint64_t *)mbufs[i];
+		nb_pkts = 1;
 
 		/* Add Virtio header */
 		hdr = rte_pktmbuf_mtod_offset((struct rte_mbuf *)mbuf0, struct virtio_net_hdr*,
 					      -(virtio_hdr_sz));
-		hdr->flags = 0;
-		hdr->gso_type = 0;
-		hdr->gso_size = 0;
-		hdr->csum_start = 0;
-		hdr->csum_offset = 0;
-
-		if (flags & VIRTIO_NET_ENQ_OFFLOAD_CHECKSUM) {
-			if (!(((struct rte_mbuf *)mbuf0)->ol_flags & RTE_MBUF_F_RX_IP_CKSUM_BAD) &&
-			    !(((struct rte_mbuf *)mbuf0)->ol_flags & RTE_MBUF_F_RX_L4_CKSUM_BAD))
-				hdr->flags = VIRTIO_NET_HDR_F_DATA_VALID;
-		} else {
-			hdr->flags = 0;
-		}
-
-		if (flags & VIRTIO_NET_ENQ_OFFLOAD_HASH_REPORT) {
-			uint16_t hash_rpt;
-
-			hash_rpt =
-				mbuf_pkt_type_to_virtio_hash_report(hrp, *((uint32_t *)mbuf0 + 8));
-
-			hdr->hash_value = ((struct rte_mbuf *)mbuf0)->hash.rss;
-			hdr->hash_report = hdr->hash_value ? hash_rpt : 0;
-		}
+		enq_hdr_fill(hdr, (struct rte_mbuf *)mbuf0, hrp, flags);
 
 		d_flags = *DESC_PTR_OFF(sd_desc_base, off, 8);
 		buf_len = d_flags & (RTE_BIT64(32) - 1);
 		len = ((struct rte_mbuf *)mbuf0)->pkt_len + virtio_hdr_sz;
 
 		if (flags & VIRTIO_NET_ENQ_OFFLOAD_MSEG) {
-			if (likely(buf_len >= len))
+			if (flags & VIRTIO_NET_ENQ_OFFLOAD_GRO)
+				nb_pkts = gro_tcp_run(&mbufs[i], nb_mbufs - i, &gro, q->gro_flags);
+
+			/* Shrink the run till coalesced packet fits descriptors and a DMA op */
+			while (unlikely(nb_pkts > 1)) {
+				gro_len = gro.hdr_len + gro.tot_len[nb_pkts - 1] + virtio_hdr_sz;
+				nb_enq = calculate_nb_enq(sd_desc_base, off, gro_len, q_sz,
+							  avail_sd);
+				if (nb_enq != UINT16_MAX &&
+				    RTE_MAX(nb_enq, nb_pkts) <= mem2dev->flush_thr)
+					break;
+				nb_pkts--;
+			}
+
+			/* Coalesced run has its nb_enq from above */
+			if (nb_pkts == 1 && likely(buf_len >= len))
 				nb_enq = 1;
-			else
+			else if (nb_pkts == 1)
 				nb_enq = calculate_nb_enq(sd_desc_base, off, len, q_sz, avail_sd);
 
 			if (flags & VIRTIO_NET_ENQ_OFFLOAD_NOFF) {
-				mbuf_nb_segs = ((struct rte_mbuf *)mbuf0)->nb_segs;
+				/* Coalesced run becomes a chain of nb_pkts segments */
+				mbuf_nb_segs = nb_pkts > 1 ? nb_pkts :
+							     ((struct rte_mbuf *)mbuf0)->nb_segs;
 
 				extra_desc = nb_enq < mbuf_nb_segs ? mbuf_nb_segs - nb_enq : 0;
 				nb_enq += extra_desc;
@@ -474,10 +806,15 @@ push_enq_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev,
 
 			last_idx = mem2dev->tail;
 			/* Check for available descriptors and mbuf space */
-			if (!dao_dma_flush(mem2dev, nb_enq) || nb_enq > avail_sd ||
-			    nb_enq > avail_mbuf || nb_enq == UINT16_MAX)
+			if (!dao_dma_flush(mem2dev, RTE_MAX(nb_enq, nb_pkts)) ||
+			    nb_enq > avail_sd || nb_enq > avail_mbuf || nb_enq == UINT16_MAX)
 				goto exit;
 
+			if (nb_pkts > 1) {
+				gro_tcp_merge(&mbufs[i], nb_pkts, &gro, hdr);
+				if (virtio_net_has_stats_feature())
+					q->wrkr_stats.gso_pkts += nb_pkts;
+			}
 			hdr->num_buffers = nb_enq;
 
 			avail_mbuf -= nb_enq;
@@ -509,15 +846,18 @@ push_enq_data(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev,
 		 * Mark them as put since SW didnot not be freeing them.
 		 */
 		if (!(flags & VIRTIO_NET_ENQ_OFFLOAD_NOFF))
-			RTE_MEMPOOL_CHECK_COOKIES(mbufs[i]->pool, (void **)&mbufs[i], 1, 0);
+			RTE_MEMPOOL_CHECK_COOKIES(mbufs[i]->pool, (void **)&mbufs[i], nb_pkts, 0);
 #endif
-		i++;
+		i += nb_pkts;
 		used += hdr->num_buffers;
 
 		last_idx = mem2dev->tail;
 		/* Flush on reaching max SG limit */
-		if (!dao_dma_flush(mem2dev, 1))
+		if (!dao_dma_flush(mem2dev, 1)) {
+			if (virtio_net_has_stats_feature())
+				q->wrkr_stats.dma_fails++;
 			goto exit;
+		}
 	}
 
 exit:
@@ -532,17 +872,61 @@ exit:
 	return i;
 }
 
+/* Account packets of a burst, called again with negative sign for packets not consumed */
+static __rte_always_inline void
+virtio_net_enq_stats(struct virtio_net_queue *q, struct rte_mbuf **mbufs, uint16_t nb_pkts,
+		     int64_t sign, const uint16_t flags)
+{
+	struct dao_virtio_netdev_queue_stats *stats = &q->wrkr_stats;
+	uint64_t bytes = 0, mseg = 0, csum = 0;
+	uint16_t i;
+
+	for (i = 0; i < nb_pkts; i++) {
+		bytes += mbufs[i]->pkt_len;
+		mseg += mbufs[i]->nb_segs > 1;
+		if (flags & VIRTIO_NET_ENQ_OFFLOAD_CHECKSUM)
+			csum += !(mbufs[i]->ol_flags &
+				  (RTE_MBUF_F_RX_IP_CKSUM_BAD | RTE_MBUF_F_RX_L4_CKSUM_BAD));
+	}
+	stats->pkts += sign * nb_pkts;
+	stats->bytes += sign * bytes;
+	stats->mseg_pkts += sign * mseg;
+	stats->csum_pkts += sign * csum;
+}
+
+/* Packets are copied for capture ahead of DMA, which can free them, and copies are kept only
+ * for packets sent. Transfer is done in capture bursts so copies of a burst can be held.
+ */
+static __rte_always_inline uint16_t
+virtio_net_enq_capture(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev,
+		       struct rte_mbuf **mbufs, uint16_t count, const uint16_t flags)
+{
+	struct virtio_net_capture_stage st;
+	uint16_t nb_used = 0, nb, used;
+
+	while (nb_used < count) {
+		nb = RTE_MIN(count - nb_used, VIRTIO_NET_CAPTURE_BURST);
+		virtio_net_capture_stage(q, mbufs + nb_used, nb, false, &st);
+		used = push_enq_data(q, mem2dev, mbufs + nb_used, nb, flags);
+		virtio_net_capture_commit(&st, used);
+		nb_used += used;
+		if (used < nb)
+			break;
+	}
+	return nb_used;
+}
+
 static __rte_always_inline int
 virtio_net_enq(struct virtio_net_queue *q, struct rte_mbuf **mbufs, uint16_t nb_mbufs,
 	       const uint16_t flags)
 {
-	struct dao_dma_vchan_info *vchan_info = RTE_PER_LCORE(dao_dma_vchan_info);
 	uint16_t dma_vchan = q->dma_vchan;
 	struct dao_dma_vchan_state *mem2dev;
+	struct virtio_net_shaper *shaper;
 	uint16_t nb_used, sd_desc_off;
 	uint16_t count;
 
-	mem2dev = &vchan_info->mem2dev[dma_vchan];
+	mem2dev = dao_dma_lcore_mem2dev_get(dma_vchan, q->qid);
 
 	/* Fetch mem2dev DMA completed status */
 	dao_dma_check_meta_compl(mem2dev, 1 /* ATOMIC update */);
@@ -550,6 +934,8 @@ virtio_net_enq(struct virtio_net_queue *q, struct rte_mbuf **mbufs, uint16_t nb_
 	/* Send only mbufs as per available descriptors */
 	sd_desc_off = __atomic_load_n(&q->sd_desc_off, __ATOMIC_ACQUIRE);
 	count = desc_off_diff(sd_desc_off, q->last_off, q->q_sz);
+	if (virtio_net_has_stats_feature() && unlikely(count < nb_mbufs))
+		q->wrkr_stats.no_desc++;
 	count = RTE_MIN(count, nb_mbufs);
 	count = RTE_MIN(count, q->q_sz - q->pend_sd_mbuf);
 
@@ -557,11 +943,38 @@ virtio_net_enq(struct virtio_net_queue *q, struct rte_mbuf **mbufs, uint16_t nb_
 	if (unlikely(!count))
 		return 0;
 
+	/* Packets over rate limit are left to caller, others are charged ahead of DMA which
+	 * can free them, packets not sent are refunded after.
+	 */
+	shaper = q->shaper;
+	if (unlikely(shaper)) {
+		count = virtio_net_shaper_admit(shaper, count);
+		if (!count)
+			return 0;
+		virtio_net_shaper_consume(shaper, mbufs, count, 1);
+	}
+
 	/* Validate descriptors */
 	VIRTIO_NET_DESC_CHECK(q, q->last_off, count, true, false);
 
+	/* Hash report needs a hash of packets from sources without NIC hash */
+	if ((flags & VIRTIO_NET_ENQ_OFFLOAD_HASH_REPORT) && q->rss)
+		virtio_net_rss_sw_hash(q->rss, mbufs, count);
+
+	/* Mbufs can be freed by DMA once enqueued, account them upfront */
+	if (virtio_net_has_stats_feature())
+		virtio_net_enq_stats(q, mbufs, count, 1, flags);
+
 	/* Process mbuf transfer using DMA */
-	nb_used = push_enq_data(q, mem2dev, mbufs, count, flags);
+	if (unlikely(q->cap))
+		nb_used = virtio_net_enq_capture(q, mem2dev, mbufs, count, flags);
+	else
+		nb_used = push_enq_data(q, mem2dev, mbufs, count, flags);
+
+	if (virtio_net_has_stats_feature() && unlikely(nb_used < count))
+		virtio_net_enq_stats(q, mbufs + nb_used, count - nb_used, -1, flags);
+	if (unlikely(shaper) && unlikely(nb_used < count))
+		virtio_net_shaper_consume(shaper, mbufs + nb_used, count - nb_used, -1);
 
 	return nb_used;
 }
@@ -26,12 +26,11 @@ virtio_net_flush_enq_ext(struct virtio_net_queue *q)
 
 	if (sd_mbuf_off != last_off) {
 		pend = desc_off_diff_no_wrap(last_off, sd_mbuf_off, q_sz);
-		user_cbs.extbuf_put(q->netdev_id, &q->extbuf_arr[DESC_OFF(sd_mbuf_off)], pend);
+		virtio_net_extbuf_put(q, &q->extbuf_arr[DESC_OFF(sd_mbuf_off)], pend);
 		sd_mbuf_off = desc_off_add(sd_mbuf_off, pend, q_sz);
 		pend = last_off - sd_mbuf_off;
 		if (pend) {
-			user_cbs.extbuf_put(q->netdev_id, &q->extbuf_arr[DESC_OFF(sd_mbuf_off)],
-					    pend);
+			virtio_net_extbuf_put(q, &q->extbuf_arr[DESC_OFF(sd_mbuf_off)], pend);
 			sd_mbuf_off = desc_off_add(sd_mbuf_off, pend, q_sz);
 		}
 		q->sd_mbuf_off = sd_mbuf_off;
@@ -124,13 +123,12 @@ exit:
 static __rte_always_inline int
 virtio_net_enq_ext(struct virtio_net_queue *q, void **vbufs, uint16_t nb_bufs, const uint16_t flags)
 {
-	struct dao_dma_vchan_info *vchan_info = RTE_PER_LCORE(dao_dma_vchan_info);
 	uint16_t dma_vchan = q->dma_vchan;
 	struct dao_dma_vchan_state *mem2dev;
 	uint16_t nb_used, sd_desc_off;
 	uint16_t count;
 
-	mem2dev = &vchan_info->mem2dev[dma_vchan];
+	mem2dev = dao_dma_lcore_mem2dev_get(dma_vchan, q->qid);
 
 	/* Fetch mem2dev DMA completed status */
 	dao_dma_check_compl(mem2dev);
@@ -141,6 +139,8 @@ virtio_net_enq_ext(struct virtio_net_queue *q, void **vbufs, uint16_t nb_bufs, c
 	/* Send only mbufs as per available descriptors */
 	sd_desc_off = __atomic_load_n(&q->sd_desc_off, __ATOMIC_ACQUIRE);
 	count = desc_off_diff(sd_desc_off, q->last_off, q->q_sz);
+	if (virtio_net_has_stats_feature() && unlikely(count < nb_bufs))
+		q->wrkr_stats.no_desc++;
 	count = RTE_MIN(count, nb_bufs);
 	count = RTE_MIN(count, q->q_sz - q->pend_sd_mbuf);
 
@@ -153,6 +153,8 @@ virtio_net_enq_ext(struct virtio_net_queue *q, void **vbufs, uint16_t nb_bufs, c
 
 	/* Process mbuf transfer using DMA */
 	nb_used = push_enq_ext_data(q, mem2dev, vbufs, count, flags);
+	if (virtio_net_has_stats_feature())
+		q->wrkr_stats.pkts += nb_used;
 
 	return nb_used;
 }
@@ -4,6 +4,26 @@
 #ifndef __INCLUDE_VIRTIO_NET_PRIV_H__
 #define __INCLUDE_VIRTIO_NET_PRIV_H__
 
+#include <rte_spinlock.h>
+
+/* Max entries of an indirect descriptor table fetched per ring position */
+#define VIRTIO_NET_IND_DESC_MAX 32
+
+/* Shadow descriptor flag marking a packet to drop after fetch, bit unused by virtio spec */
+#define VIRTIO_NET_DESC_F_DROP RTE_BIT32(3)
+
+/* Shadow split descriptor flags of a chain head walked into indirect table shadow, with
+ * entries of the chain in flight to the table. Bits unused by virtio spec.
+ */
+#define VIRTIO_NET_DESC_F_CHAIN      RTE_BIT32(4)
+#define VIRTIO_NET_DESC_F_CHAIN_PEND RTE_BIT32(5)
+
+/* Worker idle time after which descriptor fetch throttle is let go */
+#define VIRTIO_NET_THROTTLE_STALL_US 10
+
+/* Max packets of a mergeable buffer run whose descriptor spans are computed at once */
+#define VIRTIO_NET_ENQ_MRG_BURST 32
+
 struct virtio_net_queue {
 	/* Fast path */
 	/* Read only, shared by both service and worker */
@@ -14,17 +34,29 @@ struct virtio_net_queue {
 	uint16_t q_sz;
 	uint16_t dma_vchan;
 	uint16_t netdev_id;
+	uint16_t qid;
 	uint8_t virtio_hdr_sz;
 	uint8_t auto_free;
+	/* Address families coalesced for guest, VIRTIO_NET_GRO_F_* */
+	uint8_t gro_flags;
 	uint8_t *hash_report;
+	/* Software RSS, valid when enabled */
+	struct virtio_net_rss *rss;
+	/* Packet capture, valid when enabled */
+	struct virtio_net_capture *cap;
+	/* Rate limits and weight, valid when queue or its direction is shaped */
+	struct virtio_net_shaper *shaper;
 
 	/* Slow path */
 	struct dao_virtio_netdev *dao_netdev __rte_cache_aligned;
-	uint16_t qid;
+	/* Stats snapshot at last reset */
+	struct dao_virtio_netdev_queue_stats stats_base;
 
 	/* Read-Write worker. */
 	uint16_t pend_sd_mbuf __rte_cache_aligned;
 	uint16_t pend_sd_mbuf_idx;
+	uint32_t cap_cnt;
+	struct dao_virtio_netdev_queue_stats wrkr_stats;
 
 	RTE_CACHE_GUARD;
 
@@ -34,16 +66,52 @@ struct virtio_net_queue {
 	uint16_t pend_compl_idx;
 	uint16_t pend_compl;
 	uint16_t compl_off;
+	/* Valid only for split virtqueue */
+	uint16_t sd_avail_off;
+	uint16_t pend_sd_avail;
+	uint16_t used_idx;
+	/* Split virtqueue avail index known to device and avail_event published for it */
+	uint16_t avail_idx;
+	uint16_t avail_event;
+	uint16_t sd_avail_idx;
+	uint16_t pend_avail_event;
+	uint16_t avail_event_chk;
+	/* Valid only when indirect descriptors are negotiated or split chains are walked */
+	uint16_t pend_sd_ind;
+	uint16_t ind_batch_off;
+	/* Interrupt moderation and event suppression, valid only for Host Rx queue */
+	uint16_t intr_compl_off;
+	uint16_t intr_used_off;
+	uint16_t intr_sig_off;
+	uint16_t intr_event_off;
+	uint16_t pend_event_idx;
+	uint16_t pend_event;
+	uint16_t intr_max_pkts;
+	uint8_t intr_adaptive;
+	uint8_t intr_level;
+	/* Event index negotiated, set on all queues */
+	uint8_t event_idx;
+	uint32_t intr_win_pkts;
+	uint64_t intr_max_tsc;
+	uint64_t intr_tsc;
+	uint64_t intr_win_tsc;
+	/* Descriptor fetch throttle window */
+	uint16_t desc_throttle;
+	uint16_t thr_last_off;
+	uint64_t thr_tsc;
+	uint64_t thr_stall_tsc;
+	struct dao_virtio_netdev_queue_stats svc_stats;
 
 	RTE_CACHE_GUARD;
 
 	uint16_t last_off __rte_cache_aligned;
 	uint16_t sd_desc_off;
+	uint16_t sd_ind_off;
 	uint16_t sd_mbuf_off;
 	uint32_t *cb_notify_addr;
 	uint64_t *cb_intr_addr;
 
-	/* Mempool to use for DMA inbound */
+	/* Mempool to use for DMA inbound, library extbuf pool if any in extbuf mode */
 	struct rte_mempool *mp;
 	/* TODO avoid indirection */
 	union {
@@ -52,10 +120,89 @@ struct virtio_net_queue {
 	};
 	uintptr_t driver_area;
 	uintptr_t sd_driver_area;
+	/* Split virtqueue used ring and shadow avail/used ring space */
+	uintptr_t device_area;
+	uint16_t *sd_avail;
+	uint64_t *sd_used;
+	uint16_t *sd_used_idx;
+	/* Shadow indirect descriptor tables, one slot per ring position */
+	uint64_t *sd_ind_base;
 	/* Shadow Ring space */
 	uint64_t sd_desc_base[] __rte_cache_aligned;
 } __rte_cache_aligned;
 
+/* Longest RSS input tuple, IPv6 addresses and L4 ports */
+#define VIRTIO_NET_RSS_TUPLE_MAX 36
+
+/* Software RSS state programmed by guest over control queue */
+struct virtio_net_rss {
+	/* Toeplitz hash of each byte value at each tuple byte position */
+	uint32_t tbl[VIRTIO_NET_RSS_TUPLE_MAX][256];
+	uint32_t crc_init;
+	uint32_t hash_types;
+	/* enum dao_virtio_netdev_rss_algo */
+	uint8_t algo;
+};
+
+/* Packet capture of a device, workers copy packets to ring drained to pcapng file */
+struct virtio_net_capture {
+	struct rte_ring *ring;
+	struct rte_mempool *mp;
+	struct rte_pcapng *pcapng;
+	dao_virtio_netdev_capture_filter_t filter;
+	uint32_t sample_rate;
+	uint32_t snaplen;
+	uint16_t qid;
+	uint8_t enabled;
+	/* Workers in capture, waited on by stop */
+	uint32_t busy;
+	uint64_t drops;
+};
+
+/* Packets copied or written in one go */
+#define VIRTIO_NET_CAPTURE_BURST 32
+
+/* Copies of a burst held by a worker till it knows which packets were sent */
+struct virtio_net_capture_stage {
+	struct virtio_net_capture *cap;
+	struct rte_mbuf *pkts[VIRTIO_NET_CAPTURE_BURST];
+	/* Index of the packet of each copy in the burst */
+	uint16_t idx[VIRTIO_NET_CAPTURE_BURST];
+	uint16_t nb;
+};
+
+/* Token bucket refilled with per_period tokens every period TSC cycles */
+struct virtio_net_tb {
+	uint64_t period;
+	uint64_t per_period;
+	uint64_t tsc;
+	int64_t size;
+	int64_t tokens;
+};
+
+/* Rate limits of a queue or of a device direction. Buckets are updated by queue worker, or
+ * by workers of the direction under lock, which pick up config when control moves conf_gen.
+ */
+struct virtio_net_shaper {
+	struct virtio_net_tb pkts;
+	struct virtio_net_tb bytes;
+	uint16_t burst_max;
+	uint32_t gen;
+	/* Device shaper of queue direction when enabled */
+	struct virtio_net_shaper *dev;
+	rte_spinlock_t lock;
+	/* Written by control under lock */
+	uint32_t conf_gen;
+	uint8_t en;
+	struct dao_virtio_netdev_shaper_conf conf;
+} __rte_cache_aligned;
+
+struct virtio_net_shapers {
+	/* Indexed by direction, host Tx queues being odd */
+	struct virtio_net_shaper dev[2];
+	struct virtio_net_shaper qs[DAO_VIRTIO_MAX_QUEUES];
+};
+
 struct virtio_netdev {
 	struct virtio_dev dev;
 	uint16_t vq_pairs_set; /* CTRL_MQ_VQ_PAIRS_SET */
@@ -67,11 +214,20 @@ struct virtio_netdev {
 		/** Valid when DOS_VIRTIO_NETDEV_EXTBUF is set */
 		uint16_t dataroom_size;
 	};
+	/* Library extbuf pool, valid with DAO_VIRTIO_NETDEV_EXTBUF_POOL */
+	struct rte_mempool *extbuf_pool;
 	bool auto_free_en;
 	uint16_t reta_size;
 	uint16_t hash_key_size;
+	/* Host Rx queue interrupt coalescing config */
+	struct dao_virtio_netdev_intr_coalesce intr_conf;
+	uint16_t desc_throttle;
 #define DAO_HASH_REPORT_INDEX_MAX 256
 	uint8_t *hash_report;
+	struct virtio_net_rss *rss;
+	struct virtio_net_capture cap;
+	/* Allocated when a shaper is first set */
+	struct virtio_net_shapers *shapers;
 
 	/* Fast path data */
 	struct virtio_net_queue *qs[DAO_VIRTIO_MAX_QUEUES] __rte_cache_aligned;
@@ -85,6 +241,28 @@ void virtio_net_flush_enq_ext(struct virtio_net_queue *q);
 void virtio_net_flush_deq_ext(struct virtio_net_queue *q);
 void virtio_net_desc_validate(struct virtio_net_queue *q, uint16_t start, uint16_t count,
 			      bool avail, bool used);
+void virtio_net_rss_config(struct virtio_net_rss *rss, struct virtio_net_ctrl_rss *ctrl);
+uint32_t virtio_net_rss_hash(struct virtio_net_rss *rss, struct rte_mbuf *m);
+void virtio_net_capture(struct virtio_net_queue *q, struct rte_mbuf **mbufs, uint16_t nb_mbufs,
+			bool host_tx);
+void virtio_net_capture_stage(struct virtio_net_queue *q, struct rte_mbuf **mbufs,
+			      uint16_t nb_mbufs, bool host_tx, struct virtio_net_capture_stage *st);
+void virtio_net_capture_commit(struct virtio_net_capture_stage *st, uint16_t nb_sent);
+void virtio_net_capture_queue_setup(struct virtio_netdev *netdev, struct virtio_net_queue *q);
+uint16_t virtio_net_shaper_admit(struct virtio_net_shaper *sh, uint16_t nb_mbufs);
+void virtio_net_shaper_consume(struct virtio_net_shaper *sh, struct rte_mbuf **mbufs,
+			       uint16_t nb_mbufs, int sign);
+void virtio_net_shaper_queue_setup(struct virtio_netdev *netdev, struct virtio_net_queue *q);
+
+static __rte_always_inline int
+virtio_net_has_stats_feature(void)
+{
+#if DAO_VIRTIO_STATS
+	return 1;
+#else
+	return 0;
+#endif
+}
 
 #ifdef DAO_VIRTIO_DEBUG
 #define VIRTIO_NET_DESC_CHECK(q, start, count, avail, used)                                        \
@@ -119,7 +297,8 @@ virtio_netdev_to_dao(struct virtio_netdev *netdev)
 #define VIRTIO_NET_DEQ_OFFLOAD_CHECKSUM RTE_BIT64(0)
 #define VIRTIO_NET_DEQ_OFFLOAD_NOINOR   RTE_BIT64(1)
 #define VIRTIO_NET_DEQ_OFFLOAD_GSO      RTE_BIT64(2)
-#define VIRTIO_NET_DEQ_OFFLOAD_LAST     RTE_BIT64(2)
+#define VIRTIO_NET_DEQ_OFFLOAD_SPLIT    RTE_BIT64(3)
+#define VIRTIO_NET_DEQ_OFFLOAD_LAST     RTE_BIT64(3)
 
 /* Flags to control dequeue function.
  * Defining it from backwards to denote its been
@@ -130,6 +309,7 @@ virtio_netdev_to_dao(struct virtio_netdev *netdev)
 #define D_CSUM_F    VIRTIO_NET_DEQ_OFFLOAD_CHECKSUM
 #define D_NOORDER_F VIRTIO_NET_DEQ_OFFLOAD_NOINOR
 #define D_GSO_F     VIRTIO_NET_DEQ_OFFLOAD_GSO
+#define D_SPLIT_F   VIRTIO_NET_DEQ_OFFLOAD_SPLIT
 
 #define VIRTIO_NET_DEQ_FASTPATH_MODES                                                              \
 	R(no_offload, VIRTIO_NET_DEQ_OFFLOAD_NONE)                                                 \
@@ -139,7 +319,15 @@ virtio_netdev_to_dao(struct virtio_netdev *netdev)
 	R(noinorder_csum, D_NOORDER_F | D_CSUM_F)                                                  \
 	R(cksum_gso, D_CSUM_F | D_GSO_F)                                                           \
 	R(noinorder_gso, D_NOORDER_F | D_GSO_F)                                                    \
-	R(noinorder_csum_gso, D_NOORDER_F | D_CSUM_F | D_GSO_F)
+	R(noinorder_csum_gso, D_NOORDER_F | D_CSUM_F | D_GSO_F)                                    \
+	R(split, D_SPLIT_F)                                                                        \
+	R(split_cksum, D_SPLIT_F | D_CSUM_F)                                                       \
+	R(split_noinorder, D_SPLIT_F | D_NOORDER_F)                                                \
+	R(split_gso, D_SPLIT_F | D_GSO_F)                                                          \
+	R(split_noinorder_csum, D_SPLIT_F | D_NOORDER_F | D_CSUM_F)                                \
+	R(split_cksum_gso, D_SPLIT_F | D_CSUM_F | D_GSO_F)                                         \
+	R(split_noinorder_gso, D_SPLIT_F | D_NOORDER_F | D_GSO_F)                                  \
+	R(split_noinorder_csum_gso, D_SPLIT_F | D_NOORDER_F | D_CSUM_F | D_GSO_F)
 
 #define R(name, flags)                                                                             \
 	uint16_t virtio_net_deq_##name(void *q, struct rte_mbuf **pkts, uint16_t nb_pkts);         \
@@ -156,7 +344,8 @@ VIRTIO_NET_DEQ_FASTPATH_MODES
 #define VIRTIO_NET_ENQ_OFFLOAD_CHECKSUM RTE_BIT64(1)
 #define VIRTIO_NET_ENQ_OFFLOAD_MSEG     RTE_BIT64(2)
 #define VIRTIO_NET_ENQ_OFFLOAD_HASH_REPORT RTE_BIT64(3)
-#define VIRTIO_NET_ENQ_OFFLOAD_LAST     RTE_BIT64(3)
+#define VIRTIO_NET_ENQ_OFFLOAD_GRO      RTE_BIT64(4)
+#define VIRTIO_NET_ENQ_OFFLOAD_LAST     RTE_BIT64(4)
 
 /* Flags to control enqueue function.
  * Defining it from backwards to denote its been
@@ -168,6 +357,14 @@ VIRTIO_NET_DEQ_FASTPATH_MODES
 #define CSUM_F VIRTIO_NET_ENQ_OFFLOAD_CHECKSUM
 #define MSEG_F VIRTIO_NET_ENQ_OFFLOAD_MSEG
 #define HRP_F VIRTIO_NET_ENQ_OFFLOAD_HASH_REPORT
+#define GRO_F VIRTIO_NET_ENQ_OFFLOAD_GRO
+
+/* Max packets coalesced to a single packet on enqueue */
+#define VIRTIO_NET_GRO_MAX_PKTS 8
+
+/* Address families coalesced on enqueue, by guest TSO features negotiated */
+#define VIRTIO_NET_GRO_F_IPV4 RTE_BIT32(0)
+#define VIRTIO_NET_GRO_F_IPV6 RTE_BIT32(1)
 
 #define VIRTIO_NET_ENQ_FASTPATH_MODES                                                              \
 	T(no_offload, VIRTIO_NET_ENQ_OFFLOAD_NONE)                                                 \
@@ -185,7 +382,15 @@ VIRTIO_NET_DEQ_FASTPATH_MODES
 	T(no_ff_cksum_hash_report, NOFF_F | CSUM_F | HRP_F)                                        \
 	T(no_ff_mseg_hash_report, NOFF_F | MSEG_F | HRP_F)                                         \
 	T(cksum_mseg_hash_report, CSUM_F | MSEG_F | HRP_F)                                         \
-	T(no_ff_cksum_mseg_hash_report, NOFF_F | CSUM_F | MSEG_F | HRP_F)
+	T(no_ff_cksum_mseg_hash_report, NOFF_F | CSUM_F | MSEG_F | HRP_F)                          \
+	T(mseg_gro, MSEG_F | GRO_F)                                                                \
+	T(no_ff_mseg_gro, NOFF_F | MSEG_F | GRO_F)                                                 \
+	T(cksum_mseg_gro, CSUM_F | MSEG_F | GRO_F)                                                 \
+	T(mseg_hash_report_gro, MSEG_F | HRP_F | GRO_F)                                            \
+	T(no_ff_cksum_mseg_gro, NOFF_F | CSUM_F | MSEG_F | GRO_F)                                  \
+	T(no_ff_mseg_hash_report_gro, NOFF_F | MSEG_F | HRP_F | GRO_F)                             \
+	T(cksum_mseg_hash_report_gro, CSUM_F | MSEG_F | HRP_F | GRO_F)                             \
+	T(no_ff_cksum_mseg_hash_report_gro, NOFF_F | CSUM_F | MSEG_F | HRP_F | GRO_F)
 
 #define T(name, flags)                                                                             \
 	uint16_t virtio_net_enq_##name(void *q, struct rte_mbuf **pkts, uint16_t nb_pkts);         \
@@ -201,11 +406,13 @@ VIRTIO_NET_ENQ_FASTPATH_MODES
 #define VIRTIO_NET_DESC_MANAGE_NOINORDER RTE_BIT64(0)
 #define VIRTIO_NET_DESC_MANAGE_MSEG      RTE_BIT64(1)
 #define VIRTIO_NET_DESC_MANAGE_EXTBUF    RTE_BIT64(2)
-#define VIRTIO_NET_DESC_MANAGE_LAST      RTE_BIT64(2)
+#define VIRTIO_NET_DESC_MANAGE_SPLIT     RTE_BIT64(3)
+#define VIRTIO_NET_DESC_MANAGE_LAST      RTE_BIT64(3)
 
 #define M_NOORDER_F VIRTIO_NET_DESC_MANAGE_NOINORDER
 #define M_MSEG_F    VIRTIO_NET_DESC_MANAGE_MSEG
 #define M_EBUF_F    VIRTIO_NET_DESC_MANAGE_EXTBUF
+#define M_SPLIT_F   VIRTIO_NET_DESC_MANAGE_SPLIT
 
 #define VIRTIO_NET_DESC_MANAGE_MODES                                                               \
 	M(def, VIRTIO_NET_DESC_MANAGE_DEF)                                                         \
@@ -215,44 +422,81 @@ VIRTIO_NET_ENQ_FASTPATH_MODES
 	M(noinorder_mseg, M_MSEG_F | M_NOORDER_F)                                                  \
 	M(noinorder_extbuf, M_NOORDER_F | M_EBUF_F)                                                \
 	M(mseg_extbuf, M_MSEG_F | M_EBUF_F)                                                        \
-	M(noinorder_mseg_extbuf, M_MSEG_F | M_NOORDER_F | M_EBUF_F)
-
-#define M(name, flags) int virtio_net_desc_manage_##name(uint16_t devid, uint16_t qp_count);
+	M(noinorder_mseg_extbuf, M_MSEG_F | M_NOORDER_F | M_EBUF_F)                                \
+	M(split, M_SPLIT_F)                                                                        \
+	M(noinorder_split, M_NOORDER_F | M_SPLIT_F)                                                \
+	M(mseg_split, M_MSEG_F | M_SPLIT_F)                                                        \
+	M(extbuf_split, M_EBUF_F | M_SPLIT_F)                                                      \
+	M(noinorder_mseg_split, M_MSEG_F | M_NOORDER_F | M_SPLIT_F)                                \
+	M(noinorder_extbuf_split, M_NOORDER_F | M_EBUF_F | M_SPLIT_F)                              \
+	M(mseg_extbuf_split, M_MSEG_F | M_EBUF_F | M_SPLIT_F)                                      \
+	M(noinorder_mseg_extbuf_split, M_MSEG_F | M_NOORDER_F | M_EBUF_F | M_SPLIT_F)
+
+#define M(name, flags)                                                                             \
+	int virtio_net_desc_manage_##name(uint16_t devid, uint16_t qp_start, uint16_t nb_qps);
 
 VIRTIO_NET_DESC_MANAGE_MODES
 #undef M
 
+/* Library extbuf pool is served inline from lcore cache, else user callbacks are called */
+static __rte_always_inline int
+virtio_net_extbuf_get(struct virtio_net_queue *q, void **extbuf, uint16_t cnt)
+{
+	if (q->mp)
+		return rte_mempool_get_bulk(q->mp, extbuf, cnt);
+	return user_cbs.extbuf_get(q->netdev_id, extbuf, cnt);
+}
+
+static __rte_always_inline void
+virtio_net_extbuf_put(struct virtio_net_queue *q, void **extbuf, uint16_t cnt)
+{
+	if (q->mp)
+		rte_mempool_put_bulk(q->mp, extbuf, cnt);
+	else
+		user_cbs.extbuf_put(q->netdev_id, extbuf, cnt);
+}
+
+/* Hash in software only packets that come without a NIC hash */
+static __rte_always_inline void
+virtio_net_rss_sw_hash(struct virtio_net_rss *rss, struct rte_mbuf **mbufs, uint16_t nb_mbufs)
+{
+	uint16_t i;
+
+	for (i = 0; i < nb_mbufs; i++) {
+		if (unlikely(!(mbufs[i]->ol_flags & RTE_MBUF_F_RX_RSS_HASH)))
+			virtio_net_rss_hash(rss, mbufs[i]);
+	}
+}
+
 static __rte_always_inline void
 free_extbufs(struct virtio_net_queue *q, uint16_t off, uint16_t q_sz, uint16_t num, uint16_t flags)
 {
-	uint8_t netdev_id = q->netdev_id;
 	void **extbuf = q->extbuf_arr;
 	uint16_t cnt;
 
 	RTE_SET_USED(flags);
 
 	cnt = (off + num) > q_sz ? q_sz - off : num;
-	user_cbs.extbuf_put(netdev_id, extbuf + off, cnt);
+	virtio_net_extbuf_put(q, extbuf + off, cnt);
 	off = (off + cnt) & (q_sz - 1);
 	cnt = num - cnt;
 	if (cnt)
-		user_cbs.extbuf_put(netdev_id, extbuf + off, cnt);
+		virtio_net_extbuf_put(q, extbuf + off, cnt);
 }
 
 static __rte_always_inline uint16_t
 alloc_extbufs(struct virtio_net_queue *q, uint16_t off, uint16_t q_sz, uint16_t num)
 {
-	uint8_t netdev_id = q->netdev_id;
 	void **extbuf = q->extbuf_arr;
 	uint16_t cnt;
 
 	cnt = (off + num) > q_sz ? q_sz - off : num;
-	if (user_cbs.extbuf_get(netdev_id, extbuf + off, cnt) < 0)
+	if (virtio_net_extbuf_get(q, extbuf + off, cnt) < 0)
 		return 0;
 
 	off = (off + cnt) & (q_sz - 1);
 	cnt = num - cnt;
-	if (cnt && user_cbs.extbuf_get(netdev_id, extbuf + off, cnt) < 0)
+	if (cnt && virtio_net_extbuf_get(q, extbuf + off, cnt) < 0)
 		num -= cnt;
 
 	return num;
@@ -336,6 +580,36 @@ free_mbufs(struct rte_mbuf **mbuf_arr, uint16_t off, uint16_t q_sz, uint16_t nb_
 		rte_mempool_put_bulk(mp, (void **)&mbuf_arr[off], cnt);
 }
 
+/* Throttle descriptor fetch to window ahead of worker. Next batch is fetched only once worker
+ * has consumed half of the window. Window is let go when worker makes no progress for a while
+ * as it could be waiting for descriptors beyond the window, for the rest of a descriptor
+ * chain or for mergeable buffers of a large packet.
+ */
+static __rte_always_inline int
+virtio_net_desc_fetch_throttle(struct virtio_net_queue *q, uint16_t sd_desc_off, int nb_desc)
+{
+	uint16_t window = q->desc_throttle;
+	uint16_t last_off;
+	uint64_t now;
+	int occ;
+
+	if (likely(!window))
+		return nb_desc;
+
+	last_off = __atomic_load_n(&q->last_off, __ATOMIC_RELAXED);
+	occ = desc_off_diff(sd_desc_off, last_off, q->q_sz) + q->pend_sd_desc;
+	if (occ <= window / 2)
+		return RTE_MIN(nb_desc, window - occ);
+
+	now = rte_rdtsc();
+	if (last_off != q->thr_last_off) {
+		q->thr_last_off = last_off;
+		q->thr_tsc = now;
+		return 0;
+	}
+	return (now - q->thr_tsc) < q->thr_stall_tsc ? 0 : nb_desc;
+}
+
 static __rte_always_inline uint16_t
 fetch_deq_desc_prep(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
 		    struct rte_dma_sge *src, struct rte_dma_sge *dst, const uint16_t flags)
@@ -348,7 +622,7 @@ fetch_deq_desc_prep(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2
 	uint32_t notify_data;
 	uint16_t next_off, off;
 	int i, j = 0;
-	int nb_desc;
+	int nb_desc, alloc;
 	int desc_count = 0;
 	uint16_t sd_desc_val = 0;
 
@@ -363,6 +637,7 @@ fetch_deq_desc_prep(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2
 
 	/* Limit the fetch to end of the queue */
 	nb_desc = desc_off_diff(next_off, sd_desc_off, q_sz) - pend_sd_desc;
+	nb_desc = virtio_net_desc_fetch_throttle(q, sd_desc_off, nb_desc);
 	if (unlikely(!nb_desc))
 		return 0;
 
@@ -372,10 +647,13 @@ fetch_deq_desc_prep(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2
 	mbuf_arr = q->mbuf_arr;
 
 	if (flags & VIRTIO_NET_DESC_MANAGE_EXTBUF)
-		nb_desc = alloc_extbufs(q, off, q_sz, nb_desc);
+		alloc = alloc_extbufs(q, off, q_sz, nb_desc);
 	else
-		nb_desc = alloc_mbufs(mbuf_arr, q->mp, off, q_sz, nb_desc);
+		alloc = alloc_mbufs(mbuf_arr, q->mp, off, q_sz, nb_desc);
 
+	if (virtio_net_has_stats_feature() && unlikely(alloc < nb_desc))
+		q->svc_stats.alloc_fails++;
+	nb_desc = alloc;
 	if (unlikely(!nb_desc))
 		return 0;
 
@@ -402,6 +680,8 @@ fetch_deq_desc_prep(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2
 	q->pend_sd_desc += desc_count;
 	dao_dma_update_cmpl_meta(dev2mem, &q->sd_desc_off, sd_desc_val, &q->pend_sd_desc,
 				 desc_count, dev2mem->tail);
+	if (virtio_net_has_stats_feature())
+		q->svc_stats.desc_fetched += desc_count;
 	return j;
 }
 
@@ -431,6 +711,7 @@ fetch_enq_desc_prep(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2
 
 	/* Limit the fetch to end of the queue */
 	nb_desc = desc_off_diff(next_off, sd_desc_off, q_sz) - q->pend_sd_desc;
+	nb_desc = virtio_net_desc_fetch_throttle(q, sd_desc_off, nb_desc);
 	if (unlikely(!nb_desc))
 		return 0;
 
@@ -460,9 +741,519 @@ fetch_enq_desc_prep(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2
 	q->pend_sd_desc += desc_count;
 	dao_dma_update_cmpl_meta(dev2mem, &q->sd_desc_off, sd_desc_val, &q->pend_sd_desc,
 				 desc_count, dev2mem->tail);
+	if (virtio_net_has_stats_feature())
+		q->svc_stats.desc_fetched += desc_count;
+	return j;
+}
+
+static __rte_always_inline uint16_t
+fetch_split_avail_prep(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
+		       struct rte_dma_sge *src, struct rte_dma_sge *dst)
+{
+	uint16_t sd_avail_off, pend_sd_avail;
+	uint16_t next_off, off, avail_idx;
+	uintptr_t avail_ring;
+	uint16_t q_sz = q->q_sz;
+	uint32_t notify_data;
+	int avail_count = 0;
+	int nb_avail;
+	int i, j = 0;
+
+	pend_sd_avail = q->pend_sd_avail;
+	sd_avail_off = q->sd_avail_off;
+
+	/* Notify data carries free running avail index for split virtqueue. With event index,
+	 * avail index read back after avail_event update can be ahead of the last kick.
+	 */
+	notify_data = __atomic_load_n(q->notify_addr, __ATOMIC_RELAXED);
+	avail_idx = notify_data >> 16;
+	if (q->event_idx && (int16_t)(q->sd_avail_idx - avail_idx) > 0)
+		avail_idx = q->sd_avail_idx;
+	q->avail_idx = avail_idx;
+	next_off = split_idx_to_desc_off(avail_idx, q_sz);
+	if (unlikely(next_off == sd_avail_off))
+		return 0;
+
+	nb_avail = desc_off_diff(next_off, sd_avail_off, q_sz) - pend_sd_avail;
+	if (unlikely(nb_avail <= 0))
+		return 0;
+
+	/* Start DMA of avail ring entries, at most two pointers on ring wrap */
+	avail_ring = q->driver_area + offsetof(struct vring_avail, ring);
+	off = DESC_OFF(desc_off_add(sd_avail_off, pend_sd_avail, q_sz));
+	do {
+		i = (off + nb_avail) > q_sz ? (q_sz - off) : nb_avail;
+		src[j].addr = (rte_iova_t)(avail_ring + off * sizeof(uint16_t));
+		dst[j].addr = (rte_iova_t)&q->sd_avail[off];
+		src[j].length = i * sizeof(uint16_t);
+		dst[j].length = i * sizeof(uint16_t);
+
+		avail_count += i;
+		off = (off + i) & (q_sz - 1);
+		nb_avail -= i;
+		j++;
+	} while (nb_avail);
+
+	q->pend_sd_avail += avail_count;
+	dao_dma_update_cmpl_meta(dev2mem, &q->sd_avail_off,
+				 desc_off_add(sd_avail_off, q->pend_sd_avail, q_sz),
+				 &q->pend_sd_avail, avail_count, dev2mem->tail);
+	return j;
+}
+
+/* Keep avail_event of split virtqueue at avail index seen by device so that driver kicks
+ * for next buffers. Avail index is read back once avail_event lands to catch buffers made
+ * available before driver could see it, their kick is suppressed.
+ */
+static __rte_always_inline void
+virtio_net_avail_event_update(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
+			      struct dao_dma_vchan_state *mem2dev)
+{
+	uintptr_t used_ring = q->device_area + offsetof(struct vring_used, ring);
+	uintptr_t avail_idx = q->driver_area + offsetof(struct vring_avail, idx);
+
+	if (q->pend_avail_event)
+		return;
+
+	if (q->avail_event_chk) {
+		if (!dao_dma_flush(dev2mem, 1))
+			return;
+		dao_dma_enq_x1(dev2mem, (rte_iova_t)avail_idx, sizeof(uint16_t),
+			       (rte_iova_t)&q->sd_avail_idx, sizeof(uint16_t));
+		q->pend_avail_event = 1;
+		dao_dma_update_cmpl_meta(dev2mem, &q->avail_event_chk, 0, &q->pend_avail_event, 1,
+					 dev2mem->tail);
+		return;
+	}
+
+	if (q->avail_event == q->avail_idx || !dao_dma_flush(mem2dev, 1))
+		return;
+
+	q->avail_event = q->avail_idx;
+	dao_dma_enq_x1(mem2dev, (rte_iova_t)&q->avail_event, sizeof(uint16_t),
+		       (rte_iova_t)(used_ring + q->q_sz * sizeof(struct vring_used_elem)),
+		       sizeof(uint16_t));
+	q->pend_avail_event = 1;
+	dao_dma_update_cmpl_meta(mem2dev, &q->avail_event_chk, 1, &q->pend_avail_event, 1,
+				 mem2dev->tail);
+}
+
+static __rte_always_inline uint16_t
+fetch_split_desc_prep(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
+		      struct rte_dma_sge *src, struct rte_dma_sge *dst, uint16_t max_sg,
+		      const bool deq, const uint16_t flags)
+{
+	uintptr_t sd_desc_base = (uintptr_t)q->sd_desc_base;
+	uint16_t sd_desc_off, pend_sd_desc, sd_avail_off;
+	uintptr_t desc_base = q->desc_base;
+	uint16_t *sd_avail = q->sd_avail;
+	uint16_t q_sz = q->q_sz;
+	uint16_t off, head, run;
+	int nb_desc, desc_count = 0;
+	int alloc, j = 0, k;
+
+	pend_sd_desc = q->pend_sd_desc;
+	sd_desc_off = q->sd_desc_off;
+	sd_avail_off = q->sd_avail_off;
+
+	/* Gather descriptors only for avail ring entries already in shadow */
+	off = desc_off_add(sd_desc_off, pend_sd_desc, q_sz);
+	nb_desc = desc_off_diff(sd_avail_off, off, q_sz);
+	nb_desc = virtio_net_desc_fetch_throttle(q, sd_desc_off, nb_desc);
+	if (unlikely(!nb_desc))
+		return 0;
+
+	/* Head descriptors are fetched to the slot of their avail ring entry. Heads that
+	 * are consecutive in descriptor table, which is the case when driver posts
+	 * buffers in order, are coalesced into single pointer.
+	 */
+	off = DESC_OFF(off);
+	while (desc_count < nb_desc && j < max_sg) {
+		head = sd_avail[off] & (q_sz - 1);
+		run = 1;
+		while (desc_count + run < nb_desc && off + run < q_sz && head + run < q_sz &&
+		       sd_avail[off + run] == head + run)
+			run++;
+
+		src[j].addr = (rte_iova_t)DESC_PTR_OFF(desc_base, head, 0);
+		dst[j].addr = (rte_iova_t)DESC_PTR_OFF(sd_desc_base, off, 0);
+		src[j].length = run << 4;
+		dst[j].length = run << 4;
+
+		desc_count += run;
+		off = (off + run) & (q_sz - 1);
+		j++;
+	}
+
+	if (deq) {
+		/* Allocate buffers only for the descriptors being gathered */
+		off = DESC_OFF(desc_off_add(sd_desc_off, pend_sd_desc, q_sz));
+		if (flags & VIRTIO_NET_DESC_MANAGE_EXTBUF)
+			alloc = alloc_extbufs(q, off, q_sz, desc_count);
+		else
+			alloc = alloc_mbufs(q->mbuf_arr, q->mp, off, q_sz, desc_count);
+		if (unlikely(!alloc))
+			return 0;
+
+		/* Trim pointers to allocated count */
+		if (unlikely(alloc < desc_count)) {
+			if (virtio_net_has_stats_feature())
+				q->svc_stats.alloc_fails++;
+			for (k = 0, desc_count = 0;
+			     desc_count + (int)(src[k].length >> 4) < alloc; k++)
+				desc_count += src[k].length >> 4;
+			src[k].length = (alloc - desc_count) << 4;
+			dst[k].length = src[k].length;
+			desc_count = alloc;
+			j = k + 1;
+		}
+	}
+
+	q->pend_sd_desc += desc_count;
+	dao_dma_update_cmpl_meta(dev2mem, &q->sd_desc_off,
+				 desc_off_add(sd_desc_off, q->pend_sd_desc, q_sz), &q->pend_sd_desc,
+				 desc_count, dev2mem->tail);
+	if (virtio_net_has_stats_feature())
+		q->svc_stats.desc_fetched += desc_count;
+	return j;
+}
+
+/* Split virtqueue fetch is done in two stages, avail ring entries are fetched first
+ * and head descriptors are gathered from descriptor table once those land in shadow.
+ */
+static __rte_always_inline bool
+fetch_split_desc(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem, const bool deq,
+		 const uint16_t flags)
+{
+	struct rte_dma_sge *src, *dst;
+	uint16_t sg_i, max_sg;
+
+	if (!dao_dma_flush(dev2mem, DAO_DMA_MAX_POINTER))
+		return false;
+
+	/* Limit gather pointers to what is left till flush threshold */
+	max_sg = RTE_MAX((int)dev2mem->flush_thr - (int)dev2mem->src_i, 1);
+	src = dao_dma_sge_src(dev2mem);
+	dst = dao_dma_sge_dst(dev2mem);
+	sg_i = fetch_split_desc_prep(q, dev2mem, src, dst, max_sg, deq, flags);
+	dev2mem->src_i += sg_i;
+	dev2mem->dst_i += sg_i;
+
+	if (!dao_dma_flush(dev2mem, 2))
+		return false;
+
+	src = dao_dma_sge_src(dev2mem);
+	dst = dao_dma_sge_dst(dev2mem);
+	sg_i = fetch_split_avail_prep(q, dev2mem, src, dst);
+	dev2mem->src_i += sg_i;
+	dev2mem->dst_i += sg_i;
+	return true;
+}
+
+static __rte_always_inline uint64_t *
+virtio_net_ind_ptr(struct virtio_net_queue *q, uint16_t off)
+{
+	return (uint64_t *)((uintptr_t)q->sd_ind_base +
+			    DESC_OFF(off) * VIRTIO_NET_IND_DESC_MAX * DESC_ENTRY_SZ);
+}
+
+/* Table slot of a split descriptor chain entry. Entries past the table are walked through
+ * its last slot only to find the end of the chain, such packets are dropped.
+ */
+static __rte_always_inline uint16_t
+virtio_net_chain_slot(uint32_t cnt)
+{
+	return RTE_MIN(cnt, VIRTIO_NET_IND_DESC_MAX - 1);
+}
+
+/* Chain entries fetched following the last one walked, as many as would be contiguous in
+ * descriptor table which they are when driver uses descriptors in order.
+ */
+static __rte_always_inline uint32_t
+virtio_net_chain_span(struct virtio_net_queue *q, uint64_t *tbl, uint32_t cnt, uint16_t *next)
+{
+	uint64_t d = tbl[virtio_net_chain_slot(cnt - 1) * 2 + 1];
+
+	*next = (d >> 48) & (q->q_sz - 1);
+	return RTE_MIN(VIRTIO_NET_IND_DESC_MAX - virtio_net_chain_slot(cnt),
+		       (uint32_t)(q->q_sz - *next));
+}
+
+static __rte_always_inline void
+fetch_chain_prep(struct virtio_net_queue *q, uint64_t *tbl, uint32_t cnt, struct rte_dma_sge *src,
+		 struct rte_dma_sge *dst)
+{
+	uint16_t next;
+	uint32_t nb;
+
+	nb = virtio_net_chain_span(q, tbl, cnt, &next);
+	src->addr = (rte_iova_t)DESC_PTR_OFF(q->desc_base, next, 0);
+	dst->addr = (rte_iova_t)&tbl[virtio_net_chain_slot(cnt) * 2];
+	src->length = nb * DESC_ENTRY_SZ;
+	dst->length = nb * DESC_ENTRY_SZ;
+}
+
+/* Take chain entries landed in table, first one always and each next one as long as the
+ * previous one links to it. Returns count of entries walked.
+ */
+static __rte_always_inline uint32_t
+fetch_chain_accept(struct virtio_net_queue *q, uint64_t *tbl, uint32_t cnt)
+{
+	uint16_t slot = virtio_net_chain_slot(cnt);
+	uint16_t next;
+	uint32_t nb, i;
+	uint64_t d;
+
+	nb = virtio_net_chain_span(q, tbl, cnt, &next);
+	for (i = 1; i < nb; i++) {
+		d = tbl[(slot + i - 1) * 2 + 1];
+		if (!((d >> 32) & VRING_DESC_F_NEXT) || (uint16_t)(d >> 48) != next + i)
+			break;
+	}
+	return cnt + i;
+}
+
+/* Walk a round of split descriptor chains of the batch in [sd_ind_off, ind_batch_off).
+ * Entries landed are taken into table of their head and next ones are fetched for chains
+ * not ended yet. Walked head points to its table with VRING_DESC_F_INDIRECT and length of
+ * entries walked, so that dequeue takes it as an indirect table.
+ */
+static __rte_always_inline uint16_t
+fetch_chain_walk(struct virtio_net_queue *q, struct rte_dma_sge *src, struct rte_dma_sge *dst,
+		 uint16_t max_sg)
+{
+	uintptr_t sd_desc_base = (uintptr_t)q->sd_desc_base;
+	uint16_t q_sz = q->q_sz;
+	uint64_t d, *tbl;
+	uint16_t off, i, nb_desc;
+	uint32_t cnt;
+	int j = 0;
+
+	nb_desc = desc_off_diff(q->ind_batch_off, q->sd_ind_off, q_sz);
+	off = DESC_OFF(q->sd_ind_off);
+	for (i = 0; i < nb_desc && j < max_sg; i++, off = (off + 1) & (q_sz - 1)) {
+		d = *DESC_PTR_OFF(sd_desc_base, off, 8);
+		if (!((d >> 32) & VIRTIO_NET_DESC_F_CHAIN) || ((d >> 32) & VIRTIO_NET_DESC_F_DROP))
+			continue;
+
+		tbl = virtio_net_ind_ptr(q, off);
+		cnt = (d & (RTE_BIT64(32) - 1)) / DESC_ENTRY_SZ;
+		if ((d >> 32) & VIRTIO_NET_DESC_F_CHAIN_PEND) {
+			cnt = fetch_chain_accept(q, tbl, cnt);
+			d &= ~((uint64_t)VIRTIO_NET_DESC_F_CHAIN_PEND << 32);
+		}
+
+		if ((tbl[virtio_net_chain_slot(cnt - 1) * 2 + 1] >> 32) & VRING_DESC_F_NEXT) {
+			if (unlikely(cnt >= q_sz)) {
+				/* Chain longer than the ring loops, stop walking */
+				d |= (uint64_t)VIRTIO_NET_DESC_F_DROP << 32;
+			} else {
+				fetch_chain_prep(q, tbl, cnt, &src[j], &dst[j]);
+				d |= (uint64_t)VIRTIO_NET_DESC_F_CHAIN_PEND << 32;
+				j++;
+			}
+		}
+		d = (d & ~(RTE_BIT64(32) - 1)) | cnt * DESC_ENTRY_SZ;
+		*DESC_PTR_OFF(sd_desc_base, off, 8) = d;
+	}
+	return j;
+}
+
+static __rte_always_inline uint16_t
+fetch_ind_desc_prep(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
+		    struct rte_dma_sge *src, struct rte_dma_sge *dst, uint16_t max_sg,
+		    const uint16_t flags)
+{
+	const uint8_t shift = (flags & VIRTIO_NET_DESC_MANAGE_SPLIT) ? 32 : 48;
+	uintptr_t sd_desc_base = (uintptr_t)q->sd_desc_base;
+	uint16_t sd_ind_off, sd_desc_off, off;
+	uint16_t q_sz = q->q_sz;
+	uint64_t d_flags, *tbl;
+	bool chain = false;
+	int nb_desc, i;
+	uint32_t len;
+	int j = 0;
+
+	/* Wait for previous batch of tables to land */
+	if (q->pend_sd_ind)
+		return 0;
+
+	sd_ind_off = q->sd_ind_off;
+	if (unlikely(q->ind_batch_off != sd_ind_off)) {
+		/* Batch has split descriptor chains being walked, publish it once all end */
+		j = fetch_chain_walk(q, src, dst, max_sg);
+		if (!j) {
+			__atomic_store_n(&q->sd_ind_off, q->ind_batch_off, __ATOMIC_RELEASE);
+			return 0;
+		}
+		q->pend_sd_ind++;
+		dao_dma_update_cmpl_meta(dev2mem, &q->ind_batch_off, q->ind_batch_off,
+					 &q->pend_sd_ind, 1, dev2mem->tail);
+		return j;
+	}
+
+	sd_desc_off = q->sd_desc_off;
+	if (sd_ind_off == sd_desc_off)
+		return 0;
+
+	/* Scan descriptors landed in shadow for indirect tables and split descriptor chains */
+	nb_desc = desc_off_diff(sd_desc_off, sd_ind_off, q_sz);
+	off = DESC_OFF(sd_ind_off);
+	for (i = 0; i < nb_desc; i++) {
+		d_flags = *DESC_PTR_OFF(sd_desc_base, off, 8);
+		if (unlikely((d_flags >> shift) & VRING_DESC_F_INDIRECT)) {
+			if (j == max_sg)
+				break;
+			len = RTE_MIN(d_flags & (RTE_BIT64(32) - 1),
+				      VIRTIO_NET_IND_DESC_MAX * DESC_ENTRY_SZ);
+			src[j].addr = *DESC_PTR_OFF(sd_desc_base, off, 0);
+			dst[j].addr = (rte_iova_t)virtio_net_ind_ptr(q, off);
+			src[j].length = len;
+			dst[j].length = len;
+			j++;
+		} else if (unlikely((flags & VIRTIO_NET_DESC_MANAGE_SPLIT) &&
+				    ((d_flags >> 32) & VRING_DESC_F_NEXT))) {
+			if (j == max_sg)
+				break;
+			/* Head is first entry of its table, fetch the ones it links to */
+			tbl = virtio_net_ind_ptr(q, off);
+			tbl[0] = *DESC_PTR_OFF(sd_desc_base, off, 0);
+			tbl[1] = d_flags;
+			fetch_chain_prep(q, tbl, 1, &src[j], &dst[j]);
+			d_flags &= ~(((uint64_t)VRING_DESC_F_NEXT << 32) | (RTE_BIT64(32) - 1));
+			d_flags |= (uint64_t)(VRING_DESC_F_INDIRECT | VIRTIO_NET_DESC_F_CHAIN |
+					      VIRTIO_NET_DESC_F_CHAIN_PEND)
+				   << 32;
+			*DESC_PTR_OFF(sd_desc_base, off, 8) = d_flags | DESC_ENTRY_SZ;
+			chain = true;
+			j++;
+		}
+		off = (off + 1) & (q_sz - 1);
+	}
+
+	sd_ind_off = desc_off_add(sd_ind_off, i, q_sz);
+	q->ind_batch_off = sd_ind_off;
+	if (!j) {
+		/* Nothing to fetch, descriptors are ready for worker */
+		__atomic_store_n(&q->sd_ind_off, sd_ind_off, __ATOMIC_RELEASE);
+		return 0;
+	}
+
+	/* Batch with chains is published only after walking them, see fetch_chain_walk() */
+	q->pend_sd_ind += i;
+	dao_dma_update_cmpl_meta(dev2mem, chain ? &q->ind_batch_off : &q->sd_ind_off, sd_ind_off,
+				 &q->pend_sd_ind, i, dev2mem->tail);
 	return j;
 }
 
+/* Indirect tables are fetched as a second stage once the descriptors pointing
+ * to them land in shadow, worker picks descriptors only till sd_ind_off.
+ */
+static __rte_always_inline bool
+fetch_ind_desc(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
+	       const uint16_t flags)
+{
+	struct rte_dma_sge *src, *dst;
+	uint16_t sg_i, max_sg;
+
+	if (likely(!q->sd_ind_base))
+		return true;
+
+	if (!dao_dma_flush(dev2mem, DAO_DMA_MAX_POINTER))
+		return false;
+
+	max_sg = RTE_MAX((int)dev2mem->flush_thr - (int)dev2mem->src_i, 1);
+	src = dao_dma_sge_src(dev2mem);
+	dst = dao_dma_sge_dst(dev2mem);
+	sg_i = fetch_ind_desc_prep(q, dev2mem, src, dst, max_sg, flags);
+	dev2mem->src_i += sg_i;
+	dev2mem->dst_i += sg_i;
+	return true;
+}
+
+static __rte_always_inline void
+mark_used_split(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev, uint16_t start,
+		uint16_t nb_desc)
+{
+	uintptr_t used_ring = q->device_area + offsetof(struct vring_used, ring);
+	uint16_t q_sz = q->q_sz;
+	uint16_t pend;
+
+	/* Issue used ring entries DMA, at most two pointers on ring wrap */
+	pend = RTE_MIN(nb_desc, q_sz - start);
+	dao_dma_enq_x1(mem2dev, (rte_iova_t)&q->sd_used[start], pend * sizeof(uint64_t),
+		       (rte_iova_t)(used_ring + start * sizeof(uint64_t)), pend * sizeof(uint64_t));
+	if (nb_desc - pend)
+		dao_dma_enq_x1(mem2dev, (rte_iova_t)&q->sd_used[0],
+			       (nb_desc - pend) * sizeof(uint64_t), (rte_iova_t)used_ring,
+			       (nb_desc - pend) * sizeof(uint64_t));
+}
+
+static __rte_always_inline void
+mark_used_idx_split(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev,
+		    uint16_t nb_desc)
+{
+	uint16_t q_sz = q->q_sz;
+	uint16_t slot;
+
+	/* Each index update has its own shadow slot so that source is not overwritten
+	 * while DMA is in flight. Index is written on the same vchan after the used ring
+	 * entries it publishes, both always by DMA so that they stay ordered.
+	 */
+	q->used_idx += nb_desc;
+	slot = (q->used_idx - 1) & (q_sz - 1);
+	q->sd_used_idx[slot] = q->used_idx;
+	dao_dma_enq_x1(mem2dev, (rte_iova_t)&q->sd_used_idx[slot], sizeof(uint16_t),
+		       (rte_iova_t)(q->device_area + offsetof(struct vring_used, idx)),
+		       sizeof(uint16_t));
+}
+
+static __rte_always_inline void
+mark_deq_compl_split(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev,
+		     uint16_t start, uint16_t nb_desc, const uint16_t flags)
+{
+	uint16_t q_sz = q->q_sz;
+	uint16_t off, slot, i;
+
+	start = DESC_OFF(start);
+	if (flags & VIRTIO_NET_DESC_MANAGE_NOINORDER) {
+		/* Return every buffer with zero written length */
+		for (i = 0, off = start; i < nb_desc; i++, off = (off + 1) & (q_sz - 1))
+			q->sd_used[off] = q->sd_avail[off];
+		mark_used_split(q, mem2dev, start, nb_desc);
+	} else {
+		/* With in-order, a batch is returned by single used ring entry at current used
+		 * index carrying id of its last buffer. Driver reads the entry at its last used
+		 * index and skips forward by the batch size that used index moves by.
+		 */
+		off = (start + nb_desc - 1) & (q_sz - 1);
+		slot = q->used_idx & (q_sz - 1);
+		q->sd_used[slot] = q->sd_avail[off];
+		mark_used_split(q, mem2dev, slot, 1);
+	}
+	mark_used_idx_split(q, mem2dev, nb_desc);
+}
+
+static __rte_always_inline void
+mark_enq_compl_split(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev,
+		     uint16_t start, uint16_t end)
+{
+	uintptr_t sd_desc_base = (uintptr_t)q->sd_desc_base;
+	uint16_t q_sz = q->q_sz;
+	uint16_t nb_desc, off, i;
+	uint64_t len;
+
+	nb_desc = desc_off_diff(end, start, q_sz);
+	start = DESC_OFF(start);
+	/* Written length is in first word of descriptor second dword in shadow */
+	for (i = 0, off = start; i < nb_desc; i++, off = (off + 1) & (q_sz - 1)) {
+		len = *DESC_PTR_OFF(sd_desc_base, off, 8) & (RTE_BIT64(32) - 1);
+		q->sd_used[off] = q->sd_avail[off] | len << 32;
+	}
+	mark_used_split(q, mem2dev, start, nb_desc);
+	mark_used_idx_split(q, mem2dev, nb_desc);
+}
+
 static __rte_always_inline void
 mark_deq_compl_no_inorder(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev,
 			  uint16_t start, uint16_t nb_desc)
@@ -479,19 +1270,18 @@ mark_deq_compl_no_inorder(struct virtio_net_queue *q, struct dao_dma_vchan_state
 	VIRTIO_NET_DESC_CHECK(q, start, desc_off_diff(end, start, q_sz), true, true);
 
 	/* Issue descriptor data DMA */
-	dao_dma_enq_x1(mem2dev, (rte_iova_t)DESC_PTR_OFF(sd_desc_base, DESC_OFF(start), 0),
-		       DESC_ENTRY_SZ * pend,
-		       (rte_iova_t)DESC_PTR_OFF(desc_base, DESC_OFF(start), 0),
-		       DESC_ENTRY_SZ * pend);
+	dao_dma_enq_meta_x1(mem2dev, (rte_iova_t)DESC_PTR_OFF(sd_desc_base, DESC_OFF(start), 0),
+			    (rte_iova_t)DESC_PTR_OFF(desc_base, DESC_OFF(start), 0),
+			    DESC_ENTRY_SZ * pend);
 
 	start = desc_off_add(start, pend, q_sz);
 	pend = end - start;
 
 	if (pend) {
-		dao_dma_enq_x1(mem2dev, (rte_iova_t)DESC_PTR_OFF(sd_desc_base, DESC_OFF(start), 0),
-			       DESC_ENTRY_SZ * pend,
-			       (rte_iova_t)DESC_PTR_OFF(desc_base, DESC_OFF(start), 0),
-			       DESC_ENTRY_SZ * pend);
+		dao_dma_enq_meta_x1(mem2dev,
+				    (rte_iova_t)DESC_PTR_OFF(sd_desc_base, DESC_OFF(start), 0),
+				    (rte_iova_t)DESC_PTR_OFF(desc_base, DESC_OFF(start), 0),
+				    DESC_ENTRY_SZ * pend);
 	}
 }
 
@@ -507,6 +1297,9 @@ mark_deq_compl(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev,
 	uint64_t used;
 	uint16_t end;
 
+	if (flags & VIRTIO_NET_DESC_MANAGE_SPLIT)
+		return mark_deq_compl_split(q, mem2dev, start, nb_desc, flags);
+
 	if (flags & VIRTIO_NET_DESC_MANAGE_NOINORDER)
 		return mark_deq_compl_no_inorder(q, mem2dev, start, nb_desc);
 
@@ -523,7 +1316,7 @@ mark_deq_compl(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev,
 	dst = (rte_iova_t)DESC_PTR_OFF(desc_base, start, 8);
 
 	/* Enqueue DMA op assuming space is available */
-	dao_dma_enq_x1(mem2dev, src, 8, dst, 8);
+	dao_dma_enq_meta_x1(mem2dev, src, dst, 8);
 }
 
 static __rte_always_inline void
@@ -547,20 +1340,22 @@ mark_enq_compl(struct virtio_net_queue *q, struct dao_dma_vchan_state *mem2dev,
 				   desc_off_diff(end, start, q_sz), flags);
 	}
 
+	if (flags & VIRTIO_NET_DESC_MANAGE_SPLIT)
+		return mark_enq_compl_split(q, mem2dev, start, end);
+
 	pend = desc_off_diff_no_wrap(end, start, q_sz);
 
 	/* Issue descriptor data DMA */
-	dao_dma_enq_x1(mem2dev, (rte_iova_t)DESC_PTR_OFF(sd_desc_base, DESC_OFF(start), 0),
-		       DESC_ENTRY_SZ * pend,
-		       (rte_iova_t)DESC_PTR_OFF(desc_base, DESC_OFF(start), 0),
-		       DESC_ENTRY_SZ * pend);
+	dao_dma_enq_meta_x1(mem2dev, (rte_iova_t)DESC_PTR_OFF(sd_desc_base, DESC_OFF(start), 0),
+			    (rte_iova_t)DESC_PTR_OFF(desc_base, DESC_OFF(start), 0),
+			    DESC_ENTRY_SZ * pend);
 	start = desc_off_add(start, pend, q_sz);
 	pend = end - start;
 	if (pend) {
-		dao_dma_enq_x1(mem2dev, (rte_iova_t)DESC_PTR_OFF(sd_desc_base, DESC_OFF(start), 0),
-			       DESC_ENTRY_SZ * pend,
-			       (rte_iova_t)DESC_PTR_OFF(desc_base, DESC_OFF(start), 0),
-			       DESC_ENTRY_SZ * pend);
+		dao_dma_enq_meta_x1(mem2dev,
+				    (rte_iova_t)DESC_PTR_OFF(sd_desc_base, DESC_OFF(start), 0),
+				    (rte_iova_t)DESC_PTR_OFF(desc_base, DESC_OFF(start), 0),
+				    DESC_ENTRY_SZ * pend);
 	}
 }
 
@@ -0,0 +1,208 @@
+/* SPDX-License-Identifier: Marvell-Proprietary
+ * Copyright (c) 2024 Marvell.
+ */
+
+#include <netinet/in.h>
+
+#include <rte_ether.h>
+#include <rte_hash_crc.h>
+#include <rte_ip.h>
+
+#include "dao_virtio_netdev.h"
+#include "spec/virtio_net.h"
+#include "virtio_dev_priv.h"
+#include "virtio_net_priv.h"
+
+/* Bytes of key covered by 32 bit windows of the longest tuple */
+#define VIRTIO_NET_RSS_KEY_MIN (VIRTIO_NET_RSS_TUPLE_MAX + 4)
+
+static void
+virtio_net_rss_key_set(struct virtio_net_rss *rss, const uint8_t *key, uint8_t key_len)
+{
+	uint8_t k[VIRTIO_NET_RSS_KEY_MIN] = {0};
+	uint32_t win[8], h;
+	uint64_t bits;
+	uint16_t v;
+	int i, j;
+
+	memcpy(k, key, RTE_MIN(key_len, (uint8_t)VIRTIO_NET_RSS_KEY_MIN));
+
+	/* Input bit j of byte i adds in the key window starting at bit 8 * i + j, so a byte
+	 * value adds in XOR of windows of its set bits and is looked up once per byte.
+	 */
+	for (i = 0; i < VIRTIO_NET_RSS_TUPLE_MAX; i++) {
+		bits = 0;
+		for (j = 0; j < 5; j++)
+			bits = (bits << 8) | k[i + j];
+		for (j = 0; j < 8; j++)
+			win[j] = (uint32_t)(bits >> (8 - j));
+
+		for (v = 0; v < 256; v++) {
+			h = 0;
+			for (j = 0; j < 8; j++) {
+				if (v & (0x80 >> j))
+					h ^= win[j];
+			}
+			rss->tbl[i][v] = h;
+		}
+	}
+
+	rss->crc_init = (uint32_t)k[0] << 24 | (uint32_t)k[1] << 16 | (uint32_t)k[2] << 8 | k[3];
+}
+
+void
+virtio_net_rss_config(struct virtio_net_rss *rss, struct virtio_net_ctrl_rss *ctrl)
+{
+	rss->hash_types = ctrl->hash_types;
+	virtio_net_rss_key_set(rss, ctrl->hash_key_data, ctrl->hash_key_length);
+}
+
+static __rte_always_inline void
+virtio_net_rss_tuple_sort(uint8_t *tuple, uint8_t addr_len, uint8_t len)
+{
+	uint8_t tmp[16];
+	uint16_t port;
+
+	if (memcmp(tuple, tuple + addr_len, addr_len) <= 0)
+		return;
+
+	memcpy(tmp, tuple, addr_len);
+	memcpy(tuple, tuple + addr_len, addr_len);
+	memcpy(tuple + addr_len, tmp, addr_len);
+	if (len > 2 * addr_len) {
+		memcpy(&port, tuple + 2 * addr_len, 2);
+		memcpy(tuple + 2 * addr_len, tuple + 2 * addr_len + 2, 2);
+		memcpy(tuple + 2 * addr_len + 2, &port, 2);
+	}
+}
+
+/* Build hash input as per guest hash types, returns zero for unclassified packet */
+static __rte_always_inline uint8_t
+virtio_net_rss_tuple(struct rte_mbuf *m, uint32_t hash_types, uint8_t *tuple, uint8_t *addr_len,
+		     uint32_t *ptype)
+{
+	uint8_t *data = rte_pktmbuf_mtod(m, uint8_t *);
+	uint32_t l3_off = sizeof(struct rte_ether_hdr);
+	struct rte_vlan_hdr *vh;
+	struct rte_ipv4_hdr *ip4;
+	struct rte_ipv6_hdr *ip6;
+	uint16_t ether_type;
+	uint32_t l4_off;
+	uint8_t proto;
+
+	if (unlikely(m->data_len < l3_off))
+		return 0;
+	ether_type = ((struct rte_ether_hdr *)data)->ether_type;
+	if (ether_type == rte_cpu_to_be_16(RTE_ETHER_TYPE_VLAN)) {
+		vh = (struct rte_vlan_hdr *)(data + l3_off);
+		l3_off += sizeof(*vh);
+		if (unlikely(m->data_len < l3_off))
+			return 0;
+		ether_type = vh->eth_proto;
+	}
+
+	if (ether_type == rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4)) {
+		if (unlikely(m->data_len < l3_off + sizeof(*ip4)))
+			return 0;
+		ip4 = (struct rte_ipv4_hdr *)(data + l3_off);
+		l4_off = l3_off + (ip4->version_ihl & 0xf) * 4;
+		*addr_len = 4;
+		*ptype = RTE_PTYPE_L2_ETHER | RTE_PTYPE_L3_IPV4;
+		/* Source and destination addresses are adjacent */
+		memcpy(tuple, &ip4->src_addr, 8);
+		proto = ip4->next_proto_id;
+		/* Only first fragment has ports */
+		if (ip4->fragment_offset &
+		    rte_cpu_to_be_16(RTE_IPV4_HDR_MF_FLAG | RTE_IPV4_HDR_OFFSET_MASK))
+			proto = 0;
+		if (proto == IPPROTO_TCP && (hash_types & VIRTIO_NET_HASH_TYPE_TCPV4))
+			goto l4_ports;
+		if (proto == IPPROTO_UDP && (hash_types & VIRTIO_NET_HASH_TYPE_UDPV4))
+			goto l4_ports;
+		return hash_types & VIRTIO_NET_HASH_TYPE_IPV4 ? 8 : 0;
+	}
+
+	if (ether_type == rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV6)) {
+		if (unlikely(m->data_len < l3_off + sizeof(*ip6)))
+			return 0;
+		ip6 = (struct rte_ipv6_hdr *)(data + l3_off);
+		l4_off = l3_off + sizeof(*ip6);
+		*addr_len = 16;
+		*ptype = RTE_PTYPE_L2_ETHER | RTE_PTYPE_L3_IPV6;
+		memcpy(tuple, &ip6->src_addr, 32);
+		/* Extension headers are not walked, such packets are hashed on addresses */
+		proto = ip6->proto;
+		if (proto == IPPROTO_TCP && (hash_types & VIRTIO_NET_HASH_TYPE_TCPV6))
+			goto l4_ports;
+		if (proto == IPPROTO_UDP && (hash_types & VIRTIO_NET_HASH_TYPE_UDPV6))
+			goto l4_ports;
+		return hash_types & VIRTIO_NET_HASH_TYPE_IPV6 ? 32 : 0;
+	}
+
+	return 0;
+
+l4_ports:
+	if (unlikely(m->data_len < l4_off + 4))
+		return 0;
+	*ptype |= proto == IPPROTO_TCP ? RTE_PTYPE_L4_TCP : RTE_PTYPE_L4_UDP;
+	/* Source and destination ports lead both TCP and UDP headers */
+	memcpy(tuple + 2 * *addr_len, data + l4_off, 4);
+	return 2 * *addr_len + 4;
+}
+
+uint32_t
+virtio_net_rss_hash(struct virtio_net_rss *rss, struct rte_mbuf *m)
+{
+	uint8_t tuple[VIRTIO_NET_RSS_TUPLE_MAX];
+	uint32_t ptype = 0, hash = 0;
+	uint8_t addr_len = 0, len, i;
+
+	len = virtio_net_rss_tuple(m, rss->hash_types, tuple, &addr_len, &ptype);
+	if (len) {
+		switch (rss->algo) {
+		case DAO_VIRTIO_NETDEV_RSS_ALGO_CRC32:
+			hash = rte_hash_crc(tuple, len, rss->crc_init);
+			break;
+		case DAO_VIRTIO_NETDEV_RSS_ALGO_SYMMETRIC_TOEPLITZ:
+			virtio_net_rss_tuple_sort(tuple, addr_len, len);
+			/* fallthrough */
+		default:
+			for (i = 0; i < len; i++)
+				hash ^= rss->tbl[i][tuple[i]];
+			break;
+		}
+
+		/* Hash report is looked up by packet type */
+		if (!(m->packet_type & RTE_PTYPE_L3_MASK))
+			m->packet_type = ptype;
+	}
+
+	/* Zero hash is reported as no hash */
+	m->hash.rss = hash;
+	m->ol_flags |= RTE_MBUF_F_RX_RSS_HASH;
+	return hash;
+}
+
+int
+dao_virtio_netdev_rss_algo_set(uint16_t devid, enum dao_virtio_netdev_rss_algo algo)
+{
+	struct virtio_netdev *netdev;
+	struct virtio_net_rss *rss;
+	uint32_t i;
+
+	if (devid >= DAO_VIRTIO_DEV_MAX || (uint32_t)algo > DAO_VIRTIO_NETDEV_RSS_ALGO_CRC32)
+		return -EINVAL;
+
+	netdev = virtio_netdev_priv(&dao_virtio_netdevs[devid]);
+	rss = netdev->rss;
+	/* RSS state exists only between device init and fini */
+	if (!rss)
+		return -ENODEV;
+	rss->algo = algo;
+	/* Enqueue hashes in software only when enabled */
+	for (i = 0; i < DAO_VIRTIO_MAX_QUEUES; i += 2) {
+		if (netdev->qs[i])
+			netdev->qs[i]->rss = algo ? rss : NULL;
+	}
+	return 0;
+}
@@ -0,0 +1,262 @@
+/* SPDX-License-Identifier: Marvell-Proprietary
+ * Copyright (c) 2024 Marvell.
+ */
+
+#include <rte_cycles.h>
+#include <rte_malloc.h>
+
+#include "dao_virtio_netdev.h"
+#include "spec/virtio_net.h"
+#include "virtio_dev_priv.h"
+#include "virtio_net_priv.h"
+
+/* Min TSC cycles between refills, keeps rate error of integer tokens under 0.1% */
+#define VIRTIO_NET_TB_PERIOD_MIN 1000
+
+/* Bucket depth when not configured is tokens of one millisecond */
+#define VIRTIO_NET_TB_SIZE_DIV 1000
+
+static void
+virtio_net_tb_conf(struct virtio_net_tb *tb, uint64_t rate, uint32_t size, uint64_t tsc)
+{
+	uint64_t hz = rte_get_tsc_hz();
+
+	memset(tb, 0, sizeof(*tb));
+	if (!rate)
+		return;
+
+	if (hz / rate >= VIRTIO_NET_TB_PERIOD_MIN) {
+		tb->per_period = 1;
+		tb->period = hz / rate;
+	} else {
+		tb->per_period = (VIRTIO_NET_TB_PERIOD_MIN * rate) / hz + 1;
+		tb->period = (tb->per_period * hz) / rate;
+	}
+
+	if (!size)
+		size = RTE_MIN(rate / VIRTIO_NET_TB_SIZE_DIV, (uint64_t)UINT32_MAX);
+	tb->size = RTE_MAX((uint64_t)size, tb->per_period);
+	tb->tokens = tb->size;
+	tb->tsc = tsc;
+}
+
+/* Called with shaper lock held */
+static void
+virtio_net_shaper_apply(struct virtio_net_shaper *sh, uint64_t tsc)
+{
+	struct dao_virtio_netdev_shaper_conf *conf = &sh->conf;
+
+	virtio_net_tb_conf(&sh->pkts, conf->pps, conf->burst_pkts, tsc);
+	virtio_net_tb_conf(&sh->bytes, conf->bps, conf->burst_bytes, tsc);
+	sh->burst_max = RTE_MIN((uint32_t)conf->weight * DAO_VIRTIO_NETDEV_SHAPER_QUANTUM,
+				(uint32_t)UINT16_MAX);
+	sh->gen = sh->conf_gen;
+}
+
+static __rte_always_inline void
+virtio_net_tb_refill(struct virtio_net_tb *tb, uint64_t tsc)
+{
+	uint64_t n;
+
+	/* TSC read on another lcore can be behind the last refill of a device bucket */
+	if (unlikely(tsc <= tb->tsc))
+		return;
+
+	n = (tsc - tb->tsc) / tb->period;
+	tb->tsc += n * tb->period;
+	tb->tokens = RTE_MIN(tb->tokens + (int64_t)(n * tb->per_period), tb->size);
+}
+
+static __rte_always_inline uint16_t
+virtio_net_shaper_limit(struct virtio_net_shaper *sh, uint16_t nb_mbufs, uint64_t tsc)
+{
+	if (sh->burst_max)
+		nb_mbufs = RTE_MIN(nb_mbufs, sh->burst_max);
+
+	if (sh->pkts.period) {
+		virtio_net_tb_refill(&sh->pkts, tsc);
+		if (sh->pkts.tokens <= 0)
+			return 0;
+		nb_mbufs = RTE_MIN((int64_t)nb_mbufs, sh->pkts.tokens);
+	}
+
+	/* Packet lengths are known only after dequeue, burst goes while bytes are left */
+	if (sh->bytes.period) {
+		virtio_net_tb_refill(&sh->bytes, tsc);
+		if (sh->bytes.tokens <= 0)
+			return 0;
+	}
+	return nb_mbufs;
+}
+
+static __rte_always_inline void
+virtio_net_shaper_charge(struct virtio_net_shaper *sh, int64_t nb_mbufs, int64_t bytes)
+{
+	if (sh->pkts.period)
+		sh->pkts.tokens -= nb_mbufs;
+	if (sh->bytes.period)
+		sh->bytes.tokens -= bytes;
+}
+
+uint16_t
+virtio_net_shaper_admit(struct virtio_net_shaper *sh, uint16_t nb_mbufs)
+{
+	struct virtio_net_shaper *dev;
+	uint64_t tsc = rte_rdtsc();
+
+	if (unlikely(__atomic_load_n(&sh->conf_gen, __ATOMIC_ACQUIRE) != sh->gen)) {
+		rte_spinlock_lock(&sh->lock);
+		virtio_net_shaper_apply(sh, tsc);
+		rte_spinlock_unlock(&sh->lock);
+	}
+	nb_mbufs = virtio_net_shaper_limit(sh, nb_mbufs, tsc);
+
+	dev = __atomic_load_n(&sh->dev, __ATOMIC_ACQUIRE);
+	if (!dev || !nb_mbufs)
+		return nb_mbufs;
+
+	rte_spinlock_lock(&dev->lock);
+	if (unlikely(dev->conf_gen != dev->gen))
+		virtio_net_shaper_apply(dev, tsc);
+	nb_mbufs = virtio_net_shaper_limit(dev, nb_mbufs, tsc);
+	rte_spinlock_unlock(&dev->lock);
+	return nb_mbufs;
+}
+
+/* Charge packets to shaper buckets, called with negative sign to refund packets not sent */
+void
+virtio_net_shaper_consume(struct virtio_net_shaper *sh, struct rte_mbuf **mbufs,
+			  uint16_t nb_mbufs, int sign)
+{
+	struct virtio_net_shaper *dev;
+	int64_t bytes = 0;
+	uint16_t i;
+
+	for (i = 0; i < nb_mbufs; i++)
+		bytes += mbufs[i]->pkt_len;
+
+	virtio_net_shaper_charge(sh, sign * nb_mbufs, sign * bytes);
+
+	dev = __atomic_load_n(&sh->dev, __ATOMIC_ACQUIRE);
+	if (!dev)
+		return;
+
+	rte_spinlock_lock(&dev->lock);
+	virtio_net_shaper_charge(dev, sign * nb_mbufs, sign * bytes);
+	rte_spinlock_unlock(&dev->lock);
+}
+
+static struct virtio_net_shaper *
+virtio_net_shaper_attach(struct virtio_net_shapers *shapers, uint16_t qid)
+{
+	struct virtio_net_shaper *dev = &shapers->dev[qid & 1];
+	struct virtio_net_shaper *sh = &shapers->qs[qid];
+
+	__atomic_store_n(&sh->dev, dev->en ? dev : NULL, __ATOMIC_RELEASE);
+	return sh->en || dev->en ? sh : NULL;
+}
+
+void
+virtio_net_shaper_queue_setup(struct virtio_netdev *netdev, struct virtio_net_queue *q)
+{
+	if (netdev->shapers)
+		q->shaper = virtio_net_shaper_attach(netdev->shapers, q->qid);
+}
+
+static void
+virtio_net_shaper_conf_set(struct virtio_net_shaper *sh,
+			   struct dao_virtio_netdev_shaper_conf *conf)
+{
+	rte_spinlock_lock(&sh->lock);
+	if (conf)
+		sh->conf = *conf;
+	else
+		memset(&sh->conf, 0, sizeof(sh->conf));
+	sh->en = sh->conf.pps || sh->conf.bps || sh->conf.weight;
+	/* Buckets are reset by worker on next burst */
+	__atomic_store_n(&sh->conf_gen, sh->conf_gen + 1, __ATOMIC_RELEASE);
+	rte_spinlock_unlock(&sh->lock);
+}
+
+static struct virtio_net_shapers *
+virtio_net_shapers_get(struct virtio_netdev *netdev)
+{
+	struct virtio_net_shapers *shapers = netdev->shapers;
+	uint32_t i;
+
+	if (shapers)
+		return shapers;
+
+	shapers = rte_zmalloc("virtio_net_shapers", sizeof(*shapers), RTE_CACHE_LINE_SIZE);
+	if (!shapers)
+		return NULL;
+
+	for (i = 0; i < RTE_DIM(shapers->dev); i++)
+		rte_spinlock_init(&shapers->dev[i].lock);
+	for (i = 0; i < DAO_VIRTIO_MAX_QUEUES; i++)
+		rte_spinlock_init(&shapers->qs[i].lock);
+
+	netdev->shapers = shapers;
+	return shapers;
+}
+
+int
+dao_virtio_netdev_shaper_set(uint16_t devid, bool host_tx,
+			     struct dao_virtio_netdev_shaper_conf *conf)
+{
+	struct dao_virtio_netdev_shaper_conf dev_conf;
+	struct virtio_net_shapers *shapers;
+	struct virtio_net_shaper *sh;
+	struct virtio_netdev *netdev;
+	uint32_t i;
+
+	if (devid >= DAO_VIRTIO_DEV_MAX)
+		return -EINVAL;
+
+	netdev = virtio_netdev_priv(&dao_virtio_netdevs[devid]);
+	shapers = virtio_net_shapers_get(netdev);
+	if (!shapers)
+		return -ENOMEM;
+
+	/* Weight is per queue */
+	if (conf) {
+		dev_conf = *conf;
+		dev_conf.weight = 0;
+	}
+	virtio_net_shaper_conf_set(&shapers->dev[host_tx], conf ? &dev_conf : NULL);
+	for (i = host_tx; i < DAO_VIRTIO_MAX_QUEUES; i += 2) {
+		sh = virtio_net_shaper_attach(shapers, i);
+		if (netdev->qs[i])
+			__atomic_store_n(&netdev->qs[i]->shaper, sh, __ATOMIC_RELEASE);
+	}
+
+	dao_dbg("[dev %u] Host %s shaper pps %" PRIu64 " bps %" PRIu64, devid,
+		host_tx ? "Tx" : "Rx", conf ? conf->pps : 0, conf ? conf->bps : 0);
+	return 0;
+}
+
+int
+dao_virtio_netdev_queue_shaper_set(uint16_t devid, uint16_t qid,
+				   struct dao_virtio_netdev_shaper_conf *conf)
+{
+	struct virtio_net_shapers *shapers;
+	struct virtio_netdev *netdev;
+	struct virtio_net_shaper *sh;
+
+	if (devid >= DAO_VIRTIO_DEV_MAX || qid >= DAO_VIRTIO_MAX_QUEUES)
+		return -EINVAL;
+
+	netdev = virtio_netdev_priv(&dao_virtio_netdevs[devid]);
+	shapers = virtio_net_shapers_get(netdev);
+	if (!shapers)
+		return -ENOMEM;
+
+	virtio_net_shaper_conf_set(&shapers->qs[qid], conf);
+	sh = virtio_net_shaper_attach(shapers, qid);
+	if (netdev->qs[qid])
+		__atomic_store_n(&netdev->qs[qid]->shaper, sh, __ATOMIC_RELEASE);
+
+	dao_dbg("[dev %u] Queue %u shaper pps %" PRIu64 " bps %" PRIu64 " weight %u", devid, qid,
+		conf ? conf->pps : 0, conf ? conf->bps : 0, conf ? conf->weight : 0);
+	return 0;
+}
@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: Marvell-Proprietary
  * Copyright (c) 2024 Marvell.
  */
+#include <rte_errno.h>
 #include <rte_ethdev.h>
 #include <rte_malloc.h>
 
@@ -18,6 +19,20 @@ dao_net_desc_manage_fn_t dao_net_desc_manage_fns[VIRTIO_NET_DESC_MANAGE_LAST <<
 };
 
 struct dao_virtio_netdev_cbs user_cbs;
+
+/* Interrupt coalescing profiles for adaptive mode, from low latency to high rate */
+static const struct dao_virtio_netdev_intr_coalesce virtio_net_intr_profiles[] = {
+	{.max_pkts = 1, .usecs = 0},   {.max_pkts = 8, .usecs = 16},
+	{.max_pkts = 16, .usecs = 32}, {.max_pkts = 32, .usecs = 64},
+	{.max_pkts = 64, .usecs = 128},
+};
+
+/* Used buffers in an adaptive window to move past each profile */
+static const uint32_t virtio_net_intr_profile_thr[] = {16, 128, 512, 2048};
+
+/* Adaptive window of about 1ms as TSC hz shift */
+#define VIRTIO_NET_INTR_ADAPT_WIN_SHIFT 10
+
 int virtio_netdev_clear_queue_info(struct virtio_netdev *netdev);
 
 static int
@@ -101,6 +116,9 @@ virtio_netdev_feature_validate(struct virtio_dev *dev, uint64_t feature_bits)
 		case VIRTIO_NET_F_CTRL_MAC_ADDR:
 			dao_dbg("[dev %u]    +%s", dev_id, "VIRTIO_NET_F_CTRL_MAC_ADDR");
 			break;
+		case VIRTIO_NET_F_HOST_USO:
+			dao_dbg("[dev %u]    +%s", dev_id, "VIRTIO_NET_F_HOST_USO");
+			break;
 		case VIRTIO_NET_F_HASH_REPORT:
 			dao_dbg("[dev %u]    +%s", dev_id, "VIRTIO_NET_F_HASH_REPORT");
 			break;
@@ -113,6 +131,12 @@ virtio_netdev_feature_validate(struct virtio_dev *dev, uint64_t feature_bits)
 		case VIRTIO_NET_F_SPEED_DUPLEX:
 			dao_dbg("[dev %u]    +%s", dev_id, "VIRTIO_NET_F_SPEED_DUPLEX");
 			break;
+		case VIRTIO_F_INDIRECT_DESC:
+			dao_dbg("[dev %u]    +%s", dev->dev_id, "VIRTIO_F_INDIRECT_DESC");
+			break;
+		case VIRTIO_F_RING_EVENT_IDX:
+			dao_dbg("[dev %u]    +%s", dev->dev_id, "VIRTIO_F_RING_EVENT_IDX");
+			break;
 		case VIRTIO_F_VERSION_1:
 			dao_dbg("[dev %u]    +%s", dev->dev_id, "VIRTIO_F_VERSION_1");
 			break;
@@ -232,32 +256,98 @@ virtio_hash_types_to_hash_report(struct virtio_netdev *netdev, uint64_t virtio_h
 	}
 }
 
+static int
+net_qps_update(struct virtio_netdev *netdev, uint16_t nb_qps)
+{
+	uint16_t devid = netdev->dev.dev_id;
+	uint16_t prev, qp;
+	int rc = 0;
+
+	if (!nb_qps || nb_qps * 2 > netdev->dev.max_virtio_queues - 1) {
+		dao_err("[dev %u] Invalid vq pairs %u", devid, nb_qps);
+		return -EINVAL;
+	}
+
+	/* Spec default is one queue pair till guest sets the count */
+	prev = netdev->vq_pairs_set ? netdev->vq_pairs_set : 1;
+
+	/* Pairs that stay enabled are not notified and keep their lcore mapping */
+	for (qp = prev; qp > nb_qps; qp--) {
+		rc = user_cbs.qp_state_cb(devid, qp - 1, false);
+		if (rc) {
+			dao_err("[dev %u] Failed to disable queue pair %u, rc=%d", devid, qp - 1,
+				rc);
+			goto rollback;
+		}
+	}
+
+	for (qp = prev; qp < nb_qps; qp++) {
+		rc = user_cbs.qp_state_cb(devid, qp, true);
+		if (rc) {
+			dao_err("[dev %u] Failed to enable queue pair %u, rc=%d", devid, qp, rc);
+			goto rollback;
+		}
+	}
+
+	/* Queue count changes only once application has taken all pairs */
+	netdev->vq_pairs_set = nb_qps;
+	dao_dbg("[dev %u] vq pairs %u -> %u", devid, prev, nb_qps);
+	return 0;
+
+rollback:
+	/* Return pairs already notified to their previous state, in reverse order */
+	if (prev > nb_qps) {
+		for (; qp < prev; qp++)
+			if (user_cbs.qp_state_cb(devid, qp, true))
+				dao_err("[dev %u] Failed to re-enable queue pair %u", devid, qp);
+	} else {
+		for (; qp > prev; qp--)
+			if (user_cbs.qp_state_cb(devid, qp - 1, false))
+				dao_err("[dev %u] Failed to re-disable queue pair %u", devid,
+					qp - 1);
+	}
+	return rc;
+}
+
 static int
 net_rss_setup(struct virtio_netdev *netdev, struct virtio_net_ctrl *ctrl_cmd)
 {
 	struct virtio_net_ctrl_rss *rss = (struct virtio_net_ctrl_rss *)ctrl_cmd->data;
-	int ret;
+	int ret = 0;
 
-	if (user_cbs.rss_cb == NULL)
+	/* Software RSS can serve guest config without application */
+	if (user_cbs.rss_cb == NULL && !netdev->rss->algo)
 		return -ENOTSUP;
 
-	/* Set number of vq pairs to requested number of queues */
-	netdev->vq_pairs_set = rss->max_tx_vq;
+	if (user_cbs.qp_state_cb) {
+		ret = net_qps_update(netdev, rss->max_tx_vq);
+		if (ret)
+			return ret;
+	} else {
+		/* Set number of vq pairs to requested number of queues */
+		netdev->vq_pairs_set = rss->max_tx_vq;
+	}
 
-	/* Clear the core and queue map before updating the core map
-	 * to requested number of queues.
-	 */
-	user_cbs.rss_cb(netdev->dev.dev_id, NULL);
+	if (user_cbs.rss_cb) {
+		/* Clear the core and queue map before updating the core map
+		 * to requested number of queues.
+		 */
+		if (!user_cbs.qp_state_cb)
+			user_cbs.rss_cb(netdev->dev.dev_id, NULL);
 
-	/* Update the core map to requested number of queues and
-	 * configure rss.
-	 */
-	ret = user_cbs.rss_cb(netdev->dev.dev_id, rss);
-	if (!ret)
+		/* Update the core map to requested number of queues and
+		 * configure rss.
+		 */
+		ret = user_cbs.rss_cb(netdev->dev.dev_id, rss);
+	}
+	if (!ret) {
 		/* Set hash report values based on the requested hash types, which will be
 		 * used in enqueue data path.
 		 */
 		virtio_hash_types_to_hash_report(netdev, rss->hash_types);
+		/* Keep key and hash types for software hash */
+		virtio_net_rss_config(netdev->rss, rss);
+	}
 
 	return ret;
 }
@@ -317,10 +407,14 @@ net_mq_configure(struct virtio_netdev *netdev, struct virtio_net_ctrl *ctrl_cmd)
 {
 	uint16_t nb_qps;
 
+	nb_qps = *(uint16_t *)ctrl_cmd->data;
+	/* Only pairs added or removed are remapped, others keep traffic flowing */
+	if (user_cbs.qp_state_cb)
+		return net_qps_update(netdev, nb_qps);
+
 	if (user_cbs.mq_configure == NULL)
 		return -ENOTSUP;
 
-	nb_qps = *(uint16_t *)ctrl_cmd->data;
 	/* Set number of vq pairs to requested number of queues */
 	netdev->vq_pairs_set = nb_qps;
 
@@ -333,11 +427,35 @@ net_mq_configure(struct virtio_netdev *netdev, struct virtio_net_ctrl *ctrl_cmd)
 	return user_cbs.mq_configure(netdev->dev.dev_id, true);
 }
 
+static void
+virtio_net_intr_coalesce_conf(struct virtio_net_queue *q,
+			      const struct dao_virtio_netdev_intr_coalesce *conf)
+{
+	q->intr_adaptive = conf->adaptive;
+	q->intr_level = 0;
+	q->intr_win_pkts = 0;
+	q->intr_win_tsc = rte_rdtsc();
+	if (conf->adaptive)
+		conf = &virtio_net_intr_profiles[0];
+
+	q->intr_max_pkts = RTE_MAX(conf->max_pkts, 1);
+	q->intr_max_tsc = (rte_get_tsc_hz() * conf->usecs) / 1000000;
+}
+
+static void
+virtio_net_desc_throttle_conf(struct virtio_net_queue *q, uint16_t window)
+{
+	q->thr_stall_tsc = (rte_get_tsc_hz() * VIRTIO_NET_THROTTLE_STALL_US) / 1000000;
+	q->thr_last_off = q->last_off;
+	__atomic_store_n(&q->desc_throttle, RTE_MIN(window, q->q_sz), __ATOMIC_RELAXED);
+}
+
 static int
 virtio_queue_driver_event_flag(struct virtio_dev *dev, struct virtio_net_queue *queue)
 {
 	struct vring_packed_desc_event *sd_driver_area;
 	int16_t dev2mem = dao_dma_ctrl_dev2mem();
+	struct vring_avail *avail;
 	bool has_err = 0;
 	uint16_t tmo_ms;
 	int cnt, rc;
@@ -364,6 +482,13 @@ virtio_queue_driver_event_flag(struct virtio_dev *dev, struct virtio_net_queue *
 		}
 	} while (cnt != 1);
 
+	/* Split virtqueue avail ring header carries interrupt suppression flag */
+	if (virtio_dev_is_split(dev)) {
+		avail = (struct vring_avail *)sd_driver_area;
+		return (avail->flags & VRING_AVAIL_F_NO_INTERRUPT) ? RING_EVENT_FLAGS_DISABLE :
+								     RING_EVENT_FLAGS_ENABLE;
+	}
+
 	return sd_driver_area->desc_event_flags;
 }
 
@@ -417,9 +542,12 @@ virtio_netdev_populate_queue_info(struct virtio_netdev *netdev, uint16_t queue_i
 	struct virtio_dev *dev = &netdev->dev;
 	struct virtio_queue_conf *q_conf;
 	struct virtio_net_queue *queue;
+	uint32_t split_area = 0;
 	bool cb_enabled = false;
+	uint32_t ind_area = 0;
 	uint32_t shadow_area;
 	uint32_t mbuf_area;
+	uintptr_t split_base;
 	uint16_t buf_len;
 	int event_flag;
 
@@ -440,10 +568,21 @@ virtio_netdev_populate_queue_info(struct virtio_netdev *netdev, uint16_t queue_i
 	if (!q_conf->queue_enable || netdev->qs[queue_id] != NULL)
 		return 0;
 
-	/* Setup only enabled queues assuming packed virt queue */
+	/* Setup only enabled queues, shadow descriptors are laid out by ring position */
 	shadow_area = RTE_ALIGN(q_conf->queue_size * 16 + 8, RTE_CACHE_LINE_SIZE);
 	mbuf_area = RTE_ALIGN(q_conf->queue_size * 8, RTE_CACHE_LINE_SIZE);
-	queue = rte_zmalloc("virtio_net_queue", sizeof(*queue) + shadow_area + mbuf_area,
+	/* Split virt queue needs shadow avail ring, used ring and used index slots */
+	if (virtio_dev_is_split(dev))
+		split_area = RTE_ALIGN(q_conf->queue_size * 2, RTE_CACHE_LINE_SIZE) * 2 +
+			     RTE_ALIGN(q_conf->queue_size * 8, RTE_CACHE_LINE_SIZE);
+	/* Host Tx queue needs shadow space for indirect tables of each ring position, split
+	 * descriptor chains are walked into the same tables.
+	 */
+	if ((queue_id & 0x1) && ((dev->feature_bits & RTE_BIT64(VIRTIO_F_INDIRECT_DESC)) ||
+				 virtio_dev_is_split(dev)))
+		ind_area = q_conf->queue_size * VIRTIO_NET_IND_DESC_MAX * DESC_ENTRY_SZ;
+	queue = rte_zmalloc("virtio_net_queue",
+			    sizeof(*queue) + shadow_area + mbuf_area + split_area + ind_area,
 			    RTE_CACHE_LINE_SIZE);
 	if (!queue) {
 		dao_err("[dev %u] Failed to allocate memory for virtio queue", dev->dev_id);
@@ -458,16 +597,45 @@ virtio_netdev_populate_queue_info(struct virtio_netdev *netdev, uint16_t queue_i
 		queue->data_off = (sizeof(struct rte_mbuf));
 		queue->data_off += RTE_PKTMBUF_HEADROOM;
 		queue->data_off += rte_pktmbuf_priv_size(netdev->pool);
+	} else {
+		/* NULL unless library extbuf pool is in use */
+		queue->mp = netdev->extbuf_pool;
 	}
 
 	queue->buf_len = buf_len;
 	queue->notify_addr = (uint32_t *)(dev->notify_base + (queue_id * dev->notify_off_mltpr));
 	queue->mbuf_arr = (struct rte_mbuf **)((uintptr_t)(queue + 1) + shadow_area);
-	/* Initial queue wrap counter is 1 as per spec? */
-	queue->sd_desc_off = RTE_BIT64(15);
-	queue->sd_mbuf_off = RTE_BIT64(15);
-	queue->last_off = RTE_BIT64(15);
-	queue->compl_off = RTE_BIT64(15); /* Valid only for Rx queue */
+	if (!split_area) {
+		/* Initial queue wrap counter is 1 as per spec? */
+		queue->sd_desc_off = RTE_BIT64(15);
+		queue->sd_mbuf_off = RTE_BIT64(15);
+		queue->last_off = RTE_BIT64(15);
+		queue->compl_off = RTE_BIT64(15); /* Valid only for Rx queue */
+	} else {
+		/* Split virt queue offsets follow avail index starting at 0 */
+		split_base = (uintptr_t)queue->mbuf_arr + mbuf_area;
+		queue->sd_avail = (uint16_t *)split_base;
+		split_base += RTE_ALIGN(q_conf->queue_size * 2, RTE_CACHE_LINE_SIZE);
+		queue->sd_used_idx = (uint16_t *)split_base;
+		split_base += RTE_ALIGN(q_conf->queue_size * 2, RTE_CACHE_LINE_SIZE);
+		queue->sd_used = (uint64_t *)split_base;
+		queue->device_area = (((uint64_t)q_conf->queue_used_hi << 32) |
+				      (q_conf->queue_used_lo));
+	}
+	queue->sd_ind_off = queue->sd_desc_off;
+	queue->ind_batch_off = queue->sd_desc_off;
+	queue->event_idx = !!(dev->feature_bits & RTE_BIT64(VIRTIO_F_RING_EVENT_IDX));
+	if (!(queue_id & 0x1)) {
+		/* Nothing is used yet for interrupt moderation */
+		queue->intr_compl_off = queue->compl_off;
+		queue->intr_used_off = queue->compl_off;
+		queue->intr_sig_off = queue->compl_off;
+		virtio_net_intr_coalesce_conf(queue, &netdev->intr_conf);
+	}
+	if (ind_area)
+		queue->sd_ind_base =
+			(uint64_t *)((uintptr_t)queue->mbuf_arr + mbuf_area + split_area);
+	virtio_net_desc_throttle_conf(queue, netdev->desc_throttle);
 	queue->auto_free = netdev->auto_free_en;
 	queue->qid = queue_id;
 	queue->dma_vchan = dev->dma_vchan;
@@ -476,6 +644,14 @@ virtio_netdev_populate_queue_info(struct virtio_netdev *netdev, uint16_t queue_i
 	queue->dao_netdev = dao_netdev;
 	queue->netdev_id = netdev->dev.dev_id;
 	queue->hash_report = netdev->hash_report;
+	if (dev->feature_bits & RTE_BIT64(VIRTIO_NET_F_GUEST_TSO4))
+		queue->gro_flags |= VIRTIO_NET_GRO_F_IPV4;
+	if (dev->feature_bits & RTE_BIT64(VIRTIO_NET_F_GUEST_TSO6))
+		queue->gro_flags |= VIRTIO_NET_GRO_F_IPV6;
+	if (!(queue_id & 0x1) && netdev->rss->algo)
+		queue->rss = netdev->rss;
+	virtio_net_capture_queue_setup(netdev, queue);
+	virtio_net_shaper_queue_setup(netdev, queue);
 	queue->virtio_hdr_sz = virtio_netdev_hdr_size(netdev);
 
 	queue->driver_area = (((uint64_t)q_conf->queue_avail_hi << 32) | (q_conf->queue_avail_lo));
@@ -722,7 +898,8 @@ virtio_netdev_status_cb(struct virtio_dev *dev, uint8_t status)
 
 			gso_offload = dev->drv_feature_bits_lo & 0XFFFF;
 			if (gso_offload & RTE_BIT64(VIRTIO_NET_F_HOST_TSO4) ||
-			    gso_offload & RTE_BIT64(VIRTIO_NET_F_HOST_TSO6))
+			    gso_offload & RTE_BIT64(VIRTIO_NET_F_HOST_TSO6) ||
+			    dev->feature_bits & RTE_BIT64(VIRTIO_NET_F_HOST_USO))
 				dao_netdev->deq_fn_id |= VIRTIO_NET_DEQ_OFFLOAD_GSO;
 		}
 		if (csum_offload & RTE_BIT64(VIRTIO_NET_F_GUEST_CSUM))
@@ -737,15 +914,33 @@ virtio_netdev_status_cb(struct virtio_dev *dev, uint8_t status)
 		}
 
 		dao_netdev->enq_fn_id &= ~VIRTIO_NET_ENQ_OFFLOAD_MSEG;
+		dao_netdev->enq_fn_id &= ~VIRTIO_NET_ENQ_OFFLOAD_GRO;
 		if (dev->drv_feature_bits_lo & RTE_BIT64(VIRTIO_NET_F_MRG_RXBUF)) {
 			dao_netdev->enq_fn_id |= VIRTIO_NET_ENQ_OFFLOAD_MSEG;
 			dao_netdev->mgmt_fn_id |= VIRTIO_NET_DESC_MANAGE_MSEG;
+
+			/* Coalesce TCP segments to mergeable buffers if guest takes GSO, only
+			 * of address families whose guest TSO feature is negotiated. GSO packets
+			 * are not built without mergeable buffers.
+			 */
+			if ((csum_offload & RTE_BIT64(VIRTIO_NET_F_GUEST_CSUM)) &&
+			    (dev->drv_feature_bits_lo & (RTE_BIT64(VIRTIO_NET_F_GUEST_TSO4) |
+							 RTE_BIT64(VIRTIO_NET_F_GUEST_TSO6))))
+				dao_netdev->enq_fn_id |= VIRTIO_NET_ENQ_OFFLOAD_GRO;
 		}
 
 		dao_netdev->enq_fn_id &= ~VIRTIO_NET_ENQ_OFFLOAD_HASH_REPORT;
 		if (dev->feature_bits & RTE_BIT64(VIRTIO_NET_F_HASH_REPORT))
 			dao_netdev->enq_fn_id |= VIRTIO_NET_ENQ_OFFLOAD_HASH_REPORT;
 
+		/* Select split virt queue descriptor management and dequeue */
+		dao_netdev->deq_fn_id &= ~VIRTIO_NET_DEQ_OFFLOAD_SPLIT;
+		dao_netdev->mgmt_fn_id &= ~VIRTIO_NET_DESC_MANAGE_SPLIT;
+		if (virtio_dev_is_split(dev)) {
+			dao_netdev->deq_fn_id |= VIRTIO_NET_DEQ_OFFLOAD_SPLIT;
+			dao_netdev->mgmt_fn_id |= VIRTIO_NET_DESC_MANAGE_SPLIT;
+		}
+
 		return user_cbs.status_cb(netdev->dev.dev_id, status);
 	} else if (status == VIRTIO_DEV_RESET) {
 		struct virtio_net_queue *q;
@@ -791,6 +986,32 @@ dao_virtio_netdev_cb_unregister(void)
 	memset(&user_cbs, 0, sizeof(user_cbs));
 }
 
+static int
+virtio_netdev_extbuf_pool_create(struct virtio_netdev *netdev, struct dao_virtio_netdev_conf *conf)
+{
+	struct virtio_dev *dev = &netdev->dev;
+	char name[RTE_MEMPOOL_NAMESIZE];
+	uint32_t elt_size, cache_size;
+
+	/* Descriptor data followed by data room starting with virtio net header */
+	elt_size = offsetof(struct dao_virtio_net_hdr, hdr) + conf->dataroom_size;
+	/* Per lcore caches are refilled and flushed in bulk, keep them within pool size */
+	cache_size = RTE_MIN((uint32_t)RTE_MEMPOOL_CACHE_MAX_SIZE, conf->nb_extbufs / 2);
+
+	snprintf(name, sizeof(name), "virtio_net_extbuf_%u", dev->dev_id);
+	netdev->extbuf_pool = rte_mempool_create(name, conf->nb_extbufs, elt_size, cache_size, 0,
+						 NULL, NULL, NULL, NULL, conf->extbuf_socket_id, 0);
+	if (!netdev->extbuf_pool) {
+		dao_err("[dev %u] Failed to create extbuf pool of %u buffers, rte_errno=%d",
+			dev->dev_id, conf->nb_extbufs, rte_errno);
+		return -rte_errno;
+	}
+
+	dao_dbg("[dev %u] Extbuf pool of %u x %u bytes on socket %d", dev->dev_id,
+		conf->nb_extbufs, elt_size, conf->extbuf_socket_id);
+	return 0;
+}
+
 int
 dao_virtio_netdev_init(uint16_t devid, struct dao_virtio_netdev_conf *conf)
 {
@@ -810,7 +1031,14 @@ dao_virtio_netdev_init(uint16_t devid, struct dao_virtio_netdev_conf *conf)
 	else
 		netdev->dataroom_size = conf->dataroom_size;
 
+	if ((conf->flags & DAO_VIRTIO_NETDEV_EXTBUF_POOL) &&
+	    (!(conf->flags & DAO_VIRTIO_NETDEV_EXTBUF) || !conf->nb_extbufs)) {
+		dao_err("[dev %u] Extbuf pool needs extbuf mode and pool size", devid);
+		return -EINVAL;
+	}
+
 	netdev->flags = conf->flags;
+	memset(&netdev->intr_conf, 0, sizeof(netdev->intr_conf));
 	netdev->reta_size = conf->reta_size;
 	netdev->hash_key_size = conf->hash_key_size;
 	netdev->auto_free_en = conf->auto_free_en;
@@ -818,10 +1046,17 @@ dao_virtio_netdev_init(uint16_t devid, struct dao_virtio_netdev_conf *conf)
 	if (conf->max_virt_qps_limit)
 		dev->max_virtio_queues_limit = (conf->max_virt_qps_limit * 2) + 1;
 
+	netdev->extbuf_pool = NULL;
+	if (conf->flags & DAO_VIRTIO_NETDEV_EXTBUF_POOL) {
+		rc = virtio_netdev_extbuf_pool_create(netdev, conf);
+		if (rc)
+			return rc;
+	}
+
 	/* Initialize base virtio device */
 	rc = virtio_dev_init(dev);
 	if (rc)
-		return rc;
+		goto pool_free;
 
 	/* Setup netdev config */
 	dev_cfg = (volatile struct virtio_net_config *)dev->dev_cfg;
@@ -847,11 +1082,28 @@ dao_virtio_netdev_init(uint16_t devid, struct dao_virtio_netdev_conf *conf)
 		feature_bits |= RTE_BIT64(VIRTIO_NET_F_CSUM) | RTE_BIT64(VIRTIO_NET_F_GUEST_CSUM);
 		feature_bits |= RTE_BIT64(VIRTIO_NET_F_HOST_TSO4);
 		feature_bits |= RTE_BIT64(VIRTIO_NET_F_HOST_TSO6);
+		feature_bits |= RTE_BIT64(VIRTIO_NET_F_HOST_USO);
 		feature_bits |= (RTE_BIT64(VIRTIO_NET_F_GUEST_HDRLEN));
+		/* Receive side coalescing to guest */
+		feature_bits |= RTE_BIT64(VIRTIO_NET_F_GUEST_TSO4);
+		feature_bits |= RTE_BIT64(VIRTIO_NET_F_GUEST_TSO6);
 	}
 
+	/* Indirect tables are resolved into mbuf chains, not supported with external buffers */
+	if (!(conf->flags & DAO_VIRTIO_NETDEV_EXTBUF))
+		feature_bits |= RTE_BIT64(VIRTIO_F_INDIRECT_DESC);
+
+	if (conf->flags & DAO_VIRTIO_NETDEV_EVENT_IDX)
+		feature_bits |= RTE_BIT64(VIRTIO_F_RING_EVENT_IDX);
+
 	virtio_dev_feature_bits_set(dev, feature_bits);
 
+	/* Offer only split virt queue by not advertising packed ring */
+	if (conf->flags & DAO_VIRTIO_NETDEV_SPLIT_RING) {
+		dev->dev_feature_bits &= ~RTE_BIT64(VIRTIO_F_RING_PACKED);
+		dev->feature_bits &= ~RTE_BIT64(VIRTIO_F_RING_PACKED);
+	}
+
 	/* Copy default netdev config */
 	dao_dev_memcpy(dev_cfg->mac, conf->mac, sizeof(dev_cfg->mac));
 	dev_cfg->status = conf->link_info.status;
@@ -869,11 +1121,20 @@ dao_virtio_netdev_init(uint16_t devid, struct dao_virtio_netdev_conf *conf)
 	virtio_netdev->mgmt_fn_id &= ~VIRTIO_NET_DESC_MANAGE_EXTBUF;
 	if (conf->flags & DAO_VIRTIO_NETDEV_EXTBUF)
 		virtio_netdev->mgmt_fn_id |= VIRTIO_NET_DESC_MANAGE_EXTBUF;
+	virtio_netdev->extbuf_pool = netdev->extbuf_pool;
 
 	netdev->hash_report = rte_zmalloc(NULL, sizeof(uint8_t) * DAO_HASH_REPORT_INDEX_MAX, 0);
 	if (!netdev->hash_report) {
 		dao_err("[dev %u] Failed to allocate memory for hash report table", dev->dev_id);
-		return -ENOMEM;
+		rc = -ENOMEM;
+		goto dev_fini;
+	}
+
+	netdev->rss = rte_zmalloc(NULL, sizeof(struct virtio_net_rss), RTE_CACHE_LINE_SIZE);
+	if (!netdev->rss) {
+		dao_err("[dev %u] Failed to allocate memory for RSS state", dev->dev_id);
+		rc = -ENOMEM;
+		goto hash_free;
 	}
 
 	/* One time setup */
@@ -883,6 +1144,16 @@ dao_virtio_netdev_init(uint16_t devid, struct dao_virtio_netdev_conf *conf)
 	dev_cbs[VIRTIO_DEV_TYPE_NET].queue_enable = virtio_netdev_queue_enable;
 	dev_cbs[VIRTIO_DEV_TYPE_NET].feature_validate = virtio_netdev_feature_validate;
 	return 0;
+hash_free:
+	rte_free(netdev->hash_report);
+	netdev->hash_report = NULL;
+dev_fini:
+	virtio_dev_fini(dev);
+pool_free:
+	rte_mempool_free(netdev->extbuf_pool);
+	netdev->extbuf_pool = NULL;
+	virtio_netdev->extbuf_pool = NULL;
+	return rc;
 }
 
 int
@@ -891,8 +1162,22 @@ dao_virtio_netdev_fini(uint16_t devid)
 	struct dao_virtio_netdev *virtio_netdev = &dao_virtio_netdevs[devid];
 	struct virtio_netdev *netdev = virtio_netdev_priv(virtio_netdev);
 
+	int rc;
+
+	if (netdev->cap.enabled)
+		dao_virtio_netdev_capture_stop(devid);
 	rte_free(netdev->hash_report);
-	return virtio_dev_fini(&netdev->dev);
+	netdev->hash_report = NULL;
+	rte_free(netdev->rss);
+	netdev->rss = NULL;
+	rte_free(netdev->shapers);
+	netdev->shapers = NULL;
+	rc = virtio_dev_fini(&netdev->dev);
+	/* Buffers still held by application are lost with the pool */
+	rte_mempool_free(netdev->extbuf_pool);
+	netdev->extbuf_pool = NULL;
+	virtio_netdev->extbuf_pool = NULL;
+	return rc;
 }
 
 int
@@ -933,6 +1218,209 @@ dao_virtio_netdev_hdrlen_get(uint16_t devid)
 	return virtio_netdev_hdr_size(netdev);
 }
 
+int
+dao_virtio_netdev_intr_coalesce_set(uint16_t devid, struct dao_virtio_netdev_intr_coalesce *conf)
+{
+	struct dao_virtio_netdev *virtio_netdev = &dao_virtio_netdevs[devid];
+	struct virtio_netdev *netdev = virtio_netdev_priv(virtio_netdev);
+	uint32_t i;
+
+	if (!conf)
+		return -EINVAL;
+
+	/* Count threshold alone would hold interrupt forever once traffic stops */
+	if (!conf->adaptive && conf->max_pkts > 1 && !conf->usecs) {
+		dao_err("[dev %u] Interrupt coalescing needs usecs with max_pkts", devid);
+		return -EINVAL;
+	}
+
+	netdev->intr_conf = *conf;
+	for (i = 0; i < DAO_VIRTIO_MAX_QUEUES; i += 2) {
+		if (netdev->qs[i])
+			virtio_net_intr_coalesce_conf(netdev->qs[i], conf);
+	}
+	return 0;
+}
+
+static const struct {
+	const char *name;
+	size_t offset;
+} virtio_netdev_xstats_tbl[] = {
+#define X(field) {#field, offsetof(struct dao_virtio_netdev_queue_stats, field)}
+	X(pkts),      X(bytes),    X(drops),     X(alloc_fails),  X(no_desc),   X(mseg_pkts),
+	X(csum_pkts), X(gso_pkts), X(dma_fails), X(desc_fetched), X(desc_used), X(compl_lag_max),
+#undef X
+};
+
+#define VIRTIO_NETDEV_NB_XSTATS RTE_DIM(virtio_netdev_xstats_tbl)
+
+static void
+virtio_netdev_queue_stats_raw(struct virtio_net_queue *q, struct dao_virtio_netdev_queue_stats *st)
+{
+	const uint64_t *wrkr = (const uint64_t *)&q->wrkr_stats;
+	const uint64_t *svc = (const uint64_t *)&q->svc_stats;
+	uint64_t *val = (uint64_t *)st;
+	unsigned int i;
+
+	/* Counters are updated by one worker and one service lcore, sum both views */
+	for (i = 0; i < sizeof(*st) / sizeof(uint64_t); i++)
+		val[i] = __atomic_load_n(&wrkr[i], __ATOMIC_RELAXED) +
+			 __atomic_load_n(&svc[i], __ATOMIC_RELAXED);
+	st->compl_lag_max = __atomic_load_n(&q->svc_stats.compl_lag_max, __ATOMIC_RELAXED);
+}
+
+int
+dao_virtio_netdev_stats_get(uint16_t devid, uint16_t qid,
+			    struct dao_virtio_netdev_queue_stats *stats)
+{
+	struct dao_virtio_netdev *virtio_netdev;
+	struct virtio_net_queue *q;
+	uint64_t *val, *base;
+	unsigned int i;
+
+	if (devid >= DAO_VIRTIO_DEV_MAX || qid >= DAO_VIRTIO_MAX_QUEUES || !stats)
+		return -EINVAL;
+
+	memset(stats, 0, sizeof(*stats));
+	if (!virtio_net_has_stats_feature())
+		return 0;
+
+	virtio_netdev = &dao_virtio_netdevs[devid];
+	q = virtio_netdev->qs[qid];
+	if (!q)
+		return -ENOENT;
+
+	virtio_netdev_queue_stats_raw(q, stats);
+	val = (uint64_t *)stats;
+	base = (uint64_t *)&q->stats_base;
+	for (i = 0; i < sizeof(*stats) / sizeof(uint64_t); i++)
+		val[i] -= base[i];
+	/* Max is not cumulative, it restarts from zero on reset */
+	stats->compl_lag_max = __atomic_load_n(&q->svc_stats.compl_lag_max, __ATOMIC_RELAXED);
+	return 0;
+}
+
+int
+dao_virtio_netdev_stats_reset(uint16_t devid)
+{
+	struct dao_virtio_netdev *virtio_netdev;
+	struct virtio_net_queue *q;
+	uint16_t qid;
+
+	if (devid >= DAO_VIRTIO_DEV_MAX)
+		return -EINVAL;
+
+	virtio_netdev = &dao_virtio_netdevs[devid];
+	for (qid = 0; qid < DAO_VIRTIO_MAX_QUEUES; qid++) {
+		q = virtio_netdev->qs[qid];
+		if (!q)
+			continue;
+
+		/* Datapath counters are never written here, reset is a snapshot */
+		virtio_netdev_queue_stats_raw(q, &q->stats_base);
+		__atomic_store_n(&q->svc_stats.compl_lag_max, 0, __ATOMIC_RELAXED);
+	}
+	return 0;
+}
+
+int
+dao_virtio_netdev_xstats_names_get(uint16_t devid, struct dao_virtio_netdev_xstat_name *names,
+				   unsigned int size)
+{
+	unsigned int count, i, j, n = 0;
+	int nb_qs;
+
+	if (devid >= DAO_VIRTIO_DEV_MAX)
+		return -EINVAL;
+
+	nb_qs = dao_virtio_netdev_queue_count(devid);
+	count = nb_qs * VIRTIO_NETDEV_NB_XSTATS;
+	if (!names || size < count)
+		return count;
+
+	for (i = 0; i < (unsigned int)nb_qs; i++) {
+		for (j = 0; j < VIRTIO_NETDEV_NB_XSTATS; j++, n++)
+			snprintf(names[n].name, sizeof(names[n].name), "host_%s_q%u_%s",
+				 (i & 1) ? "tx" : "rx", i / 2, virtio_netdev_xstats_tbl[j].name);
+	}
+	return count;
+}
+
+int
+dao_virtio_netdev_xstats_get(uint16_t devid, uint64_t *values, unsigned int size)
+{
+	struct dao_virtio_netdev_queue_stats stats;
+	unsigned int count, i, j, n = 0;
+	int nb_qs;
+
+	if (devid >= DAO_VIRTIO_DEV_MAX)
+		return -EINVAL;
+
+	nb_qs = dao_virtio_netdev_queue_count(devid);
+	count = nb_qs * VIRTIO_NETDEV_NB_XSTATS;
+	if (!values || size < count)
+		return count;
+
+	for (i = 0; i < (unsigned int)nb_qs; i++) {
+		/* Queue not yet set up reports zero */
+		if (dao_virtio_netdev_stats_get(devid, i, &stats))
+			memset(&stats, 0, sizeof(stats));
+		for (j = 0; j < VIRTIO_NETDEV_NB_XSTATS; j++, n++)
+			values[n] = *(uint64_t *)((uint8_t *)&stats +
+						  virtio_netdev_xstats_tbl[j].offset);
+	}
+	return count;
+}
+
+int
+dao_virtio_netdev_desc_fetch_throttle_set(uint16_t devid, uint16_t window)
+{
+	struct virtio_netdev *netdev;
+	uint32_t i;
+
+	if (devid >= DAO_VIRTIO_DEV_MAX)
+		return -EINVAL;
+
+	netdev = virtio_netdev_priv(&dao_virtio_netdevs[devid]);
+	/* RSS state exists only between device init and fini */
+	if (!netdev->rss)
+		return -ENODEV;
+
+	if (window && window < DAO_VIRTIO_NETDEV_DESC_THROTTLE_MIN) {
+		dao_err("[dev %u] Descriptor fetch throttle window %u below %u", devid, window,
+			DAO_VIRTIO_NETDEV_DESC_THROTTLE_MIN);
+		return -EINVAL;
+	}
+
+	netdev->desc_throttle = window;
+	for (i = 0; i < DAO_VIRTIO_MAX_QUEUES; i++) {
+		if (netdev->qs[i])
+			virtio_net_desc_throttle_conf(netdev->qs[i], window);
+	}
+	return 0;
+}
+
+int
+dao_virtio_netdev_queue_occupancy_get(uint16_t devid, uint16_t qid,
+				      struct dao_virtio_netdev_queue_occupancy *occ)
+{
+	struct virtio_net_queue *q;
+	uint16_t sd_desc_off;
+
+	if (devid >= DAO_VIRTIO_DEV_MAX || qid >= DAO_VIRTIO_MAX_QUEUES || !occ)
+		return -EINVAL;
+
+	q = dao_virtio_netdevs[devid].qs[qid];
+	if (!q)
+		return -ENOENT;
+
+	sd_desc_off = __atomic_load_n(&q->sd_desc_off, __ATOMIC_ACQUIRE);
+	occ->ready = desc_off_diff(sd_desc_off, q->last_off, q->q_sz);
+	occ->inflight = __atomic_load_n(&q->pend_sd_desc, __ATOMIC_RELAXED);
+	occ->window = q->desc_throttle;
+	return 0;
+}
+
 int
 dao_virtio_netdev_queue_count_max(uint16_t pem_devid, uint16_t devid)
 {
@@ -956,6 +1444,10 @@ virtio_net_desc_validate(struct virtio_net_queue *q, uint16_t start, uint16_t co
 	uint64_t flags;
 	int i;
 
+	/* Split virt queue descriptors don't carry avail/used state */
+	if (virtio_dev_is_split(dev))
+		return;
+
 	for (i = 0; i < count; i++) {
 		off = desc_off_add(start, i, q_sz);
 
@@ -995,35 +1487,233 @@ virtio_net_desc_validate(struct virtio_net_queue *q, uint16_t start, uint16_t co
 	}
 }
 
+/* Check if used offset moving from old to new passed driver event offset */
+static __rte_always_inline bool
+virtio_net_need_event(uint16_t event, uint16_t new, uint16_t old, uint16_t q_sz)
+{
+	uint16_t mask = (q_sz << 1) - 1;
+
+	/* Offsets carry wrap counter in bit 15, linearize them over two laps of ring */
+	event = (event & (q_sz - 1)) | ((event & RTE_BIT64(15)) ? q_sz : 0);
+	new = DESC_OFF(new) | ((new & RTE_BIT64(15)) ? q_sz : 0);
+	old = DESC_OFF(old) | ((old & RTE_BIT64(15)) ? q_sz : 0);
+
+	return ((uint16_t)(new - event - 1) & mask) < ((uint16_t)(new - old) & mask);
+}
+
+static __rte_always_inline bool
+virtio_net_event_check(struct virtio_net_queue *q, const uint16_t flags)
+{
+	struct vring_packed_desc_event *event;
+	struct vring_avail *avail;
+
+	if (flags & VIRTIO_NET_DESC_MANAGE_SPLIT) {
+		avail = (struct vring_avail *)q->sd_driver_area;
+		/* With event index, used_event is fetched in place of avail index */
+		if (q->event_idx)
+			return virtio_net_need_event(split_idx_to_desc_off(avail->idx, q->q_sz),
+						     q->intr_event_off, q->intr_sig_off, q->q_sz);
+		return !(avail->flags & VRING_AVAIL_F_NO_INTERRUPT);
+	}
+
+	event = (struct vring_packed_desc_event *)q->sd_driver_area;
+	if (q->event_idx && event->desc_event_flags == RING_EVENT_FLAGS_DESC)
+		return virtio_net_need_event(event->desc_event_off_wrap, q->intr_event_off,
+					     q->intr_sig_off, q->q_sz);
+	return event->desc_event_flags != RING_EVENT_FLAGS_DISABLE;
+}
+
+static __rte_always_inline bool
+virtio_net_event_fetch(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
+		       const uint16_t flags)
+{
+	uint32_t len = sizeof(struct vring_packed_desc_event);
+	uintptr_t src = q->driver_area;
+	uintptr_t dst = q->sd_driver_area;
+
+	/* Only interrupt suppression flag of avail ring header for split virtqueue, or
+	 * used_event after avail ring with event index.
+	 */
+	if (flags & VIRTIO_NET_DESC_MANAGE_SPLIT) {
+		len = sizeof(uint16_t);
+		if (q->event_idx) {
+			src += offsetof(struct vring_avail, ring) + q->q_sz * sizeof(uint16_t);
+			dst += offsetof(struct vring_avail, idx);
+		}
+	}
+
+	if (!dao_dma_flush(dev2mem, 1))
+		return false;
+
+	dao_dma_enq_x1(dev2mem, (rte_iova_t)src, len, (rte_iova_t)dst, len);
+	q->pend_event_idx = dev2mem->tail;
+	q->pend_event = 1;
+	return true;
+}
+
+static __rte_always_inline void
+virtio_net_intr_adapt(struct virtio_net_queue *q, uint64_t now)
+{
+	uint64_t win = rte_get_tsc_hz() >> VIRTIO_NET_INTR_ADAPT_WIN_SHIFT;
+	uint64_t elapsed = now - q->intr_win_tsc;
+	uint8_t level = q->intr_level;
+	uint32_t target = 0;
+	uint64_t pkts;
+
+	if (elapsed < win)
+		return;
+
+	/* Scale used buffers to a window so that idle time brings rate down */
+	pkts = (q->intr_win_pkts * win) / elapsed;
+	while (target < RTE_DIM(virtio_net_intr_profile_thr) &&
+	       pkts >= virtio_net_intr_profile_thr[target])
+		target++;
+
+	/* Move one profile at a time to avoid oscillation on bursty traffic */
+	if (target > level)
+		level++;
+	else if (target < level)
+		level--;
+
+	if (level != q->intr_level) {
+		q->intr_level = level;
+		q->intr_max_pkts = virtio_net_intr_profiles[level].max_pkts;
+		q->intr_max_tsc =
+			(rte_get_tsc_hz() * virtio_net_intr_profiles[level].usecs) / 1000000;
+	}
+	q->intr_win_pkts = 0;
+	q->intr_win_tsc = now;
+}
+
+static __rte_always_inline void
+virtio_net_intr_used(struct virtio_net_queue *q)
+{
+	if (q->intr_used_off == q->intr_sig_off)
+		q->intr_tsc = rte_rdtsc();
+	q->intr_win_pkts += desc_off_diff(q->intr_compl_off, q->intr_used_off, q->q_sz);
+	q->intr_used_off = q->intr_compl_off;
+	q->pend_compl = 0;
+}
+
+static __rte_always_inline void
+virtio_net_event_signal(struct virtio_net_queue *q, const uint16_t flags)
+{
+	q->pend_event = 0;
+	if (virtio_net_event_check(q, flags)) {
+		__atomic_store_n(q->cb_notify_addr, 1, __ATOMIC_RELAXED);
+		__atomic_store_n(q->cb_intr_addr, (1UL << 59), __ATOMIC_RELAXED);
+	}
+	/* Buffers used after event fetch are checked against a fresh event */
+	q->intr_sig_off = q->intr_event_off;
+}
+
+static __rte_always_inline void
+virtio_net_compl_stats(struct virtio_net_queue *q, uint16_t nb_desc)
+{
+	if (!virtio_net_has_stats_feature())
+		return;
+
+	q->svc_stats.desc_used += nb_desc;
+	if (nb_desc > q->svc_stats.compl_lag_max)
+		q->svc_stats.compl_lag_max = nb_desc;
+}
+
+static __rte_always_inline void
+virtio_net_dma_fail_stats(struct virtio_net_queue *q)
+{
+	if (virtio_net_has_stats_feature())
+		q->svc_stats.dma_fails++;
+}
+
+/* Moderate and deliver host interrupt for used buffers of Host Rx queue */
+static __rte_always_inline void
+virtio_net_intr_process(struct virtio_net_queue *q, struct dao_dma_vchan_state *dev2mem,
+			struct dao_dma_vchan_state *mem2dev, const uint16_t flags)
+{
+	uint16_t nb_used;
+	uint64_t now;
+
+	/* Used buffers are visible to driver once their DMA completes */
+	if (q->pend_compl && dao_dma_op_status(mem2dev, q->pend_compl_idx))
+		virtio_net_intr_used(q);
+
+	if (q->pend_event) {
+		if (!dao_dma_op_status(dev2mem, q->pend_event_idx))
+			return;
+
+		virtio_net_event_signal(q, flags);
+		return;
+	}
+
+	if (q->intr_used_off == q->intr_sig_off)
+		return;
+
+	now = rte_rdtsc();
+	if (q->intr_adaptive)
+		virtio_net_intr_adapt(q, now);
+
+	/* Hold interrupt till enough buffers are used or hold time elapses */
+	nb_used = desc_off_diff(q->intr_used_off, q->intr_sig_off, q->q_sz);
+	if (nb_used < q->intr_max_pkts && (now - q->intr_tsc) < q->intr_max_tsc)
+		return;
+
+	/* Driver event is fetched after used buffers are visible so that a driver
+	 * re-enabling events after its last poll is not missed.
+	 */
+	if (virtio_net_event_fetch(q, dev2mem, flags))
+		q->intr_event_off = q->intr_used_off;
+}
+
 static  __rte_always_inline int
-virtio_net_desc_manage(uint16_t devid, uint16_t qp_count, const uint16_t flags)
+virtio_net_desc_manage(uint16_t devid, uint16_t qp_start, uint16_t nb_qps, const uint16_t flags)
 {
 	struct dao_virtio_netdev *virtio_netdev = &dao_virtio_netdevs[devid];
 	struct virtio_netdev *netdev = virtio_netdev_priv(virtio_netdev);
-	struct dao_dma_vchan_info *vchan_info = RTE_PER_LCORE(dao_dma_vchan_info);
 	struct dao_dma_vchan_state *dev2mem, *mem2dev;
 	struct rte_dma_sge *src, *dst;
 	struct virtio_net_queue *q;
 	uint16_t compl_off, q_sz;
 	uint16_t off, sg_i = 0;
-	uint16_t dma_vchan;
+	uint16_t dma_vchan, qp_end;
 	uint16_t nb_desc;
 	int i;
 
-	if (unlikely(!netdev->qs[qp_count * 2 - 1]))
+	qp_end = qp_start + nb_qps;
+	if (unlikely(!netdev->qs[qp_end * 2 - 1]))
 		return 0;
 
-	dma_vchan = netdev->qs[0]->dma_vchan;
-	dev2mem = &vchan_info->dev2mem[dma_vchan];
-	mem2dev = &vchan_info->mem2dev[dma_vchan];
+	dma_vchan = netdev->qs[qp_start * 2]->dma_vchan;
+	/* All queues of a device share vchan state of this lcore to batch descriptor fetch */
+	dev2mem = dao_dma_lcore_dev2mem_get(dma_vchan, devid);
+	mem2dev = dao_dma_lcore_mem2dev_get(dma_vchan, devid);
 
 	/* Fetch all DMA completed status */
 	dao_dma_check_meta_compl(dev2mem, 1 /* ATOMIC update */);
 	dao_dma_check_meta_compl(mem2dev, 1 /* ATOMIC update */);
 
-	for (i = 0; i < qp_count; i++) {
-		if (!dao_dma_flush(dev2mem, DAO_DMA_MAX_POINTER))
+	for (i = qp_start; i < qp_end; i++) {
+		if (flags & VIRTIO_NET_DESC_MANAGE_SPLIT) {
+			/* Populate pointers for Host Rx and Tx queue */
+			if (!fetch_split_desc(netdev->qs[(i * 2)], dev2mem, false, flags) ||
+			    !fetch_split_desc(netdev->qs[(i * 2) + 1], dev2mem, true, flags) ||
+			    !fetch_ind_desc(netdev->qs[(i * 2) + 1], dev2mem, flags)) {
+				virtio_net_dma_fail_stats(netdev->qs[(i * 2) + 1]);
+				break;
+			}
+			/* Keep driver kicking for buffers made available next */
+			q = netdev->qs[(i * 2)];
+			if (q->event_idx) {
+				virtio_net_avail_event_update(q, dev2mem, mem2dev);
+				virtio_net_avail_event_update(netdev->qs[(i * 2) + 1], dev2mem,
+							      mem2dev);
+			}
+			continue;
+		}
+
+		if (!dao_dma_flush(dev2mem, DAO_DMA_MAX_POINTER)) {
+			virtio_net_dma_fail_stats(netdev->qs[(i * 2)]);
 			break;
+		}
 
 		/* Populate pointers for Host Rx queue */
 		q = netdev->qs[(i * 2)];
@@ -1033,8 +1723,10 @@ virtio_net_desc_manage(uint16_t devid, uint16_t qp_count, const uint16_t flags)
 		dev2mem->src_i += sg_i;
 		dev2mem->dst_i += sg_i;
 
-		if (!dao_dma_flush(dev2mem, DAO_DMA_MAX_POINTER))
+		if (!dao_dma_flush(dev2mem, DAO_DMA_MAX_POINTER)) {
+			virtio_net_dma_fail_stats(q);
 			break;
+		}
 
 		/* Populate pointers for Host Tx queue */
 		q = netdev->qs[(i * 2) + 1];
@@ -1043,10 +1735,16 @@ virtio_net_desc_manage(uint16_t devid, uint16_t qp_count, const uint16_t flags)
 		sg_i = fetch_deq_desc_prep(q, dev2mem, src, dst, flags);
 		dev2mem->src_i += sg_i;
 		dev2mem->dst_i += sg_i;
+
+		/* Fetch indirect tables of Host Tx queue descriptors */
+		if (!fetch_ind_desc(q, dev2mem, flags)) {
+			virtio_net_dma_fail_stats(q);
+			break;
+		}
 	}
 
 	/* Process Host Tx queue completion marking */
-	for (i = 0; i < qp_count; i++) {
+	for (i = qp_start; i < qp_end; i++) {
 		q = netdev->qs[(i * 2) + 1];
 
 		off = __atomic_load_n(&q->last_off, __ATOMIC_ACQUIRE);
@@ -1055,38 +1753,44 @@ virtio_net_desc_manage(uint16_t devid, uint16_t qp_count, const uint16_t flags)
 		if (compl_off == off)
 			continue;
 
-		/* Need space for at least 1 pointer */
-		if (!dao_dma_flush(mem2dev, 1))
+		/* Need space for at least 1 pointer, 3 for split used ring and index */
+		if (!dao_dma_flush(mem2dev, (flags & VIRTIO_NET_DESC_MANAGE_SPLIT) ? 3 : 1)) {
+			virtio_net_dma_fail_stats(q);
 			break;
+		}
 
 		nb_desc = desc_off_diff(off, compl_off, q_sz);
+		virtio_net_compl_stats(q, nb_desc);
 
 		/* Enqueue Rx completion DMA */
 		mark_deq_compl(q, mem2dev, compl_off, nb_desc, flags);
 		q->compl_off = off;
+
+		/* Store tail to quiesce queue before handing it to another lcore */
+		q->pend_compl_idx = mem2dev->tail;
+		q->pend_compl = 1;
 	}
 
 	/* Process Host Rx queue completion marking */
-	for (i = 0; i < qp_count; i++) {
+	for (i = qp_start; i < qp_end; i++) {
 		q = netdev->qs[(i * 2)];
 
 		/* Check descriptor DMA completion and trigger host interrupt */
-		if (q->cb_intr_addr && q->pend_compl &&
-		    dao_dma_op_status(mem2dev, q->pend_compl_idx)) {
-			__atomic_store_n(q->cb_notify_addr, 1, __ATOMIC_RELAXED);
-			__atomic_store_n(q->cb_intr_addr, (1UL << 59), __ATOMIC_RELAXED);
-			q->pend_compl = 0;
-		}
+		if (q->cb_intr_addr)
+			virtio_net_intr_process(q, dev2mem, mem2dev, flags);
 
 		off = __atomic_load_n(&q->sd_mbuf_off, __ATOMIC_ACQUIRE);
 		compl_off = q->compl_off;
 		if (compl_off == off)
 			continue;
 
-		/* Need space for at least 2 pointer */
-		if (!dao_dma_flush(mem2dev, 2))
+		/* Need space for at least 2 pointer, 3 for split used ring and index */
+		if (!dao_dma_flush(mem2dev, (flags & VIRTIO_NET_DESC_MANAGE_SPLIT) ? 3 : 2)) {
+			virtio_net_dma_fail_stats(q);
 			break;
+		}
 
+		virtio_net_compl_stats(q, desc_off_diff(off, compl_off, q->q_sz));
 		/* Enqueue Tx completion DMA */
 		mark_enq_compl(q, mem2dev, compl_off, off, flags);
 		q->compl_off = off;
@@ -1094,11 +1798,84 @@ virtio_net_desc_manage(uint16_t devid, uint16_t qp_count, const uint16_t flags)
 		/* Store tail to check descriptor DMA completion */
 		q->pend_compl_idx = mem2dev->tail;
 		q->pend_compl = 1;
+		q->intr_compl_off = off;
 	}
 
 	return 0;
 }
 
+int
+dao_virtio_net_desc_manage_quiesce(uint16_t devid, uint16_t qp_start, uint16_t nb_qps)
+{
+	struct dao_virtio_netdev *virtio_netdev = &dao_virtio_netdevs[devid];
+	struct virtio_netdev *netdev = virtio_netdev_priv(virtio_netdev);
+	const uint16_t flags = virtio_netdev->mgmt_fn_id;
+	struct dao_dma_vchan_state *dev2mem, *mem2dev;
+	struct virtio_net_queue *q;
+	uint16_t dma_vchan, qp_end;
+	int rc = 0, i;
+
+	qp_end = qp_start + nb_qps;
+	if (!nb_qps || qp_end * 2 > DAO_VIRTIO_MAX_QUEUES)
+		return -EINVAL;
+
+	/* Nothing could have been issued on queues not yet setup */
+	if (!netdev->qs[qp_end * 2 - 1])
+		return 0;
+
+	dma_vchan = netdev->qs[qp_start * 2]->dma_vchan;
+	dev2mem = dao_dma_lcore_dev2mem_get(dma_vchan, devid);
+	mem2dev = dao_dma_lcore_mem2dev_get(dma_vchan, devid);
+
+	dao_dma_check_meta_compl(dev2mem, 1 /* ATOMIC update */);
+	dao_dma_check_meta_compl(mem2dev, 1 /* ATOMIC update */);
+
+	/* Push out partially built ops so that their completion can be tracked */
+	if (!dao_dma_flush(dev2mem, DAO_DMA_MAX_POINTER) ||
+	    !dao_dma_flush(mem2dev, DAO_DMA_MAX_POINTER))
+		return -EAGAIN;
+
+	for (i = qp_start; i < qp_end; i++) {
+		/* Host Rx queue */
+		q = netdev->qs[i * 2];
+		if (q->pend_sd_desc || q->pend_sd_avail || q->pend_avail_event)
+			rc = -EAGAIN;
+
+		if (q->pend_compl) {
+			if (dao_dma_op_status(mem2dev, q->pend_compl_idx))
+				virtio_net_intr_used(q);
+			else
+				rc = -EAGAIN;
+		}
+
+		/* Deliver interrupt for an event fetched by this lcore */
+		if (q->pend_event) {
+			if (dao_dma_op_status(dev2mem, q->pend_event_idx))
+				virtio_net_event_signal(q, flags);
+			else
+				rc = -EAGAIN;
+		}
+
+		/* Host Tx queue */
+		q = netdev->qs[(i * 2) + 1];
+		if (q->pend_sd_desc || q->pend_sd_avail || q->pend_sd_ind || q->pend_avail_event)
+			rc = -EAGAIN;
+
+		if (q->pend_compl) {
+			if (dao_dma_op_status(mem2dev, q->pend_compl_idx))
+				q->pend_compl = 0;
+			else
+				rc = -EAGAIN;
+		}
+	}
+
+	/* Make shadow state visible to the lcore taking over the queues */
+	if (!rc)
+		rte_smp_wmb();
+
+	return rc;
+}
+
 int
 dao_virtio_netdev_link_sts_update(uint16_t devid, struct dao_virtio_netdev_link_info *link_info)
 {
@@ -1122,9 +1899,9 @@ dao_virtio_netdev_link_sts_update(uint16_t devid, struct dao_virtio_netdev_link_
 }
 
 #define M(name, flags)                                                                             \
-	int virtio_net_desc_manage_##name(uint16_t devid, uint16_t qp_count)                       \
+	int virtio_net_desc_manage_##name(uint16_t devid, uint16_t qp_start, uint16_t nb_qps)      \
 	{                                                                                          \
-		return virtio_net_desc_manage(devid, qp_count, (flags));                           \
+		return virtio_net_desc_manage(devid, qp_start, nb_qps, (flags));                   \
 	}
 
 VIRTIO_NET_DESC_MANAGE_MODES
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: Marvell-MIT
+ * Copyright (c) 2024 Marvell.
+ */
+
+#ifndef __DAO_TEST_H__
+#define __DAO_TEST_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dao_log.h"
+
+/* Exit code reported by meson as a skipped test */
+#define TEST_SKIPPED 77
+
+/* Argument after EAL ones selecting perf cases, passed by meson benchmark() */
+#define TEST_PERF_ARG "perf"
+
+#define TEST_ASSERT(cond, ...)                                                                     \
+	do {                                                                                       \
+		if (!(cond)) {                                                                     \
+			dao_err(__VA_ARGS__);                                                      \
+			return -1;                                                                 \
+		}                                                                                  \
+	} while (0)
+
+struct dao_test_case {
+	const char *name;
+	int (*fn)(void);
+};
+
+/* Check whether perf cases are requested by application arguments left after EAL ones */
+static inline bool
+dao_test_perf_mode(int argc, char *argv[])
+{
+	return argc > 1 && !strcmp(argv[1], TEST_PERF_ARG);
+}
+
+/* Run cases in order till first failure, returns exit code of test executable */
+static inline int
+dao_test_run(const struct dao_test_case *cases, uint32_t nb_cases)
+{
+	uint32_t i;
+	int rc;
+
+	for (i = 0; i < nb_cases; i++) {
+		rc = cases[i].fn();
+		printf("%-20s %s\n", cases[i].name, rc ? "FAIL" : "OK");
+		if (rc)
+			return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+#endif /* __DAO_TEST_H__ */
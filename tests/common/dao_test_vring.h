@@ -0,0 +1,124 @@
+/* SPDX-License-Identifier: Marvell-MIT
+ * Copyright (c) 2024 Marvell.
+ */
+
+#ifndef __DAO_TEST_VRING_H__
+#define __DAO_TEST_VRING_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <rte_atomic.h>
+#include <rte_common.h>
+
+#include "spec/virtio.h"
+
+/* Largest ring driven by test driver */
+#define DAO_TEST_VRING_SZ_MAX 256
+
+/* Driver side of a packed virtqueue in local memory, device reads it at its own address */
+struct dao_test_vring {
+	struct vring_packed_desc *desc;
+	/* Notify word polled by device, next avail offset with wrap bit in upper half */
+	uint32_t notify;
+	uint16_t q_sz;
+	/* Ring offsets with wrap bit */
+	uint16_t avail_off;
+	uint16_t used_off;
+	uint16_t id;
+	/* Descriptors of chain posted at each head */
+	uint16_t nb_desc[DAO_TEST_VRING_SZ_MAX];
+};
+
+struct dao_test_vring_seg {
+	void *buf;
+	uint32_t len;
+	bool write;
+};
+
+static inline void
+dao_test_vring_init(struct dao_test_vring *vr, struct vring_packed_desc *desc, uint16_t q_sz)
+{
+	memset(vr, 0, sizeof(*vr));
+	memset(desc, 0, q_sz * sizeof(*desc));
+	vr->desc = desc;
+	vr->q_sz = q_sz;
+	/* Wrap counters start at 1 */
+	vr->avail_off = RTE_BIT32(15);
+	vr->used_off = RTE_BIT32(15);
+	vr->notify = (uint32_t)vr->avail_off << 16;
+}
+
+static inline uint16_t
+dao_test_vring_off_add(struct dao_test_vring *vr, uint16_t off, uint16_t n)
+{
+	uint16_t pos = (off & (RTE_BIT32(15) - 1)) + n;
+
+	if (pos < vr->q_sz)
+		return (off & RTE_BIT32(15)) | pos;
+	return ((off & RTE_BIT32(15)) ^ RTE_BIT32(15)) | (pos - vr->q_sz);
+}
+
+/* Free ring entries, one chain per head */
+static inline uint16_t
+dao_test_vring_free(struct dao_test_vring *vr)
+{
+	uint16_t a = vr->avail_off & (RTE_BIT32(15) - 1);
+	uint16_t u = vr->used_off & (RTE_BIT32(15) - 1);
+
+	if ((vr->avail_off ^ vr->used_off) & RTE_BIT32(15))
+		return u - a;
+	return vr->q_sz - (a - u);
+}
+
+/* Post a chain and notify device, returns head offset */
+static inline uint16_t
+dao_test_vring_post(struct dao_test_vring *vr, const struct dao_test_vring_seg *segs, uint16_t nb)
+{
+	uint16_t head = vr->avail_off, off = head, flags, i;
+	struct vring_packed_desc *d;
+
+	for (i = 0; i < nb; i++) {
+		d = &vr->desc[off & (RTE_BIT32(15) - 1)];
+		flags = (off & RTE_BIT32(15)) ? VRING_PACKED_DESC_F_AVAIL :
+						VRING_PACKED_DESC_F_USED;
+		if (i != nb - 1)
+			flags |= VRING_DESC_F_NEXT;
+		if (segs[i].write)
+			flags |= VRING_DESC_F_WRITE;
+		d->addr = (uintptr_t)segs[i].buf;
+		d->len = segs[i].len;
+		d->id = vr->id;
+		d->flags = flags;
+		off = dao_test_vring_off_add(vr, off, 1);
+	}
+	vr->id = (vr->id + 1) % vr->q_sz;
+	vr->nb_desc[head & (RTE_BIT32(15) - 1)] = nb;
+	vr->avail_off = off;
+
+	rte_wmb();
+	__atomic_store_n(&vr->notify, (uint32_t)off << 16, __ATOMIC_RELAXED);
+	return head;
+}
+
+/* Reap used descriptor of oldest posted chain, returns false if device has not used it */
+static inline bool
+dao_test_vring_used(struct dao_test_vring *vr, uint32_t *len)
+{
+	struct vring_packed_desc *d = &vr->desc[vr->used_off & (RTE_BIT32(15) - 1)];
+	uint16_t flags = __atomic_load_n(&d->flags, __ATOMIC_ACQUIRE);
+	bool wrap = !!(vr->used_off & RTE_BIT32(15));
+	uint16_t nb;
+
+	if (vr->used_off == vr->avail_off || !!(flags & VRING_PACKED_DESC_F_USED) != wrap ||
+	    !!(flags & VRING_PACKED_DESC_F_AVAIL) != wrap)
+		return false;
+
+	*len = d->len;
+	nb = vr->nb_desc[vr->used_off & (RTE_BIT32(15) - 1)];
+	vr->used_off = dao_test_vring_off_add(vr, vr->used_off, nb);
+	return true;
+}
+
+#endif /* __DAO_TEST_VRING_H__ */
@@ -0,0 +1,392 @@
+/* SPDX-License-Identifier: Marvell-MIT
+ * Copyright (c) 2024 Marvell.
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_dmadev.h>
+#include <rte_eal.h>
+#include <rte_launch.h>
+#include <rte_malloc.h>
+#include <rte_random.h>
+
+#include "dao_dma.h"
+#include "dao_log.h"
+
+#include "dao_test.h"
+
+#define TEST_BUF_SZ  8192
+#define TEST_MAX_LEN 128
+
+static uint8_t *src_buf;
+static uint8_t *dst_buf;
+static int16_t dma_devid;
+
+static void
+test_bufs_reset(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < TEST_BUF_SZ; i++)
+		src_buf[i] = rte_rand();
+	memset(dst_buf, 0, TEST_BUF_SZ);
+}
+
+static rte_iova_t
+test_iova(void *va)
+{
+	return rte_malloc_virt2iova(va);
+}
+
+/* Flush all pointers, submit and reap completions of a vchan */
+static int
+test_vchan_drain(struct dao_dma_vchan_state *vchan)
+{
+	dao_dma_flush_submit();
+	TEST_ASSERT(!vchan->src_i && !vchan->dst_i, "Pointers left after flush, src %u dst %u",
+		    vchan->src_i, vchan->dst_i);
+
+	dao_dma_check_compl(vchan);
+	TEST_ASSERT(vchan->head == vchan->tail, "Ops not completed, head %u tail %u", vchan->head,
+		    vchan->tail);
+	return 0;
+}
+
+static int
+test_copy_x1(void)
+{
+	struct dao_dma_vchan_state *vchan = dao_dma_lcore_dev2mem_get(0, 0);
+	uint16_t first_op = vchan->tail;
+	uint32_t off = 0, len;
+
+	test_bufs_reset();
+	while (off < TEST_BUF_SZ) {
+		len = (rte_rand() % TEST_MAX_LEN) + 1;
+		len = RTE_MIN(len, TEST_BUF_SZ - off);
+		if (!dao_dma_avail(vchan))
+			TEST_ASSERT(dao_dma_flush(vchan, 1), "Flush failed at offset %u", off);
+		dao_dma_enq_x1(vchan, test_iova(src_buf + off), len, test_iova(dst_buf + off), len);
+		off += len;
+	}
+
+	if (test_vchan_drain(vchan))
+		return -1;
+
+	TEST_ASSERT(vchan->tail != first_op, "No ops were issued");
+	TEST_ASSERT(dao_dma_op_status(vchan, first_op), "First op %u not reported done",
+		    first_op);
+	TEST_ASSERT(!memcmp(src_buf, dst_buf, TEST_BUF_SZ), "Data mismatch");
+	return 0;
+}
+
+static int
+test_copy_sg_split(void)
+{
+	struct dao_dma_vchan_state *vchan = dao_dma_lcore_mem2dev_get(0, 0);
+	const uint32_t src_len[] = {100, 200, 300, 424};
+	const uint32_t dst_len[] = {250, 350, 1, 423};
+	uint32_t off, i;
+
+	test_bufs_reset();
+	TEST_ASSERT(dao_dma_flush(vchan, RTE_DIM(src_len)), "Flush failed");
+
+	/* Source and destination lists are split at different offsets */
+	for (i = 0, off = 0; i < RTE_DIM(src_len); off += src_len[i], i++)
+		dao_dma_enq_src_x1(vchan, test_iova(src_buf + off), src_len[i]);
+	for (i = 0, off = 0; i < RTE_DIM(dst_len); off += dst_len[i], i++)
+		dao_dma_enq_dst_x1(vchan, test_iova(dst_buf + off), dst_len[i]);
+
+	if (test_vchan_drain(vchan))
+		return -1;
+
+	TEST_ASSERT(!memcmp(src_buf, dst_buf, off), "Data mismatch");
+	TEST_ASSERT(dst_buf[off] == 0, "Copy overran destination");
+	return 0;
+}
+
+static int
+test_copy_x4(void)
+{
+	struct dao_dma_vchan_state *vchan = dao_dma_lcore_dev2mem_get(0, 0);
+	uint64x2_t vsrc[4], vdst[4];
+	uint32_t off = 0, len, i;
+	uint16_t n;
+
+	test_bufs_reset();
+	while (off + 4 * TEST_MAX_LEN <= TEST_BUF_SZ) {
+		for (i = 0; i < 4; i++) {
+			len = (rte_rand() % TEST_MAX_LEN) + 1;
+			vsrc[i] = vsetq_lane_u64(test_iova(src_buf + off), vdupq_n_u64(len), 0);
+			vdst[i] = vsetq_lane_u64(test_iova(dst_buf + off), vdupq_n_u64(len), 0);
+			off += len;
+		}
+
+		/* Pointers not taken due to full vchan are enqueued after a flush */
+		n = dao_dma_enq_x4(vchan, vsrc, vdst);
+		for (i = n; i < 4; i++) {
+			TEST_ASSERT(dao_dma_flush(vchan, 1), "Flush failed at offset %u", off);
+			dao_dma_enq_x1(vchan, vgetq_lane_u64(vsrc[i], 0),
+				       vgetq_lane_u64(vsrc[i], 1), vgetq_lane_u64(vdst[i], 0),
+				       vgetq_lane_u64(vdst[i], 1));
+		}
+	}
+
+	if (test_vchan_drain(vchan))
+		return -1;
+
+	TEST_ASSERT(!memcmp(src_buf, dst_buf, off), "Data mismatch");
+	return 0;
+}
+
+static int
+test_meta_compl(void)
+{
+	struct dao_dma_vchan_state *vchan = dao_dma_lcore_mem2dev_get(0, 0);
+	uint16_t val = 0, pend = 3;
+
+	test_bufs_reset();
+	TEST_ASSERT(dao_dma_flush(vchan, 1), "Flush failed");
+	dao_dma_enq_x1(vchan, test_iova(src_buf), 64, test_iova(dst_buf), 64);
+	dao_dma_update_cmpl_meta(vchan, &val, 42, &pend, 3, vchan->tail);
+
+	dao_dma_flush_submit();
+	dao_dma_check_meta_compl(vchan, 1);
+
+	TEST_ASSERT(vchan->head == vchan->tail, "Ops not completed, head %u tail %u", vchan->head,
+		    vchan->tail);
+	TEST_ASSERT(val == 42, "Completion value not written, got %u", val);
+	TEST_ASSERT(pend == 0, "Pending count not released, got %u", pend);
+	TEST_ASSERT(!memcmp(src_buf, dst_buf, 64), "Data mismatch");
+	return 0;
+}
+
+static int
+test_compl_wait(void)
+{
+	struct dao_dma_vchan_state *d2m = dao_dma_lcore_dev2mem_get(0, 0);
+	struct dao_dma_vchan_state *m2d = dao_dma_lcore_mem2dev_get(0, 0);
+
+	test_bufs_reset();
+	TEST_ASSERT(dao_dma_flush(d2m, 1) && dao_dma_flush(m2d, 1), "Flush failed");
+	dao_dma_enq_x1(d2m, test_iova(src_buf), 128, test_iova(dst_buf), 128);
+	dao_dma_enq_x1(m2d, test_iova(src_buf + 128), 128, test_iova(dst_buf + 128), 128);
+
+	/* Calling lcore owns the vchans, wait progresses them itself */
+	TEST_ASSERT(!dao_dma_compl_wait(0), "Wait failed");
+
+	TEST_ASSERT(d2m->head == d2m->tail && m2d->head == m2d->tail,
+		    "Ops not completed on wait return");
+	TEST_ASSERT(!memcmp(src_buf, dst_buf, 256), "Data mismatch");
+	return 0;
+}
+
+static int
+test_cpu_copy(void)
+{
+	struct dao_dma_vchan_state *vchan = dao_dma_lcore_mem2dev_get(0, 0);
+	uint64_t cpu_ops = vchan->cpu_ops;
+	uint16_t tail;
+
+	/* Destination buffer acts as host window mapped at its own address */
+	test_bufs_reset();
+	TEST_ASSERT(!dao_dma_lcore_mem2dev_cpu_copy_set(dma_devid, 0, 16, test_iova(dst_buf),
+							  dst_buf, TEST_BUF_SZ / 2),
+		    "CPU copy set failed");
+	TEST_ASSERT(dao_dma_flush(vchan, 4), "Flush failed");
+	tail = vchan->tail;
+
+	/* Small transfer in window is done right away, without a DMA op */
+	TEST_ASSERT(dao_dma_enq_meta_x1(vchan, test_iova(src_buf), test_iova(dst_buf), 16),
+		    "Small transfer not done by CPU");
+	TEST_ASSERT(!memcmp(src_buf, dst_buf, 16), "CPU copy data mismatch");
+	TEST_ASSERT(!vchan->src_i && vchan->tail == tail, "CPU copy consumed a DMA pointer");
+
+	/* Transfers above threshold or crossing window end go to DMA */
+	TEST_ASSERT(!dao_dma_enq_meta_x1(vchan, test_iova(src_buf + 64), test_iova(dst_buf + 64),
+					 17),
+		    "Large transfer done by CPU");
+	if (test_vchan_drain(vchan))
+		return -1;
+	TEST_ASSERT(!memcmp(src_buf + 64, dst_buf + 64, 17), "Large transfer data mismatch");
+
+	TEST_ASSERT(dao_dma_flush(vchan, 4), "Flush failed");
+	TEST_ASSERT(!dao_dma_enq_meta_x1(vchan, test_iova(src_buf + 128),
+					 test_iova(dst_buf + (TEST_BUF_SZ / 2) - 8), 16),
+		    "Transfer crossing window done by CPU");
+	if (test_vchan_drain(vchan))
+		return -1;
+	TEST_ASSERT(!memcmp(src_buf + 128, dst_buf + (TEST_BUF_SZ / 2) - 8, 16),
+		    "Transfer crossing window data mismatch");
+
+	/* Pointers waiting to be flushed must not be overtaken */
+	TEST_ASSERT(dao_dma_flush(vchan, 4), "Flush failed");
+	dao_dma_enq_x1(vchan, test_iova(src_buf + 256), 8, test_iova(dst_buf + 256), 8);
+	TEST_ASSERT(!dao_dma_enq_meta_x1(vchan, test_iova(src_buf + 264), test_iova(dst_buf + 264),
+					 8),
+		    "CPU copy overtook pending pointers");
+	if (test_vchan_drain(vchan))
+		return -1;
+	TEST_ASSERT(!memcmp(src_buf + 256, dst_buf + 256, 16), "Pending transfers data mismatch");
+
+	if (dao_dma_has_stats_feature())
+		TEST_ASSERT(vchan->cpu_ops == cpu_ops + 1, "CPU ops %" PRIu64 " expected %" PRIu64,
+			    vchan->cpu_ops, cpu_ops + 1);
+
+	TEST_ASSERT(!dao_dma_lcore_mem2dev_cpu_copy_set(dma_devid, 0, 0, 0, NULL, 0),
+		    "CPU copy disable failed");
+	return 0;
+}
+
+/* Worker enqueues an op and returns without flushing it */
+static int
+test_worker_enq(void *arg)
+{
+	struct dao_dma_vchan_state *vchan;
+	uint32_t off = *(uint32_t *)arg;
+
+	if (dao_dma_lcore_dev2mem_set(dma_devid, 1, 0))
+		return -1;
+	if (dao_dma_lcore_mem2dev_set(dma_devid, 1, 0))
+		return -1;
+
+	vchan = dao_dma_lcore_dev2mem_get(0, 0);
+	dao_dma_enq_x1(vchan, test_iova(src_buf + off), 128, test_iova(dst_buf + off), 128);
+	return 0;
+}
+
+static int
+test_compl_wait_stopped(void)
+{
+	uint32_t lcore_id, off = 512;
+
+	lcore_id = rte_get_next_lcore(-1, 1, 0);
+	if (lcore_id >= RTE_MAX_LCORE) {
+		printf("No worker lcore, stopped lcore wait not tested\n");
+		return 0;
+	}
+
+	test_bufs_reset();
+	TEST_ASSERT(!rte_eal_remote_launch(test_worker_enq, &off, lcore_id), "Launch failed");
+	TEST_ASSERT(!rte_eal_wait_lcore(lcore_id), "Worker failed to assign vchans");
+
+	/* Worker lcore no longer polls, wait has to complete its op itself */
+	TEST_ASSERT(!dao_dma_compl_wait(0), "Wait failed");
+
+	TEST_ASSERT(!memcmp(src_buf + off, dst_buf + off, 128), "Data mismatch");
+	return 0;
+}
+
+static uint32_t test_worker_ready;
+static uint32_t test_worker_release;
+
+/* Worker keeps running with an op outstanding and polls only once released */
+static int
+test_worker_enq_hold(void *arg)
+{
+	struct dao_dma_vchan_state *vchan;
+	uint32_t off = *(uint32_t *)arg, i;
+
+	if (!RTE_PER_LCORE(dao_dma_vchan_info) &&
+	    (dao_dma_lcore_dev2mem_set(dma_devid, 1, 0) ||
+	     dao_dma_lcore_mem2dev_set(dma_devid, 1, 0)))
+		return -1;
+
+	vchan = dao_dma_lcore_dev2mem_get(0, 0);
+	dao_dma_enq_x1(vchan, test_iova(src_buf + off), 128, test_iova(dst_buf + off), 128);
+	__atomic_store_n(&test_worker_ready, 1, __ATOMIC_RELEASE);
+
+	while (!__atomic_load_n(&test_worker_release, __ATOMIC_ACQUIRE))
+		rte_delay_us_sleep(100);
+
+	/* Takes the request left by timed out wait and completes it */
+	for (i = 0; i < 4; i++)
+		dao_dma_compl_poll();
+	return 0;
+}
+
+static int
+test_compl_wait_timeout(void)
+{
+	uint32_t lcore_id, off = 1024;
+	int rc;
+
+	lcore_id = rte_get_next_lcore(-1, 1, 0);
+	if (lcore_id >= RTE_MAX_LCORE) {
+		printf("No worker lcore, wait timeout not tested\n");
+		return 0;
+	}
+
+	test_bufs_reset();
+	test_worker_ready = 0;
+	test_worker_release = 0;
+	TEST_ASSERT(!rte_eal_remote_launch(test_worker_enq_hold, &off, lcore_id), "Launch failed");
+	while (!__atomic_load_n(&test_worker_ready, __ATOMIC_ACQUIRE))
+		rte_delay_us_sleep(100);
+
+	/* Worker is running but not polling, wait must not hang */
+	rc = dao_dma_compl_wait(0);
+	TEST_ASSERT(rc == -ETIMEDOUT, "Wait returned %d, expected timeout", rc);
+
+	/* Request outlives the wait and is completed by worker */
+	__atomic_store_n(&test_worker_release, 1, __ATOMIC_RELEASE);
+	TEST_ASSERT(!rte_eal_wait_lcore(lcore_id), "Worker failed");
+	TEST_ASSERT(!memcmp(src_buf + off, dst_buf + off, 128), "Data mismatch");
+	return 0;
+}
+
+static const struct dao_test_case tests[] = {
+	{"copy_x1", test_copy_x1},
+	{"copy_sg_split", test_copy_sg_split},
+	{"copy_x4", test_copy_x4},
+	{"meta_compl", test_meta_compl},
+	{"cpu_copy", test_cpu_copy},
+	{"compl_wait", test_compl_wait},
+	{"compl_wait_stopped", test_compl_wait_stopped},
+	{"compl_wait_timeout", test_compl_wait_timeout},
+};
+
+int
+main(int argc, char *argv[])
+{
+	int rc;
+
+	rc = rte_eal_init(argc, argv);
+	if (rc < 0)
+		rte_exit(EXIT_FAILURE, "Error with EAL initialization\n");
+
+	if (!dao_dma_has_sw_backend()) {
+		printf("DMA software backend not enabled at build, skipping\n");
+		rc = TEST_SKIPPED;
+		goto exit;
+	}
+
+	/* Device only anchors vchan state, copies are done by CPU */
+	dma_devid = rte_dma_next_dev(0);
+	if (dma_devid < 0) {
+		printf("No DMA device, e.g. --vdev=dma_skeleton, skipping\n");
+		rc = TEST_SKIPPED;
+		goto exit;
+	}
+
+	rc = dao_dma_lcore_dev2mem_set(dma_devid, 1, 0);
+	rc |= dao_dma_lcore_mem2dev_set(dma_devid, 1, 0);
+	if (rc)
+		rte_exit(EXIT_FAILURE, "Failed to assign DMA vchans to lcore\n");
+
+	src_buf = rte_malloc("dma_sw_src", TEST_BUF_SZ, RTE_CACHE_LINE_SIZE);
+	dst_buf = rte_malloc("dma_sw_dst", TEST_BUF_SZ, RTE_CACHE_LINE_SIZE);
+	if (!src_buf || !dst_buf)
+		rte_exit(EXIT_FAILURE, "Failed to allocate buffers\n");
+
+	rc = dao_test_run(tests, RTE_DIM(tests));
+
+	rte_free(src_buf);
+	rte_free(dst_buf);
+exit:
+	rte_eal_cleanup();
+	return rc;
+}
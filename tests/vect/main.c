@@ -0,0 +1,122 @@
+/* SPDX-License-Identifier: Marvell-MIT
+ * Copyright (c) 2024 Marvell.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_common.h>
+#include <rte_random.h>
+
+#include "vect_ops.h"
+
+#define TEST_ROUNDS 4096
+
+/* Scalar reference of each helper, NEON semantics */
+static void
+vect_ref_run(const struct vect_in *in, struct vect_out *out)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		out->dup32[i] = in->x32;
+		out->set32[i] = i == 2 ? in->x32 : in->a32[i];
+		out->sub32[i] = in->a32[i] - in->b32[i];
+		out->and32[i] = in->a32[i] & in->b32[i];
+		out->orr32[i] = in->a32[i] | in->b32[i];
+		out->shr32[i] = in->a32[i] >> 7;
+		out->cgt32[i] = in->a32[i] > in->b32[i] ? UINT32_MAX : 0;
+		out->clt32[i] = in->a32[i] < in->b32[i] ? UINT32_MAX : 0;
+		out->min32[i] = RTE_MIN(in->a32[i], in->b32[i]);
+		out->trn1_32[i] = i & 1 ? in->b32[i - 1] : in->a32[i];
+		out->trn2_32[i] = i & 1 ? in->b32[i] : in->a32[i + 1];
+		out->uzp1_32[i] = i < 2 ? in->a32[2 * i] : in->b32[2 * (i - 2)];
+		out->zip1_32[i] = i & 1 ? in->b32[i / 2] : in->a32[i / 2];
+		out->zip2_32[i] = i & 1 ? in->b32[2 + i / 2] : in->a32[2 + i / 2];
+	}
+
+	for (i = 0; i < 2; i++) {
+		out->dup64[i] = in->x64;
+		out->set64[i] = i == 1 ? in->x64 : in->a64[i];
+		out->add64[i] = in->a64[i] + in->b64[i];
+		out->sub64[i] = in->a64[i] - in->b64[i];
+		out->and64[i] = in->a64[i] & in->b64[i];
+		out->shr64[i] = in->a64[i] >> 13;
+		out->ceqz64[i] = in->a64[i] ? 0 : UINT64_MAX;
+	}
+	out->padd64[0] = in->a64[0] + in->a64[1];
+	out->padd64[1] = in->b64[0] + in->b64[1];
+	out->zip1_64[0] = in->a64[0];
+	out->zip1_64[1] = in->b64[0];
+	out->zip2_64[0] = in->a64[1];
+	out->zip2_64[1] = in->b64[1];
+
+	for (i = 0; i < 16; i++) {
+		out->shr8[i] = in->t8[i] >> 3;
+		out->tbl8[i] = in->i8[i] < 16 ? in->t8[in->i8[i]] : 0;
+	}
+
+	out->lane32 = in->a32[3];
+	out->lane64 = in->b64[1];
+}
+
+/* Random inputs with equal and zero lanes to hit compare edges */
+static void
+vect_in_fill(struct vect_in *in)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		in->a32[i] = rte_rand();
+		in->b32[i] = rte_rand() & 1 ? in->a32[i] : (uint32_t)rte_rand();
+	}
+	for (i = 0; i < 2; i++) {
+		in->a64[i] = rte_rand() & 1 ? 0 : rte_rand();
+		in->b64[i] = rte_rand();
+	}
+	for (i = 0; i < 16; i++) {
+		in->t8[i] = rte_rand();
+		in->i8[i] = rte_rand();
+	}
+	in->x32 = rte_rand();
+	in->x64 = rte_rand();
+}
+
+int
+main(void)
+{
+	struct vect_out ref, def, gen;
+	struct vect_in in;
+	int round;
+
+	printf("Vector helpers built with %s, checked against %s and scalar reference\n",
+	       vect_default_impl(), vect_generic_impl());
+
+	for (round = 0; round < TEST_ROUNDS; round++) {
+		memset(&in, 0, sizeof(in));
+		vect_in_fill(&in);
+
+		/* Zero padding so whole results can be compared */
+		memset(&ref, 0, sizeof(ref));
+		memset(&def, 0, sizeof(def));
+		memset(&gen, 0, sizeof(gen));
+		vect_ref_run(&in, &ref);
+		vect_default_run(&in, &def);
+		vect_generic_run(&in, &gen);
+
+		if (memcmp(&ref, &def, sizeof(ref))) {
+			printf("Round %d: %s helpers differ from reference\n", round,
+			       vect_default_impl());
+			return EXIT_FAILURE;
+		}
+		if (memcmp(&ref, &gen, sizeof(ref))) {
+			printf("Round %d: %s helpers differ from reference\n", round,
+			       vect_generic_impl());
+			return EXIT_FAILURE;
+		}
+	}
+
+	printf("%d rounds OK\n", TEST_ROUNDS);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,8 @@
+/* SPDX-License-Identifier: Marvell-MIT
+ * Copyright (c) 2024 Marvell.
+ */
+
+#define VECT_IMPL_FN vect_default_impl
+#define VECT_RUN_FN  vect_default_run
+
+#include "vect_ops_body.h"
@@ -0,0 +1,11 @@
+/* SPDX-License-Identifier: Marvell-MIT
+ * Copyright (c) 2024 Marvell.
+ */
+
+/* Generic C helpers regardless of build host SSE support */
+#define DAO_VECT_FORCE_GENERIC
+
+#define VECT_IMPL_FN vect_generic_impl
+#define VECT_RUN_FN  vect_generic_run
+
+#include "vect_ops_body.h"
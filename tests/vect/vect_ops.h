@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: Marvell-MIT
+ * Copyright (c) 2024 Marvell.
+ */
+
+#ifndef __VECT_OPS_H__
+#define __VECT_OPS_H__
+
+#include <stdint.h>
+
+/* Inputs of one round of vector helper checks */
+struct vect_in {
+	uint32_t a32[4];
+	uint32_t b32[4];
+	uint64_t a64[2];
+	uint64_t b64[2];
+	uint8_t t8[16];
+	uint8_t i8[16];
+	uint32_t x32;
+	uint64_t x64;
+};
+
+/* Result of each vector helper on a round of inputs */
+struct vect_out {
+	uint32_t dup32[4];
+	uint32_t set32[4];
+	uint32_t sub32[4];
+	uint32_t and32[4];
+	uint32_t orr32[4];
+	uint32_t shr32[4];
+	uint32_t cgt32[4];
+	uint32_t clt32[4];
+	uint32_t min32[4];
+	uint32_t trn1_32[4];
+	uint32_t trn2_32[4];
+	uint32_t uzp1_32[4];
+	uint32_t zip1_32[4];
+	uint32_t zip2_32[4];
+	uint64_t dup64[2];
+	uint64_t set64[2];
+	uint64_t add64[2];
+	uint64_t sub64[2];
+	uint64_t and64[2];
+	uint64_t shr64[2];
+	uint64_t ceqz64[2];
+	uint64_t padd64[2];
+	uint64_t zip1_64[2];
+	uint64_t zip2_64[2];
+	uint8_t shr8[16];
+	uint8_t tbl8[16];
+	uint32_t lane32;
+	uint64_t lane64;
+};
+
+/* Helpers built with the implementation dao_vect.h selects for the build */
+const char *vect_default_impl(void);
+void vect_default_run(const struct vect_in *in, struct vect_out *out);
+
+/* Helpers built with DAO_VECT_FORCE_GENERIC */
+const char *vect_generic_impl(void);
+void vect_generic_run(const struct vect_in *in, struct vect_out *out);
+
+#endif /* __VECT_OPS_H__ */
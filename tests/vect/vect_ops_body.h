@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: Marvell-MIT
+ * Copyright (c) 2024 Marvell.
+ */
+
+/* Body of vector helper checks, included by each implementation unit with
+ * VECT_IMPL_FN and VECT_RUN_FN naming its entry points.
+ */
+
+#include <string.h>
+
+#include <dao_vect.h>
+
+#include "vect_ops.h"
+
+#define VECT_OUT(field, v) memcpy(out->field, &(v), sizeof(out->field))
+
+const char *
+VECT_IMPL_FN(void)
+{
+#if defined(RTE_ARCH_ARM64)
+	return "neon";
+#elif defined(DAO_VECT_IMPL_SSE)
+	return "sse";
+#else
+	return "generic";
+#endif
+}
+
+void
+VECT_RUN_FN(const struct vect_in *in, struct vect_out *out)
+{
+	uint32x4_t a32 = vld1q_u32(in->a32), b32 = vld1q_u32(in->b32), r32;
+	uint64x2_t a64 = vld1q_u64(in->a64), b64 = vld1q_u64(in->b64), r64;
+	uint8x16_t t8, i8, r8;
+
+	memcpy(&t8, in->t8, sizeof(t8));
+	memcpy(&i8, in->i8, sizeof(i8));
+
+	r32 = vdupq_n_u32(in->x32);
+	VECT_OUT(dup32, r32);
+	r32 = vsetq_lane_u32(in->x32, a32, 2);
+	VECT_OUT(set32, r32);
+	r32 = vsubq_u32(a32, b32);
+	VECT_OUT(sub32, r32);
+	r32 = vandq_u32(a32, b32);
+	VECT_OUT(and32, r32);
+	r32 = vorrq_u32(a32, b32);
+	VECT_OUT(orr32, r32);
+	r32 = vshrq_n_u32(a32, 7);
+	VECT_OUT(shr32, r32);
+	r32 = vcgtq_u32(a32, b32);
+	VECT_OUT(cgt32, r32);
+	r32 = vcltq_u32(a32, b32);
+	VECT_OUT(clt32, r32);
+	r32 = vminq_u32(a32, b32);
+	VECT_OUT(min32, r32);
+	r32 = vtrn1q_u32(a32, b32);
+	VECT_OUT(trn1_32, r32);
+	r32 = vtrn2q_u32(a32, b32);
+	VECT_OUT(trn2_32, r32);
+	r32 = vuzp1q_u32(a32, b32);
+	VECT_OUT(uzp1_32, r32);
+	r32 = vzip1q_u32(a32, b32);
+	VECT_OUT(zip1_32, r32);
+	r32 = vzip2q_u32(a32, b32);
+	VECT_OUT(zip2_32, r32);
+
+	r64 = vdupq_n_u64(in->x64);
+	VECT_OUT(dup64, r64);
+	r64 = vsetq_lane_u64(in->x64, a64, 1);
+	VECT_OUT(set64, r64);
+	r64 = vaddq_u64(a64, b64);
+	VECT_OUT(add64, r64);
+	r64 = vsubq_u64(a64, b64);
+	VECT_OUT(sub64, r64);
+	r64 = vandq_u64(a64, b64);
+	VECT_OUT(and64, r64);
+	r64 = vshrq_n_u64(a64, 13);
+	VECT_OUT(shr64, r64);
+	r64 = vceqzq_u64(a64);
+	VECT_OUT(ceqz64, r64);
+	r64 = vpaddq_u64(a64, b64);
+	VECT_OUT(padd64, r64);
+	r64 = vzip1q_u64(a64, b64);
+	VECT_OUT(zip1_64, r64);
+	r64 = vzip2q_u64(a64, b64);
+	VECT_OUT(zip2_64, r64);
+
+	r8 = vshrq_n_u8(t8, 3);
+	VECT_OUT(shr8, r8);
+	r8 = vqtbl1q_u8(t8, i8);
+	VECT_OUT(tbl8, r8);
+
+	out->lane32 = vgetq_lane_u32(a32, 3);
+	out->lane64 = vgetq_lane_u64(b64, 1);
+
+	/* Round trip through store */
+	vst1q_u64(out->zip2_64, vzip2q_u64(a64, b64));
+}
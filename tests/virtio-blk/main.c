@@ -0,0 +1,383 @@
+/* SPDX-License-Identifier: Marvell-MIT
+ * Copyright (c) 2024 Marvell.
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <rte_dmadev.h>
+#include <rte_eal.h>
+#include <rte_malloc.h>
+#include <rte_random.h>
+
+#include "dao_dma.h"
+#include "dao_log.h"
+#include "dao_virtio_blkdev.h"
+#include "virtio_dev_priv.h"
+#include "virtio_req_priv.h"
+
+#include "virtio_blk_priv.h"
+
+#include "dao_test.h"
+#include "dao_test_vring.h"
+
+#define TEST_Q_SZ    64
+#define TEST_DEPTH   16
+#define TEST_SEG_SZ  4096
+#define TEST_BLKS    256
+#define TEST_BLK_SZ  (1U << VIRTIO_BLK_SECTOR_SHIFT)
+#define TEST_POLLS   1000000
+#define TEST_MAX_SEG 8
+
+/* Request of test driver, header, data and status in one buffer */
+struct test_req {
+	struct virtio_blk_outhdr hdr;
+	uint8_t data[TEST_MAX_SEG * TEST_BLK_SZ];
+	uint8_t status;
+};
+
+static struct dao_virtio_blkdev_backend be;
+static struct virtio_blk_queue *q;
+static struct dao_test_vring vr;
+static struct vring_packed_desc *desc;
+static struct test_req *reqs;
+static char path[] = "/tmp/dao-virtio-blk-XXXXXX";
+static int fd = -1;
+
+/* Run device till oldest posted request is used, returns its used length */
+static int
+test_wait(uint32_t *len)
+{
+	uint32_t i;
+
+	for (i = 0; i < TEST_POLLS; i++) {
+		dao_virtio_blkdev_process(0, 0);
+		dao_dma_flush_submit();
+		if (dao_test_vring_used(&vr, len))
+			return 0;
+	}
+	dao_err("Request at %x not used after %u polls", vr.used_off, TEST_POLLS);
+	return -1;
+}
+
+/* Post a request with data split over nb_seg buffers of the given lengths. Header is given a
+ * buffer of its own or, for writes, shares first buffer with data.
+ */
+static uint16_t
+test_post(struct test_req *r, uint32_t type, uint64_t sector, const uint32_t *lens,
+	  uint16_t nb_seg, bool hdr_shared)
+{
+	struct dao_test_vring_seg segs[TEST_MAX_SEG + 2];
+	bool write = type == VIRTIO_BLK_T_IN;
+	uint8_t *data = r->data;
+	uint16_t n = 0, i;
+
+	r->hdr.type = type;
+	r->hdr.ioprio = 0;
+	r->hdr.sector = sector;
+	r->status = 0xFF;
+
+	/* Data follows header in request buffer so that both fit one segment */
+	if (hdr_shared && !write && nb_seg) {
+		segs[n++] = (struct dao_test_vring_seg){&r->hdr, sizeof(r->hdr) + lens[0], false};
+		data += lens[0];
+		i = 1;
+	} else {
+		segs[n++] = (struct dao_test_vring_seg){&r->hdr, sizeof(r->hdr), false};
+		i = 0;
+	}
+	for (; i < nb_seg; i++) {
+		segs[n++] = (struct dao_test_vring_seg){data, lens[i], write};
+		data += lens[i];
+	}
+	segs[n++] = (struct dao_test_vring_seg){&r->status, 1, true};
+	return dao_test_vring_post(&vr, segs, n);
+}
+
+static void
+test_pattern(uint8_t *buf, uint32_t len, uint64_t sector)
+{
+	uint32_t i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = (uint8_t)(sector * 7 + i * 13 + (i >> 9));
+}
+
+/* Data is contiguous in test buffer whatever the segment layout */
+static uint32_t
+test_lens(uint32_t *lens, uint16_t nb_seg, uint32_t nb_blks)
+{
+	uint32_t total = nb_blks * TEST_BLK_SZ, left = total;
+	uint16_t i;
+
+	for (i = 0; i < nb_seg - 1; i++) {
+		lens[i] = 1 + rte_rand() % (left - (nb_seg - 1 - i));
+		left -= lens[i];
+	}
+	lens[i] = left;
+	return total;
+}
+
+/* Writes reach the file and reads of the same blocks return them, for header in a buffer of
+ * its own or sharing one with data, over random segment splits.
+ */
+static int
+test_write_read(void)
+{
+	uint8_t expect[TEST_MAX_SEG * TEST_BLK_SZ];
+	uint32_t lens[TEST_MAX_SEG], len, total;
+	uint16_t nb_seg, round;
+	uint64_t sector;
+	uint32_t nb_blks;
+	struct test_req *r = &reqs[0];
+
+	for (round = 0; round < 64; round++) {
+		nb_blks = 1 + rte_rand() % TEST_MAX_SEG;
+		nb_seg = 1 + rte_rand() % TEST_MAX_SEG;
+		sector = rte_rand() % (TEST_BLKS - nb_blks + 1);
+		total = test_lens(lens, nb_seg, nb_blks);
+
+		test_pattern(expect, total, sector + round);
+		memcpy(r->data, expect, total);
+		test_post(r, VIRTIO_BLK_T_OUT, sector, lens, nb_seg, round & 1);
+		if (test_wait(&len))
+			return -1;
+		TEST_ASSERT(r->status == VIRTIO_BLK_S_OK && len == 1,
+			    "Round %u write status %u len %u", round, r->status, len);
+
+		memset(r->data, 0, sizeof(r->data));
+		TEST_ASSERT(pread(fd, r->data, total, sector * TEST_BLK_SZ) == total &&
+				    !memcmp(r->data, expect, total),
+			    "Round %u file data mismatch at sector %" PRIu64, round, sector);
+
+		memset(r->data, 0, sizeof(r->data));
+		nb_seg = 1 + rte_rand() % TEST_MAX_SEG;
+		test_lens(lens, nb_seg, nb_blks);
+		test_post(r, VIRTIO_BLK_T_IN, sector, lens, nb_seg, false);
+		if (test_wait(&len))
+			return -1;
+		TEST_ASSERT(r->status == VIRTIO_BLK_S_OK && len == total + 1,
+			    "Round %u read status %u len %u", round, r->status, len);
+		TEST_ASSERT(!memcmp(r->data, expect, total),
+			    "Round %u read data mismatch at sector %" PRIu64, round, sector);
+	}
+	return 0;
+}
+
+/* More requests than queue depth are used in ring order as data slots free up, while ring
+ * wraps a few times.
+ */
+static int
+test_burst(void)
+{
+	uint32_t lens[2], len, posted = 0, done = 0, nb = TEST_Q_SZ * 4;
+	uint8_t expect[2 * TEST_BLK_SZ];
+	struct test_req *r;
+	uint64_t sector;
+
+	/* Block pairs written by requests in flight together are distinct */
+	while (done < nb) {
+		while (posted < nb && dao_test_vring_free(&vr) >= 3) {
+			r = &reqs[posted % TEST_Q_SZ];
+			sector = posted % (TEST_BLKS / 2) * 2;
+			test_lens(lens, 2, 2);
+			test_pattern(r->data, 2 * TEST_BLK_SZ, sector + posted);
+			test_post(r, VIRTIO_BLK_T_OUT, sector, lens, 2, true);
+			posted++;
+		}
+		if (test_wait(&len))
+			return -1;
+		r = &reqs[done % TEST_Q_SZ];
+		TEST_ASSERT(r->status == VIRTIO_BLK_S_OK && len == 1, "Request %u status %u len %u",
+			    done, r->status, len);
+		done++;
+	}
+
+	/* Last writes of each block pair */
+	for (done = nb - TEST_BLKS / 2; done < nb; done++) {
+		sector = done % (TEST_BLKS / 2) * 2;
+		test_pattern(expect, 2 * TEST_BLK_SZ, sector + done);
+		TEST_ASSERT(pread(fd, reqs[0].data, 2 * TEST_BLK_SZ, sector * TEST_BLK_SZ) ==
+					2 * TEST_BLK_SZ &&
+				    !memcmp(reqs[0].data, expect, 2 * TEST_BLK_SZ),
+			    "File data mismatch at sector %" PRIu64, sector);
+	}
+	return 0;
+}
+
+/* Flush is served, malformed requests fail without reaching backend and a chain with nowhere
+ * to put status is returned untouched.
+ */
+static int
+test_errors(void)
+{
+	struct dao_test_vring_seg segs[2];
+	struct test_req *r = &reqs[0];
+	uint32_t lens[1] = {0}, len;
+
+	test_post(r, VIRTIO_BLK_T_FLUSH, 0, lens, 0, false);
+	if (test_wait(&len))
+		return -1;
+	TEST_ASSERT(r->status == VIRTIO_BLK_S_OK && len == 1, "Flush status %u len %u", r->status,
+		    len);
+
+	/* Past capacity */
+	lens[0] = 2 * TEST_BLK_SZ;
+	test_post(r, VIRTIO_BLK_T_IN, TEST_BLKS - 1, lens, 1, false);
+	if (test_wait(&len))
+		return -1;
+	TEST_ASSERT(r->status == VIRTIO_BLK_S_IOERR && len == 1,
+		    "Read past capacity status %u len %u", r->status, len);
+
+	/* Not whole blocks */
+	lens[0] = TEST_BLK_SZ + 1;
+	test_post(r, VIRTIO_BLK_T_OUT, 0, lens, 1, false);
+	if (test_wait(&len))
+		return -1;
+	TEST_ASSERT(r->status == VIRTIO_BLK_S_IOERR && len == 1,
+		    "Partial block write status %u len %u", r->status, len);
+
+	test_post(r, VIRTIO_BLK_T_GET_ID, 0, lens, 0, false);
+	if (test_wait(&len))
+		return -1;
+	TEST_ASSERT(r->status == VIRTIO_BLK_S_UNSUPP && len == 1,
+		    "Unsupported request status %u len %u", r->status, len);
+
+	/* No writable buffer */
+	r->status = 0xFF;
+	segs[0] = (struct dao_test_vring_seg){&r->hdr, sizeof(r->hdr), false};
+	segs[1] = (struct dao_test_vring_seg){r->data, TEST_BLK_SZ, false};
+	dao_test_vring_post(&vr, segs, 2);
+	if (test_wait(&len))
+		return -1;
+	TEST_ASSERT(r->status == 0xFF && !len, "Chain without status buffer len %u", len);
+	return 0;
+}
+
+static const struct dao_test_case tests[] = {
+	{"write_read", test_write_read},
+	{"burst", test_burst},
+	{"errors", test_errors},
+};
+
+/* Queue laid out as by device queue setup, with descriptor ring of test driver */
+static int
+test_queue_setup(void)
+{
+	uint32_t shadow_area, req_area;
+	struct virtio_blk_req *blk_reqs;
+	size_t buf_sz;
+	uint16_t i;
+	int rc;
+
+	shadow_area = RTE_ALIGN(TEST_Q_SZ * DESC_ENTRY_SZ + 8, RTE_CACHE_LINE_SIZE);
+	req_area = TEST_Q_SZ * sizeof(struct virtio_blk_req);
+	q = rte_zmalloc("virtio_blk_q", sizeof(*q) + shadow_area + req_area + TEST_DEPTH * 2,
+			RTE_CACHE_LINE_SIZE);
+	desc = rte_zmalloc("virtio_blk_desc", TEST_Q_SZ * sizeof(*desc), RTE_CACHE_LINE_SIZE);
+	reqs = rte_zmalloc("virtio_blk_reqs", TEST_Q_SZ * sizeof(*reqs), RTE_CACHE_LINE_SIZE);
+	if (!q || !desc || !reqs)
+		return -ENOMEM;
+
+	dao_test_vring_init(&vr, desc, TEST_Q_SZ);
+	blk_reqs = (struct virtio_blk_req *)((uintptr_t)(q + 1) + shadow_area);
+	virtio_req_ring_init(&q->ring, (uintptr_t)rte_malloc_virt2iova(desc), &vr.notify,
+			     TEST_Q_SZ, q->sd_desc_base, blk_reqs, sizeof(*blk_reqs), NULL);
+	q->intr_used_off = q->ring.sd_desc_off;
+	q->intr_event_off = q->ring.sd_desc_off;
+	q->intr_sig_off = q->ring.sd_desc_off;
+	q->free_slots = (uint16_t *)((uintptr_t)blk_reqs + req_area);
+	for (i = 0; i < TEST_DEPTH; i++)
+		q->free_slots[i] = TEST_DEPTH - 1 - i;
+	q->nb_free_slots = TEST_DEPTH;
+
+	q->ops = be.ops;
+	q->capacity = be.capacity;
+	q->blk_mask = be.blk_size - 1;
+	q->flush = be.flush;
+	q->slot_sz = VIRTIO_BLK_SEG_MAX * TEST_SEG_SZ;
+	buf_sz = (size_t)q->slot_sz * TEST_DEPTH;
+	q->buf_area = rte_zmalloc("virtio_blk_buf", buf_sz, RTE_PGSIZE_4K);
+	if (!q->buf_area)
+		return -ENOMEM;
+
+	rc = be.ops->queue_setup(be.ctx, 0, TEST_DEPTH, q->buf_area, buf_sz, &q->qctx);
+	if (rc) {
+		q->qctx = NULL;
+		return rc;
+	}
+
+	dao_virtio_blkdevs[0].qs[0] = q;
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int16_t dma_devid;
+	int rc;
+
+	rc = rte_eal_init(argc, argv);
+	if (rc < 0)
+		rte_exit(EXIT_FAILURE, "Error with EAL initialization\n");
+
+	if (!dao_dma_has_sw_backend()) {
+		printf("DMA software backend not enabled at build, skipping\n");
+		rc = TEST_SKIPPED;
+		goto exit;
+	}
+
+	/* Device only anchors vchan state, copies are done by CPU */
+	dma_devid = rte_dma_next_dev(0);
+	if (dma_devid < 0) {
+		printf("No DMA device, e.g. --vdev=dma_skeleton, skipping\n");
+		rc = TEST_SKIPPED;
+		goto exit;
+	}
+
+	rc = dao_dma_lcore_dev2mem_set(dma_devid, 1, 0);
+	rc |= dao_dma_lcore_mem2dev_set(dma_devid, 1, 0);
+	if (rc)
+		rte_exit(EXIT_FAILURE, "Failed to assign DMA vchans to lcore\n");
+
+	/* Local file backs the device */
+	fd = mkstemp(path);
+	if (fd < 0 || ftruncate(fd, (off_t)TEST_BLKS * TEST_BLK_SZ))
+		rte_exit(EXIT_FAILURE, "Failed to create backing file\n");
+
+	rc = dao_virtio_blkdev_uring_open(path, 0, &be);
+	if (rc)
+		rte_exit(EXIT_FAILURE, "Failed to open backend, rc=%d\n", rc);
+
+	rc = test_queue_setup();
+	if (rc == -ENOSYS || rc == -EPERM) {
+		printf("io_uring not available, rc=%d, skipping\n", rc);
+		rc = TEST_SKIPPED;
+		goto cleanup;
+	}
+	if (rc)
+		rte_exit(EXIT_FAILURE, "Failed to setup queue, rc=%d\n", rc);
+
+	rc = dao_test_run(tests, RTE_DIM(tests));
+
+	dao_virtio_blkdevs[0].qs[0] = NULL;
+	virtio_blk_queue_drain(q);
+cleanup:
+	if (q && q->qctx)
+		be.ops->queue_release(q->qctx);
+	if (q)
+		rte_free(q->buf_area);
+	rte_free(q);
+	rte_free(reqs);
+	rte_free(desc);
+	dao_virtio_blkdev_uring_close(&be);
+	close(fd);
+	unlink(path);
+exit:
+	rte_eal_cleanup();
+	return rc;
+}
@@ -0,0 +1,435 @@
+/* SPDX-License-Identifier: Marvell-MIT
+ * Copyright (c) 2024 Marvell.
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_cryptodev.h>
+#include <rte_dmadev.h>
+#include <rte_eal.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+#include <rte_random.h>
+
+#include "dao_dma.h"
+#include "dao_log.h"
+#include "dao_virtio_cryptodev.h"
+#include "virtio_dev_priv.h"
+#include "virtio_req_priv.h"
+
+#include "virtio_crypto_priv.h"
+
+#include "dao_test.h"
+#include "dao_test_vring.h"
+
+#define TEST_Q_SZ     64
+#define TEST_POLLS    1000000
+#define TEST_DATA_MAX 1024
+#define TEST_MAX_SEG  4
+#define TEST_IV_LEN   16
+#define TEST_NB_MBUFS 512
+#define TEST_NB_OPS   512
+
+/* Sessions set up for the queue, as control queue would */
+enum {
+	TEST_SESS_ENC,
+	TEST_SESS_DEC,
+	TEST_NB_SESS,
+};
+
+/* Request of test driver, readable header, IV and source are contiguous */
+struct test_req {
+	struct virtio_crypto_op_data_req hdr;
+	uint8_t iv[TEST_IV_LEN];
+	uint8_t src[TEST_DATA_MAX];
+	uint8_t dst[TEST_DATA_MAX];
+	uint8_t status;
+};
+
+/* AES-128-CBC vector of NIST SP 800-38A F.2.1 */
+static const uint8_t test_key[] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+				   0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+static const uint8_t test_iv[] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+				  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+static const uint8_t test_pt[] = {
+	0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73,
+	0x93, 0x17, 0x2a, 0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7,
+	0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51, 0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4,
+	0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef, 0xf6, 0x9f, 0x24, 0x45,
+	0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10};
+static const uint8_t test_ct[] = {
+	0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46, 0xce, 0xe9, 0x8e, 0x9b, 0x12,
+	0xe9, 0x19, 0x7d, 0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee, 0x95, 0xdb,
+	0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2, 0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74,
+	0x3b, 0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16, 0x3f, 0xf1, 0xca, 0xa1,
+	0x68, 0x1f, 0xac, 0x09, 0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7};
+
+static struct virtio_crypto_sess sess_tbl[TEST_NB_SESS];
+static struct rte_mempool *mbuf_mp, *op_mp, *sess_mp;
+static struct virtio_crypto_queue *q;
+static struct dao_test_vring vr;
+static struct vring_packed_desc *desc;
+static struct test_req *reqs;
+static uint8_t cdev_id;
+
+/* Run device till oldest posted request is used, returns its used length */
+static int
+test_wait(uint32_t *len)
+{
+	uint32_t i;
+
+	for (i = 0; i < TEST_POLLS; i++) {
+		dao_virtio_cryptodev_process(0, 0);
+		dao_dma_flush_submit();
+		if (dao_test_vring_used(&vr, len))
+			return 0;
+	}
+	dao_err("Request at %x not used after %u polls", vr.used_off, TEST_POLLS);
+	return -1;
+}
+
+/* Split a buffer into nb_seg segments of random length */
+static uint16_t
+test_split(struct dao_test_vring_seg *segs, uint8_t *buf, uint32_t len, uint16_t nb_seg,
+	   bool write)
+{
+	uint32_t n;
+	uint16_t i;
+
+	nb_seg = RTE_MIN(nb_seg, len);
+	for (i = 0; i < nb_seg - 1; i++) {
+		n = 1 + rte_rand() % (len - (nb_seg - 1 - i));
+		segs[i] = (struct dao_test_vring_seg){buf, n, write};
+		buf += n;
+		len -= n;
+	}
+	segs[i] = (struct dao_test_vring_seg){buf, len, write};
+	return nb_seg;
+}
+
+/* Post a cipher request with header, IV and source over random readable segments and
+ * destination over random writable ones, followed by status.
+ */
+static void
+test_post(struct test_req *r, uint32_t opcode, uint64_t sess_id, uint32_t src_len,
+	  uint32_t dst_len)
+{
+	struct dao_test_vring_seg segs[2 * TEST_MAX_SEG + 1];
+	struct virtio_crypto_cipher_para *para;
+	uint16_t n;
+
+	memset(&r->hdr, 0, sizeof(r->hdr));
+	r->hdr.header.opcode = opcode;
+	r->hdr.header.session_id = sess_id;
+	r->hdr.u.sym_req.op_type = VIRTIO_CRYPTO_SYM_OP_CIPHER;
+	para = &r->hdr.u.sym_req.u.cipher.para;
+	para->iv_len = TEST_IV_LEN;
+	para->src_data_len = src_len;
+	para->dst_data_len = dst_len;
+	r->status = 0xFF;
+
+	n = test_split(segs, (uint8_t *)&r->hdr, sizeof(r->hdr) + TEST_IV_LEN + src_len,
+		       1 + rte_rand() % TEST_MAX_SEG, false);
+	if (dst_len)
+		n += test_split(&segs[n], r->dst, dst_len, 1 + rte_rand() % TEST_MAX_SEG, true);
+	segs[n++] = (struct dao_test_vring_seg){&r->status, 1, true};
+	dao_test_vring_post(&vr, segs, n);
+}
+
+static int
+test_cipher(struct test_req *r, uint32_t opcode, uint64_t sess_id, const uint8_t *iv,
+	    const uint8_t *src, uint8_t *dst, uint32_t len)
+{
+	uint32_t used_len;
+
+	memcpy(r->iv, iv, TEST_IV_LEN);
+	memcpy(r->src, src, len);
+	memset(r->dst, 0, len);
+	test_post(r, opcode, sess_id, len, len);
+	if (test_wait(&used_len))
+		return -1;
+	TEST_ASSERT(r->status == VIRTIO_CRYPTO_OK && used_len == len + 1,
+		    "Cipher op %x status %u used len %u", opcode, r->status, used_len);
+	memcpy(dst, r->dst, len);
+	return 0;
+}
+
+/* Known answer of encrypt and decrypt */
+static int
+test_kat(void)
+{
+	uint8_t out[sizeof(test_pt)];
+
+	if (test_cipher(&reqs[0], VIRTIO_CRYPTO_CIPHER_ENCRYPT, TEST_SESS_ENC, test_iv, test_pt,
+			out, sizeof(test_pt)))
+		return -1;
+	TEST_ASSERT(!memcmp(out, test_ct, sizeof(test_ct)), "Ciphertext mismatch");
+
+	if (test_cipher(&reqs[0], VIRTIO_CRYPTO_CIPHER_DECRYPT, TEST_SESS_DEC, test_iv, test_ct,
+			out, sizeof(test_ct)))
+		return -1;
+	TEST_ASSERT(!memcmp(out, test_pt, sizeof(test_pt)), "Plaintext mismatch");
+	return 0;
+}
+
+/* Bursts of encrypts wrapping the ring, each decrypted back to its source */
+static int
+test_round_trip(void)
+{
+	uint32_t len, used_len, posted, done, i;
+	uint8_t *ct, *pt;
+
+	/* Ciphertext of each request, then decrypt output */
+	ct = rte_malloc("test_ct", (TEST_Q_SZ + 1) * TEST_DATA_MAX, 0);
+	if (!ct)
+		return -ENOMEM;
+	pt = &ct[TEST_Q_SZ * TEST_DATA_MAX];
+
+	for (i = 0; i < 8; i++) {
+		/* Ring is filled with chains of up to 2 * TEST_MAX_SEG + 1 descriptors */
+		posted = 0;
+		done = 0;
+		while (done < TEST_Q_SZ) {
+			while (posted < TEST_Q_SZ &&
+			       dao_test_vring_free(&vr) >= 2 * TEST_MAX_SEG + 1) {
+				len = (1 + rte_rand() % (TEST_DATA_MAX / 16)) * 16;
+				rte_memcpy(reqs[posted].iv, test_iv, TEST_IV_LEN);
+				reqs[posted].iv[0] = posted;
+				for (used_len = 0; used_len < len; used_len++)
+					reqs[posted].src[used_len] = rte_rand();
+				test_post(&reqs[posted], VIRTIO_CRYPTO_CIPHER_ENCRYPT,
+					  TEST_SESS_ENC, len, len);
+				posted++;
+			}
+			if (test_wait(&used_len)) {
+				rte_free(ct);
+				return -1;
+			}
+			len = reqs[done].hdr.u.sym_req.u.cipher.para.src_data_len;
+			if (reqs[done].status != VIRTIO_CRYPTO_OK || used_len != len + 1) {
+				dao_err("Round %u request %u status %u used len %u", i, done,
+					reqs[done].status, used_len);
+				rte_free(ct);
+				return -1;
+			}
+			memcpy(&ct[done * TEST_DATA_MAX], reqs[done].dst, len);
+			done++;
+		}
+
+		for (done = 0; done < TEST_Q_SZ; done++) {
+			len = reqs[done].hdr.u.sym_req.u.cipher.para.src_data_len;
+			if (test_cipher(&reqs[TEST_Q_SZ], VIRTIO_CRYPTO_CIPHER_DECRYPT,
+					TEST_SESS_DEC, reqs[done].iv, &ct[done * TEST_DATA_MAX], pt,
+					len) ||
+			    memcmp(pt, reqs[done].src, len)) {
+				dao_err("Round %u request %u did not decrypt to source", i, done);
+				rte_free(ct);
+				return -1;
+			}
+		}
+	}
+	rte_free(ct);
+	return 0;
+}
+
+/* Malformed requests fail without reaching cryptodev and a chain with nowhere to put status
+ * is returned untouched.
+ */
+static int
+test_errors(void)
+{
+	struct dao_test_vring_seg segs[1];
+	struct test_req *r = &reqs[0];
+	uint32_t len;
+
+	test_post(r, VIRTIO_CRYPTO_CIPHER_ENCRYPT, TEST_NB_SESS, 16, 16);
+	if (test_wait(&len))
+		return -1;
+	TEST_ASSERT(r->status == VIRTIO_CRYPTO_INVSESS && len == 1,
+		    "Invalid session status %u len %u", r->status, len);
+
+	test_post(r, VIRTIO_CRYPTO_HASH, TEST_SESS_ENC, 16, 16);
+	if (test_wait(&len))
+		return -1;
+	TEST_ASSERT(r->status == VIRTIO_CRYPTO_NOTSUPP && len == 1,
+		    "Unsupported op status %u len %u", r->status, len);
+
+	/* Destination shorter than source */
+	test_post(r, VIRTIO_CRYPTO_CIPHER_ENCRYPT, TEST_SESS_ENC, 32, 16);
+	if (test_wait(&len))
+		return -1;
+	TEST_ASSERT(r->status == VIRTIO_CRYPTO_BADMSG && len == 1,
+		    "Short destination status %u len %u", r->status, len);
+
+	/* Header only, no writable buffer */
+	r->status = 0xFF;
+	segs[0] = (struct dao_test_vring_seg){&r->hdr, sizeof(r->hdr), false};
+	dao_test_vring_post(&vr, segs, 1);
+	if (test_wait(&len))
+		return -1;
+	TEST_ASSERT(r->status == 0xFF && !len, "Chain without status buffer len %u", len);
+	return 0;
+}
+
+static const struct dao_test_case tests[] = {
+	{"kat", test_kat},
+	{"round_trip", test_round_trip},
+	{"errors", test_errors},
+};
+
+static int
+test_sess_create(uint16_t id, enum rte_crypto_cipher_operation op)
+{
+	struct rte_crypto_sym_xform xform;
+
+	memset(&xform, 0, sizeof(xform));
+	xform.type = RTE_CRYPTO_SYM_XFORM_CIPHER;
+	xform.cipher.op = op;
+	xform.cipher.algo = RTE_CRYPTO_CIPHER_AES_CBC;
+	xform.cipher.key.data = test_key;
+	xform.cipher.key.length = sizeof(test_key);
+	xform.cipher.iv.offset = VIRTIO_CRYPTO_IV_OFF;
+	xform.cipher.iv.length = TEST_IV_LEN;
+
+	sess_tbl[id].sess = rte_cryptodev_sym_session_create(cdev_id, &xform, sess_mp);
+	sess_tbl[id].iv_len = TEST_IV_LEN;
+	return sess_tbl[id].sess ? 0 : -ENOTSUP;
+}
+
+/* Cryptodev with one queue pair and AES-CBC sessions, as device init and control queue
+ * would set them up.
+ */
+static int
+test_cdev_setup(void)
+{
+	struct rte_cryptodev_qp_conf qp_conf = {.nb_descriptors = TEST_NB_OPS};
+	struct rte_cryptodev_config conf = {.socket_id = SOCKET_ID_ANY, .nb_queue_pairs = 1};
+	int rc;
+
+	sess_mp = rte_cryptodev_sym_session_pool_create(
+		"test_sess_mp", 2 * TEST_NB_SESS,
+		rte_cryptodev_sym_get_private_session_size(cdev_id), 0, 0, SOCKET_ID_ANY);
+	op_mp = rte_crypto_op_pool_create("test_op_mp", RTE_CRYPTO_OP_TYPE_SYMMETRIC, TEST_NB_OPS,
+					  0, VIRTIO_CRYPTO_OP_PRIV_SZ, SOCKET_ID_ANY);
+	mbuf_mp = rte_pktmbuf_pool_create("test_mbuf_mp", TEST_NB_MBUFS, 0, 0,
+					  RTE_PKTMBUF_HEADROOM + 2 * TEST_DATA_MAX, SOCKET_ID_ANY);
+	if (!sess_mp || !op_mp || !mbuf_mp)
+		return -ENOMEM;
+
+	qp_conf.mp_session = sess_mp;
+	rc = rte_cryptodev_configure(cdev_id, &conf);
+	rc = rc ? rc : rte_cryptodev_queue_pair_setup(cdev_id, 0, &qp_conf, SOCKET_ID_ANY);
+	rc = rc ? rc : rte_cryptodev_start(cdev_id);
+	if (rc)
+		return rc;
+
+	rc = test_sess_create(TEST_SESS_ENC, RTE_CRYPTO_CIPHER_OP_ENCRYPT);
+	return rc ? rc : test_sess_create(TEST_SESS_DEC, RTE_CRYPTO_CIPHER_OP_DECRYPT);
+}
+
+/* Queue laid out as by device queue setup, with descriptor ring of test driver */
+static int
+test_queue_setup(void)
+{
+	struct virtio_crypto_req *crypto_reqs;
+	uint32_t shadow_area, req_area;
+
+	shadow_area = RTE_ALIGN(TEST_Q_SZ * DESC_ENTRY_SZ + 8, RTE_CACHE_LINE_SIZE);
+	req_area = TEST_Q_SZ * sizeof(struct virtio_crypto_req);
+	q = rte_zmalloc("virtio_crypto_q", sizeof(*q) + shadow_area + req_area,
+			RTE_CACHE_LINE_SIZE);
+	desc = rte_zmalloc("virtio_crypto_desc", TEST_Q_SZ * sizeof(*desc), RTE_CACHE_LINE_SIZE);
+	/* One spare request used for decrypt checks */
+	reqs = rte_zmalloc("virtio_crypto_reqs", (TEST_Q_SZ + 1) * sizeof(*reqs),
+			   RTE_CACHE_LINE_SIZE);
+	if (!q || !desc || !reqs)
+		return -ENOMEM;
+
+	dao_test_vring_init(&vr, desc, TEST_Q_SZ);
+	crypto_reqs = (struct virtio_crypto_req *)((uintptr_t)(q + 1) + shadow_area);
+	virtio_req_ring_init(&q->ring, (uintptr_t)rte_malloc_virt2iova(desc), &vr.notify,
+			     TEST_Q_SZ, q->sd_desc_base, crypto_reqs, sizeof(*crypto_reqs), NULL);
+	q->cdev_id = cdev_id;
+	q->cdev_qp = 0;
+	q->mp = mbuf_mp;
+	q->op_mp = op_mp;
+	q->sess_tbl = sess_tbl;
+	q->max_sessions = TEST_NB_SESS;
+	q->max_req_sz = rte_pktmbuf_data_room_size(mbuf_mp) - RTE_PKTMBUF_HEADROOM;
+
+	dao_virtio_cryptodevs[0].qs[0] = q;
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int16_t dma_devid;
+	uint16_t i;
+	int rc;
+
+	rc = rte_eal_init(argc, argv);
+	if (rc < 0)
+		rte_exit(EXIT_FAILURE, "Error with EAL initialization\n");
+
+	if (!dao_dma_has_sw_backend()) {
+		printf("DMA software backend not enabled at build, skipping\n");
+		rc = TEST_SKIPPED;
+		goto exit;
+	}
+
+	/* Device only anchors vchan state, copies are done by CPU */
+	dma_devid = rte_dma_next_dev(0);
+	if (dma_devid < 0) {
+		printf("No DMA device, e.g. --vdev=dma_skeleton, skipping\n");
+		rc = TEST_SKIPPED;
+		goto exit;
+	}
+
+	if (!rte_cryptodev_count()) {
+		printf("No crypto device, e.g. --vdev=crypto_openssl, skipping\n");
+		rc = TEST_SKIPPED;
+		goto exit;
+	}
+	cdev_id = 0;
+
+	rc = dao_dma_lcore_dev2mem_set(dma_devid, 1, 0);
+	rc |= dao_dma_lcore_mem2dev_set(dma_devid, 1, 0);
+	if (rc)
+		rte_exit(EXIT_FAILURE, "Failed to assign DMA vchans to lcore\n");
+
+	rc = test_cdev_setup();
+	if (rc == -ENOTSUP) {
+		printf("AES-CBC not supported by crypto device, skipping\n");
+		rc = TEST_SKIPPED;
+		goto cleanup;
+	}
+	if (rc)
+		rte_exit(EXIT_FAILURE, "Failed to setup crypto device, rc=%d\n", rc);
+
+	if (test_queue_setup())
+		rte_exit(EXIT_FAILURE, "Failed to allocate test memory\n");
+
+	rc = dao_test_run(tests, RTE_DIM(tests));
+
+	dao_virtio_cryptodevs[0].qs[0] = NULL;
+	virtio_crypto_queue_drain(q);
+cleanup:
+	for (i = 0; i < TEST_NB_SESS; i++)
+		if (sess_tbl[i].sess)
+			rte_cryptodev_sym_session_free(cdev_id, sess_tbl[i].sess);
+	rte_cryptodev_stop(cdev_id);
+	rte_free(reqs);
+	rte_free(desc);
+	rte_free(q);
+	rte_mempool_free(mbuf_mp);
+	rte_mempool_free(op_mp);
+	rte_mempool_free(sess_mp);
+exit:
+	rte_eal_cleanup();
+	return rc;
+}
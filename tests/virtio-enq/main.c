@@ -0,0 +1,303 @@
+/* SPDX-License-Identifier: Marvell-MIT
+ * Copyright (c) 2024 Marvell.
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_cycles.h>
+#include <rte_dmadev.h>
+#include <rte_eal.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+#include <rte_random.h>
+
+#include "dao_dma.h"
+#include "dao_log.h"
+#include "dao_virtio_netdev.h"
+#include "virtio_dev_priv.h"
+
+#include "spec/virtio_net.h"
+
+#include "virtio_net_priv.h"
+
+#include "dao_test.h"
+
+#define TEST_Q_SZ      256
+#define TEST_BUF_LEN   1024
+#define TEST_BURST     32
+#define TEST_PKT_MAX   (3 * TEST_BUF_LEN)
+#define TEST_PAT_STEP  7
+#define TEST_PAT_SZ    (TEST_PKT_MAX + TEST_BURST * TEST_PAT_STEP)
+#define TEST_ROUNDS    64
+#define TEST_BENCH_RND 2048
+
+static struct rte_mempool *pool;
+static struct virtio_net_queue *q;
+static uint8_t *guest_mem;
+static uint8_t *pattern;
+static uint32_t pkt_lens[TEST_BURST];
+
+/* Make all ring descriptors available with a guest buffer each, first wrap of the ring */
+static void
+test_ring_reset(void)
+{
+	uint16_t i;
+
+	for (i = 0; i < TEST_Q_SZ; i++) {
+		*DESC_PTR_OFF(q->sd_desc_base, i, 0) =
+			rte_malloc_virt2iova(guest_mem + (i * TEST_BUF_LEN));
+		*DESC_PTR_OFF(q->sd_desc_base, i, 8) =
+			VIRT_PACKED_RING_DESC_F_AVAIL | ((uint64_t)i << 32) | TEST_BUF_LEN;
+		q->mbuf_arr[i] = NULL;
+	}
+	memset(guest_mem, 0, TEST_Q_SZ * TEST_BUF_LEN);
+
+	/* Descriptor management has fetched the whole ring */
+	q->sd_desc_off = RTE_BIT64(15);
+	q->last_off = 0;
+	q->sd_mbuf_off = 0;
+	q->pend_sd_mbuf = 0;
+}
+
+/* Packets of a burst spanning two to three guest buffers each */
+static void
+test_lens_gen(void)
+{
+	uint32_t min = TEST_BUF_LEN - q->virtio_hdr_sz + 1;
+	uint32_t i;
+
+	for (i = 0; i < TEST_BURST; i++)
+		pkt_lens[i] = min + (rte_rand() % (TEST_PKT_MAX - q->virtio_hdr_sz - min + 1));
+}
+
+static struct rte_mbuf *
+test_seg_alloc(const uint8_t *data, uint32_t len)
+{
+	struct rte_mbuf *m;
+	uint8_t *p;
+
+	m = rte_pktmbuf_alloc(pool);
+	if (!m)
+		return NULL;
+	p = (uint8_t *)rte_pktmbuf_append(m, len);
+	if (!p) {
+		rte_pktmbuf_free(m);
+		return NULL;
+	}
+	memcpy(p, data, len);
+	return m;
+}
+
+/* Build a burst as single segment packets or as two segment chains of same data */
+static int
+test_pkts_build(struct rte_mbuf **pkts, bool chained)
+{
+	const uint8_t *data;
+	struct rte_mbuf *m;
+	uint32_t i, len;
+
+	for (i = 0; i < TEST_BURST; i++) {
+		data = pattern + (i * TEST_PAT_STEP);
+		len = chained ? pkt_lens[i] / 2 : pkt_lens[i];
+		pkts[i] = test_seg_alloc(data, len);
+		TEST_ASSERT(pkts[i], "Failed to allocate packet %u", i);
+		if (!chained)
+			continue;
+
+		m = test_seg_alloc(data + len, pkt_lens[i] - len);
+		TEST_ASSERT(m, "Failed to allocate segment of packet %u", i);
+		TEST_ASSERT(!rte_pktmbuf_chain(pkts[i], m), "Failed to chain packet %u", i);
+	}
+	return 0;
+}
+
+/* Complete DMA of the burst and free its mbufs as descriptor management would */
+static void
+test_drain(struct dao_dma_vchan_state *mem2dev)
+{
+	dao_dma_flush_submit();
+	dao_dma_check_meta_compl(mem2dev, 1);
+
+	/* Burst is enqueued from start of ring, mbufs of its descriptors are done */
+	rte_pktmbuf_free_bulk(q->mbuf_arr, DESC_OFF(q->sd_mbuf_off));
+}
+
+/* Check guest buffers and used descriptors against the burst */
+static int
+test_ring_check(void)
+{
+	uint32_t i, j, len, dlen, span;
+	struct virtio_net_hdr *hdr;
+	uint16_t off = 0;
+	uint64_t d;
+
+	for (i = 0; i < TEST_BURST; i++) {
+		len = pkt_lens[i] + q->virtio_hdr_sz;
+		span = (len + TEST_BUF_LEN - 1) / TEST_BUF_LEN;
+
+		/* Buffers of a packet are contiguous in guest memory here */
+		hdr = (struct virtio_net_hdr *)(guest_mem + (off * TEST_BUF_LEN));
+		TEST_ASSERT(hdr->num_buffers == span, "Packet %u num_buffers %u expected %u", i,
+			    hdr->num_buffers, span);
+		TEST_ASSERT(!memcmp((uint8_t *)hdr + q->virtio_hdr_sz,
+				    pattern + (i * TEST_PAT_STEP), pkt_lens[i]),
+			    "Packet %u data mismatch", i);
+
+		for (j = 0; j < span; j++, off++) {
+			d = *DESC_PTR_OFF(q->sd_desc_base, off, 8);
+			dlen = RTE_MIN(len, (uint32_t)TEST_BUF_LEN);
+			len -= dlen;
+			TEST_ASSERT((d & (RTE_BIT64(32) - 1)) == dlen,
+				    "Descriptor %u len %" PRIu64 " expected %u", off,
+				    d & (RTE_BIT64(32) - 1), dlen);
+			TEST_ASSERT((d & VIRT_PACKED_RING_DESC_F_AVAIL_USED) ==
+					    VIRT_PACKED_RING_DESC_F_AVAIL_USED,
+				    "Descriptor %u not marked used", off);
+			TEST_ASSERT(((d >> 32) & 0xFFFF) == off, "Descriptor %u id changed", off);
+		}
+	}
+
+	d = *DESC_PTR_OFF(q->sd_desc_base, off, 8);
+	TEST_ASSERT(!(d & VIRT_PACKED_RING_DESC_F_USED), "Descriptor %u used past burst", off);
+	TEST_ASSERT(q->last_off == off, "Ring offset %u expected %u", q->last_off, off);
+	return 0;
+}
+
+static int
+test_enq_run(bool chained, uint64_t *cycles)
+{
+	struct dao_dma_vchan_state *mem2dev = dao_dma_lcore_mem2dev_get(0, 0);
+	struct rte_mbuf *pkts[TEST_BURST];
+	uint64_t start;
+	uint16_t nb;
+
+	test_ring_reset();
+	if (test_pkts_build(pkts, chained))
+		return -1;
+
+	start = rte_rdtsc();
+	nb = virtio_net_enq_no_ff_mseg(q, pkts, TEST_BURST);
+	dao_dma_flush_submit();
+	*cycles += rte_rdtsc() - start;
+
+	test_drain(mem2dev);
+	TEST_ASSERT(nb == TEST_BURST, "Enqueued %u of %u packets", nb, TEST_BURST);
+	TEST_ASSERT(mem2dev->head == mem2dev->tail, "DMA ops left in flight");
+	return test_ring_check();
+}
+
+/* Single segment packets take mergeable buffer run path, chained ones the scalar path. Both
+ * have to leave identical guest buffers and used descriptors.
+ */
+static int
+test_mrg_vs_scalar(void)
+{
+	uint64_t cycles = 0;
+	uint32_t i;
+
+	for (i = 0; i < TEST_ROUNDS; i++) {
+		test_lens_gen();
+		TEST_ASSERT(!test_enq_run(false, &cycles), "Mergeable run path failed, round %u",
+			    i);
+		TEST_ASSERT(!test_enq_run(true, &cycles), "Scalar mseg path failed, round %u", i);
+	}
+	return 0;
+}
+
+/* Cycles per packet of enqueue and DMA submit of both paths for same guest buffer spans,
+ * run as benchmark rather than unit test.
+ */
+static int
+test_mrg_bench(void)
+{
+	uint64_t mrg = 0, scalar = 0;
+	uint32_t i;
+
+	for (i = 0; i < TEST_BENCH_RND; i++) {
+		test_lens_gen();
+		if (test_enq_run(false, &mrg) || test_enq_run(true, &scalar))
+			return -1;
+	}
+
+	printf("Mergeable run path %" PRIu64 " cycles/pkt, scalar mseg path %" PRIu64
+	       " cycles/pkt\n",
+	       mrg / (TEST_BENCH_RND * TEST_BURST), scalar / (TEST_BENCH_RND * TEST_BURST));
+	return 0;
+}
+
+static const struct dao_test_case tests[] = {
+	{"mrg_vs_scalar", test_mrg_vs_scalar},
+};
+
+static const struct dao_test_case perf_tests[] = {
+	{"mrg_bench", test_mrg_bench},
+};
+
+int
+main(int argc, char *argv[])
+{
+	int16_t dma_devid;
+	uint32_t i;
+	int rc;
+
+	rc = rte_eal_init(argc, argv);
+	if (rc < 0)
+		rte_exit(EXIT_FAILURE, "Error with EAL initialization\n");
+	argc -= rc;
+	argv += rc;
+
+	if (!dao_dma_has_sw_backend()) {
+		printf("DMA software backend not enabled at build, skipping\n");
+		rc = TEST_SKIPPED;
+		goto exit;
+	}
+
+	/* Device only anchors vchan state, copies are done by CPU */
+	dma_devid = rte_dma_next_dev(0);
+	if (dma_devid < 0) {
+		printf("No DMA device, e.g. --vdev=dma_skeleton, skipping\n");
+		rc = TEST_SKIPPED;
+		goto exit;
+	}
+
+	/* Max pointers per op so that any span of the burst fits an op */
+	rc = dao_dma_lcore_mem2dev_set(dma_devid, 1, DAO_DMA_MAX_POINTER);
+	if (rc)
+		rte_exit(EXIT_FAILURE, "Failed to assign DMA vchan to lcore\n");
+
+	pool = rte_pktmbuf_pool_create("virtio_enq_pool", 4 * TEST_BURST, 0, 0,
+				       TEST_PKT_MAX + RTE_PKTMBUF_HEADROOM, SOCKET_ID_ANY);
+	q = rte_zmalloc("virtio_enq_q", sizeof(*q) + TEST_Q_SZ * DESC_ENTRY_SZ,
+			RTE_CACHE_LINE_SIZE);
+	guest_mem = rte_zmalloc("virtio_enq_guest", TEST_Q_SZ * TEST_BUF_LEN, RTE_CACHE_LINE_SIZE);
+	pattern = rte_malloc("virtio_enq_pat", TEST_PAT_SZ, RTE_CACHE_LINE_SIZE);
+	if (!pool || !q || !guest_mem || !pattern)
+		rte_exit(EXIT_FAILURE, "Failed to allocate test memory\n");
+
+	q->mbuf_arr = rte_zmalloc("virtio_enq_mbufs", TEST_Q_SZ * sizeof(struct rte_mbuf *), 0);
+	if (!q->mbuf_arr)
+		rte_exit(EXIT_FAILURE, "Failed to allocate mbuf array\n");
+	q->q_sz = TEST_Q_SZ;
+	q->virtio_hdr_sz = offsetof(struct virtio_net_hdr, num_buffers) +
+			   sizeof(((struct virtio_net_hdr *)0)->num_buffers);
+	for (i = 0; i < TEST_PAT_SZ; i++)
+		pattern[i] = rte_rand();
+
+	if (dao_test_perf_mode(argc, argv))
+		rc = dao_test_run(perf_tests, RTE_DIM(perf_tests));
+	else
+		rc = dao_test_run(tests, RTE_DIM(tests));
+
+	rte_free(q->mbuf_arr);
+	rte_free(q);
+	rte_free(guest_mem);
+	rte_free(pattern);
+	rte_mempool_free(pool);
+exit:
+	rte_eal_cleanup();
+	return rc;
+}
@@ -44,13 +44,6 @@
 #include <dao_pal.h>
 #include <dao_virtio_netdev.h>
 
-#define GET_MBUF_FROM_DATA_ADDR(mbuf, sz)                                                          \
-	((struct rte_mbuf *)((uint8_t *)(mbuf) + sz - RTE_PKTMBUF_HEADROOM -                       \
-			     sizeof(struct rte_mbuf)))
-
-#define GET_VIRTIO_ADDR_FROM_MBUF(mbuf, sz)                                                        \
-	(struct dao_virtio_net_hdr *)rte_pktmbuf_prepend((mbuf), sz)
-
 /* Log type */
 #define RTE_LOGTYPE_VIRTIO_L2FWD_EXTBUF RTE_LOGTYPE_USER1
 
@@ -74,6 +67,12 @@
 
 #define THREAD_INITIALIZED 1
 
+/* Service threads sharing virtio descriptor management */
+#define MAX_SERVICE_THREADS 8
+
+/* Time given to a service thread to quiesce queue pairs handed over to another one */
+#define SERVICE_DRAIN_TIMEOUT_MS 1000
+
 #define APP_INFO(fmt, args...) RTE_LOG(INFO, VIRTIO_L2FWD_EXTBUF, fmt, ##args)
 
 #define APP_INFO_NH(fmt, args...)                                                                  \
@@ -81,10 +80,17 @@
 
 #define APP_ERR(fmt, args...) RTE_LOG(ERR, VIRTIO_L2FWD_EXTBUF, fmt, ##args)
 
+/* Range of virtio queue pairs managed by a service thread */
+struct virtio_shard {
+	uint16_t qp_start;
+	uint16_t nb_qps;
+};
+
 typedef struct {
 	uint64_t netdev_map;
-	uint32_t state;
-	uint16_t netdev_qp_count;
+	/* Devices whose queue pairs are being handed over to another service thread */
+	uint64_t drain_map;
+	struct virtio_shard netdev_shard[DAO_VIRTIO_DEV_MAX];
 } service_t;
 
 typedef struct {
@@ -95,7 +101,9 @@ typedef struct {
 } worker_t;
 
 static worker_t worker;
-static service_t service;
+static service_t services[MAX_SERVICE_THREADS];
+static uint16_t nb_services;
+static uint32_t service_state;
 static uint64_t worker_mask;
 static uint64_t virtio_port_mask;
 static uint64_t eth_port_mask;
@@ -121,6 +129,7 @@ static uint16_t eth_dev_q_count;
 struct thread_context {
 	pthread_t id;
 	uint32_t wrk_id;
+	uint16_t svc_id;
 };
 
 struct thread_context thread_contexts[RTE_MAX_LCORE];
@@ -135,6 +144,8 @@ static int vhdr_sz;
 static int pool_buf_len = RTE_MBUF_DEFAULT_BUF_SIZE;
 
 static struct rte_mempool *pktmbuf_pool;
+/* Mbufs without data room attaching virtio extbufs for ethdev Tx */
+static struct rte_mempool *extbuf_mbuf_pool;
 
 static uint16_t virtio_netdev_dma_vchans[DAO_VIRTIO_DEV_MAX];
 static uint16_t virtio_netdev_reta_sz;
@@ -172,8 +183,8 @@ check_virtio_config(void)
 	uint16_t nb_lcores = 0, nb_dma_devs;
 
 	nb_dma_devs = rte_dma_count_avail();
-	/* Service lcore */
-	nb_lcores += 1;
+	/* Service lcores */
+	nb_lcores += nb_services;
 	/* 1 Worker */
 	nb_lcores += 1;
 
@@ -181,8 +192,8 @@ check_virtio_config(void)
 	wrkr_dma_devs = 2 + (nb_lcores * 2);
 	if (nb_dma_devs < wrkr_dma_devs) {
 		APP_INFO("%u DMA devices not enough, need at least %u for %u lcores,"
-			 " 1 ctrl core, 1 service core\n",
-			 nb_dma_devs, wrkr_dma_devs, nb_lcores - 2);
+			 " 1 ctrl core, %u service cores\n",
+			 nb_dma_devs, wrkr_dma_devs, nb_lcores - nb_services, nb_services);
 		return -1;
 	}
 
@@ -403,7 +414,7 @@ signal_handler(int signum)
 }
 
 static __rte_always_inline uint16_t
-l2_virtio_desc_process(uint64_t netdev_map, uint16_t netdev_qp_count)
+l2_virtio_desc_process(uint64_t netdev_map, struct virtio_shard *netdev_shard)
 {
 	uint16_t dev_id = 0;
 
@@ -413,17 +424,37 @@ l2_virtio_desc_process(uint64_t netdev_map, uint16_t netdev_qp_count)
 			dev_id++;
 			continue;
 		}
-		dao_virtio_net_desc_manage(dev_id, netdev_qp_count);
+		dao_virtio_net_desc_manage_qps(dev_id, netdev_shard[dev_id].qp_start,
+					       netdev_shard[dev_id].nb_qps);
 		netdev_map >>= 1;
 		dev_id++;
 	}
 	return 0;
 }
 
+static __rte_noinline void
+l2_virtio_desc_drain(service_t *svc, uint64_t drain_map)
+{
+	struct virtio_shard *shard;
+	uint16_t dev_id;
+
+	while (drain_map) {
+		dev_id = rte_ctz64(drain_map);
+		drain_map &= ~RTE_BIT64(dev_id);
+
+		/* Complete DMA in flight on this thread before queues move to another thread */
+		shard = &svc->netdev_shard[dev_id];
+		if (!dao_virtio_net_desc_manage_quiesce(dev_id, shard->qp_start, shard->nb_qps))
+			__atomic_fetch_and(&svc->drain_map, ~RTE_BIT64(dev_id), __ATOMIC_RELEASE);
+	}
+}
+
 static void *
 service_main_loop(void *conf)
 {
 	struct thread_context *t = (struct thread_context *)conf;
+	service_t *svc = &services[t->svc_id];
+	uint64_t drain_map;
 	uint32_t lcore_id;
 	pthread_t thread;
 	cpu_set_t cpuset;
@@ -437,7 +468,7 @@ service_main_loop(void *conf)
 
 	dao_pal_thread_init(t->wrk_id);
 
-	while (service.state != THREAD_INITIALIZED)
+	while (service_state != THREAD_INITIALIZED)
 		rte_pause();
 
 	lcore_id = rte_lcore_id();
@@ -452,7 +483,13 @@ service_main_loop(void *conf)
 
 	while (likely(!force_quit)) {
 		/* Process virtio descriptors */
-		l2_virtio_desc_process(service.netdev_map, service.netdev_qp_count);
+		l2_virtio_desc_process(__atomic_load_n(&svc->netdev_map, __ATOMIC_ACQUIRE),
+				       svc->netdev_shard);
+
+		/* Quiesce queues being handed over to another service thread */
+		drain_map = __atomic_load_n(&svc->drain_map, __ATOMIC_ACQUIRE);
+		if (unlikely(drain_map))
+			l2_virtio_desc_drain(svc, drain_map);
 
 		/* Flush and submit DMA ops */
 		dao_dma_flush_submit();
@@ -469,18 +506,40 @@ service_main_loop(void *conf)
 
 #define RX_BURST_MAX 128
 
+/* Return extbuf to library pool once ethdev is done with mbuf attaching it */
+static void
+virtio_extbuf_free_cb(void *addr, void *opaque)
+{
+	dao_virtio_netdev_extbuf_free((uint16_t)(uintptr_t)opaque, &addr, 1);
+}
+
 static __rte_always_inline void
-eth_extbuf_enqueue_inline(uint16_t port, uint16_t queue, struct rte_mbuf **mbufs, uint16_t nb_pkts)
+eth_extbuf_enqueue_inline(uint16_t virtio_devid, uint16_t port, uint16_t queue, void **buffs,
+			  uint16_t nb_pkts)
 {
+	struct rte_mbuf_ext_shared_info *shinfo;
+	struct rte_mbuf *mbufs[nb_pkts];
+	struct dao_virtio_net_hdr *vhdr;
 	int i = 0, nb_sent = 0;
 	uint32_t len = 0;
-	struct dao_virtio_net_hdr *vhdr;
+
+	if (rte_pktmbuf_alloc_bulk(extbuf_mbuf_pool, mbufs, nb_pkts)) {
+		dao_virtio_netdev_extbuf_free(virtio_devid, buffs, nb_pkts);
+		return;
+	}
 
 	for (i = 0; i < nb_pkts; i++) {
-		vhdr = (struct dao_virtio_net_hdr *)mbufs[i];
+		vhdr = (struct dao_virtio_net_hdr *)buffs[i];
 		len = vhdr->desc_data[1];
-		/* Get mbuf address from data address */
-		mbufs[i] = GET_MBUF_FROM_DATA_ADDR(mbufs[i], sizeof(vhdr->desc_data) + vhdr_sz);
+
+		/* Attach extbuf to mbuf, shared info is in mbuf private area */
+		shinfo = rte_mbuf_to_priv(mbufs[i]);
+		shinfo->free_cb = virtio_extbuf_free_cb;
+		shinfo->fcb_opaque = (void *)(uintptr_t)virtio_devid;
+		rte_mbuf_ext_refcnt_set(shinfo, 1);
+		rte_pktmbuf_attach_extbuf(mbufs[i], buffs[i], rte_mempool_virt2iova(buffs[i]),
+					  sizeof(vhdr->desc_data) + pool_buf_len, shinfo);
+		mbufs[i]->data_off = sizeof(vhdr->desc_data) + vhdr_sz;
 		mbufs[i]->data_len = len - vhdr_sz;
 		mbufs[i]->pkt_len = len - vhdr_sz;
 	}
@@ -499,27 +558,30 @@ virtio_extbuf_enqueue_inline(uint16_t virtio_devid, uint16_t virt_q, struct rte_
 	void *buffs[nb_pkts];
 	struct dao_virtio_net_hdr *dhdr;
 
+	if (dao_virtio_netdev_extbuf_alloc(virtio_devid, buffs, nb_pkts)) {
+		rte_pktmbuf_free_bulk(mbufs, nb_pkts);
+		return;
+	}
+
 	for (i = 0; i < nb_pkts; i++) {
-		len = rte_pktmbuf_pkt_len(mbufs[i]) + vhdr_sz;
-		/* Prepend virtio header from data : Note: handled only single segment */
-		dhdr = GET_VIRTIO_ADDR_FROM_MBUF(mbufs[i], sizeof(dhdr->desc_data) + vhdr_sz);
-		if (!dhdr)
-			continue;
-		dhdr->desc_data[1] = len;
-		buffs[i] = (void *)dhdr;
+		/* Copy packet after virtio header : Note: handled only single segment */
+		dhdr = (struct dao_virtio_net_hdr *)buffs[i];
+		len = RTE_MIN(rte_pktmbuf_data_len(mbufs[i]), pool_buf_len - vhdr_sz);
+		rte_memcpy((uint8_t *)buffs[i] + sizeof(dhdr->desc_data) + vhdr_sz,
+			   rte_pktmbuf_mtod(mbufs[i], void *), len);
+		dhdr->desc_data[1] = len + vhdr_sz;
 		dhdr->hdr.flags = 0;
 		dhdr->hdr.gso_type = 0;
 		dhdr->hdr.gso_size = 0;
 		dhdr->hdr.csum_start = 0;
 		dhdr->hdr.csum_offset = 0;
 		dhdr->hdr.num_buffers = 1;
-
-		buffs[i] = (void *)dhdr;
 	}
+	rte_pktmbuf_free_bulk(mbufs, nb_pkts);
 
 	nb_sent = dao_virtio_net_enqueue_burst_ext(virtio_devid, virt_q, buffs, nb_pkts);
 	if (nb_sent != nb_pkts)
-		rte_pktmbuf_free_bulk(&mbufs[nb_sent], nb_pkts - nb_sent);
+		dao_virtio_netdev_extbuf_free(virtio_devid, &buffs[nb_sent], nb_pkts - nb_sent);
 }
 
 static __rte_always_inline uint16_t
@@ -546,7 +608,7 @@ l2fwd_extbuf_process_inline(void)
 		count = dao_virtio_net_dequeue_burst_ext(virtio_devid, virt_q, (void **)mbufs,
 							 RX_BURST_MAX);
 		if (count)
-			eth_extbuf_enqueue_inline(port, queue, mbufs, count);
+			eth_extbuf_enqueue_inline(virtio_devid, port, queue, (void **)mbufs, count);
 
 		count = rte_eth_rx_burst(port, queue, mbufs, RX_BURST_MAX);
 		if (count) {
@@ -646,14 +708,53 @@ rss_table_reset(uint16_t portid)
 }
 
 static void
-clear_lcore_queue_mapping(uint16_t virtio_devid)
+clear_lcore_queue_mapping(uint16_t virtio_devid, bool drain)
 {
+	service_t *svc;
+	uint16_t i;
+
 	/* Clear valid virtio queue map */
 	worker.rx_q_map = 0;
-	service.netdev_map &= ~RTE_BIT64(virtio_devid);
+	for (i = 0; i < nb_services; i++) {
+		svc = &services[i];
+		if (svc->netdev_map & RTE_BIT64(virtio_devid)) {
+			/* Stop managing queues before drain is seen, as done by l2fwd */
+			__atomic_fetch_and(&svc->netdev_map, ~RTE_BIT64(virtio_devid),
+					   __ATOMIC_RELEASE);
+			/* Service thread quiesces the queues it managed before they are remapped */
+			if (drain)
+				__atomic_fetch_or(&svc->drain_map, RTE_BIT64(virtio_devid),
+						  __ATOMIC_RELEASE);
+		}
+		/* Nothing to hand over when device is reset */
+		if (!drain)
+			__atomic_fetch_and(&svc->drain_map, ~RTE_BIT64(virtio_devid),
+					   __ATOMIC_RELEASE);
+	}
 	rte_io_wmb();
 }
 
+static int
+wait_service_queue_drain(uint16_t virtio_devid)
+{
+	uint64_t timeout;
+	uint16_t i;
+
+	timeout = rte_get_timer_cycles() + (rte_get_timer_hz() * SERVICE_DRAIN_TIMEOUT_MS) / 1000;
+	for (i = 0; i < nb_services; i++) {
+		while (__atomic_load_n(&services[i].drain_map, __ATOMIC_ACQUIRE) &
+		       RTE_BIT64(virtio_devid)) {
+			if (rte_get_timer_cycles() > timeout) {
+				APP_ERR("virtio_dev=%d: service thread %u failed to quiesce\n",
+					virtio_devid, i);
+				return -ETIMEDOUT;
+			}
+			rte_pause();
+		}
+	}
+	return 0;
+}
+
 static int
 reconfig_ethdev(uint16_t portid, uint16_t q_count)
 {
@@ -727,7 +828,9 @@ reconfig_ethdev(uint16_t portid, uint16_t q_count)
 static int
 setup_lcore_queue_mapping(uint16_t virtio_devid, uint16_t virt_q_count)
 {
-	uint16_t virt_rx_q, q_id;
+	uint16_t virt_rx_q, q_id, nb_shards, shard, qp_start, nb_qps;
+	service_t *svc;
+	int rc;
 
 	virt_rx_q = virt_q_count / 2;
 
@@ -746,8 +849,25 @@ setup_lcore_queue_mapping(uint16_t virtio_devid, uint16_t virt_q_count)
 		q_id++;
 	}
 
-	service.netdev_map |= RTE_BIT64(virtio_devid);
-	service.netdev_qp_count = virt_q_count / 2;
+	/* Queue pairs can move to another service thread only after their owner quiesced them */
+	rc = wait_service_queue_drain(virtio_devid);
+	if (rc)
+		return rc;
+
+	/* Split virtio queue pairs into contiguous shards, one per service thread */
+	nb_shards = RTE_MIN(nb_services, virt_rx_q);
+	qp_start = 0;
+	for (shard = 0; shard < nb_shards; shard++) {
+		nb_qps = virt_rx_q / nb_shards + (shard < virt_rx_q % nb_shards);
+		svc = &services[shard];
+		svc->netdev_shard[virtio_devid].qp_start = qp_start;
+		svc->netdev_shard[virtio_devid].nb_qps = nb_qps;
+		APP_INFO("virtio_devid %u queue pairs %u-%u on service thread %u\n", virtio_devid,
+			 qp_start, qp_start + nb_qps - 1, shard);
+		/* Add virtio device to service thread */
+		__atomic_fetch_or(&svc->netdev_map, RTE_BIT64(virtio_devid), __ATOMIC_RELEASE);
+		qp_start += nb_qps;
+	}
 	return 0;
 }
 
@@ -906,13 +1026,13 @@ rss_reta_configure(uint16_t virtio_devid, struct virtio_net_ctrl_rss *rss)
 	}
 
 	if (rss == NULL) {
-		clear_lcore_queue_mapping(virtio_devid);
+		clear_lcore_queue_mapping(virtio_devid, true);
 		/* Synchronize RCU */
 		rte_rcu_qsbr_synchronize(qs_v, RTE_QSBR_THRID_INVALID);
 		return 0;
 	}
 
-	clear_lcore_queue_mapping(virtio_devid);
+	clear_lcore_queue_mapping(virtio_devid, true);
 
 	/* Get active virt queue count */
 	virt_q_count = dao_virtio_netdev_queue_count(virtio_devid);
@@ -996,13 +1116,13 @@ mq_configure(uint16_t virtio_devid, bool qmap_set)
 	}
 
 	if (!qmap_set) {
-		clear_lcore_queue_mapping(virtio_devid);
+		clear_lcore_queue_mapping(virtio_devid, true);
 		/* Synchronize RCU */
 		rte_rcu_qsbr_synchronize(qs_v, RTE_QSBR_THRID_INVALID);
 		return 0;
 	}
 
-	clear_lcore_queue_mapping(virtio_devid);
+	clear_lcore_queue_mapping(virtio_devid, true);
 
 	/* Get active virt queue count */
 	virt_q_count = dao_virtio_netdev_queue_count(virtio_devid);
@@ -1063,7 +1183,7 @@ virtio_dev_status_cb(uint16_t virtio_devid, uint8_t status)
 	switch (status) {
 	case VIRTIO_DEV_RESET:
 	case VIRTIO_DEV_NEEDS_RESET:
-		clear_lcore_queue_mapping(virtio_devid);
+		clear_lcore_queue_mapping(virtio_devid, false);
 		reset_ethdev = true;
 		break;
 	case VIRTIO_DEV_DRIVER_OK:
@@ -1123,6 +1243,7 @@ lsc_event_callback(uint16_t port_id, enum rte_eth_event_type type __rte_unused,
 static int
 setup_mempools(void)
 {
+	uint16_t priv_sz;
 	char s[64];
 
 	snprintf(s, sizeof(s), "mbuf_pool_e%d", worker.eth_port_id);
@@ -1136,6 +1257,16 @@ setup_mempools(void)
 
 	APP_INFO("Allocated ethdev mbuf pool for portid=%d:%d\n", worker.eth_port_id,
 		 worker.virtio_devid);
+
+	/* Private area of each mbuf holds shared info of the extbuf it attaches */
+	priv_sz = RTE_ALIGN(sizeof(struct rte_mbuf_ext_shared_info), RTE_MBUF_PRIV_ALIGN);
+	snprintf(s, sizeof(s), "extbuf_mbuf_pool_e%d", worker.eth_port_id);
+	extbuf_mbuf_pool =
+		rte_pktmbuf_pool_create(s, pktmbuf_count, MEMPOOL_CACHE_SIZE, priv_sz, 0, 0);
+	if (extbuf_mbuf_pool == NULL) {
+		APP_ERR("Cannot init extbuf mbuf pool\n");
+		return -1;
+	}
 	return 0;
 }
 
@@ -1254,42 +1385,6 @@ setup_eth_devices(void)
 		 worker.virtio_devid, worker_lcore_id);
 }
 
-static int
-virtio_netdev_extbuf_put(uint16_t devid, void *buffs[], uint16_t nb_buffs)
-{
-	int i = 0;
-	struct rte_mbuf *mbufs[nb_buffs];
-	struct dao_virtio_net_hdr hdr;
-
-	RTE_SET_USED(devid);
-	for (i = 0; i < nb_buffs; i++)
-		mbufs[i] = GET_MBUF_FROM_DATA_ADDR(buffs[i], sizeof(hdr.desc_data) + vhdr_sz);
-
-	rte_pktmbuf_free_bulk(mbufs, nb_buffs);
-	return 0;
-}
-
-static int
-virtio_netdev_extbuf_get(uint16_t devid, void *buffs[], uint16_t nb_buffs)
-{
-	int rv = 0;
-	uint16_t i = 0;
-	struct rte_mbuf *mbufs[nb_buffs];
-	struct dao_virtio_net_hdr hdr;
-
-	RTE_SET_USED(devid);
-	rv = rte_pktmbuf_alloc_bulk(pktmbuf_pool, mbufs, nb_buffs);
-	if (rv) {
-		APP_INFO("rte_pktmbuf_alloc_bulk failed\n");
-		return -1;
-	}
-	for (i = 0; i < nb_buffs; i++)
-		buffs[i] = (void *)(rte_pktmbuf_mtod(mbufs[i], uint8_t *) - sizeof(hdr.desc_data) -
-				    vhdr_sz);
-
-	return 0;
-}
-
 static void
 setup_virtio_devices(void)
 {
@@ -1308,9 +1403,11 @@ setup_virtio_devices(void)
 	memset(&netdev_conf, 0, sizeof(netdev_conf));
 	netdev_conf.auto_free_en = virtio_netdev_autofree;
 	netdev_conf.pem_devid = pem_devid;
-	// netdev_conf.pool = pktmbuf_pool;
-	netdev_conf.flags = DAO_VIRTIO_NETDEV_EXTBUF;
+	/* Virtio Rx and Tx buffers come from library extbuf pool */
+	netdev_conf.flags = DAO_VIRTIO_NETDEV_EXTBUF | DAO_VIRTIO_NETDEV_EXTBUF_POOL;
 	netdev_conf.dataroom_size = pool_buf_len;
+	netdev_conf.nb_extbufs = pktmbuf_count;
+	netdev_conf.extbuf_socket_id = rte_eth_dev_socket_id(portid);
 	netdev_conf.mtu = 0;
 
 	netdev_conf.reta_size = RTE_MAX(VIRTIO_NET_RSS_RETA_SIZE, eth_dev_info.reta_size);
@@ -1350,8 +1447,6 @@ setup_virtio_devices(void)
 	cbs.mac_set = mac_addr_set;
 	cbs.mac_add = mac_addr_add;
 	cbs.mq_configure = mq_configure;
-	cbs.extbuf_get = virtio_netdev_extbuf_get;
-	cbs.extbuf_put = virtio_netdev_extbuf_put;
 	/* Register virtio dev callback register */
 	dao_virtio_netdev_cb_register(&cbs);
 
@@ -1459,7 +1554,7 @@ create_pthread_on_every_lcore(void)
 {
 	int ret = 0;
 	uint32_t lcore = 0;
-	bool service_core = 0;
+	uint16_t svc_id = 0;
 	void *(*func)(void *conf);
 	struct thread_context *t;
 	uint64_t worker_mask_cp = worker_mask;
@@ -1474,8 +1569,9 @@ create_pthread_on_every_lcore(void)
 		t = &thread_contexts[tid];
 		t->wrk_id = lcore;
 		APP_INFO("LCORE In MASK %lu:%u\n", worker_mask_cp, lcore);
-		if (!service_core) {
-			service_core = 1;
+		/* All lcores but the last one are service lcores */
+		if (svc_id < nb_services) {
+			t->svc_id = svc_id++;
 			func = service_main_loop;
 		}
 		ret = pthread_create(&t->id, NULL, func, t);
@@ -1513,8 +1609,12 @@ main(int argc, char **argv)
 	argc -= rc;
 	argv += rc;
 
-	if (__builtin_popcountl(worker_mask) != 2)
-		rte_exit(EXIT_FAILURE, "Invalid lcore parameters expected 2\n");
+	/* One worker and service lcores sharing descriptor management of the device */
+	if (__builtin_popcountl(worker_mask) < 2 ||
+	    __builtin_popcountl(worker_mask) > MAX_SERVICE_THREADS + 1)
+		rte_exit(EXIT_FAILURE, "Invalid lcore parameters expected 2 to %u\n",
+			 MAX_SERVICE_THREADS + 1);
+	nb_services = __builtin_popcountl(worker_mask) - 1;
 
 	conf.nb_virtio_devs = 1;
 	dao_pal_global_init(&conf);
@@ -1606,7 +1706,7 @@ main(int argc, char **argv)
 
 	APP_INFO("\n");
 	/* Change worker state */
-	service.state = THREAD_INITIALIZED;
+	service_state = THREAD_INITIALIZED;
 	worker.state = THREAD_INITIALIZED;
 
 	for (i = 0; i < tid; i++)
@@ -0,0 +1,360 @@
+/* SPDX-License-Identifier: Marvell-MIT
+ * Copyright (c) 2024 Marvell.
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_dmadev.h>
+#include <rte_eal.h>
+#include <rte_malloc.h>
+#include <rte_random.h>
+
+#include "dao_dma.h"
+#include "dao_log.h"
+#include "dao_virtio_netdev.h"
+#include "virtio_dev_priv.h"
+
+#include "spec/virtio_net.h"
+
+#include "virtio_net_priv.h"
+
+#include "dao_test.h"
+
+#define TEST_Q_SZ   256
+#define TEST_BURST  32
+#define TEST_ROUNDS 64
+
+static struct virtio_net_queue *q;
+static struct vring_used *used;
+static struct vring_avail *avail;
+static struct vring_desc *desc;
+
+/* Guest used ring is local memory mapped at its own address, DMA copies are done by CPU */
+static void
+test_ring_reset(void)
+{
+	memset(used, 0xFF, sizeof(*used) + TEST_Q_SZ * sizeof(struct vring_used_elem) + 2);
+	used->idx = 0;
+	q->used_idx = 0;
+}
+
+/* Complete used ring updates of a batch */
+static int
+test_drain(struct dao_dma_vchan_state *mem2dev)
+{
+	dao_dma_flush_submit();
+	dao_dma_check_meta_compl(mem2dev, 1);
+	TEST_ASSERT(mem2dev->head == mem2dev->tail, "DMA ops left in flight");
+	return 0;
+}
+
+/* Mark a batch of heads posted at avail ring offset start as used */
+static int
+test_mark(struct dao_dma_vchan_state *mem2dev, uint16_t start, uint16_t nb, const uint16_t flags)
+{
+	TEST_ASSERT(dao_dma_flush(mem2dev, 3), "Flush failed");
+	mark_deq_compl_split(q, mem2dev, start, nb, flags);
+	return test_drain(mem2dev);
+}
+
+/* In-order driver posts heads in ring order and reads one used entry per batch at its last
+ * used index, carrying id of last buffer of the batch, then skips forward by used index.
+ */
+static int
+test_used_inorder(void)
+{
+	struct dao_dma_vchan_state *mem2dev = dao_dma_lcore_mem2dev_get(0, 0);
+	uint16_t start = 0, last_used = 0, nb, last, id;
+	uint32_t i;
+
+	test_ring_reset();
+	for (i = 0; i < TEST_Q_SZ; i++)
+		q->sd_avail[i] = i;
+
+	/* Enough rounds to wrap the ring and the 16 bit index a few times */
+	for (i = 0; i < TEST_ROUNDS * TEST_Q_SZ / TEST_BURST; i++) {
+		nb = 1 + (rte_rand() % TEST_BURST);
+		if (test_mark(mem2dev, start, nb, 0))
+			return -1;
+
+		last = (start + nb - 1) & (TEST_Q_SZ - 1);
+		id = used->ring[last_used & (TEST_Q_SZ - 1)].id;
+		TEST_ASSERT(id == last, "Round %u used entry at %u id %u expected %u", i,
+			    last_used & (TEST_Q_SZ - 1), id, last);
+		last_used += nb;
+		TEST_ASSERT(used->idx == last_used, "Round %u used idx %u expected %u", i,
+			    used->idx, last_used);
+		start = (start + nb) & (TEST_Q_SZ - 1);
+	}
+	return 0;
+}
+
+/* Without in-order every buffer gets its used entry in used index order */
+static int
+test_used_noinorder(void)
+{
+	struct dao_dma_vchan_state *mem2dev = dao_dma_lcore_mem2dev_get(0, 0);
+	uint16_t start = 0, nb, off, j;
+	uint32_t i;
+
+	test_ring_reset();
+	for (i = 0; i < TEST_ROUNDS * TEST_Q_SZ / TEST_BURST; i++) {
+		nb = 1 + (rte_rand() % TEST_BURST);
+		for (j = 0; j < nb; j++)
+			q->sd_avail[(start + j) & (TEST_Q_SZ - 1)] = rte_rand() % TEST_Q_SZ;
+		if (test_mark(mem2dev, start, nb, VIRTIO_NET_DESC_MANAGE_NOINORDER))
+			return -1;
+
+		for (j = 0; j < nb; j++) {
+			off = (start + j) & (TEST_Q_SZ - 1);
+			TEST_ASSERT(used->ring[off].id == q->sd_avail[off] && !used->ring[off].len,
+				    "Round %u used entry at %u id %u len %u expected id %u", i, off,
+				    used->ring[off].id, used->ring[off].len, q->sd_avail[off]);
+		}
+		start = (start + nb) & (TEST_Q_SZ - 1);
+		TEST_ASSERT(used->idx == q->used_idx && (used->idx & (TEST_Q_SZ - 1)) == start,
+			    "Round %u used idx %u expected %u", i, used->idx, q->used_idx);
+	}
+	return 0;
+}
+
+/* Run descriptor management stages of Host Tx queue till walked chains are published */
+static int
+test_chain_fetch(struct dao_dma_vchan_state *dev2mem)
+{
+	uint32_t rounds = 0;
+
+	while (q->sd_ind_off != q->sd_desc_off) {
+		TEST_ASSERT(fetch_ind_desc(q, dev2mem, VIRTIO_NET_DESC_MANAGE_SPLIT),
+			    "Indirect fetch failed");
+		dao_dma_flush_submit();
+		dao_dma_check_meta_compl(dev2mem, 1);
+		TEST_ASSERT(++rounds < TEST_Q_SZ * 2, "Chains not published after %u rounds",
+			    rounds);
+	}
+	TEST_ASSERT(!q->pend_sd_ind && dev2mem->head == dev2mem->tail, "DMA ops left in flight");
+	return 0;
+}
+
+/* Lay out chains of given lengths in guest descriptor table, in table order or scattered,
+ * with their heads in shadow slots as split descriptor fetch leaves them. Chain of length
+ * 0 loops back to its head.
+ */
+static void
+test_chain_layout(const uint16_t *lens, uint16_t nb_chains, uint16_t *ids, bool scatter)
+{
+	uint16_t i, j, k, t, n = 0, cnt;
+
+	for (i = 0; i < TEST_Q_SZ; i++)
+		ids[i] = i;
+	for (i = TEST_Q_SZ - 1; scatter && i > 0; i--) {
+		j = rte_rand() % (i + 1);
+		t = ids[i];
+		ids[i] = ids[j];
+		ids[j] = t;
+	}
+
+	for (i = 0; i < nb_chains; i++) {
+		cnt = lens[i] ? lens[i] : 3;
+		for (j = 0; j < cnt; j++) {
+			k = ids[n + j];
+			desc[k].addr = ((uint64_t)i << 32) | j;
+			desc[k].len = 1 + (rte_rand() % 2048);
+			desc[k].flags = (j == cnt - 1 && lens[i]) ? 0 : VRING_DESC_F_NEXT;
+			desc[k].next = (j == cnt - 1) ? ids[n] : ids[n + j + 1];
+		}
+		k = ids[n];
+		*DESC_PTR_OFF(q->sd_desc_base, i, 0) = desc[k].addr;
+		*DESC_PTR_OFF(q->sd_desc_base, i, 8) = *(uint64_t *)&desc[k].len;
+		n += cnt;
+	}
+
+	q->sd_desc_off = nb_chains;
+	q->sd_ind_off = 0;
+	q->ind_batch_off = 0;
+}
+
+/* Split descriptor chains are walked into indirect table of their head slot, heads point to
+ * it with indirect flag. Chains longer than table keep their length for dequeue to drop and
+ * looping ones are marked to be dropped.
+ */
+static int
+test_chain_walk(void)
+{
+	struct dao_dma_vchan_state *dev2mem = dao_dma_lcore_dev2mem_get(0, 0);
+	const uint16_t lens[] = {1, 2, 5, 31, 32, 1, 33, 7, 0, 4, 16, 1, 3};
+	uint16_t ids[TEST_Q_SZ], i, j, n, round, flags;
+	uint64_t d, *tbl;
+	uint32_t len;
+
+	for (round = 0; round < 8; round++) {
+		test_chain_layout(lens, RTE_DIM(lens), ids, round & 1);
+		if (test_chain_fetch(dev2mem))
+			return -1;
+
+		for (i = 0, n = 0; i < RTE_DIM(lens); n += lens[i] ? lens[i] : 3, i++) {
+			d = *DESC_PTR_OFF(q->sd_desc_base, i, 8);
+			flags = d >> 32;
+			len = d & (RTE_BIT64(32) - 1);
+			if (lens[i] == 1) {
+				TEST_ASSERT(!(flags & VIRTIO_NET_DESC_F_CHAIN) &&
+						    len == desc[ids[n]].len,
+					    "Round %u head %u without chain changed", round, i);
+				continue;
+			}
+
+			TEST_ASSERT((flags & VRING_DESC_F_INDIRECT) &&
+					    !(flags & VRING_DESC_F_NEXT) &&
+					    (flags & VIRTIO_NET_DESC_F_CHAIN) &&
+					    !(flags & VIRTIO_NET_DESC_F_CHAIN_PEND),
+				    "Round %u head %u flags %x", round, i, flags);
+			if (!lens[i]) {
+				TEST_ASSERT(flags & VIRTIO_NET_DESC_F_DROP,
+					    "Round %u looping chain %u not dropped", round, i);
+				continue;
+			}
+
+			TEST_ASSERT(!(flags & VIRTIO_NET_DESC_F_DROP) &&
+					    len == lens[i] * DESC_ENTRY_SZ,
+				    "Round %u head %u len %u expected %u", round, i, len,
+				    lens[i] * DESC_ENTRY_SZ);
+			tbl = virtio_net_ind_ptr(q, i);
+			for (j = 0; j < RTE_MIN(lens[i], VIRTIO_NET_IND_DESC_MAX - 1); j++)
+				TEST_ASSERT(!memcmp(&tbl[j * 2], &desc[ids[n + j]], DESC_ENTRY_SZ),
+					    "Round %u chain %u entry %u mismatch", round, i, j);
+		}
+	}
+	return 0;
+}
+
+/* Driver kicks only when avail index passes avail_event, which follows avail index known to
+ * device. Avail index is read back once avail_event lands, buffers made available meanwhile
+ * are picked without a kick.
+ */
+static int
+test_avail_event(void)
+{
+	struct dao_dma_vchan_state *dev2mem = dao_dma_lcore_dev2mem_get(0, 0);
+	struct dao_dma_vchan_state *mem2dev = dao_dma_lcore_mem2dev_get(0, 0);
+	uint16_t *avail_event = (uint16_t *)&used->ring[TEST_Q_SZ];
+	uint16_t idx = 0, kick = 0, nb;
+	uint32_t i, j;
+
+	test_ring_reset();
+	q->event_idx = 1;
+	q->avail_idx = 0;
+	q->avail_event = 0;
+	q->sd_avail_idx = 0;
+	*avail_event = 0;
+	for (i = 0; i < TEST_ROUNDS; i++) {
+		/* Driver adds buffers, kicking only on passing avail_event */
+		nb = 1 + (rte_rand() % TEST_BURST);
+		if ((uint16_t)(idx + nb - *avail_event - 1) < nb)
+			kick = idx + nb;
+		idx += nb;
+		avail->idx = idx;
+
+		/* Device sees the last kick and then whatever is read back, a write and a read
+		 * back catch up with all buffers.
+		 */
+		for (j = 0;; j++) {
+			q->avail_idx = kick;
+			if ((int16_t)(q->sd_avail_idx - q->avail_idx) > 0)
+				q->avail_idx = q->sd_avail_idx;
+			if (q->avail_idx == idx && !q->avail_event_chk)
+				break;
+			TEST_ASSERT(j < 4, "Round %u avail index %u stuck at %u", i, idx,
+				    q->avail_idx);
+			virtio_net_avail_event_update(q, dev2mem, mem2dev);
+			dao_dma_flush_submit();
+			dao_dma_check_meta_compl(mem2dev, 1);
+			dao_dma_check_meta_compl(dev2mem, 1);
+		}
+		TEST_ASSERT(*avail_event == q->avail_event, "Round %u avail_event %u expected %u",
+			    i, *avail_event, q->avail_event);
+	}
+	q->event_idx = 0;
+	return 0;
+}
+
+static const struct dao_test_case tests[] = {
+	{"used_inorder", test_used_inorder},
+	{"used_noinorder", test_used_noinorder},
+	{"chain_walk", test_chain_walk},
+	{"avail_event", test_avail_event},
+};
+
+int
+main(int argc, char *argv[])
+{
+	uintptr_t split_base;
+	int16_t dma_devid;
+	int rc;
+
+	rc = rte_eal_init(argc, argv);
+	if (rc < 0)
+		rte_exit(EXIT_FAILURE, "Error with EAL initialization\n");
+
+	if (!dao_dma_has_sw_backend()) {
+		printf("DMA software backend not enabled at build, skipping\n");
+		rc = TEST_SKIPPED;
+		goto exit;
+	}
+
+	/* Device only anchors vchan state, copies are done by CPU */
+	dma_devid = rte_dma_next_dev(0);
+	if (dma_devid < 0) {
+		printf("No DMA device, e.g. --vdev=dma_skeleton, skipping\n");
+		rc = TEST_SKIPPED;
+		goto exit;
+	}
+
+	rc = dao_dma_lcore_dev2mem_set(dma_devid, 1, 0);
+	rc |= dao_dma_lcore_mem2dev_set(dma_devid, 1, 0);
+	if (rc)
+		rte_exit(EXIT_FAILURE, "Failed to assign DMA vchans to lcore\n");
+
+	/* Shadow descriptors followed by shadow avail ring, used index slots, used ring and
+	 * indirect tables as laid out by queue setup.
+	 */
+	q = rte_zmalloc("virtio_split_q",
+			sizeof(*q) + TEST_Q_SZ * DESC_ENTRY_SZ + TEST_Q_SZ * 2 * 2 +
+				TEST_Q_SZ * 8 + TEST_Q_SZ * VIRTIO_NET_IND_DESC_MAX * DESC_ENTRY_SZ,
+			RTE_CACHE_LINE_SIZE);
+	/* Guest used ring with avail_event, avail ring and descriptor table */
+	used = rte_zmalloc("virtio_split_used",
+			   sizeof(*used) + TEST_Q_SZ * sizeof(struct vring_used_elem) + 2,
+			   RTE_CACHE_LINE_SIZE);
+	avail = rte_zmalloc("virtio_split_avail", sizeof(*avail) + TEST_Q_SZ * 2 + 2,
+			    RTE_CACHE_LINE_SIZE);
+	desc = rte_zmalloc("virtio_split_desc", TEST_Q_SZ * sizeof(*desc), RTE_CACHE_LINE_SIZE);
+	if (!q || !used || !avail || !desc)
+		rte_exit(EXIT_FAILURE, "Failed to allocate test memory\n");
+
+	split_base = (uintptr_t)q->sd_desc_base + TEST_Q_SZ * DESC_ENTRY_SZ;
+	q->sd_avail = (uint16_t *)split_base;
+	split_base += TEST_Q_SZ * 2;
+	q->sd_used_idx = (uint16_t *)split_base;
+	split_base += TEST_Q_SZ * 2;
+	q->sd_used = (uint64_t *)split_base;
+	split_base += TEST_Q_SZ * 8;
+	q->sd_ind_base = (uint64_t *)split_base;
+	q->device_area = (uintptr_t)rte_malloc_virt2iova(used);
+	q->driver_area = (uintptr_t)rte_malloc_virt2iova(avail);
+	q->desc_base = (uintptr_t)rte_malloc_virt2iova(desc);
+	q->q_sz = TEST_Q_SZ;
+
+	rc = dao_test_run(tests, RTE_DIM(tests));
+
+	rte_free(desc);
+	rte_free(avail);
+	rte_free(used);
+	rte_free(q);
+exit:
+	rte_eal_cleanup();
+	return rc;
+}